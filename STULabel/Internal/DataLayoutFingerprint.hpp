@@ -0,0 +1,58 @@
+// Copyright 2018 Stephan Tolksdorf
+
+#import "Hash.hpp"
+
+#import <dlfcn.h>
+#import <mach-o/loader.h>
+
+// Serialized shaped strings and text frame snapshots store internal structs in their in-memory
+// representation. The data is only valid for the build of the library that created it, which is
+// checked with a fingerprint combining a compile-time hash of the struct layouts with the build ID
+// of the library binary.
+
+namespace stu_label {
+
+/// Combines the specified compile-time layout values, e.g. struct sizes and field offsets, into a
+/// hash value.
+template <typename... Values>
+[[nodiscard]] STU_CONSTEXPR
+UInt64 layoutHash(Values... values) {
+  UInt64 h = 0;
+  ((h = hash(h, static_cast<UInt64>(values)).value), ...);
+  return h;
+}
+
+/// Returns a hash of the LC_UUID of the Mach-O image containing this library, or 0 if the image
+/// has no LC_UUID load command. The linker generates a new UUID for every build.
+STU_INLINE
+UInt64 libraryBuildID() {
+  static const UInt64 buildID = []() -> UInt64 {
+    Dl_info info;
+    if (!dladdr(reinterpret_cast<const void*>(&libraryBuildID), &info) || !info.dli_fbase) {
+      return 0;
+    }
+    const auto* const header = static_cast<const mach_header*>(info.dli_fbase);
+    const Byte* p = reinterpret_cast<const Byte*>(header)
+                  + (header->magic == MH_MAGIC_64 ? sizeof(mach_header_64) : sizeof(mach_header));
+    for (UInt32 i = 0; i < header->ncmds; ++i) {
+      const auto* const command = reinterpret_cast<const load_command*>(p);
+      if (command->cmd == LC_UUID) {
+        UInt64 words[2];
+        static_assert(sizeof(words) == sizeof(uuid_command::uuid));
+        memcpy(words, reinterpret_cast<const uuid_command*>(command)->uuid, sizeof(words));
+        return hash(words[0], words[1]).value;
+      }
+      p += command->cmdsize;
+    }
+    return 0;
+  }();
+  return buildID;
+}
+
+/// Returns the fingerprint that serialized data created by this build of the library must have.
+STU_INLINE
+UInt64 dataLayoutFingerprint(UInt64 layoutHash) {
+  return hash(layoutHash, libraryBuildID()).value;
+}
+
+} // namespace stu_label
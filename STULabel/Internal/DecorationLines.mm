@@ -132,6 +132,26 @@ static void findXBoundsOfIntersectionsOfGlyphsWithHorizontalLine(
   const bool hasNonIdentityMatrix = span.run().status() & kCTRunStatusHasNonIdentityMatrix;
   const FontFaceGlyphBoundsCache::Ref boundsCache = localGlyphBoundsCache.glyphBoundsCache(font);
   const GlyphsWithPositions gwp = span.getGlyphsWithPositions();
+  // The intersection bounds of glyphs in runs with an identity text matrix are cached per
+  // font face, glyph, font size and (quantized) line position relative to the glyph origin.
+  // The cached bounds are stored in em units.
+  const CGFloat fontSize = boundsCache.fontSize;
+  const bool useIntersectionCache = !hasNonIdentityMatrix && fontSize > 0;
+
+  const auto calculateIntersections = [&](CGGlyph g, const CGAffineTransform* matrix,
+                                          Range<CGFloat> lowerY, Range<CGFloat> upperY)
+                                        STU_INLINE_LAMBDA -> LowerAndUpperInterval
+  {
+    const CGPathRef path = CTFontCreatePathForGlyph(font, g, matrix);
+    if (!path) return {Range<CGFloat>::infinitelyEmpty(), Range<CGFloat>::infinitelyEmpty()};
+    const LowerAndUpperInterval xis = findXBoundsOfPathIntersectionWithHorizontalLines(
+                                        path,
+                                        Range<CGFloat>{lowerY.start - 0.25f, lowerY.end + 0.25f},
+                                        Range<CGFloat>{upperY.start - 0.25f, upperY.end + 0.25f},
+                                        0.25f);
+    CFRelease(path);
+    return xis;
+  };
 
   const auto dilateAndRoundGap = [&](Range<CGFloat> xi) STU_INLINE_LAMBDA -> Range<CGFloat> {
     CGFloat start = xi.start - dilation;
@@ -156,23 +176,47 @@ static void findXBoundsOfIntersectionsOfGlyphsWithHorizontalLine(
       bounds = CGRectApplyAffineTransform(bounds, textMatrix);
     }
     if (!bounds.y.overlaps(Range{minY, maxY})) continue;
-    CGAffineTransform matrix = textMatrix;
-    matrix.tx = position.x;
-    matrix.ty = position.y;
-    const CGPathRef path = CTFontCreatePathForGlyph(font, gwp.glyphs()[i], &matrix);
-    if (!path) continue;
-    const LowerAndUpperInterval xis = findXBoundsOfPathIntersectionWithHorizontalLines(
-                                        path,
-                                        Range<CGFloat>{minY - 0.25f, lowerStripeMaxY + 0.25f},
-                                        Range<CGFloat>{upperStripeMinY - 0.25f, maxY + 0.25f},
-                                        0.25f);
+    const CGGlyph glyph = gwp.glyphs()[i];
+    LowerAndUpperInterval xis;
+    Optional<UInt64> key;
+    if (useIntersectionCache) {
+      key = FontFaceGlyphBoundsCache::lineIntersectionKey(glyph, fontSize,
+                                                          Range{minY, maxY} - position.y,
+                                                          !!upperStripeBuffer);
+    }
+    if (key) {
+      xis = boundsCache.cache.lineIntersectionXBounds(*key, [&]() -> LowerAndUpperInterval {
+        // Calculate the bounds for the quantized line position with the glyph at the origin.
+        const Range<CGFloat> lineY = FontFaceGlyphBoundsCache::lineIntersectionKeyLineY(*key,
+                                                                                       fontSize);
+        Range<CGFloat> lowerY = lineY;
+        Range<CGFloat> upperY = lineY;
+        if (upperStripeBuffer) {
+          const CGFloat h = lineY.diameter()/3;
+          lowerY.end = lineY.start + h;
+          upperY.start = lineY.end - h;
+        }
+        LowerAndUpperInterval r = calculateIntersections(glyph, nullptr, lowerY, upperY);
+        const CGFloat emPerPoint = 1/fontSize;
+        r.lower *= emPerPoint;
+        r.upper *= emPerPoint;
+        return r;
+      });
+      xis.lower = xis.lower*fontSize + position.x;
+      xis.upper = xis.upper*fontSize + position.x;
+    } else {
+      CGAffineTransform matrix = textMatrix;
+      matrix.tx = position.x;
+      matrix.ty = position.y;
+      xis = calculateIntersections(glyph, &matrix, Range{minY, lowerStripeMaxY},
+                                   Range{upperStripeMinY, maxY});
+    }
     if (xis.lower.start <= xis.lower.end) {
       buffer.add(dilateAndRoundGap(xis.lower));
     }
     if (upperStripeBuffer && xis.upper.start <= xis.upper.end) {
       upperStripeBuffer->add(dilateAndRoundGap(xis.upper));
     }
-    CFRelease(path);
   }
 }
 
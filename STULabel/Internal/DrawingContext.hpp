@@ -54,7 +54,7 @@ public:
   LocalGlyphBoundsCache& glyphBoundsCache() {
     if (STU_UNLIKELY(!glyphBoundsCache_)) {
       initializeGlyphBoundsCache();
-      glyphBoundsCache_.assumeNotNone();
+      STU_ASSUME(glyphBoundsCache_ != nullptr);
     }
     return *glyphBoundsCache_;
   }
@@ -72,6 +72,13 @@ public:
     CGContextSetStrokeColorWithColor(cgContext_, cgColor(index));
   }
 
+  /// The number of CTFontDrawGlyphs, CTRunDraw and CTLineDraw calls made through this context.
+  STU_INLINE_T
+  UInt32 glyphDrawCallCount() const { return glyphDrawCallCount_; }
+
+  STU_INLINE_T
+  void incrementGlyphDrawCallCount() { ++glyphDrawCallCount_; }
+
   void currentCGContextColorsMayHaveChanged() {
     colorIndices_ = reservedColorIndices;
   }
@@ -296,6 +303,7 @@ private:
   TextFlags effectiveLineFlags_;
   UInt16 colorCounts_[2]; // {ColorIndex::fixedColorCount, textFrameColorCount}
   UInt32 shadowOnlyScopeCount_{};
+  UInt32 glyphDrawCallCount_{};
   ColorIndices colorIndices_{reservedColorIndices};
   /// Indexed by TextStyle::IsOverrideIsLinkIndex
   Optional<ColorIndex> overrideTextColorIndices_[4];
@@ -312,7 +320,9 @@ private:
   const ColorRef* __nullable const colorArrays_[2]; // {otherColors_, textFrameColors}
   ColorRef otherColors_[ColorIndex::fixedColorCount];
   LocalFontInfoCache fontInfoCache_;
-  Optional<LocalGlyphBoundsCache> glyphBoundsCache_;
+  /// Points to ownGlyphBoundsCache_ or to the ThreadLocalFontCache's glyph bounds cache.
+  LocalGlyphBoundsCache* glyphBoundsCache_{};
+  Optional<LocalGlyphBoundsCache> ownGlyphBoundsCache_;
 };
 
 } // namespace stu_label
@@ -44,7 +44,11 @@ void DrawingContext::initializeGlyphBoundsCache() {
   STU_APPEARS_UNUSED
   const bool isNotInitialized = !glyphBoundsCache_;
   STU_ASSUME(isNotInitialized);
-  glyphBoundsCache_.emplace();
+  if (ThreadLocalFontCache* const cache = ThreadLocalFontCache::instance()) {
+    glyphBoundsCache_ = &cache->glyphBoundsCache();
+  } else {
+    glyphBoundsCache_ = &ownGlyphBoundsCache_.emplace();
+  }
 }
 
 } // namespace stu_label
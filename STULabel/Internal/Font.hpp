@@ -1,9 +1,12 @@
 // Copyright 2017–2018 Stephan Tolksdorf
 
 #import "DisplayScaleRounding.hpp"
+#import "GlyphPathIntersectionBounds.hpp"
 #import "HashTable.hpp"
 #import "Rect.hpp"
+#import "ThreadLocalAllocator.hpp"
 
+#import "stu/FunctionRef.hpp"
 #import "stu/UniquePtr.hpp"
 
 #include "DefineUIntOnCatalystToWorkAroundGlobalNamespacePollution.h"
@@ -224,11 +227,14 @@ public:
     index = counter_%4;
     counter_ += 1;
     fonts_[index] = font;
-    infos_[index] = CachedFontInfo::get(font);
+    infos_[index] = lookUpFontInfo(font);
     return infos_[index];
   }
 
 private:
+  /// Uses the `ThreadLocalFontCache` if the current thread has one, otherwise the global cache.
+  static CachedFontInfo lookUpFontInfo(CTFont* __nonnull font);
+
   CTFont* fonts_[4] = {};
     UInt counter_{};
   CachedFontInfo infos_[4] = {uninitialized, uninitialized, uninitialized, uninitialized};
@@ -348,6 +354,45 @@ public:
   Rect<CGFloat> boundingRect(CGFloat fontSize, ArrayRef<const CGGlyph> glyphs,
                              const CGPoint* positions);
 
+  /// Returns a key for `lineIntersectionXBounds`, or `none` if the arguments can't be represented
+  /// by a key.
+  ///
+  /// The line position is quantized to multiples of 1/1024 em, rounding outwards.
+  ///
+  /// @param lineY The y-bounds of the horizontal line relative to the glyph origin.
+  static Optional<UInt64> lineIntersectionKey(CGGlyph glyph, CGFloat fontSize,
+                                              Range<CGFloat> lineY, bool hasUpperStripe);
+
+  /// Returns the quantized y-bounds of the horizontal line represented by the key.
+  static Range<CGFloat> lineIntersectionKeyLineY(UInt64 key, CGFloat fontSize);
+
+  /// Returns the cached x-bounds of the intersection of a glyph outline with a horizontal line
+  /// (see `findXBoundsOfPathIntersectionWithHorizontalLines`) or calls `calculate` and caches its
+  /// result.
+  ///
+  /// The cached values are shared between all font sizes that map to the same key and hence should
+  /// be specified in em units relative to the glyph origin.
+  ///
+  /// @param key A key returned by `lineIntersectionKey`.
+  LowerAndUpperInterval lineIntersectionXBounds(UInt64 key,
+                                                FunctionRef<LowerAndUpperInterval()> calculate);
+
+  struct CacheStats {
+    Int64 hitCount;
+    Int64 missCount;
+
+    Float64 hitRate() const {
+      const Int64 n = hitCount + missCount;
+      return n == 0 ? 0 : static_cast<Float64>(hitCount)/static_cast<Float64>(n);
+    }
+  };
+
+  /// Returns the accumulated hit and miss counts of the line intersection caches.
+  /// Only includes the counts of caches that have since been returned to the global pool.
+  ///
+  /// Thread-safe.
+  static CacheStats lineIntersectionCacheStats();
+
   /// For testing purposes.
   bool usesIntBounds() const { return usesIntBounds_; }
 
@@ -384,6 +429,24 @@ private:
     }
   };
 
+  struct LineIntersectionKeyHasher {
+    STU_INLINE static HashCode<UInt64> hash(UInt64 key) {
+      return stu_label::hash(key);
+    }
+  };
+
+  /// Plain fields instead of `Range<Float32>` members, so that the struct is trivially
+  /// constructible (as required by HashTable).
+  struct LineIntersectionXBounds {
+    Float32 lowerStart;
+    Float32 lowerEnd;
+    Float32 upperStart;
+    Float32 upperEnd;
+  };
+
+  /// @pre glyphBoundsCacheMutex must be locked by the current thread.
+  void addLineIntersectionCacheCountsToGlobalStats();
+
   struct InitData {
     Pool& pool;
     FontRef font;
@@ -422,6 +485,12 @@ private:
     HashTable<CGGlyph, Rect<Float32>, Malloc, GlyphHasher> floatBoundsByGlyphIndex_;
     Int uninitialized_{};
   };
+
+  /// Lazily initialized.
+  HashTable<UInt64, LineIntersectionXBounds, Malloc, LineIntersectionKeyHasher>
+    lineIntersectionXBoundsByKey_{uninitialized};
+  Int lineIntersectionCacheHitCount_{};
+  Int lineIntersectionCacheMissCount_{};
 };
 
 class LocalGlyphBoundsCache {
@@ -459,6 +528,64 @@ private:
 
   Entry entries_[entryCount] = {};
   FontFaceGlyphBoundsCache* caches_[entryCount] = {};
+
+  friend class ThreadLocalFontCache;
+
+  /// Forgets the (unretained) font pointers but keeps the font face glyph bounds caches.
+  void clearFontEntries() {
+    for (auto& entry : entries_) {
+      entry = Entry{};
+    }
+  }
+};
+
+/// A font info and glyph bounds cache that a worker thread can keep alive while it processes a
+/// batch of independent layout and rendering tasks (see `LabelPrerenderer::renderBatch`).
+///
+/// While an instance exists on the current thread, `LocalFontInfoCache` misses are first looked up
+/// in this cache (which avoids locking the global font info cache) and code that would otherwise
+/// construct a temporary `LocalGlyphBoundsCache` uses the cache returned by `glyphBoundsCache()`
+/// (which avoids returning the font face glyph bounds caches to the global pool after every task).
+class ThreadLocalFontCache {
+#if STU_HAS_THREAD_LOCAL
+  static thread_local ThreadLocalFontCache* instance_pointer;
+#else
+  static const pthread_key_t instance_key;
+#endif
+public:
+  STU_INLINE_T
+  static ThreadLocalFontCache* __nullable instance() {
+  #if STU_HAS_THREAD_LOCAL
+    return instance_pointer;
+  #else
+    return static_cast<ThreadLocalFontCache*>(pthread_getspecific(instance_key));
+  #endif
+  }
+
+  ThreadLocalFontCache();
+  ~ThreadLocalFontCache();
+
+  ThreadLocalFontCache(const ThreadLocalFontCache&) = delete;
+  ThreadLocalFontCache& operator=(const ThreadLocalFontCache&) = delete;
+
+  CachedFontInfo fontInfo(CTFont* __nonnull font);
+
+  LocalGlyphBoundsCache& glyphBoundsCache() { return glyphBoundsCache_; }
+
+  /// Must be called after each task, because the `LocalGlyphBoundsCache` only stores unretained
+  /// font pointers, which may be reused for different fonts by subsequent tasks.
+  void taskDidFinish() {
+    glyphBoundsCache_.clearFontEntries();
+  }
+
+private:
+  static constexpr Int entryCount = 8;
+
+  /// In LRU order.
+  RC<CTFont> fonts_[entryCount];
+  CachedFontInfo infos_[entryCount] = {uninitialized, uninitialized, uninitialized, uninitialized,
+                                       uninitialized, uninitialized, uninitialized, uninitialized};
+  LocalGlyphBoundsCache glyphBoundsCache_;
 };
 
 } // namespace stu_label
@@ -211,6 +211,72 @@ CachedFontInfo CachedFontInfo::get(FontRef font) {
   return info;
 };
 
+CachedFontInfo LocalFontInfoCache::lookUpFontInfo(CTFont* __nonnull font) {
+  if (ThreadLocalFontCache* const cache = ThreadLocalFontCache::instance()) {
+    return cache->fontInfo(font);
+  }
+  return CachedFontInfo::get(font);
+}
+
+#if STU_HAS_THREAD_LOCAL
+
+thread_local ThreadLocalFontCache* ThreadLocalFontCache::instance_pointer;
+
+#else
+
+static pthread_key_t createThreadLocalFontCachePThreadKey() {
+  pthread_key_t key;
+  const int rc = pthread_key_create(&key, nullptr);
+  STU_CHECK(rc == 0);
+  return key;
+}
+
+const pthread_key_t ThreadLocalFontCache::instance_key = createThreadLocalFontCachePThreadKey();
+
+#endif
+
+ThreadLocalFontCache::ThreadLocalFontCache() {
+  STU_ASSERT(ThreadLocalFontCache::instance() == nullptr);
+#if STU_HAS_THREAD_LOCAL
+  ThreadLocalFontCache::instance_pointer = this;
+#else
+  pthread_setspecific(instance_key, this);
+#endif
+}
+
+ThreadLocalFontCache::~ThreadLocalFontCache() {
+#if STU_HAS_THREAD_LOCAL
+  ThreadLocalFontCache::instance_pointer = nullptr;
+#else
+  pthread_setspecific(instance_key, nullptr);
+#endif
+}
+
+CachedFontInfo ThreadLocalFontCache::fontInfo(CTFont* __nonnull font) {
+  // The fonts are retained, so comparing pointers is safe across tasks.
+  Int i = 0;
+  for (; i < entryCount; ++i) {
+    if (fonts_[i].get() == font) break;
+  }
+  if (i == entryCount) {
+    i = entryCount - 1;
+    fonts_[i] = font;
+    infos_[i] = CachedFontInfo::get(font);
+  }
+  if (i != 0) {
+    // Move the entry to the front.
+    RC<CTFont> f = std::move(fonts_[i]);
+    const CachedFontInfo info = infos_[i];
+    for (; i > 0; --i) {
+      fonts_[i] = std::move(fonts_[i - 1]);
+      infos_[i] = infos_[i - 1];
+    }
+    fonts_[0] = std::move(f);
+    infos_[0] = info;
+  }
+  return infos_[0];
+}
+
 struct FontFaceGlyphBoundsCache::Pool {
   FontFace fontFace;
   RC<CTFont> ctFont;
@@ -237,6 +303,8 @@ public:
 
 stu_mutex glyphBoundsCacheMutex = STU_MUTEX_INIT;
 bool glyphBoundsCacheIsInitialized = false;
+// Guarded by glyphBoundsCacheMutex.
+FontFaceGlyphBoundsCache::CacheStats lineIntersectionCacheStats = {};
 alignas(GlyphBoundsCache)
 Byte glyphBoundsCacheStorage[sizeof(GlyphBoundsCache)];
 // To inspect the glyph bounds cache in the debugger add the following watch expression:
@@ -294,6 +362,7 @@ void FontFaceGlyphBoundsCache::exchange(InOut<UniquePtr> inOutArg, FontRef font,
   }
   GlyphBoundsCache& glyphBoundsCache = reinterpret_cast<GlyphBoundsCache&>(glyphBoundsCacheStorage);
   if (inOutCache) { // Return the cache to its pool.
+    inOutCache->addLineIntersectionCacheCountsToGlobalStats();
     inOutCache->pool_.unusedCaches.append(Malloced{std::move(inOutCache).toRawPointer()});
   }
   const auto isEqualFontFace = [&](const Malloced<Pool>& entry) {
@@ -325,6 +394,7 @@ void FontFaceGlyphBoundsCache::exchange(InOut<UniquePtr> inOutArg, FontRef font,
 
 void FontFaceGlyphBoundsCache::returnToGlobalPool(FontFaceGlyphBoundsCache* __nonnull cache) noexcept {
   stu_mutex_lock(&glyphBoundsCacheMutex);
+  cache->addLineIntersectionCacheCountsToGlobalStats();
   cache->pool_.unusedCaches.append(Malloced{cache});
   stu_mutex_unlock(&glyphBoundsCacheMutex);
 }
@@ -336,12 +406,81 @@ void FontFaceGlyphBoundsCache
   stu_mutex_lock(&glyphBoundsCacheMutex);
   for (const auto cache : caches) {
     if (cache) {
+      cache->addLineIntersectionCacheCountsToGlobalStats();
       cache->pool_.unusedCaches.append(Malloced{cache});
     }
   }
   stu_mutex_unlock(&glyphBoundsCacheMutex);
 }
 
+void FontFaceGlyphBoundsCache::addLineIntersectionCacheCountsToGlobalStats() {
+  lineIntersectionCacheStats.hitCount += lineIntersectionCacheHitCount_;
+  lineIntersectionCacheStats.missCount += lineIntersectionCacheMissCount_;
+  lineIntersectionCacheHitCount_ = 0;
+  lineIntersectionCacheMissCount_ = 0;
+}
+
+auto FontFaceGlyphBoundsCache::lineIntersectionCacheStats() -> CacheStats {
+  stu_mutex_lock(&glyphBoundsCacheMutex);
+  const CacheStats stats = stu_label::lineIntersectionCacheStats;
+  stu_mutex_unlock(&glyphBoundsCacheMutex);
+  return stats;
+}
+
+static constexpr CGFloat lineIntersectionKeyUnitsPerEM = 1024;
+
+Optional<UInt64> FontFaceGlyphBoundsCache::lineIntersectionKey(CGGlyph glyph, CGFloat fontSize,
+                                                               Range<CGFloat> lineY,
+                                                               bool hasUpperStripe)
+{
+  // Key layout: | hasUpperStripe: 1 | 4*fontSize: 15 | lineY.end: 16 | lineY.start: 16 | glyph: 16 |
+  const CGFloat scaledFontSize = nearbyint(4*fontSize);
+  if (!(0 < scaledFontSize && scaledFontSize < (1 << 15)) || glyph == maxValue<CGGlyph>) {
+    return none;
+  }
+  const CGFloat unitsPerPoint = lineIntersectionKeyUnitsPerEM/fontSize;
+  const CGFloat y0 = floor(lineY.start*unitsPerPoint);
+  const CGFloat y1 = ceil(lineY.end*unitsPerPoint);
+  if (!(minValue<Int16> <= y0 && y1 <= maxValue<Int16>)) return none;
+  return UInt64{glyph}
+       | (UInt64{static_cast<UInt16>(static_cast<Int16>(y0))} << 16)
+       | (UInt64{static_cast<UInt16>(static_cast<Int16>(y1))} << 32)
+       | (static_cast<UInt64>(scaledFontSize) << 48)
+       | (UInt64{hasUpperStripe} << 63);
+}
+
+Range<CGFloat> FontFaceGlyphBoundsCache::lineIntersectionKeyLineY(UInt64 key, CGFloat fontSize) {
+  const CGFloat pointsPerUnit = fontSize/lineIntersectionKeyUnitsPerEM;
+  return {static_cast<Int16>(static_cast<UInt16>(key >> 16))*pointsPerUnit,
+          static_cast<Int16>(static_cast<UInt16>(key >> 32))*pointsPerUnit};
+}
+
+LowerAndUpperInterval FontFaceGlyphBoundsCache::lineIntersectionXBounds(
+                        UInt64 key, FunctionRef<LowerAndUpperInterval()> calculate)
+{
+  if (STU_UNLIKELY(lineIntersectionXBoundsByKey_.buckets().isEmpty())) {
+    lineIntersectionXBoundsByKey_.initializeWithBucketCount(16);
+  }
+  if (const auto bounds = lineIntersectionXBoundsByKey_.find(key, isEqualTo(key))) {
+    lineIntersectionCacheHitCount_ += 1;
+    return {Range<CGFloat>{bounds->lowerStart, bounds->lowerEnd},
+            Range<CGFloat>{bounds->upperStart, bounds->upperEnd}};
+  }
+  lineIntersectionCacheMissCount_ += 1;
+  const LowerAndUpperInterval xis = calculate();
+  // The number of distinct keys for a font face is usually small, but we don't want the table to
+  // grow without bounds for text with e.g. many different font sizes.
+  if (lineIntersectionXBoundsByKey_.count() >= 2048) {
+    lineIntersectionXBoundsByKey_.removeAll();
+  }
+  lineIntersectionXBoundsByKey_.insertNew(key, LineIntersectionXBounds{
+                                                 narrow_cast<Float32>(xis.lower.start),
+                                                 narrow_cast<Float32>(xis.lower.end),
+                                                 narrow_cast<Float32>(xis.upper.start),
+                                                 narrow_cast<Float32>(xis.upper.end)});
+  return xis;
+}
+
 // NOTE: We use the following details of the transformation that Core Text applies to the emoji font
 // glyph bounds only for transforming the bounds back into 16-bit integer coordinates (in order to
 // save memory without loosing accuracy). Should these details change in the future,
@@ -59,6 +59,10 @@ struct HyphenLine {
   Int8 glyphIndex;
 };
 
+/// The caller owns a reference to the returned line. Recently created hyphen lines are kept in a
+/// small process-wide cache that is shared by all text frames.
+///
+/// Thread-safe.
 HyphenLine createHyphenLine(const NSAttributedStringRef& originalAttributedString,
                             GlyphRunRef trailingRun, Char32 hyphen);
 
@@ -2,6 +2,8 @@
 
 #import "Kerning.hpp"
 
+#import "STULabel/stu_mutex.h"
+
 #import "Once.hpp"
 
 namespace stu_label {
@@ -262,16 +264,14 @@ Optional<Float64> kerningAdjustment(const GlyphForKerningPurposes& glyph0,
 
 static CFStringRef const hyphenCodePointString = (__bridge CFStringRef)@"\u2010";
 
-HyphenLine createHyphenLine(const NSAttributedStringRef& originalAttributedString,
-                            GlyphRunRef trailingRun, Char32 hyphen)
+static HyphenLine createUncachedHyphenLine(const NSAttributedStringRef& originalAttributedString,
+                                           const GlyphForKerningPurposes& tg, Char32 hyphen)
 {
   UTF16Char hyphenChars[2];
   const Int hyphenCharsCount = CFStringGetSurrogatePairForLongCharacter(hyphen, hyphenChars)
                              ? 2 : 1;
 
   const NSStringRef& string = originalAttributedString.string;
-  const auto tg = GlyphForKerningPurposes::find(trailingRun, originalAttributedString,
-                                                lastGlyphInStringOrder);
 
   HyphenLine result;
   if (!tg.glyph) {
@@ -404,5 +404,160 @@ HyphenLine createHyphenLine(const NSAttributedStringRef& originalAttributedStrin
   return result;
 }
 
+namespace {
+
+/// A small most-recently-used cache of hyphen lines. The hyphen line only depends on the
+/// attributes, font, glyph and string of the trailing glyph, which repeat often for the same
+/// hyphenated syllables, e.g. when the same text is laid out in many text frames.
+struct HyphenLineCache {
+  static constexpr Int capacity = 32;
+  static constexpr Int maxGlyphStringLength = 4;
+
+  struct Key {
+    NSDictionary<NSAttributedStringKey, id>* attributes;
+    RC<CTFont> font;
+    Float64 trailingGlyphWidth;
+    Char32 hyphen;
+    CGGlyph trailingGlyph;
+    bool hasTrailingGlyph;
+    bool isRightToLeftRun;
+    bool hasDelegate;
+    Int8 glyphStringLength;
+    Char16 glyphString[maxGlyphStringLength];
+
+    bool operator==(const Key& other) const {
+      return hyphen == other.hyphen
+          && trailingGlyph == other.trailingGlyph
+          && hasTrailingGlyph == other.hasTrailingGlyph
+          && isRightToLeftRun == other.isRightToLeftRun
+          && hasDelegate == other.hasDelegate
+          && glyphStringLength == other.glyphStringLength
+          && trailingGlyphWidth == other.trailingGlyphWidth
+          && std::equal(glyphString, glyphString + glyphStringLength, other.glyphString)
+          && (font == other.font
+              || (font && other.font && CFEqual(font.get(), other.font.get())))
+          && (attributes == other.attributes || [attributes isEqual:other.attributes]);
+    }
+  };
+
+  struct Entry {
+    Key key;
+    HyphenLine line;
+  };
+
+  Int count;
+  Entry entries[capacity];
+
+  void clear() {
+    for (Int i = 0; i < count; ++i) {
+      CFRelease(entries[i].line.line);
+      entries[i] = Entry{};
+    }
+    count = 0;
+  }
+};
+
+stu_mutex hyphenLineCacheMutex = STU_MUTEX_INIT;
+bool hyphenLineCacheIsInitialized = false;
+alignas(HyphenLineCache)
+Byte hyphenLineCacheStorage[sizeof(HyphenLineCache)];
+
+} // namespace
+
+/// @pre hyphenLineCacheMutex must be locked by the current thread.
+static HyphenLineCache& hyphenLineCache() {
+  if (STU_UNLIKELY(!hyphenLineCacheIsInitialized)) {
+    hyphenLineCacheIsInitialized = true;
+    HyphenLineCache& cache = *new (hyphenLineCacheStorage) HyphenLineCache{};
+
+#if TARGET_OS_IPHONE
+    NSNotificationCenter* const notificationCenter = NSNotificationCenter.defaultCenter;
+    NSOperationQueue* const mainQueue = NSOperationQueue.mainQueue;
+    const auto clearCacheBlock = ^(NSNotification*) {
+      stu_mutex_lock(&hyphenLineCacheMutex);
+      cache.clear();
+      stu_mutex_unlock(&hyphenLineCacheMutex);
+    };
+    [notificationCenter addObserverForName:UIApplicationDidEnterBackgroundNotification
+                                    object:nil queue:mainQueue usingBlock:clearCacheBlock];
+    [notificationCenter addObserverForName:UIApplicationDidReceiveMemoryWarningNotification
+                                    object:nil queue:mainQueue usingBlock:clearCacheBlock];
+#endif
+  }
+  return reinterpret_cast<HyphenLineCache&>(hyphenLineCacheStorage);
+}
+
+HyphenLine createHyphenLine(const NSAttributedStringRef& originalAttributedString,
+                            GlyphRunRef trailingRun, Char32 hyphen)
+{
+  const auto tg = GlyphForKerningPurposes::find(trailingRun, originalAttributedString,
+                                                lastGlyphInStringOrder);
+  const Int glyphStringLength = tg.glyph ? tg.stringRange.count() : 0;
+  if (glyphStringLength > HyphenLineCache::maxGlyphStringLength) {
+    return createUncachedHyphenLine(originalAttributedString, tg, hyphen);
+  }
+  HyphenLineCache::Key key = {
+    .attributes = tg.attributes,
+    .font = tg.font,
+    .trailingGlyphWidth = tg.glyph ? tg.width : 0,
+    .hyphen = hyphen,
+    .trailingGlyph = tg.glyph ? *tg.glyph : CGGlyph{},
+    .hasTrailingGlyph = !!tg.glyph,
+    .isRightToLeftRun = tg.isRightToLeftRun,
+    .hasDelegate = tg.hasDelegate,
+    .glyphStringLength = narrow_cast<Int8>(glyphStringLength)
+  };
+  if (glyphStringLength != 0) {
+    originalAttributedString.string.copyUTF16Chars(
+      tg.stringRange, ArrayRef{key.glyphString, glyphStringLength});
+  }
+
+  stu_mutex_lock(&hyphenLineCacheMutex);
+  {
+    HyphenLineCache& cache = hyphenLineCache();
+    for (Int i = 0; i < cache.count; ++i) {
+      if (!(cache.entries[i].key == key)) continue;
+      if (i != 0) {
+        std::rotate(cache.entries, cache.entries + i, cache.entries + i + 1);
+      }
+      const HyphenLine result = cache.entries[0].line;
+      CFRetain(result.line);
+      stu_mutex_unlock(&hyphenLineCacheMutex);
+      return result;
+    }
+  }
+  stu_mutex_unlock(&hyphenLineCacheMutex);
+
+  const HyphenLine result = createUncachedHyphenLine(originalAttributedString, tg, hyphen);
+  // The attributes may be a mutable dictionary, so we store an immutable copy.
+  key.attributes = [key.attributes copy];
+
+  stu_mutex_lock(&hyphenLineCacheMutex);
+  {
+    HyphenLineCache& cache = hyphenLineCache();
+    Int i = 0;
+    for (; i < cache.count; ++i) {
+      if (cache.entries[i].key == key) break;
+    }
+    if (i == cache.count) {
+      if (cache.count < HyphenLineCache::capacity) {
+        cache.count += 1;
+      } else {
+        i -= 1;
+      }
+    }
+    std::rotate(cache.entries, cache.entries + i, cache.entries + i + 1);
+    HyphenLineCache::Entry& entry = cache.entries[0];
+    if (entry.line.line) {
+      CFRelease(entry.line.line);
+    }
+    entry.key = std::move(key);
+    entry.line = result;
+    CFRetain(result.line);
+  }
+  stu_mutex_unlock(&hyphenLineCacheMutex);
+
+  return result;
+}
 
 } // namespace stu_label
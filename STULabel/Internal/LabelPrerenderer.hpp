@@ -23,8 +23,12 @@ class LabelPrerenderer final : public LabelTextShapingAndLayoutAndRenderTask,
   bool hasTextFrame_{};
   bool textFrameOptionsIsPrivate_{};
   bool contentInsetsAreDirectional_{};
+  /// Only accessed on the main thread.
+  bool renderingWasDeferred_{};
   CGSize size_{};
   STUEdgeInsets contentInsets_{};
+  /// The task function that a cancelled batch didn't run.
+  dispatch_function_t deferredTaskFunction_{};
 
   alignas(void*) Byte objcObjectStorage[];
 
@@ -32,6 +36,8 @@ class LabelPrerenderer final : public LabelTextShapingAndLayoutAndRenderTask,
 
   static STULabelPrerenderer* create(Class prerendererClass) NS_RETURNS_RETAINED;
 
+  friend class LabelPrerendererBatch;
+
   friend STULabelPrerenderer* ::STULabelPrerendererAlloc(Class);
   friend void detail::labelPrerendererObjCObjectWasDestroyed(LabelPrerenderer&);
   void objcObjectWasDestroyed();
@@ -58,6 +64,12 @@ private:
 
   Optional<LabelLayer&> popLabelFromWaitingSet();
 
+  /// Called by a batch worker instead of the task function after the batch was cancelled.
+  void deferRendering(dispatch_function_t taskFunction);
+  static void deferRendering_onMainThread(void* prerenderer);
+  /// \pre isMainThread()
+  void startDeferredRendering();
+
   void checkNotFrozen() {
     if (STU_UNLIKELY(isFrozen_)) {
       attemptedMutationOfFrozenObject();
@@ -375,6 +387,14 @@ public:
     referers_.store(Referers::layerOrPrerenderer | Referers::task, std::memory_order_relaxed);
     std::forward<Scheduler>(scheduler)(this, function);
   }
+
+  /// Freezes the prerenderers and renders them on up to `maxTaskCount` concurrently running tasks.
+  /// Each task reuses one arena allocator and one `ThreadLocalFontCache` for all the prerenderers
+  /// it processes.
+  static void renderBatch(NSArray<STULabelPrerenderer*>* __unsafe_unretained prerenderers,
+                          __nullable dispatch_queue_t queue, Int maxTaskCount,
+                          const STUCancellationFlag* __nullable cancellationFlag,
+                          __nullable STULabelPrerendererBatchProgressBlock progress);
 };
 
 } // stu_label
@@ -4,6 +4,9 @@
 
 #import "STULabel/STUObjCRuntimeWrappers.h"
 
+#import "CoreAnimationUtils.hpp"
+#import "Font.hpp"
+
 STU_EXTERN_C_BEGIN
 
 STULabelPrerenderer* STULabelPrerendererAlloc(const Class prerendererClass) NS_RETURNS_RETAINED {
@@ -83,6 +86,10 @@ void LabelPrerenderer::layout() {
 }
 
 void LabelPrerenderer::registerWaitingLabelLayer(LabelLayer& label) {
+  if (STU_UNLIKELY(renderingWasDeferred_)) {
+    referers_.fetch_or(Referers::task, std::memory_order_relaxed);
+    startDeferredRendering();
+  }
   if (!label_) {
     label_ = &label;
     incrementRefCount(((__bridge id)implicit_cast<void*>(objcObjectStorage)));
@@ -127,6 +134,146 @@ Optional<LabelLayer&> LabelPrerenderer::popLabelFromWaitingSet() {
   return label;
 }
 
+void LabelPrerenderer::deferRendering(dispatch_function_t taskFunction) {
+  deferredTaskFunction_ = taskFunction;
+  dispatch_async_f(dispatch_get_main_queue(), this, deferRendering_onMainThread);
+}
+
+void LabelPrerenderer::deferRendering_onMainThread(void* pointer) {
+  STU_DEBUG_ASSERT(is_main_thread());
+  LabelPrerenderer& self = *static_cast<LabelPrerenderer*>(pointer);
+  if (self.label_) {
+    // A label is already waiting for the result, so we can't postpone the rendering.
+    self.startDeferredRendering();
+    return;
+  }
+  // If a label is later configured with this prerenderer, registerWaitingLabelLayer will restart
+  // the rendering. (The label keeps the Objective-C object alive, so the task reference can't be
+  // the last one at that point.)
+  self.renderingWasDeferred_ = true;
+  self.taskStoppedAfterBeingCancelled();
+}
+
+void LabelPrerenderer::startDeferredRendering() {
+  STU_DEBUG_ASSERT(is_main_thread() && deferredTaskFunction_);
+  renderingWasDeferred_ = false;
+  dispatch_async_f(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), this,
+                   std::exchange(deferredTaskFunction_, nullptr));
+}
+
+// MARK: - Batch rendering
+
+class LabelPrerendererBatch {
+  struct Item {
+    LabelPrerenderer* prerenderer;
+    dispatch_function_t function;
+  };
+
+  Vector<Item> items_;
+  std::atomic<Int> nextIndex_{};
+  std::atomic<Int> completedCount_;
+  std::atomic<Int> remainingTaskCount_;
+  const Int totalCount_;
+  const STUCancellationFlag& cancellationFlag_;
+  const STULabelPrerendererBatchProgressBlock __nullable progress_;
+
+public:
+  LabelPrerendererBatch(Vector<Item>&& items, Int totalCount, Int taskCount,
+                        const STUCancellationFlag* __nullable cancellationFlag,
+                        STULabelPrerendererBatchProgressBlock __nullable progress)
+  : items_{std::move(items)},
+    completedCount_{totalCount - items_.count()},
+    remainingTaskCount_{taskCount},
+    totalCount_{totalCount},
+    cancellationFlag_{*(cancellationFlag ?: &CancellationFlag::neverCancelledFlag)},
+    progress_{progress}
+  {}
+
+  static void start(NSArray<STULabelPrerenderer*>* __unsafe_unretained prerenderers,
+                    dispatch_queue_t queue, Int maxTaskCount,
+                    const STUCancellationFlag* __nullable cancellationFlag,
+                    STULabelPrerendererBatchProgressBlock __nullable progress)
+  {
+    const Int totalCount = sign_cast(prerenderers.count);
+    Vector<Item> items;
+    items.ensureFreeCapacity(totalCount);
+    for (STULabelPrerenderer* __unsafe_unretained stuPrerenderer in prerenderers) {
+      LabelPrerenderer& prerenderer = *stuPrerenderer->prerenderer;
+      prerenderer.renderUsingScheduler([&](void* task, dispatch_function_t function) {
+        STU_DEBUG_ASSERT(task == &prerenderer);
+        items.append(Item{&prerenderer, function});
+      });
+    }
+    if (items.isEmpty()) {
+      if (progress) {
+        dispatch_async(dispatch_get_main_queue(), ^{ progress(totalCount, totalCount); });
+      }
+      return;
+    }
+    if (maxTaskCount <= 0) {
+      maxTaskCount = sign_cast(NSProcessInfo.processInfo.activeProcessorCount);
+    }
+    const Int taskCount = clamp(Int{1}, maxTaskCount, items.count());
+    LabelPrerendererBatch* const batch = new (Malloc().allocate<LabelPrerendererBatch>(1))
+                                           LabelPrerendererBatch{std::move(items), totalCount,
+                                                                 taskCount, cancellationFlag,
+                                                                 progress};
+    for (Int i = 0; i < taskCount; ++i) {
+      dispatch_async_f(queue, batch, run);
+    }
+  }
+
+private:
+  void destroyAndDeallocate() {
+    this->~LabelPrerendererBatch();
+    free(this);
+  }
+
+  void didProcessItem() {
+    const Int count = completedCount_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (const STULabelPrerendererBatchProgressBlock progress = progress_) {
+      const Int totalCount = totalCount_;
+      // The prerenderer's result was already dispatched to the main queue, so the labels waiting
+      // for the prerenderer will have been updated when the progress block is called.
+      dispatch_async(dispatch_get_main_queue(), ^{ progress(count, totalCount); });
+    }
+  }
+
+  static void run(void* pointer) {
+    LabelPrerendererBatch& batch = *static_cast<LabelPrerendererBatch*>(pointer);
+    {
+      ThreadLocalArenaAllocator::InitialBuffer<4096> buffer;
+      ThreadLocalArenaAllocator alloc{Ref{buffer}};
+      ThreadLocalFontCache fontCache;
+      for (;;) {
+        const Int index = batch.nextIndex_.fetch_add(1, std::memory_order_relaxed);
+        if (index >= batch.items_.count()) break;
+        const Item item = batch.items_[index];
+        if (!isCancelled(batch.cancellationFlag_)) {
+          item.function(item.prerenderer);
+          fontCache.taskDidFinish();
+        } else {
+          item.prerenderer->deferRendering(item.function);
+        }
+        batch.didProcessItem();
+      }
+    }
+    if (batch.remainingTaskCount_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      batch.destroyAndDeallocate();
+    }
+  }
+};
+
+void LabelPrerenderer::renderBatch(NSArray<STULabelPrerenderer*>* __unsafe_unretained prerenderers,
+                                   __nullable dispatch_queue_t queue, Int maxTaskCount,
+                                   const STUCancellationFlag* __nullable cancellationFlag,
+                                   __nullable STULabelPrerendererBatchProgressBlock progress)
+{
+  if (!queue) {
+    queue = dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0);
+  }
+  LabelPrerendererBatch::start(prerenderers, queue, maxTaskCount, cancellationFlag, progress);
+}
 
 void detail::labelPrerendererObjCObjectWasDestroyed(LabelPrerenderer& prerenderer) {
   prerenderer.objcObjectWasDestroyed();
@@ -4,6 +4,8 @@
 
 #import "Kerning.hpp"
 
+#import "stu/BinarySearch.hpp"
+
 #include "DefineUIntOnCatalystToWorkAroundGlobalNamespacePollution.h"
 
 namespace stu_label {
@@ -34,6 +36,9 @@ struct Iterator {
 
   /// The sum of the typographic width skipped by the iterator.
   Float64 offset_;
+  /// The offset before the last call of `advance()` in `advanceToInitialMinOffset`, or -1 if the
+  /// constructor didn't advance the iterator by a grapheme cluster.
+  Float64 offsetBeforeLastInitialAdvance_{-1};
 
   /// If isStringForwardIterator, the UTF-16 index of the end of the continuous string span that the
   /// iterator has skipped over; otherwise the UTF-16 index of the start of the continuous string
@@ -89,6 +94,9 @@ struct Iterator {
 
   STU_INLINE Float64 offset() const { return offset_; }
 
+  STU_INLINE
+  Float64 offsetBeforeLastInitialAdvance() const { return offsetBeforeLastInitialAdvance_; }
+
   STU_INLINE Range<Int> lineStringRange() const { return lineStringRange_; }
 
   STU_INLINE Int stringIndex() const { return stringIndex_; }
@@ -163,6 +171,8 @@ private:
 
   void advanceToInitialMinOffset(Float64 minOffset);
 
+  void skipGlyphsInRunBeforeMinOffset(Float64 minOffset);
+
   STU_INLINE
   Int runGlyphCount() const {
     const Int count = runGlyphCount_;
@@ -244,11 +254,111 @@ void Iterator::advanceToInitialMinOffset(const Float64 minOffset) {
     stringIndex_ = string_.startIndexOfGraphemeClusterAt(stringIndex);
   }
   loadNextRun();
+  if (run_ && !skipRun_ && !isNonMonotonicRun_) {
+    skipGlyphsInRunBeforeMinOffset(minOffset);
+  }
   while (offset_ < minOffset) {
+    offsetBeforeLastInitialAdvance_ = offset_;
     advance();
   }
 }
 
+/// Runs with fewer glyphs are cheaper to iterate over one grapheme cluster at a time.
+static const Int minGlyphCountForBinarySearch = 64;
+
+/// Skips the glyphs at the start (in iteration order) of the newly loaded run that lie completely
+/// before the `minOffset`, stopping at the start of a grapheme cluster. The glyph range is found
+/// with a binary search over the prefix sums of the glyph advances, so that `advance` only has to
+/// iterate over the last few grapheme clusters before the `minOffset`.
+///
+/// @pre The run was just loaded, has the direction of the line and is monotonic.
+STU_NO_INLINE
+void Iterator::skipGlyphsInRunBeforeMinOffset(const Float64 minOffset) {
+  STU_DEBUG_ASSERT(run_ && !skipRun_ && !isNonMonotonicRun_);
+  const Int n = runGlyphCount();
+  const Float64 maxSkippedWidth = minOffset - offset_;
+  if (n < minGlyphCountForBinarySearch || !(maxSkippedWidth > 0)) return;
+
+  TempArray<Float64> prefixSums{uninitialized, Count{n + 1}};
+  {
+    TempVector<CGSize> advancesBuffer;
+    const CGSize* advances = CTRunGetAdvancesPtr(run_->ctRun());
+    if (!advances) {
+      advancesBuffer.append(repeat(uninitialized, n));
+      CTRunGetAdvances(run_->ctRun(), CFRange{0, n}, advancesBuffer.begin());
+      advances = advancesBuffer.begin();
+    }
+    Float64 sum = 0;
+    prefixSums[0] = 0;
+    for (Int i = 0; i < n; ++i) {
+      sum += advances[i].width;
+      prefixSums[i + 1] = sum;
+    }
+  }
+  // The number of glyphs that we skip. Since the advances can be negative, the prefix sums needn't
+  // be monotonic, which is why we verify the result below with the typographic width.
+  Int m;
+  if (!isRightToLeftIterator_) {
+    m = binarySearchFirstIndexWhere(prefixSums, [&](Float64 sum) { return sum >= maxSkippedWidth; })
+        .indexOrArrayCount - 1;
+  } else {
+    const Float64 minSum = prefixSums[n] - maxSkippedWidth;
+    m = n - binarySearchFirstIndexWhere(prefixSums, [&](Float64 sum) { return sum > minSum; })
+            .indexOrArrayCount;
+  }
+  m = min(m, n - 1);
+  if (m <= 0) return;
+
+  if (!stringIndices_.isValidIndex(glyphIndex_)) {
+    glyphStringIndex_slowPath();
+  }
+  const auto glyphIndexAfterSkippingGlyphs = [&](Int count) -> Int {
+    return !isRightToLeftIterator_ ? count : n - 1 - count;
+  };
+  const Int minusOneIfRightToLeftIter = one_minusOne_Int[isRightToLeftIterator_];
+  // Move back to a glyph that starts a grapheme cluster.
+  for (; m > 0; --m) {
+    const Int i = glyphIndexAfterSkippingGlyphs(m);
+    const Int stringIndex = stringIndices_[i];
+    const Int previousStringIndex = stringIndices_[i - minusOneIfRightToLeftIter];
+    if (isStringForwardIterator_
+        ? stringIndex >= stringIndex_
+          && stringIndex >= string_.endIndexOfGraphemeClusterAt(previousStringIndex)
+        : stringIndex < stringIndex_
+          && stringIndex < string_.startIndexOfGraphemeClusterAt(previousStringIndex))
+    {
+      break;
+    }
+  }
+  if (m == 0) return;
+  const Range<Int> glyphRange = !isRightToLeftIterator_ ? Range{0, m} : Range{n - m, n};
+  const Float64 width = CTRunGetTypographicBounds(run_->ctRun(), glyphRange,
+                                                  nullptr, nullptr, nullptr);
+  if (!(width < maxSkippedWidth)) return;
+  offset_ += width;
+  glyphIndex_ = glyphIndexAfterSkippingGlyphs(m);
+  // The next call of `advance` updates stringIndex_ for the new glyph index.
+}
+
+/// Indicates whether the initial run skipping of an iterator constructed with the specified
+/// MinInitialOffset stops before the offset, i.e. whether the first run that ends after the offset
+/// has the writing direction of the line (runs with the opposite direction are skipped as a whole).
+static bool initialRunSkippingStopsBeforeOffset(const TruncatableTextLine& line,
+                                                const bool isLeftToRightIterator,
+                                                const Float64 offset)
+{
+  const Int n = line.runs.count();
+  Float64 width = 0;
+  for (Int i = 0; i < n; ++i) {
+    const GlyphRunRef run = line.runs[isLeftToRightIterator ? i : n - 1 - i];
+    width += run.typographicWidth();
+    if (width > offset) {
+      return !!(run.status() & kCTRunStatusRightToLeft) == line.isRightToLeftLine;
+    }
+  }
+  return false;
+}
+
 STU_NO_INLINE
 bool Iterator::loadNextRun() {
   // Note that this method may be called from the constructor
@@ -555,12 +665,6 @@ ExcisedGlyphRange findRangeToExciseForMiddleTruncation(
   // We iteratively determine the two spans at the ends of the lines that will remain after
   // truncation. We alternate between both sides to keep the widths balanced when possible.
 
-  Iterator iterS{line, StartAtEndOfLineString{false}};
-  Iterator iterE{line, StartAtEndOfLineString{true}};
-
-  auto& iterL = line.isRightToLeftLine ? iterE : iterS;
-  auto& iterR = line.isRightToLeftLine ? iterS : iterE;
-
   // - 0.01 to protect against infinite iteration due to accumulated floating point rounding errors.
   const Float64 maxWidthForIteration = min(maxWidth, line.width - 0.01);
 
@@ -569,12 +673,42 @@ ExcisedGlyphRange findRangeToExciseForMiddleTruncation(
   STU_DEBUG_ASSERT(line.stringRange.contains(truncationRange));
   const bool isMiddleStartOrEndTruncation = truncationType != kCTLineTruncationMiddle;
 
+  // The loop below advances the iterators one grapheme cluster at a time in the order of the
+  // offsets after the steps. For a plain middle truncation all steps ending before half the
+  // maximum width thus fit, which lets us skip them right away (with a binary search within long
+  // runs), instead of iterating over them one by one.
+  Float64 minInitialOffset = 0;
+  if (!isMiddleStartOrEndTruncation) {
+    minInitialOffset = maxWidthForIteration/2;
+    if (!initialRunSkippingStopsBeforeOffset(line, !line.isRightToLeftLine, minInitialOffset)
+        || !initialRunSkippingStopsBeforeOffset(line, line.isRightToLeftLine, minInitialOffset))
+    {
+      minInitialOffset = 0;
+    }
+  }
+
+  Iterator iterS{line, StartAtEndOfLineString{false}, MinInitialOffset{minInitialOffset}};
+  Iterator iterE{line, StartAtEndOfLineString{true}, MinInitialOffset{minInitialOffset}};
+
+  auto& iterL = line.isRightToLeftLine ? iterE : iterS;
+  auto& iterR = line.isRightToLeftLine ? iterS : iterE;
+
   {
-    Float64 offsetS = 0;
-    Float64 offsetE = 0;
-    // Look ahead one step.
-    iterS.advance();
-    iterE.advance();
+    Float64 offsetS;
+    Float64 offsetE;
+    // Look ahead one step (unless the constructor already did).
+    if (iterS.offsetBeforeLastInitialAdvance() >= 0) {
+      offsetS = iterS.offsetBeforeLastInitialAdvance();
+    } else {
+      offsetS = iterS.offset();
+      iterS.advance();
+    }
+    if (iterE.offsetBeforeLastInitialAdvance() >= 0) {
+      offsetE = iterE.offsetBeforeLastInitialAdvance();
+    } else {
+      offsetE = iterE.offset();
+      iterE.advance();
+    }
     for (;;) {
       const bool canAdvanceS = iterS.offset() + offsetE <= maxWidthForIteration;
       const bool canAdvanceE = iterE.offset() + offsetS <= maxWidthForIteration;
@@ -197,6 +197,76 @@ public:
     return result;
   }
 
+  /// A set of up to 4 UTF-16 code units.
+  class UTF16CharSet {
+  public:
+    STU_INLINE
+    UTF16CharSet(Char16 c0) : chars_{c0, c0, c0, c0} {}
+    STU_INLINE
+    UTF16CharSet(Char16 c0, Char16 c1) : chars_{c0, c1, c1, c1} {}
+    STU_INLINE
+    UTF16CharSet(Char16 c0, Char16 c1, Char16 c2) : chars_{c0, c1, c2, c2} {}
+    STU_INLINE
+    UTF16CharSet(Char16 c0, Char16 c1, Char16 c2, Char16 c3) : chars_{c0, c1, c2, c3} {}
+
+    STU_INLINE
+    bool contains(Char16 ch) const {
+      return ch == chars_[0] || ch == chars_[1] || ch == chars_[2] || ch == chars_[3];
+    }
+
+    STU_INLINE_T
+    const Char16 (&chars() const)[4] { return chars_; }
+
+  private:
+    Char16 chars_[4];
+  };
+
+  /// Returns the index of the first UTF-16 char in the range that is contained in the set.
+  /// Returns `max(range.start, range.end)` if there is no such char.
+  ///
+  /// This is a vectorized equivalent of
+  /// `indexOfFirstUTF16CharWhere(range, [&](Char16 ch) { return set.contains(ch); })`.
+  STU_INLINE
+  Int indexOfFirstUTF16CharIn(Range<Int> range, const UTF16CharSet& set) const {
+    const BufferKind kind = kind_;
+    const Int count = this->count();
+    STU_PRECONDITION(   0 <= range.start && range.start <= count
+                     && 0 <= range.end   && range.end <= count);
+    Int result;
+    if (STU_LIKELY(!range.isEmpty())) {
+      result = indexOfFirstUTF16CharInImpl(range, set);
+      STU_ASSUME(range.start <= result && result <= range.end);
+    } else {
+      result = range.start;
+    }
+    STU_ASSUME(kind == kind_); discard(kind);
+    STU_ASSUME(count == count_);
+    return result;
+  }
+
+  /// Returns the index of the first UTF-16 char in the range that is a Latin-1 letter or not a
+  /// Latin-1 char at all. Returns `max(range.start, range.end)` if there is no such char.
+  ///
+  /// @note The Latin-1 letters are exactly the Latin-1 chars with the strong bidi type L, and no
+  ///       other Latin-1 char has a strong bidi type.
+  STU_INLINE
+  Int indexOfFirstLatin1LetterOrNonLatin1Char(Range<Int> range) const {
+    const BufferKind kind = kind_;
+    const Int count = this->count();
+    STU_PRECONDITION(   0 <= range.start && range.start <= count
+                     && 0 <= range.end   && range.end <= count);
+    Int result;
+    if (STU_LIKELY(!range.isEmpty())) {
+      result = indexOfFirstLatin1LetterOrNonLatin1CharImpl(range);
+      STU_ASSUME(range.start <= result && result <= range.end);
+    } else {
+      result = range.start;
+    }
+    STU_ASSUME(kind == kind_); discard(kind);
+    STU_ASSUME(count == count_);
+    return result;
+  }
+
   template <typename Predicate, EnableIf<isCallable<Predicate, bool(Char32)>> = 0>
   /// Returns `range.start` if no code point in the range satisfies the predicate.
   STU_INLINE
@@ -304,6 +374,10 @@ private:
 
   Int indexOfFirstUTF16CharWhereImpl(Range<Int> range, FunctionRef<bool(Int, Char16)>) const;
 
+  Int indexOfFirstUTF16CharInImpl(Range<Int> range, const UTF16CharSet&) const STU_PURE;
+
+  Int indexOfFirstLatin1LetterOrNonLatin1CharImpl(Range<Int> range) const STU_PURE;
+
   Int indexOfFirstCodePointWhereImpl(Range<Int> range, FunctionRef<bool(Int, Char32)>) const;
 
   Int indexOfEndOfLastCodePointWhereImpl(Range<Int> range, FunctionRef<bool(Int, Char32)>) const;
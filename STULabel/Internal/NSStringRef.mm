@@ -4,6 +4,8 @@
 
 #import "stu/Array.hpp"
 
+#import <simd/simd.h>
+
 #include "DefineUIntOnCatalystToWorkAroundGlobalNamespacePollution.h"
 
 namespace stu_label {
@@ -251,6 +253,71 @@ Int indexOfFirstUTF16CharWhereImpl(const NSStringRef& string, const Range<Int> r
   return index;
 }
 
+/// Compares `sizeof(Vector)/sizeof(Char)` chars at a time with the 4 set values and returns the
+/// index of the first matching char, or `end` if there is none.
+template <typename Vector, typename Char>
+STU_INLINE
+Int indexOfFirstCharIn(const Char* const chars, Int index, const Int end, const Char (&set)[4]) {
+  static_assert(sizeof(Vector) % sizeof(Char) == 0);
+  constexpr Int n = sizeof(Vector)/sizeof(Char);
+  using Element = Conditional<sizeof(Char) == 1, UInt8, UInt16>;
+  const Vector c0 = static_cast<Element>(set[0]);
+  const Vector c1 = static_cast<Element>(set[1]);
+  const Vector c2 = static_cast<Element>(set[2]);
+  const Vector c3 = static_cast<Element>(set[3]);
+  for (; end - index >= n; index += n) {
+    Vector v;
+    memcpy(&v, chars + index, sizeof(v)); // An unaligned load.
+    if (simd_any((v == c0) | (v == c1) | (v == c2) | (v == c3))) break;
+  }
+  // Finds the match in the block where the vector loop stopped or checks the remaining chars.
+  for (; index < end; ++index) {
+    const Char ch = chars[index];
+    if (ch == set[0] || ch == set[1] || ch == set[2] || ch == set[3]) break;
+  }
+  return index;
+}
+
+STU_INLINE
+bool isLatin1LetterOrNonLatin1Char(Char16 ch) {
+  return ch >= 0xC0 ? ch != 0xD7 && ch != 0xF7
+       : UInt16((ch | 0x20) - 'a') < 26 || ch == 0xAA || ch == 0xB5 || ch == 0xBA;
+}
+
+STU_INLINE
+Int indexOfFirstLatin1LetterOrNonLatin1Char(const Char16* const chars, Int index, const Int end) {
+  constexpr Int n = 8;
+  for (; end - index >= n; index += n) {
+    simd_ushort8 v;
+    memcpy(&v, chars + index, sizeof(v)); // An unaligned load.
+    const simd_ushort8 lower = v | 0x20;
+    if (simd_any(((lower - 'a') < 26)
+                 | ((v >= 0xC0) & (v != 0xD7) & (v != 0xF7))
+                 | (v == 0xAA) | (v == 0xB5) | (v == 0xBA)))
+    {
+      break;
+    }
+  }
+  for (; index < end; ++index) {
+    if (isLatin1LetterOrNonLatin1Char(chars[index])) break;
+  }
+  return index;
+}
+
+STU_INLINE
+Int indexOfFirstASCIILetter(const unsigned char* const chars, Int index, const Int end) {
+  constexpr Int n = 16;
+  for (; end - index >= n; index += n) {
+    simd_uchar16 v;
+    memcpy(&v, chars + index, sizeof(v)); // An unaligned load.
+    if (simd_any(((v | 0x20) - 'a') < 26)) break;
+  }
+  for (; index < end; ++index) {
+    if (UInt8((chars[index] | 0x20) - 'a') < 26) break;
+  }
+  return index;
+}
+
 template <NSStringRefBufferKind kind, typename Predicate,
           EnableIf<isCallable<Predicate, bool(Int index, Char32)>> = 0>
 STU_INLINE
@@ -342,6 +409,42 @@ Int NSStringRef
   }
 }
 
+STU_NO_INLINE
+Int NSStringRef::indexOfFirstUTF16CharInImpl(Range<Int> range, const UTF16CharSet& set) const {
+  const BufferKind kind = kind_;
+  if (kind == BufferKind::utf16) {
+    return detail::indexOfFirstCharIn<simd_ushort8>(utf16Buffer(), range.start, range.end,
+                                                    set.chars());
+  } else if (kind == BufferKind::ascii) {
+    // The ASCII buffer only contains chars less than 0x80, so we can map any other set value to
+    // 0xFF.
+    const unsigned char asciiSet[4] = {
+      static_cast<unsigned char>(set.chars()[0] < 0x80 ? set.chars()[0] : 0xFF),
+      static_cast<unsigned char>(set.chars()[1] < 0x80 ? set.chars()[1] : 0xFF),
+      static_cast<unsigned char>(set.chars()[2] < 0x80 ? set.chars()[2] : 0xFF),
+      static_cast<unsigned char>(set.chars()[3] < 0x80 ? set.chars()[3] : 0xFF)
+    };
+    return detail::indexOfFirstCharIn<simd_uchar16>(asciiBuffer(), range.start, range.end,
+                                                    asciiSet);
+  } else {
+    return detail::indexOfFirstUTF16CharWhereImpl<BufferKind::none>(*this, range,
+             [&](Int index __unused, Char16 ch) { return set.contains(ch); });
+  }
+}
+
+STU_NO_INLINE
+Int NSStringRef::indexOfFirstLatin1LetterOrNonLatin1CharImpl(Range<Int> range) const {
+  const BufferKind kind = kind_;
+  if (kind == BufferKind::utf16) {
+    return detail::indexOfFirstLatin1LetterOrNonLatin1Char(utf16Buffer(), range.start, range.end);
+  } else if (kind == BufferKind::ascii) {
+    return detail::indexOfFirstASCIILetter(asciiBuffer(), range.start, range.end);
+  } else {
+    return detail::indexOfFirstUTF16CharWhereImpl<BufferKind::none>(*this, range,
+             [](Int index __unused, Char16 ch) { return detail::isLatin1LetterOrNonLatin1Char(ch); });
+  }
+}
+
 STU_NO_INLINE
 Int NSStringRef
     ::indexOfFirstCodePointWhereImpl(Range<Int> range,
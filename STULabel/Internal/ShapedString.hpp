@@ -10,6 +10,8 @@
 
 #import "stu/FunctionRef.hpp"
 
+#include <atomic>
+
 #include "DefineUIntOnCatalystToWorkAroundGlobalNamespacePollution.h"
 
 namespace stu_label {
@@ -106,6 +108,9 @@ public:
   const bool defaultBaseWritingDirectionWasUsed;
   const Int textStylesSize;
 private:
+  struct HyphenationOpportunityArray;
+  /// Is allocated on first use and has one lazily created entry per paragraph.
+  mutable std::atomic<std::atomic<HyphenationOpportunityArray*>*> hyphenationCache_{};
   Paragraph paragraphs_[];
 
 public:
@@ -157,15 +162,62 @@ public:
             TextStyleSpan{.firstStyle = firstStyle, .terminatorStyle = terminatorStyle}};
   };
 
+  struct HyphenationOpportunity {
+    Int32 stringIndex;
+    /// The hyphen that should be inserted when the line is broken at this opportunity.
+    Char32 hyphen;
+  };
+
+  /// The hyphenation opportunities of paragraphs up to this UTF-16 length are computed for the
+  /// full paragraph on first use and then cached. For a longer paragraph the eager computation
+  /// could take much longer than breaking the few lines that are actually laid out, e.g. when the
+  /// text frame has a maximum line count, so the opportunities are queried per line instead.
+  static constexpr Int32 maxHyphenationCacheParagraphLength = 4096;
+
+  /// Calls `body` for the hyphenation opportunities in the specified paragraph of this string
+  /// whose string index lies strictly within `range`, in descending string index order, until
+  /// `body` returns true. Returns true if `body` returned true.
+  ///
+  /// The opportunities are determined with `CFStringGetHyphenationLocationBeforeIndex` for the
+  /// locales specified with the `STUHyphenationLocaleIdentifierAttributeName` attribute.
+  /// Thread-safe.
+  ///
+  /// @pre `range` is contained in the paragraph's string range.
+  bool forEachHyphenationOpportunityInReverse(
+         const Paragraph&, Range<Int> range,
+         FunctionRef<bool(const HyphenationOpportunity&)> body) const;
+
+  /// The total size of the hyphenation opportunity arrays created so far.
+  UInt hyphenationCacheSize() const;
+
   static ShapedString* __nullable create(NSAttributedString*, STUWritingDirection,
                                          const STUCancellationFlag*,
                                          FunctionRef<void*(UInt)> alloc);
 
+  /// Returns the binary representation returned by `-[STUShapedString serializedData]`, or nil
+  /// if the attributed string contains attribute values that can't be archived.
+  NSData* __nullable serializedData() const API_AVAILABLE(ios(11.0), tvos(11.0));
+
+  /// Returns null if the data is not a valid ShapedString serialization produced by a build of
+  /// this library with the same data layout.
+  static ShapedString* __nullable createFromSerializedData(NSData*, FunctionRef<void*(UInt)> alloc)
+                                    API_AVAILABLE(ios(11.0), tvos(11.0));
+
   ~ShapedString();
 
 private:
   static constexpr Int sanitizerGap = STU_USE_ADDRESS_SANITIZER ? 8 : 0;
 
+  /// Returns the hyphenation opportunities in the specified paragraph, sorted by string index.
+  /// Computes the opportunities on first access and caches them. Thread-safe.
+  /// @pre `paragraph.stringRange.count() <= maxHyphenationCacheParagraphLength`
+  ArrayRef<const HyphenationOpportunity> hyphenationOpportunities(const Paragraph&) const;
+
+  static UInt allocationSize(Int paragraphCount, Int truncationScopeCount, Int fontCount,
+                             Int colorCount, Int textStylesSize);
+
+  void poisonSanitizerGaps() const;
+
   explicit ShapedString(NSAttributedString *attributedString, Int32 stringLength,
                         STUWritingDirection defaultBaseWritingDirection,
                         bool defaultBaseWritingDirectionWasUsed,
@@ -175,8 +227,27 @@ private:
                         ArrayRef<const ColorHashBucket> colorHashBuckets,
                         ArrayRef<const FontRef> fonts,
                         ArrayRef<const Byte> textStyleDataIncludingTerminator);
+
+  struct DeserializedArrays {
+    ArrayRef<const Paragraph> paragraphs;
+    ArrayRef<const TruncationScope> truncationScopes;
+    ArrayRef<const FontMetrics> fontMetrics;
+    ArrayRef<const ColorRef> colors;
+    ArrayRef<const ColorHashBucket> colorHashBuckets;
+    ArrayRef<const Byte> textStyleDataIncludingTerminator;
+  };
+
+  explicit ShapedString(NSAttributedString *attributedString, Int32 stringLength,
+                        STUWritingDirection defaultBaseWritingDirection,
+                        bool defaultBaseWritingDirectionWasUsed,
+                        const DeserializedArrays& arrays);
 };
 
+/// The classes that may be decoded from the keyed archives in shaped string serializations and
+/// text frame snapshots: the Foundation, UIKit and STULabel classes commonly used as attribute
+/// values, plus the container classes.
+NSSet<Class>* attributedStringArchiveClasses();
+
 } // stu_label
 
 #include "UndefineUIntOnCatalystToWorkAroundGlobalNamespacePollution.h"
@@ -7,7 +7,9 @@
 #import "STULabel/STUTextAttributes-Internal.hpp"
 
 #import "CancellationFlag.hpp"
+#import "DataLayoutFingerprint.hpp"
 #import "InputClamping.hpp"
+#import "Kerning.hpp"
 #import "NSAttributedStringRef.hpp"
 #import "Once.hpp"
 #import "TextFrameLayouter.hpp"
@@ -15,6 +17,8 @@
 #import "ThreadLocalAllocator.hpp"
 #import "UnicodeCodePointProperties.hpp"
 
+#import "stu/BinarySearch.hpp"
+
 #include "DefineUIntOnCatalystToWorkAroundGlobalNamespacePollution.h"
 
 namespace stu_label {
@@ -22,6 +26,14 @@ namespace stu_label {
 NSWritingDirection detectBaseWritingDirection(const NSStringRef& string, Range<Int> range,
                                               SkipIsolatedText skipIsolatedText)
 {
+  // Fast path: The Latin-1 letters are the only Latin-1 chars with a strong bidi type and there
+  // are no isolate chars in Latin-1, so we can skip over the leading Latin-1 chars without any
+  // table lookups.
+  const Int index = string.indexOfFirstLatin1LetterOrNonLatin1Char(range);
+  if (index >= range.end) return NSWritingDirectionNatural;
+  if (string[index] <= 0xFF) return NSWritingDirectionLeftToRight;
+  range.start = index;
+
   NSWritingDirection result = NSWritingDirectionNatural;
   NSInteger isolateCounter = 0;
   string.indexOfFirstCodePointWhere(range, [&](Char32 cp) -> bool {
@@ -83,22 +95,10 @@ static ScanStatus scanAttributedString(
     ShapedString::Paragraph& para = paragraphs.append(uninitialized);
 
     // Find the end of the paragraph.
-    bool isCR = false;
-    Int32 end = narrow_cast<Int32>(attributedString.string.indexOfFirstUTF16CharWhere(
-                                     Range{start, stringLength}, [&isCR](Char16 ch) -> bool
-                                   {
-                                      switch (ch) {
-                                      case 0xD: // CR
-                                        isCR = true;
-                                        // Fall through.
-                                        [[fallthrough]];
-                                      case 0xA:    // LF
-                                      case 0x2029: // PS
-                                        return true;
-                                      default:
-                                       return false;
-                                      }
-                                    }));
+    Int32 end = narrow_cast<Int32>(attributedString.string.indexOfFirstUTF16CharIn(
+                                     Range{start, stringLength},
+                                     {0xD /* CR */, 0xA /* LF */, 0x2029 /* PS */}));
+    const bool isCR = end < stringLength && attributedString.string[end] == 0xD;
     const Int32 terminatorStart = end;
     if (end < stringLength) {
       end += 1;
@@ -451,13 +451,9 @@ ShapedString* __nullable
   const ArrayRef<const ColorRef> colors = textStyleBuffer.colors();
   const ArrayRef<const ColorHashBucket> colorHashBuckets = textStyleBuffer.colorHashBuckets();
 
-  const UInt size = sizeof(ShapedString)
-                  + paragraphs.arraySizeInBytes() + sanitizerGap
-                  + truncationScopes.arraySizeInBytes() + sanitizerGap
-                  + sizeof(FontMetrics)*sign_cast(textStyleBuffer.fonts().count()) + sanitizerGap
-                  + colors.arraySizeInBytes() + sanitizerGap
-                  + sizeof(ColorHashBucket)*sign_cast(colors.count()) + sanitizerGap
-                  + sign_cast(textStyleBuffer.data().count()) + sanitizerGap;
+  const UInt size = allocationSize(paragraphs.count(), truncationScopes.count(),
+                                   textStyleBuffer.fonts().count(), colors.count(),
+                                   textStyleBuffer.data().count());
 
   return new (alloc(size))
              ShapedString{attributedString, status.stringLength,
@@ -466,6 +462,18 @@ ShapedString* __nullable
                           textStyleBuffer.fonts(), textStyleBuffer.data()};
 }
 
+UInt ShapedString::allocationSize(Int paragraphCount, Int truncationScopeCount, Int fontCount,
+                                  Int colorCount, Int textStylesSize)
+{
+  return sizeof(ShapedString)
+       + sizeof(Paragraph)*sign_cast(paragraphCount) + sanitizerGap
+       + sizeof(TruncationScope)*sign_cast(truncationScopeCount) + sanitizerGap
+       + sizeof(FontMetrics)*sign_cast(fontCount) + sanitizerGap
+       + sizeof(ColorRef)*sign_cast(colorCount) + sanitizerGap
+       + sizeof(ColorHashBucket)*sign_cast(colorCount) + sanitizerGap
+       + sign_cast(textStylesSize) + sanitizerGap;
+}
+
 static
 CTTypesetter* createTypesetter(CFAttributedStringRef string, Int32 stringLength) CF_RETURNS_RETAINED {
 #if defined(kCTVersionNumber10_14)
@@ -495,6 +503,17 @@ CTTypesetter* createTypesetter(CFAttributedStringRef string, Int32 stringLength)
   return CTTypesetterCreateWithAttributedString(string);
 }
 
+void ShapedString::poisonSanitizerGaps() const {
+#if STU_USE_ADDRESS_SANITIZER
+  const ArraysRef tas = arrays();
+  sanitizer::poison((Byte*)tas.paragraphs.end(), sanitizerGap);
+  sanitizer::poison((Byte*)tas.truncationSopes.end(), sanitizerGap);
+  sanitizer::poison((Byte*)tas.colors.end(), sanitizerGap);
+  sanitizer::poison((Byte*)tas.fontMetrics.end(), sanitizerGap);
+  sanitizer::poison((Byte*)(tas.textStyles.dataBegin() + textStylesSize), sanitizerGap);
+#endif
+}
+
 ShapedString::ShapedString(NSAttributedString* const attributedString, const Int32 stringLength,
                            const STUWritingDirection defaultBaseWritingDirection,
                            const bool defaultBaseWritingDirectionWasUsed,
@@ -518,13 +537,7 @@ ShapedString::ShapedString(NSAttributedString* const attributedString, const Int
 {
   const ArraysRef tas = arrays();
 
-#if STU_USE_ADDRESS_SANITIZER
-  sanitizer::poison((Byte*)tas.paragraphs.end(), sanitizerGap);
-  sanitizer::poison((Byte*)tas.truncationSopes.end(), sanitizerGap);
-  sanitizer::poison((Byte*)tas.colors.end(), sanitizerGap);
-  sanitizer::poison((Byte*)tas.fontMetrics.end(), sanitizerGap);
-  sanitizer::poison((Byte*)(tas.textStyles.dataBegin() + textStylesSize), sanitizerGap);
-#endif
+  poisonSanitizerGaps();
 
   using array_utils::copyConstructArray;
 
@@ -561,6 +574,14 @@ ShapedString::ShapedString(NSAttributedString* const attributedString, const Int
 }
 
 ShapedString::~ShapedString() {
+  if (std::atomic<HyphenationOpportunityArray*>* const cache =
+        hyphenationCache_.load(std::memory_order_acquire))
+  {
+    for (Int i = 0; i < paragraphCount; ++i) {
+      free(cache[i].load(std::memory_order_relaxed));
+    }
+    free(cache);
+  }
   const ArraysRef tas = arrays();
   for (ColorRef color : tas.colors.reversed()) {
     decrementRefCount(color.cgColor());
@@ -574,5 +595,612 @@ ShapedString::~ShapedString() {
 #endif
 }
 
-} // namespace stu_label
+struct ShapedString::HyphenationOpportunityArray {
+  Int count;
+  HyphenationOpportunity opportunities[];
+};
+
+/// Calls `body` for the hyphenation opportunities with a string index strictly within
+/// `queryRange`, in descending order, until `body` returns true. The locale attribute runs are
+/// clipped to `contextRange`, which contains `queryRange`, so that CFString sees the full words at
+/// the boundaries of `queryRange`. Returns the number of hyphenation location queries.
+static UInt queryHyphenationOpportunitiesInReverse(
+              NSAttributedString* __unsafe_unretained attributedString,
+              const Range<Int> contextRange, const Range<Int> queryRange,
+              FunctionRef<bool(const ShapedString::HyphenationOpportunity&)> body)
+{
+  CFString* const string = (__bridge CFStringRef)attributedString.string;
+  CFString* cachedLocaleId = nullptr;
+  RC<CFLocale> locale;
+  UInt queryCount = 0;
+  for (Int index = queryRange.end; index > queryRange.start + 1;) {
+    NSRange nsRange;
+    CFString* const localeId = (__bridge CFStringRef)
+                                 [attributedString attribute:STUHyphenationLocaleIdentifierAttributeName
+                                                     atIndex:sign_cast(index - 1)
+                                       longestEffectiveRange:&nsRange
+                                                     inRange:NSRange(contextRange)];
+    const Range<Int> range = Range<Int>(nsRange);
+    index = range.start;
+    if (!localeId || CFStringGetLength(localeId) == 0) continue;
+    if (localeId != cachedLocaleId && !(cachedLocaleId && CFEqual(localeId, cachedLocaleId))) {
+      cachedLocaleId = localeId;
+      locale = RC<CFLocale>{CFLocaleCreate(nil, localeId), ShouldIncrementRefCount{false}};
+      if (locale && !CFStringIsHyphenationAvailableForLocale(locale.get())) {
+        locale = nullptr;
+      }
+    }
+    if (!locale) continue;
+    const Int minIndex = max(range.start, queryRange.start);
+    for (Int i = min(range.end, queryRange.end); i > minIndex + 1;) {
+      UTF32Char hyphen;
+      i = CFStringGetHyphenationLocationBeforeIndex(string, i, range, 0, locale.get(), &hyphen);
+      ++queryCount;
+      if (i <= minIndex) break;
+      if (hyphen == 0x2D) { // We prefer a proper hyphen, not a hyphen-minus.
+        hyphen = hyphenCodePoint;
+      }
+      if (body(ShapedString::HyphenationOpportunity{narrow_cast<Int32>(i), hyphen})) {
+        return queryCount;
+      }
+    }
+  }
+  return queryCount;
+}
+
+ArrayRef<const ShapedString::HyphenationOpportunity>
+  ShapedString::hyphenationOpportunities(const Paragraph& para) const
+{
+  using Entry = std::atomic<HyphenationOpportunityArray*>;
+  const Int paraIndex = &para - paragraphs_;
+  STU_PRECONDITION(0 <= paraIndex && paraIndex < paragraphCount);
+  STU_DEBUG_ASSERT(para.stringRange.count() <= maxHyphenationCacheParagraphLength);
+  Entry* cache = hyphenationCache_.load(std::memory_order_acquire);
+  if (STU_UNLIKELY(!cache)) {
+    Entry* const newCache = Malloc().allocate<Entry>(paragraphCount);
+    for (Int i = 0; i < paragraphCount; ++i) {
+      new (&newCache[i]) Entry{nullptr};
+    }
+    if (hyphenationCache_.compare_exchange_strong(cache, newCache, std::memory_order_acq_rel,
+                                                  std::memory_order_acquire))
+    {
+      cache = newCache;
+    } else {
+      free(newCache);
+    }
+  }
+  Entry& entry = cache[paraIndex];
+  HyphenationOpportunityArray* array = entry.load(std::memory_order_acquire);
+  if (!array) {
+    ThreadLocalArenaAllocator::InitialBuffer<1024> buffer;
+    ThreadLocalArenaAllocatorScope alloc{Ref{buffer}};
+    TempVector<HyphenationOpportunity> opportunities{Capacity{64}};
+    const UInt queryCount = queryHyphenationOpportunitiesInReverse(
+                              attributedString, para.stringRange, para.stringRange,
+                              [&](const HyphenationOpportunity& ho) {
+                                opportunities.append(ho);
+                                return false;
+                              });
+    std::reverse(opportunities.begin(), opportunities.end());
+    HyphenationOpportunityArray* const newArray =
+      reinterpret_cast<HyphenationOpportunityArray*>(
+        Malloc().allocate<Byte>(sign_cast(sizeof(HyphenationOpportunityArray)
+                                          + opportunities.arraySizeInBytes())));
+    newArray->count = opportunities.count();
+    array_utils::copyConstructArray(opportunities, newArray->opportunities);
+    if (entry.compare_exchange_strong(array, newArray, std::memory_order_acq_rel,
+                                      std::memory_order_acquire))
+    {
+      array = newArray;
+      addToHyphenationStatistics(1, queryCount);
+    } else {
+      free(newArray);
+    }
+  }
+  return {array->opportunities, array->count, unchecked};
+}
+
+bool ShapedString::forEachHyphenationOpportunityInReverse(
+                     const Paragraph& para, const Range<Int> range,
+                     FunctionRef<bool(const HyphenationOpportunity&)> body) const
+{
+  STU_DEBUG_ASSERT(para.stringRange.start <= range.start && range.end <= para.stringRange.end);
+  if (para.stringRange.count() > maxHyphenationCacheParagraphLength) {
+    bool result = false;
+    const UInt queryCount = queryHyphenationOpportunitiesInReverse(
+                              attributedString, para.stringRange, range,
+                              [&](const HyphenationOpportunity& ho) {
+                                result = body(ho);
+                                return result;
+                              });
+    addToHyphenationStatistics(0, queryCount);
+    return result;
+  }
+  const ArrayRef<const HyphenationOpportunity> opportunities = hyphenationOpportunities(para);
+  Int i = binarySearchFirstIndexWhere(opportunities,
+            [&](const HyphenationOpportunity& ho) { return ho.stringIndex >= range.end; }
+          ).indexOrArrayCount;
+  UInt lookupCount = 0;
+  bool result = false;
+  while (i > 0) {
+    const HyphenationOpportunity& ho = opportunities[--i];
+    if (ho.stringIndex <= range.start) break;
+    ++lookupCount;
+    if (body(ho)) {
+      result = true;
+      break;
+    }
+  }
+  if (lookupCount != 0) {
+    addToCachedHyphenationLookupCount(lookupCount);
+  }
+  return result;
+}
+
+UInt ShapedString::hyphenationCacheSize() const {
+  using Entry = std::atomic<HyphenationOpportunityArray*>;
+  const Entry* const cache = hyphenationCache_.load(std::memory_order_acquire);
+  if (!cache) return 0;
+  UInt size = sizeof(Entry)*sign_cast(paragraphCount);
+  for (Int i = 0; i < paragraphCount; ++i) {
+    if (const HyphenationOpportunityArray* const array =
+          cache[i].load(std::memory_order_acquire))
+    {
+      size += sizeof(HyphenationOpportunityArray)
+            + sizeof(HyphenationOpportunity)*sign_cast(array->count);
+    }
+  }
+  return size;
+}
+
+
+ShapedString::ShapedString(NSAttributedString* const attributedString, const Int32 stringLength,
+                           const STUWritingDirection defaultBaseWritingDirection,
+                           const bool defaultBaseWritingDirectionWasUsed,
+                           const DeserializedArrays& arrays)
+: attributedString{attributedString},
+  typesetter{createTypesetter((__bridge CFAttributedStringRef)attributedString, stringLength),
+              ShouldIncrementRefCount{false}},
+  stringLength{stringLength},
+  paragraphCount{narrow_cast<Int32>(arrays.paragraphs.count())},
+  truncationScopeCount{narrow_cast<Int32>(arrays.truncationScopes.count())},
+  fontCount{narrow_cast<UInt16>(arrays.fontMetrics.count())},
+  colorCount{narrow_cast<UInt16>(arrays.colors.count())},
+  defaultBaseWritingDirection{defaultBaseWritingDirection},
+  defaultBaseWritingDirectionWasUsed{defaultBaseWritingDirectionWasUsed},
+  textStylesSize{arrays.textStyleDataIncludingTerminator.count()}
+{
+  STU_DEBUG_ASSERT(arrays.colorHashBuckets.count() == arrays.colors.count());
+  const ArraysRef tas = this->arrays();
+
+  poisonSanitizerGaps();
+
+  using array_utils::copyConstructArray;
+
+  // The paragraphs already contain the effective min line height info, so we don't need to call
+  // initializeParagraphMinFontMetrics here.
+  copyConstructArray(arrays.paragraphs, const_array_cast(tas.paragraphs).begin());
+  copyConstructArray(arrays.truncationScopes, const_array_cast(tas.truncationSopes).begin());
+  copyConstructArray(arrays.fontMetrics, const_array_cast(tas.fontMetrics).begin());
+  for (auto& color : arrays.colors) {
+    incrementRefCount(color.cgColor());
+  }
+  copyConstructArray(arrays.colors, const_array_cast(tas.colors).begin());
+  copyConstructArray(arrays.colorHashBuckets, const_array_cast(tas.colorHashBuckets).begin());
+  copyConstructArray(arrays.textStyleDataIncludingTerminator,
+                     const_cast<Byte*>(tas.textStyles.dataBegin()));
+}
+
+// MARK: - Serialization
+
+// The serialized representation of a ShapedString consists of a header followed by the raw
+// ShapedString arrays and a keyed archive containing the attributed string and the colors.
+// Each section starts at a 16-byte aligned offset. Object pointers in the raw arrays are cleared
+// when serializing and restored from the unarchived attributed string when deserializing.
+//
+// Since the arrays are stored in their in-memory representation, serialized data can only be read
+// by the build of the library that created it. This is checked using the layout fields of the
+// header and a fingerprint combining a hash of the offsets of the serialized struct fields with
+// the build ID of the library binary.
+
+namespace {
+
+struct SerializedShapedStringHeader {
+  static constexpr UInt32 magicValue = 0x53545553; // "STUS"
+  static constexpr UInt32 currentVersion = 2;
 
+  UInt32 magic;
+  UInt32 version;
+  // Layout fields
+  UInt64 layoutFingerprint;
+  UInt16 pointerSize;
+  UInt16 cgFloatSize;
+  UInt16 paragraphSize;
+  UInt16 truncationScopeSize;
+  UInt16 fontMetricsSize;
+  UInt16 colorHashBucketSize;
+  UInt16 maxTextStyleSize;
+  // Content fields
+  UInt16 fontCount;
+  UInt16 colorCount;
+  UInt8 defaultBaseWritingDirection;
+  bool defaultBaseWritingDirectionWasUsed;
+  Int32 stringLength;
+  Int32 paragraphCount;
+  Int32 truncationScopeCount;
+  UInt64 textStylesSize;
+  UInt64 archiveSize;
+};
+
+struct SerializedShapedStringLayout {
+  Int paragraphsOffset;
+  Int truncationScopesOffset;
+  Int fontMetricsOffset;
+  Int colorFlagsOffset;
+  Int colorHashBucketsOffset;
+  Int textStylesOffset;
+  Int archiveOffset;
+  Int size;
+
+  /// \pre The counts in the header must be non-negative and the sizes must be less than 2^32.
+  explicit SerializedShapedStringLayout(const SerializedShapedStringHeader& header) {
+    using Paragraph = ShapedString::Paragraph;
+    using ColorHashBucket = ShapedString::ColorHashBucket;
+    Int offset = sizeof(SerializedShapedStringHeader);
+    const auto section = [&](UInt size) -> Int {
+      const Int start = roundUpToMultipleOf<16>(offset);
+      offset = start + sign_cast(size);
+      return start;
+    };
+    paragraphsOffset = section(sizeof(Paragraph)*sign_cast(header.paragraphCount));
+    truncationScopesOffset = section(sizeof(TruncationScope)*sign_cast(header.truncationScopeCount));
+    fontMetricsOffset = section(sizeof(FontMetrics)*header.fontCount);
+    colorFlagsOffset = section(sizeof(ColorFlags)*header.colorCount);
+    colorHashBucketsOffset = section(sizeof(ColorHashBucket)*header.colorCount);
+    textStylesOffset = section(header.textStylesSize);
+    archiveOffset = section(header.archiveSize);
+    size = offset;
+  }
+};
+
+} // namespace
+
+static UInt64 shapedStringLayoutFingerprint() {
+  using Paragraph = ShapedString::Paragraph;
+  using ColorHashBucket = ShapedString::ColorHashBucket;
+  static constexpr UInt64 structLayoutHash =
+    layoutHash(sizeof(void*), sizeof(CGFloat),
+               sizeof(Paragraph), alignof(Paragraph),
+               offsetof(Paragraph, stringRange),
+               offsetof(Paragraph, textStylesOffset),
+               offsetof(Paragraph, truncationScopeIndex),
+               offsetof(Paragraph, maxNumberOfInitialLines),
+               offsetof(Paragraph, textFlags),
+               offsetof(Paragraph, hyphenationFactor),
+               offsetof(Paragraph, commonLeftIndent),
+               offsetof(Paragraph, commonRightIndent),
+               offsetof(Paragraph, initialExtraLeftIndent),
+               offsetof(Paragraph, initialExtraRightIndent),
+               offsetof(Paragraph, lineHeightParams),
+               offsetof(Paragraph, firstLineOffset),
+               offsetof(Paragraph, minBaselineDistance),
+               offsetof(Paragraph, paddingTop),
+               offsetof(Paragraph, paddingBottom),
+               offsetof(Paragraph, effectiveMinLineHeightInfo_),
+               sizeof(TruncationScope), alignof(TruncationScope),
+               offsetof(TruncationScope, stringRange),
+               offsetof(TruncationScope, truncatableStringRange),
+               offsetof(TruncationScope, maxLineCount),
+               offsetof(TruncationScope, finalLineTerminatorUTF16Length),
+               offsetof(TruncationScope, truncationToken),
+               sizeof(FontMetrics), alignof(FontMetrics),
+               sizeof(ColorFlags),
+               sizeof(ColorHashBucket), alignof(ColorHashBucket),
+               TextStyle::maxSize);
+  return dataLayoutFingerprint(structLayoutHash);
+}
+
+static bool hasCompatibleLayout(const SerializedShapedStringHeader& header) {
+  using Header = SerializedShapedStringHeader;
+  return header.magic == Header::magicValue
+      && header.version == Header::currentVersion
+      && header.layoutFingerprint == shapedStringLayoutFingerprint()
+      && header.pointerSize == sizeof(void*)
+      && header.cgFloatSize == sizeof(CGFloat)
+      && header.paragraphSize == sizeof(ShapedString::Paragraph)
+      && header.truncationScopeSize == sizeof(TruncationScope)
+      && header.fontMetricsSize == sizeof(FontMetrics)
+      && header.colorHashBucketSize == sizeof(ShapedString::ColorHashBucket)
+      && header.maxTextStyleSize == TextStyle::maxSize;
+}
+
+/// Resets the object pointers in the specified text style data with `resetTextStyleObjectPointers`.
+///
+/// Returns false if the data is not a well-formed text style sequence for a string with the
+/// specified length or if a required attribute value is missing.
+static bool resetShapedStringTextStyleObjectPointers(ArrayRef<Byte> data, Int32 stringLength,
+                                                     NSAttributedString* __unsafe_unretained
+                                                       __nullable string)
+{
+  STU_DEBUG_ASSERT(!string || string.length == sign_cast(stringLength));
+  const TextStyle* const terminator = resetTextStyleObjectPointers(data, Range{0, stringLength},
+                                                                   string);
+  return terminator
+      && reinterpret_cast<const Byte*>(terminator)
+         + TextStyle::sizeOfTerminatorWithStringIndex(stringLength) == data.end();
+}
+
+/// Checks the string ranges, array indices and text style offsets in deserialized arrays, so that
+/// corrupted data can't lead to out-of-bounds accesses.
+///
+/// \pre `arrays.textStyleDataIncludingTerminator` must have been checked with
+///       `resetShapedStringTextStyleObjectPointers`.
+static bool hasValidRangesAndIndices(const ShapedString::DeserializedArrays& arrays,
+                                     Int32 stringLength)
+{
+  const Int fontCount = arrays.fontMetrics.count();
+  const Int colorCount = arrays.colors.count();
+  const Int truncationScopeCount = arrays.truncationScopes.count();
+
+  for (const TruncationScope& scope : arrays.truncationScopes) {
+    if (!(0 <= scope.stringRange.start && scope.stringRange.start < scope.stringRange.end
+          && scope.stringRange.end <= stringLength
+          && scope.stringRange.start <= scope.truncatableStringRange.start
+          && scope.truncatableStringRange.start <= scope.truncatableStringRange.end
+          && scope.truncatableStringRange.end <= scope.stringRange.end
+          && scope.maxLineCount >= 0
+          && (scope.lastLineTruncationMode == kCTLineTruncationStart
+              || scope.lastLineTruncationMode == kCTLineTruncationEnd
+              || scope.lastLineTruncationMode == kCTLineTruncationMiddle)
+          && scope.finalLineTerminatorUTF16Length <= 2
+          && scope.finalLineTerminatorUTF16Length <= scope.stringRange.count()))
+    {
+      return false;
+    }
+  }
+
+  for (const ShapedString::ColorHashBucket& bucket : arrays.colorHashBuckets) {
+    if (bucket.isEmpty()
+        || !(ColorIndex::fixedColorIndexRange.end <= bucket.key()
+             && bucket.key() < ColorIndex::fixedColorIndexRange.end + colorCount))
+    {
+      return false;
+    }
+  }
+
+  const ArrayRef<const Byte> textStyles = arrays.textStyleDataIncludingTerminator;
+  const TextStyle* style = reinterpret_cast<const TextStyle*>(textStyles.begin());
+  for (;;) {
+    const TextStyle& next = style->next();
+    if (&next == style) break; // The terminator has no font or color.
+    if (style->fontIndex().value >= fontCount || !hasValidColorIndices(*style, colorCount)) {
+      return false;
+    }
+    style = &next;
+  }
+
+  if (arrays.paragraphs.isEmpty()) return stringLength == 0;
+  style = reinterpret_cast<const TextStyle*>(textStyles.begin());
+  Int32 stringIndex = 0;
+  for (const ShapedString::Paragraph& para : arrays.paragraphs) {
+    if (para.stringRange.start != stringIndex
+        || para.stringRange.end < para.stringRange.start
+        || para.stringRange.end > stringLength
+        || para.terminatorStringLength > para.stringRange.count()
+        || para.truncationScopeIndex >= truncationScopeCount
+        || !(0 <= para.hyphenationFactor && para.hyphenationFactor <= 1))
+    {
+      return false;
+    }
+    // The style offset must be the offset of a style in the sequence. The offsets are
+    // nondecreasing.
+    const Int paraStylesOffset = para.textStylesOffset;
+    for (;;) {
+      const Int offset = reinterpret_cast<const Byte*>(style) - textStyles.begin();
+      if (offset == paraStylesOffset) break;
+      const TextStyle& next = style->next();
+      if (offset > paraStylesOffset || &next == style) return false;
+      style = &next;
+    }
+    stringIndex = para.stringRange.end;
+  }
+  return stringIndex == stringLength;
+}
+
+NSSet<Class>* attributedStringArchiveClasses() {
+  STU_STATIC_CONST_ONCE(NSSet<Class>*, classes, ([[NSSet alloc] initWithObjects:
+    NSArray.class, NSDictionary.class, NSNull.class, NSAttributedString.class, NSString.class,
+    NSNumber.class, NSValue.class, NSData.class, NSDate.class, NSURL.class,
+    NSParagraphStyle.class, NSTextTab.class, NSShadow.class, NSTextAttachment.class,
+    STUColor.class, STUFont.class, STUImage.class,
+    STUBackgroundAttribute.class, STUParagraphStyle.class, STUTextAttachment.class,
+    STUTruncationScope.class, nil]));
+  return classes;
+}
+
+NSData* ShapedString::serializedData() const {
+  const ArraysRef tas = arrays();
+
+  NSMutableArray<STUColor*>* const colors = [[NSMutableArray alloc] initWithCapacity:colorCount];
+  for (const ColorRef& color : tas.colors) {
+    [colors addObject:[STUColor colorWithCGColor:color.cgColor()]];
+  }
+  NSData* archive;
+  @try {
+    // CTRunDelegate values don't support NSCoding. The deserialization recreates the run
+    // delegates from the STUTextAttachment attributes.
+    NSAttributedString* const string =
+      [attributedString stu_attributedStringByRemovingCTRunDelegates];
+    archive = [NSKeyedArchiver archivedDataWithRootObject:@[string, colors]
+                                    requiringSecureCoding:true error:nil];
+  } @catch (NSException* __unused exception) {
+    archive = nil;
+  }
+  if (!archive) return nil;
+
+  SerializedShapedStringHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = SerializedShapedStringHeader::magicValue;
+  header.version = SerializedShapedStringHeader::currentVersion;
+  header.layoutFingerprint = shapedStringLayoutFingerprint();
+  header.pointerSize = sizeof(void*);
+  header.cgFloatSize = sizeof(CGFloat);
+  header.paragraphSize = sizeof(Paragraph);
+  header.truncationScopeSize = sizeof(TruncationScope);
+  header.fontMetricsSize = sizeof(FontMetrics);
+  header.colorHashBucketSize = sizeof(ColorHashBucket);
+  header.maxTextStyleSize = TextStyle::maxSize;
+  header.fontCount = fontCount;
+  header.colorCount = colorCount;
+  header.defaultBaseWritingDirection = static_cast<UInt8>(defaultBaseWritingDirection);
+  header.defaultBaseWritingDirectionWasUsed = defaultBaseWritingDirectionWasUsed;
+  header.stringLength = stringLength;
+  header.paragraphCount = paragraphCount;
+  header.truncationScopeCount = truncationScopeCount;
+  header.textStylesSize = sign_cast(textStylesSize);
+  header.archiveSize = archive.length;
+
+  const SerializedShapedStringLayout layout{header};
+
+  NSMutableData* const data = [[NSMutableData alloc] initWithLength:sign_cast(layout.size)];
+  Byte* const bytes = static_cast<Byte*>(data.mutableBytes);
+  memcpy(bytes, &header, sizeof(header));
+  memcpy(bytes + layout.paragraphsOffset, tas.paragraphs.begin(),
+         tas.paragraphs.arraySizeInBytes());
+  {
+    TruncationScope* const scopes = reinterpret_cast<TruncationScope*>(
+                                      bytes + layout.truncationScopesOffset);
+    memcpy(scopes, tas.truncationSopes.begin(), tas.truncationSopes.arraySizeInBytes());
+    for (Int i = 0; i < truncationScopeCount; ++i) {
+      scopes[i].truncationToken = nil;
+    }
+  }
+  memcpy(bytes + layout.fontMetricsOffset, tas.fontMetrics.begin(),
+         tas.fontMetrics.arraySizeInBytes());
+  for (Int i = 0; i < colorCount; ++i) {
+    bytes[layout.colorFlagsOffset + i] = static_cast<Byte>(tas.colors[i].colorFlags());
+  }
+  memcpy(bytes + layout.colorHashBucketsOffset, tas.colorHashBuckets.begin(),
+         tas.colorHashBuckets.arraySizeInBytes());
+  {
+    const ArrayRef<Byte> textStyles{bytes + layout.textStylesOffset, textStylesSize};
+    memcpy(textStyles.begin(), tas.textStyles.dataBegin(), sign_cast(textStylesSize));
+    const bool isWellFormed = resetShapedStringTextStyleObjectPointers(textStyles, stringLength,
+                                                                       nil);
+    STU_ASSERT(isWellFormed);
+  }
+  memcpy(bytes + layout.archiveOffset, archive.bytes, archive.length);
+
+  return data;
+}
+
+ShapedString* __nullable
+  ShapedString::createFromSerializedData(NSData* __unsafe_unretained const unalignedData,
+                                         const FunctionRef<void*(UInt)> alloc)
+{
+  using Header = SerializedShapedStringHeader;
+
+  NSData* data = unalignedData;
+  if (reinterpret_cast<UInt>(data.bytes)%16 != 0) {
+    data = [[NSData alloc] initWithBytes:data.bytes length:data.length];
+    if (reinterpret_cast<UInt>(data.bytes)%16 != 0) return nullptr;
+  }
+  const UInt dataLength = data.length;
+  const Byte* const bytes = static_cast<const Byte*>(data.bytes);
+
+  if (dataLength < sizeof(Header)) return nullptr;
+  Header header;
+  memcpy(&header, bytes, sizeof(header));
+  if (!hasCompatibleLayout(header)
+      || header.defaultBaseWritingDirection > 1
+      || !(0 <= header.stringLength && header.stringLength < (1 << 30))
+      || !(0 <= header.paragraphCount && header.paragraphCount <= header.stringLength + 1)
+      || !(0 <= header.truncationScopeCount
+           && header.truncationScopeCount <= header.paragraphCount)
+      || header.textStylesSize > dataLength
+      || header.archiveSize > dataLength)
+  {
+    return nullptr;
+  }
+  const SerializedShapedStringLayout layout{header};
+  if (sign_cast(layout.size) != dataLength) return nullptr;
+
+  NSData* const archive = [data subdataWithRange:NSRange{sign_cast(layout.archiveOffset),
+                                                         header.archiveSize}];
+  const id root = [NSKeyedUnarchiver unarchivedObjectOfClasses:attributedStringArchiveClasses()
+                                                       fromData:archive error:nil];
+  if (![root isKindOfClass:NSArray.class] || [root count] != 2) return nullptr;
+  NSAttributedString* attributedString = [root objectAtIndex:0];
+  NSArray<STUColor*>* const colorObjects = [root objectAtIndex:1];
+  if (![attributedString isKindOfClass:NSAttributedString.class]
+      || attributedString.length != sign_cast(header.stringLength)
+      || ![colorObjects isKindOfClass:NSArray.class]
+      || colorObjects.count != header.colorCount)
+  {
+    return nullptr;
+  }
+  attributedString = [attributedString
+                        stu_attributedStringByAddingCTRunDelegatesForSTUTextAttachments];
+
+  const Int32 stringLength = header.stringLength;
+
+  TempArray<TruncationScope> truncationScopes{uninitialized,
+                                              Count{header.truncationScopeCount}};
+  if (!truncationScopes.isEmpty()) {
+    memcpy(truncationScopes.begin(), bytes + layout.truncationScopesOffset,
+           truncationScopes.arraySizeInBytes());
+  }
+  for (TruncationScope& scope : truncationScopes) {
+    const Int32 index = scope.stringRange.start;
+    if (!(0 <= index && index < stringLength)) return nullptr;
+    STUTruncationScope* const attribute = [attributedString attribute:STUTruncationScopeAttributeName
+                                                              atIndex:sign_cast(index)
+                                                       effectiveRange:nil];
+    if (![attribute isKindOfClass:STUTruncationScope.class]) return nullptr;
+    scope.truncationToken = attribute->_fixedTruncationToken;
+  }
+
+  TempArray<ColorRef> colors{uninitialized, Count{header.colorCount}};
+  for (Int i = 0; i < colors.count(); ++i) {
+    STUColor* const color = colorObjects[sign_cast(i)];
+    if (![color isKindOfClass:STUColor.class]) return nullptr;
+    const auto flags = static_cast<ColorFlags>(bytes[layout.colorFlagsOffset + i]);
+    colors[i] = ColorRef{color.CGColor, flags};
+  }
+
+  // The text style data must be 8-byte aligned.
+  TempArray<UInt64> textStylesStorage{uninitialized,
+                                      Count{narrow_cast<Int>((header.textStylesSize + 7)/8)}};
+  const ArrayRef<Byte> textStyles{reinterpret_cast<Byte*>(textStylesStorage.begin()),
+                                  narrow_cast<Int>(header.textStylesSize)};
+  memcpy(textStyles.begin(), bytes + layout.textStylesOffset, header.textStylesSize);
+  if (!resetShapedStringTextStyleObjectPointers(textStyles, stringLength, attributedString)) {
+    return nullptr;
+  }
+
+  const DeserializedArrays arrays = {
+    .paragraphs = {reinterpret_cast<const Paragraph*>(bytes + layout.paragraphsOffset),
+                   header.paragraphCount, unchecked},
+    .truncationScopes = truncationScopes,
+    .fontMetrics = {reinterpret_cast<const FontMetrics*>(bytes + layout.fontMetricsOffset),
+                    header.fontCount, unchecked},
+    .colors = colors,
+    .colorHashBuckets = {reinterpret_cast<const ColorHashBucket*>(
+                           bytes + layout.colorHashBucketsOffset),
+                         header.colorCount, unchecked},
+    .textStyleDataIncludingTerminator = textStyles
+  };
+
+  if (!hasValidRangesAndIndices(arrays, stringLength)) return nullptr;
+
+  const UInt size = allocationSize(arrays.paragraphs.count(), arrays.truncationScopes.count(),
+                                   arrays.fontMetrics.count(), arrays.colors.count(),
+                                   arrays.textStyleDataIncludingTerminator.count());
+
+  return new (alloc(size))
+             ShapedString{attributedString, stringLength,
+                          static_cast<STUWritingDirection>(header.defaultBaseWritingDirection),
+                          header.defaultBaseWritingDirectionWasUsed, arrays};
+}
+
+} // namespace stu_label
@@ -252,13 +252,15 @@ void BackgroundSegment::draw(ArrayRef<const TextFrameLine> lines, DrawingContext
   clipRect.x -= context.textFrameOrigin().x;
   const CGAffineTransform translation = {.a = 1, .d = 1, .tx = context.textFrameOrigin().x};
 
-  const RC<CGPath> path{CGPathCreateMutable(), ShouldIncrementRefCount{false}};
-  addLineSpansPath(*path, ArrayRef{spans, sign_cast(spanCount)}, verticalPositions,
-                   ShouldFillTextLineGaps{shouldFillLineGaps},
-                   // We already extended the spans if necessary.
-                   ShouldExtendTextLinesToCommonHorizontalBounds{false}, STUEdgeInsets{},
-                   CornerRadius{attribute ? attribute->_cornerRadius : 0},
-                   &clipRect, &translation);
+  // Highlights and backgrounds are often redrawn with identical geometry (e.g. during animations),
+  // so we use the path cache.
+  const RC<CGPath> path = createLineSpansPathUsingCache(
+                            ArrayRef{spans, sign_cast(spanCount)}, verticalPositions,
+                            ShouldFillTextLineGaps{shouldFillLineGaps},
+                            // We already extended the spans if necessary.
+                            ShouldExtendTextLinesToCommonHorizontalBounds{false}, STUEdgeInsets{},
+                            CornerRadius{attribute ? attribute->_cornerRadius : 0},
+                            &clipRect, &translation);
   CGContextAddPath(context.cgContext(), path.get());
   if (context.isCancelled()) return;
   CGContextDrawPath(context.cgContext(), mode);
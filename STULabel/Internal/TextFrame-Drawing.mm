@@ -98,6 +98,7 @@ void TextFrame::draw(CGPoint origin,
 
   const Point<Float64> textFrameOrigin = origin;
 
+  UInt drawnLineCount = 0;
   for (const TextFrameLine& line : this->lines()[clipLineRange]) {
     if (context.isCancelled()) break;
 
@@ -112,8 +113,10 @@ void TextFrame::draw(CGPoint origin,
     if (const auto scope = context.enterLineDrawingScope(line)) {
       context.setLineOrigin({cgLineOrigin.x, -cgLineOrigin.y});
       line.drawLLO(context);
+      ++drawnLineCount;
     }
   }
+  addToGlyphDrawingStatistics(drawnLineCount, context.glyphDrawCallCount());
 }
 
 } // namespace stu_label
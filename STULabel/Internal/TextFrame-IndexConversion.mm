@@ -8,12 +8,73 @@
 
 namespace stu_label {
 
-TextFrameIndex TextFrame::index(IndexInOriginalString unsignedIndexInOriginalString,
-                                IndexInTruncationToken indexInTruncationToken) const
+/// Returns the index of the last line whose start index (in the string selected by
+/// @c startIndex) is less than or equal to the specified string index.
+template <Int32 StringStartIndices::* startIndex>
+STU_INLINE
+Int32 searchLineIndex(ArrayRef<const StringStartIndices> lineStringIndices, Int32 stringIndex) {
+  return narrow_cast<Int32>(binarySearchFirstIndexWhere(lineStringIndices,
+                              [&](const StringStartIndices& si)
+                              { return si.*startIndex > stringIndex; }
+                            ).indexOrArrayCount - 1);
+}
+
+/// Finds line indices with a binary search over the full line table.
+template <Int32 StringStartIndices::* startIndex>
+struct LineIndexSearcher {
+  ArrayRef<const StringStartIndices> lineStringIndices;
+
+  STU_INLINE
+  Int32 operator()(Int32 stringIndex) const {
+    return searchLineIndex<startIndex>(lineStringIndices, stringIndex);
+  }
+};
+
+/// Finds line indices by scanning forward from the previously found line, so that the total cost
+/// for a sequence of ascending string indices is linear in the number of indices plus lines.
+/// Falls back to a binary search over the preceding lines when an index is smaller than the
+/// previous one.
+///
+/// @pre The string index must be less than the end index stored in the last (sentinel) entry of
+///      @c lineStringIndices.
+template <Int32 StringStartIndices::* startIndex>
+struct LineIndexCursor {
+  ArrayRef<const StringStartIndices> lineStringIndices;
+  Int32 lineIndex{};
+
+  STU_INLINE
+  Int32 operator()(Int32 stringIndex) {
+    const StringStartIndices* const indices = lineStringIndices.begin();
+    if (indices[lineIndex].*startIndex <= stringIndex) {
+      while (indices[lineIndex + 1].*startIndex <= stringIndex) {
+        ++lineIndex;
+      }
+    } else {
+      lineIndex = searchLineIndex<startIndex>(lineStringIndices[{0, lineIndex}], stringIndex);
+    }
+    STU_DEBUG_ASSERT(0 <= lineIndex && lineIndex + 1 < lineStringIndices.count());
+    return lineIndex;
+  }
+};
+
+using OriginalStringLineIndexSearcher =
+        LineIndexSearcher<&StringStartIndices::startIndexInOriginalString>;
+using TruncatedStringLineIndexSearcher =
+        LineIndexSearcher<&StringStartIndices::startIndexInTruncatedString>;
+using OriginalStringLineIndexCursor =
+        LineIndexCursor<&StringStartIndices::startIndexInOriginalString>;
+using TruncatedStringLineIndexCursor =
+        LineIndexCursor<&StringStartIndices::startIndexInTruncatedString>;
+
+template <typename FindLineIndex>
+static TextFrameIndex indexImpl(const TextFrame& textFrame,
+                                IndexInOriginalString unsignedIndexInOriginalString,
+                                IndexInTruncationToken indexInTruncationToken,
+                                FindLineIndex&& findLineIndex)
 {
-  const Range<UInt32> fullRangeInOriginalString = Range<UInt32>(rangeInOriginalString());
+  const Range<UInt32> fullRangeInOriginalString = Range<UInt32>(textFrame.rangeInOriginalString());
   if (unsignedIndexInOriginalString >= fullRangeInOriginalString.end) {
-    return endIndex();
+    return textFrame.endIndex();
   }
   if (unsignedIndexInOriginalString <= fullRangeInOriginalString.start) {
     if (indexInTruncationToken <= 0u) {
@@ -22,13 +83,9 @@ TextFrameIndex TextFrame::index(IndexInOriginalString unsignedIndexInOriginalStr
     unsignedIndexInOriginalString.value = fullRangeInOriginalString.start;
   }
   const Int32 indexInOriginalString = static_cast<Int32>(unsignedIndexInOriginalString.value);
-  const Int32 lineIndex = narrow_cast<Int32>(
-                            binarySearchFirstIndexWhere(lineStringIndices(),
-                              [&](const StringStartIndices& si)
-                              { return si.startIndexInOriginalString > indexInOriginalString; }
-                            ).indexOrArrayCount - 1);
-  const Int32 paraIndex = lines()[lineIndex].paragraphIndex;
-  const TextFrameParagraph& para = paragraphs()[paraIndex];
+  const Int32 lineIndex = findLineIndex(indexInOriginalString);
+  const Int32 paraIndex = textFrame.lines()[lineIndex].paragraphIndex;
+  const TextFrameParagraph& para = textFrame.paragraphs()[paraIndex];
   Int32 index;
   if (indexInOriginalString < para.excisedRangeInOriginalString().start) {
     index = para.rangeInTruncatedString.start
@@ -62,46 +119,70 @@ Return:
                            .lineIndex = sign_cast(lineIndex)};
 }
 
-TextFrameIndex TextFrame::index(IndexInTruncatedString unsignedIndexInTruncatedString) const {
-  if (unsignedIndexInTruncatedString >= sign_cast(truncatedStringLength)) {
-    return endIndex();
+TextFrameIndex TextFrame::index(IndexInOriginalString indexInOriginalString,
+                                IndexInTruncationToken indexInTruncationToken) const
+{
+  return indexImpl(*this, indexInOriginalString, indexInTruncationToken,
+                   OriginalStringLineIndexSearcher{lineStringIndices()});
+}
+
+template <typename FindLineIndex>
+static TextFrameIndex indexImpl(const TextFrame& textFrame,
+                                IndexInTruncatedString unsignedIndexInTruncatedString,
+                                FindLineIndex&& findLineIndex)
+{
+  if (unsignedIndexInTruncatedString >= sign_cast(textFrame.truncatedStringLength)) {
+    return textFrame.endIndex();
   }
   if (unsignedIndexInTruncatedString == 0u) {
     return TextFrameIndex{};
   }
   const Int32 indexInTruncatedString = static_cast<Int32>(unsignedIndexInTruncatedString.value);
-  const Int32 lineIndex = narrow_cast<Int32>(
-                            binarySearchFirstIndexWhere(lineStringIndices(),
-                              [&](const StringStartIndices& si)
-                              { return si.startIndexInTruncatedString > indexInTruncatedString; }
-                            ).indexOrArrayCount - 1);
-  STU_DEBUG_ASSERT(0 <= lineIndex && lineIndex < lineCount);
+  const Int32 lineIndex = findLineIndex(indexInTruncatedString);
+  STU_DEBUG_ASSERT(0 <= lineIndex && lineIndex < textFrame.lineCount);
   return STUTextFrameIndex{.indexInTruncatedString = sign_cast(indexInTruncatedString),
                            .lineIndex = sign_cast(lineIndex)};
 }
 
-Range<TextFrameIndex> TextFrame::range(RangeInOriginalString<NSRange> rangeInOriginalString) const {
+TextFrameIndex TextFrame::index(IndexInTruncatedString indexInTruncatedString) const {
+  return indexImpl(*this, indexInTruncatedString,
+                   TruncatedStringLineIndexSearcher{lineStringIndices()});
+}
+
+template <typename FindStartLineIndex, typename FindEndLineIndex>
+static Range<TextFrameIndex> rangeImpl(const TextFrame& textFrame,
+                                       RangeInOriginalString<NSRange> rangeInOriginalString,
+                                       FindStartLineIndex&& findStartLineIndex,
+                                       FindEndLineIndex&& findEndLineIndex)
+{
   const NSRange range = rangeInOriginalString.value;
   NSUInteger rangeEnd;
   if (__builtin_add_overflow(range.location, range.length, &rangeEnd)) {
     rangeEnd = NSUIntegerMax;
   }
-  if (Range<UInt>(range.location, rangeEnd).contains(this->rangeInOriginalString())) {
-    return STUTextFrameRange{TextFrameIndex{}, endIndex()};
+  if (Range<UInt>(range.location, rangeEnd).contains(textFrame.rangeInOriginalString())) {
+    return STUTextFrameRange{TextFrameIndex{}, textFrame.endIndex()};
   }
-  const auto start = index(IndexInOriginalString{range.location}, IndexInTruncationToken{});
+  const auto start = indexImpl(textFrame, IndexInOriginalString{range.location},
+                               IndexInTruncationToken{}, findStartLineIndex);
   const auto end = range.location == rangeEnd ? start
-                 : index(IndexInOriginalString{rangeEnd},
-                         IndexInTruncationToken{UInt32{INT32_MAX}});
+                 : indexImpl(textFrame, IndexInOriginalString{rangeEnd},
+                             IndexInTruncationToken{UInt32{INT32_MAX}}, findEndLineIndex);
   return TextFrameRange{start, end};
 }
 
-Range<TextFrameIndex> TextFrame::range(RangeInTruncatedString<NSRange> rangeInTruncatedString) const {
+template <typename FindStartLineIndex, typename FindEndLineIndex>
+static Range<TextFrameIndex> rangeImpl(const TextFrame& textFrame,
+                                       RangeInTruncatedString<NSRange> rangeInTruncatedString,
+                                       FindStartLineIndex&& findStartLineIndex,
+                                       FindEndLineIndex&& findEndLineIndex)
+{
   const NSRange range = rangeInTruncatedString.value;
-  if (range.location == 0 && range.length >= sign_cast(truncatedStringLength)) {
-    return TextFrameRange{TextFrameIndex{}, endIndex()};
+  if (range.location == 0 && range.length >= sign_cast(textFrame.truncatedStringLength)) {
+    return TextFrameRange{TextFrameIndex{}, textFrame.endIndex()};
   }
-  const auto start = index(IndexInTruncatedString{range.location});
+  const auto start = indexImpl(textFrame, IndexInTruncatedString{range.location},
+                               findStartLineIndex);
   TextFrameIndex end;
   if (range.length == 0) {
     end = start;
@@ -110,11 +191,46 @@ Range<TextFrameIndex> TextFrame::range(RangeInTruncatedString<NSRange> rangeInTr
     if (__builtin_add_overflow(range.location, range.length, &rangeEnd)) {
       rangeEnd = NSUIntegerMax;
     }
-    end = index(IndexInTruncatedString{rangeEnd});
+    end = indexImpl(textFrame, IndexInTruncatedString{rangeEnd}, findEndLineIndex);
   }
   return STUTextFrameRange{start, end};
 }
 
+Range<TextFrameIndex> TextFrame::range(RangeInOriginalString<NSRange> rangeInOriginalString) const {
+  const OriginalStringLineIndexSearcher searcher{lineStringIndices()};
+  return rangeImpl(*this, rangeInOriginalString, searcher, searcher);
+}
+
+Range<TextFrameIndex> TextFrame::range(RangeInTruncatedString<NSRange> rangeInTruncatedString) const {
+  const TruncatedStringLineIndexSearcher searcher{lineStringIndices()};
+  return rangeImpl(*this, rangeInTruncatedString, searcher, searcher);
+}
+
+// The batch conversions use separate cursors for the start and the end indices, since the range
+// starts and the range ends each form an ascending sequence when the ranges are sorted by their
+// start and don't overlap. (Overlapping or unsorted input is handled correctly, just less
+// efficiently.)
+
+void TextFrame::ranges(RangesInOriginalString ranges, ArrayRef<TextFrameRange> outRanges) const {
+  STU_CHECK(ranges.value.count() == outRanges.count());
+  OriginalStringLineIndexCursor startCursor{lineStringIndices()};
+  OriginalStringLineIndexCursor endCursor{lineStringIndices()};
+  TextFrameRange* out = outRanges.begin();
+  for (const NSRange& range : ranges.value) {
+    *out++ = rangeImpl(*this, RangeInOriginalString{range}, startCursor, endCursor);
+  }
+}
+
+void TextFrame::ranges(RangesInTruncatedString ranges, ArrayRef<TextFrameRange> outRanges) const {
+  STU_CHECK(ranges.value.count() == outRanges.count());
+  TruncatedStringLineIndexCursor startCursor{lineStringIndices()};
+  TruncatedStringLineIndexCursor endCursor{lineStringIndices()};
+  TextFrameRange* out = outRanges.begin();
+  for (const NSRange& range : ranges.value) {
+    *out++ = rangeImpl(*this, RangeInTruncatedString{range}, startCursor, endCursor);
+  }
+}
+
 Optional<TextFrameIndex> TextFrame::normalize(TextFrameIndex index) const {
   const Int32 indexInTruncatedString = sign_cast(index.indexInTruncatedString);
   const UInt32 lineIndex = index.lineIndex;
@@ -209,4 +325,15 @@ Range<Int32> TextFrame::rangeInOriginalString(STUTextFrameRange range) const {
   return {start, end};
 }
 
+void TextFrame::rangesInOriginalString(ArrayRef<const TextFrameRange> ranges,
+                                       ArrayRef<NSRange> outRanges) const
+{
+  STU_CHECK(ranges.count() == outRanges.count());
+  // Text frame indices already store the line index, so no line search is needed here.
+  NSRange* out = outRanges.begin();
+  for (const TextFrameRange& range : ranges) {
+    *out++ = NSRange(rangeInOriginalString(range));
+  }
+}
+
 } // stu_label
@@ -17,11 +17,14 @@ NSDictionary<NSString*, id>* __nullable TextFrame::attributesAt(TextFrameIndex i
   }
 }
 
-static
-NSAttributedString* __nonnull creatTextFrameTruncatedAttributedString(const TextFrame& textFrame)
-                                NS_RETURNS_RETAINED
+/// Returns the paragraphs covered by the truncated string, without any trailing paragraphs that
+/// were fully excised.
+static ArrayRef<const TextFrameParagraph>
+         truncatedStringParagraphs(const TextFrame& textFrame,
+                                   Out<Range<Int32>> outRangeInOriginalString)
 {
-  Range<Int32> rangeInOriginalString = textFrame.rangeInOriginalString();
+  Range<Int32>& rangeInOriginalString = outRangeInOriginalString;
+  rangeInOriginalString = textFrame.rangeInOriginalString();
   ArrayRef<const TextFrameParagraph> paras = textFrame.paragraphs();
   for (Int i = paras.count(); i > 0; --i) {
     auto& para = paras[i - 1];
@@ -31,6 +34,16 @@ NSAttributedString* __nonnull creatTextFrameTruncatedAttributedString(const Text
       break;
     }
   }
+  return paras;
+}
+
+static
+NSAttributedString* __nonnull creatTextFrameTruncatedAttributedString(const TextFrame& textFrame)
+                                NS_RETURNS_RETAINED
+{
+  Range<Int32> rangeInOriginalString;
+  const ArrayRef<const TextFrameParagraph> paras =
+    truncatedStringParagraphs(textFrame, Out{rangeInOriginalString});
   NSMutableAttributedString* mutableString;
   if (textFrame.rangeInOriginalStringIsFullString
       && rangeInOriginalString == textFrame.rangeInOriginalString())
@@ -68,6 +81,133 @@ NSAttributedString* __nonnull creatTextFrameTruncatedAttributedString(const Text
   return [mutableString copy];
 }
 
+/// Calls `body(startInTruncatedString, source, rangeInSource)` for the consecutive substrings of
+/// the original string and the truncation tokens that make up the truncated string.
+template <typename Body>
+static ShouldStop forEachTruncatedStringSegment(const TextFrame& textFrame, Body&& body) {
+  Range<Int32> rangeInOriginalString;
+  const ArrayRef<const TextFrameParagraph> paras =
+    truncatedStringParagraphs(textFrame, Out{rangeInOriginalString});
+  NSAttributedString* __unsafe_unretained const original = textFrame.originalAttributedString;
+  Int32 indexInTruncatedString = 0;
+  Int32 indexInOriginalString = rangeInOriginalString.start;
+  if (textFrame.flags & STUTextFrameIsTruncated) {
+    for (auto para = paras.begin(), end = paras.end(); para < end; ++para) {
+      NSAttributedString* __unsafe_unretained const token = para->truncationToken;
+      const Range<Int32> tokenRange = para->rangeOfTruncationTokenInTruncatedString();
+      const Int32 excisionStart = para->excisedRangeInOriginalString().start;
+      while (para->excisedStringRangeIsContinuedInNextParagraph && para + 1 < end) {
+        ++para;
+      }
+      const Int32 excisionEnd = para->excisedRangeInOriginalString().end;
+      if (excisionStart == excisionEnd && !token) continue;
+      STU_DEBUG_ASSERT(tokenRange.start - indexInTruncatedString
+                       == excisionStart - indexInOriginalString);
+      if (indexInOriginalString < excisionStart) {
+        if (body(indexInTruncatedString, original,
+                 Range{indexInOriginalString, excisionStart}))
+        {
+          return ShouldStop{true};
+        }
+      }
+      if (token && !tokenRange.isEmpty()) {
+        if (body(tokenRange.start, token, tokenRange - tokenRange.start)) {
+          return ShouldStop{true};
+        }
+      }
+      indexInTruncatedString = tokenRange.end;
+      indexInOriginalString = excisionEnd;
+    }
+  }
+  if (indexInOriginalString < rangeInOriginalString.end) {
+    return body(indexInTruncatedString, original,
+                Range{indexInOriginalString, rangeInOriginalString.end});
+  }
+  return ShouldStop{};
+}
+
+/// Returns the truncated string if it doesn't need to be created or was already created.
+static NSAttributedString* __nullable existingTruncatedAttributedString(const TextFrame& textFrame)
+{
+  if (!(textFrame.flags & STUTextFrameIsTruncated) && textFrame.rangeInOriginalStringIsFullString) {
+    return textFrame.originalAttributedString;
+  }
+  _Atomic(CFAttributedStringRef)* const pAttributedString =
+    const_cast<_Atomic(CFAttributedStringRef)*>(&textFrame._truncatedAttributedString);
+  return (__bridge NSAttributedString*)atomic_load_explicit(pAttributedString,
+                                                            memory_order_acquire);
+}
+
+static ShouldStop forEachAttributeRunInSource(
+                    NSAttributedString* __unsafe_unretained source, Range<Int32> rangeInSource,
+                    Int32 startInTruncatedString,
+                    FunctionRef<ShouldStop(const TruncatedStringRun&)> body)
+{
+  const Int32 offset = startInTruncatedString - rangeInSource.start;
+  for (Int32 index = rangeInSource.start; index < rangeInSource.end;) {
+    NSRange effectiveRange;
+    NSDictionary<NSAttributedStringKey, id>* __unsafe_unretained const attributes =
+      [source attributesAtIndex:sign_cast(index) effectiveRange:&effectiveRange];
+    const Int32 end = min(rangeInSource.end, narrow_cast<Int32>(NSMaxRange(effectiveRange)));
+    const Range<Int32> runRange{index, end};
+    if (body(TruncatedStringRun{.rangeInTruncatedString = runRange + offset,
+                                .source = source,
+                                .rangeInSource = runRange,
+                                .attributes = attributes}))
+    {
+      return ShouldStop{true};
+    }
+    index = end;
+  }
+  return ShouldStop{};
+}
+
+ShouldStop TextFrame::forEachTruncatedStringAttributeRun(
+                        Range<Int32> range,
+                        FunctionRef<ShouldStop(const TruncatedStringRun&)> body) const
+{
+  range.intersect(rangeInTruncatedString());
+  if (range.isEmpty()) return ShouldStop{};
+  if (NSAttributedString* const string = existingTruncatedAttributedString(*this)) {
+    return forEachAttributeRunInSource(string, range, range.start, body);
+  }
+  return forEachTruncatedStringSegment(*this,
+           [&](Int32 startInTruncatedString, NSAttributedString* __unsafe_unretained source,
+               Range<Int32> rangeInSource) -> ShouldStop
+  {
+    const Int32 offset = rangeInSource.start - startInTruncatedString;
+    const Range<Int32> segment = rangeInSource - offset;
+    if (segment.start >= range.end) return ShouldStop{true};
+    const Range<Int32> subrange = segment.intersection(range);
+    if (subrange.isEmpty()) return ShouldStop{};
+    return forEachAttributeRunInSource(source, subrange + offset, subrange.start, body);
+  });
+}
+
+NSAttributedString* __nonnull TextFrame::truncatedAttributedSubstring(Range<Int32> range) const {
+  range.intersect(rangeInTruncatedString());
+  if (NSAttributedString* const string = existingTruncatedAttributedString(*this)) {
+    return [string attributedSubstringFromRange:NSRange(range)];
+  }
+  NSMutableAttributedString* const substring = [[NSMutableAttributedString alloc] init];
+  if (range.isEmpty()) return substring;
+  forEachTruncatedStringSegment(*this,
+    [&](Int32 startInTruncatedString, NSAttributedString* __unsafe_unretained source,
+        Range<Int32> rangeInSource) -> ShouldStop
+  {
+    const Int32 offset = rangeInSource.start - startInTruncatedString;
+    const Range<Int32> segment = rangeInSource - offset;
+    if (segment.start >= range.end) return ShouldStop{true};
+    const Range<Int32> subrange = segment.intersection(range);
+    if (!subrange.isEmpty()) {
+      [substring appendAttributedString:[source attributedSubstringFromRange:
+                                                  NSRange(subrange + offset)]];
+    }
+    return ShouldStop{};
+  });
+  return [substring copy];
+}
+
 Unretained<NSAttributedString* __nonnull> TextFrame::truncatedAttributedString() const {
   if (!(flags & STUTextFrameIsTruncated) && rangeInOriginalStringIsFullString) {
     return originalAttributedString;
@@ -24,6 +24,8 @@
 
 #import <stdatomic.h>
 
+#include <atomic>
+
 #include "DefineUIntOnCatalystToWorkAroundGlobalNamespacePollution.h"
 
 STU_INLINE
@@ -116,6 +118,33 @@ struct ImageBoundsContext {
   }
 };
 
+/// The parameters that determine the result of a `STUTextFrameGetImageBoundsForRange` call.
+struct ImageBoundsCacheKey {
+  STUTextFrameRange range;
+  CGPoint origin;
+  CGFloat displayScale;
+  STUTextFrameDrawingMode drawingMode;
+  bool hasHighlightTextFrameRange;
+  STUTextHighlightStyle* __unsafe_unretained __nullable highlightStyle;
+  union {
+    STUTextFrameRange highlightTextFrameRange;
+    STUTextRange highlightTextRange;
+  };
+
+  bool operator==(const ImageBoundsCacheKey& other) const {
+    return range == other.range
+        && origin == other.origin
+        && displayScale == other.displayScale
+        && drawingMode == other.drawingMode
+        && highlightStyle == other.highlightStyle
+        && hasHighlightTextFrameRange == other.hasHighlightTextFrameRange
+        && (!highlightStyle
+            || (hasHighlightTextFrameRange
+                ? highlightTextFrameRange == other.highlightTextFrameRange
+                : highlightTextRange == other.highlightTextRange));
+  }
+};
+
 #define STU_ASSUME_REGULAR_INDEX_RANGE(range) \
   STU_ASSUME(0 <= range.start && range.start <= range.end)
 
@@ -128,6 +157,17 @@ struct TruncationTokenIndex {
   NSAttributedString* __unsafe_unretained __nullable truncationToken;
 };
 
+/// An attribute run of the truncated string, represented as a view onto the original string or a
+/// truncation token.
+struct TruncatedStringRun {
+  Range<Int32> rangeInTruncatedString;
+  /// The original attributed string, a truncation token or the already created truncated string.
+  NSAttributedString* __unsafe_unretained source;
+  /// The range of the run in `source`.
+  Range<Int32> rangeInSource;
+  NSDictionary<NSAttributedStringKey, id>* __unsafe_unretained attributes;
+};
+
 struct IndexInOriginalString : Parameter<IndexInOriginalString, UInt> {
   using Parameter::Parameter;
 };
@@ -156,13 +196,22 @@ RangeInTruncatedString(NSRange) -> RangeInTruncatedString<NSRange>;
 template <typename T>
 RangeInTruncatedString(Range<T>) -> RangeInTruncatedString<Range<T>>;
 
+struct RangesInOriginalString : Parameter<RangesInOriginalString, ArrayRef<const NSRange>> {
+  using Parameter::Parameter;
+};
+struct RangesInTruncatedString : Parameter<RangesInTruncatedString, ArrayRef<const NSRange>> {
+  using Parameter::Parameter;
+};
+
 struct TextFrameOrigin : Parameter<TextFrameOrigin, Point<Float64>> {
   using Parameter::Parameter;
 };
 
 struct TextFrameLine;
 struct TextFrameParagraph;
+struct TextFrameImageBoundsCache;
 class TextFrameLayouter;
+class ShapedString;
 
 struct StringStartIndices {
   Int32 startIndexInOriginalString;
@@ -197,18 +246,45 @@ struct TextFrame : STUTextFrameData {
 
   NSDictionary<NSString*, id>* __nullable attributesAt(TextFrameIndex) const;
 
+  /// Creates the truncated attributed string on first access and caches it.
   Unretained<NSAttributedString* __nonnull> truncatedAttributedString() const;
 
+  /// Calls `body` for the attribute runs of the truncated string in the specified range, clipped to
+  /// the range. Doesn't create the truncated attributed string. Adjacent runs may have equal
+  /// attributes.
+  ShouldStop forEachTruncatedStringAttributeRun(
+               Range<Int32> rangeInTruncatedString,
+               FunctionRef<ShouldStop(const TruncatedStringRun&)> body) const;
+
+  /// Only creates the specified substring, unless the full truncated string was already created.
+  NSAttributedString* __nonnull truncatedAttributedSubstring(Range<Int32> rangeInTruncatedString)
+                                  const NS_RETURNS_RETAINED;
+
   STU_INLINE
   ArrayRef<const TextFrameParagraph> paragraphs() const;
 
   STU_INLINE
   ArrayRef<const TextFrameLine> lines() const;
 
+  /// The data of the text frame that isn't part of the public `STUTextFrameData` struct. It's
+  /// stored directly in front of the `STUTextFrameData` in the text frame's memory block.
+  struct PrivateData {
+    /// Allocated by the first `cacheImageBounds` call.
+    mutable std::atomic<TextFrameImageBoundsCache*> imageBoundsCache;
+    /// Indicates whether the results of image bounds calculations are memoized.
+    bool cachesImageBounds;
+  };
+
+  STU_INLINE
+  const PrivateData& privateData() const {
+    return *(const PrivateData*)((const Byte*)this - sizeof(PrivateData));
+  }
+
   STU_INLINE
   ArrayRef<const StringStartIndices> lineStringIndices() const {
     const Int n = lineCount + 1;
-    return {(const StringStartIndices*)((const Byte*)this - sanitizerGap) - n, n, unchecked};
+    return {(const StringStartIndices*)((const Byte*)&privateData() - sanitizerGap) - n, n,
+            unchecked};
   }
 
   STU_INLINE
@@ -224,6 +300,12 @@ struct TextFrame : STUTextFrameData {
             - _colorCount, _colorCount};
   }
 
+  /// The size of the text style data for the original string and the truncation tokens.
+  STU_INLINE
+  Int textStylesDataSize() const {
+    return (const Byte*)this + _dataSize - sanitizerGap - _textStylesData;
+  }
+
   STU_INLINE
   TextFrameIndex endIndex() const { return STUTextFrameDataGetEndIndex(this); }
 
@@ -240,6 +322,12 @@ struct TextFrame : STUTextFrameData {
   Range<TextFrameIndex> range(RangeInOriginalString<NSRange>) const;
   Range<TextFrameIndex> range(RangeInTruncatedString<NSRange>) const;
 
+  /// Batch variants of the above range conversions, which are optimized for ranges sorted by
+  /// their start index.
+  /// @pre `ranges.value.count() == outRanges.count()`
+  void ranges(RangesInOriginalString ranges, ArrayRef<TextFrameRange> outRanges) const;
+  void ranges(RangesInTruncatedString ranges, ArrayRef<TextFrameRange> outRanges) const;
+
   Range<TextFrameIndex> range(STUTextRange textRange) const {
     if (textRange.type == STURangeInOriginalString) {
       return range(RangeInOriginalString{textRange.range});
@@ -252,6 +340,10 @@ struct TextFrame : STUTextFrameData {
                                      Optional<Out<TruncationTokenIndex>> = none) const;
   Range<Int32> rangeInOriginalString(STUTextFrameRange) const;
 
+  /// @pre `ranges.count() == outRanges.count()`
+  void rangesInOriginalString(ArrayRef<const TextFrameRange> ranges,
+                              ArrayRef<NSRange> outRanges) const;
+
   TruncationTokenIndex truncationTokenIndex(TextFrameIndex index) const {
     TruncationTokenIndex result;
     rangeInOriginalString(index, Out{result});
@@ -289,6 +381,14 @@ struct TextFrame : STUTextFrameData {
 
   Rect<CGFloat> calculateImageBounds(TextFrameOrigin, const ImageBoundsContext&) const;
 
+  /// Returns the memoized result of a previous `STUTextFrameGetImageBoundsForRange` call with the
+  /// same parameters, if there is one.
+  /// Thread-safe.
+  Optional<Rect<CGFloat>> cachedImageBounds(const ImageBoundsCacheKey&) const;
+
+  /// Thread-safe.
+  void cacheImageBounds(const ImageBoundsCacheKey&, Rect<CGFloat> bounds) const;
+
   static CGFloat assumedScaleForCTM(const CGAffineTransform& ctm) {
     const CGFloat scale = stu_label::scale(ctm);
     return scale > 1/64.f ? scale : 0;
@@ -302,6 +402,21 @@ struct TextFrame : STUTextFrameData {
 
   ~TextFrame();
 
+  /// Returns a position-independent snapshot of the text frame data that can be turned back into
+  /// a text frame with `createFromSnapshotData`, or null if the truncation tokens can't be
+  /// archived.
+  NSData* __nullable snapshotData() const API_AVAILABLE(ios(11.0), tvos(11.0));
+
+  /// Returns null if the data is not a valid snapshot of a text frame created from the specified
+  /// shaped string.
+  ///
+  /// @param alloc Is called once with the required size in bytes and must return a suitably
+  ///              aligned memory block of that size. The TextFrame is constructed inside the
+  ///              block (not necessarily at its start).
+  static TextFrame* __nullable createFromSnapshotData(NSData*, const ShapedString&,
+                                                      FunctionRef<void*(UInt)> alloc)
+                                 API_AVAILABLE(ios(11.0), tvos(11.0));
+
 private:
   friend STUTextFrame* ::STUTextFrameCreateWithShapedStringRange(Class, STUShapedString*, NSRange,
                                                                  CGSize, CGFloat,
@@ -315,8 +430,18 @@ private:
       UInt offset;
   };
   static SizeAndOffset objectSizeAndThisOffset(const TextFrameLayouter& layouter);
+  static SizeAndOffset objectSizeAndThisOffset(Int paragraphCount, Int lineCount, Int colorCount,
+                                               Int textStylesSize);
 
   explicit TextFrame(TextFrameLayouter&& layouter, UInt dataSize);
+
+  /// Only copies the STUTextFrameData fields. Used by createFromSnapshotData.
+  explicit TextFrame(const STUTextFrameData& data);
+
+  void poisonSanitizerGaps() const;
+
+  STU_INLINE
+  PrivateData& mutablePrivateData() { return const_cast<PrivateData&>(privateData()); }
 };
 
 
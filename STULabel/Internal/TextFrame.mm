@@ -4,16 +4,53 @@
 
 #import "CancellationFlag.hpp"
 #import "CoreGraphicsUtils.hpp"
+#import "DataLayoutFingerprint.hpp"
+#import "Kerning.hpp"
 #import "TextFrameLayouter.hpp"
 
+#import "STULabel/stu_mutex.h"
+
+#import <CommonCrypto/CommonDigest.h>
+
 #include "DefineUIntOnCatalystToWorkAroundGlobalNamespacePollution.h"
 
 namespace stu_label {
 
+/// A small LRU cache of `STUTextFrameGetImageBoundsForRange` results. Lazily allocated.
+struct TextFrameImageBoundsCache {
+  struct Entry {
+    ImageBoundsCacheKey key;
+    Rect<CGFloat> bounds;
+    /// Keeps the highlight style alive while the entry exists, so that the pointer comparison in
+    /// `ImageBoundsCacheKey::operator==` can't produce a false positive.
+    STUTextHighlightStyle* highlightStyle; // arc
+  };
+
+  static constexpr Int capacity = 4;
+
+  stu_mutex mutex;
+  Int count;
+  /// Ordered from the most recently to the least recently used entry.
+  Entry entries[capacity];
+};
+
 TextFrame::SizeAndOffset TextFrame::objectSizeAndThisOffset(const TextFrameLayouter& layouter) {
+  const Int stylesTerminatorSize = TextStyle::sizeOfTerminatorWithStringIndex(
+                                                layouter.rangeInOriginalString().end);
+  return objectSizeAndThisOffset(
+           layouter.paragraphs().count(), layouter.lines().count(), layouter.colors().count(),
+           layouter.originalStringStyles().dataExcludingTerminator().count()
+           + stylesTerminatorSize
+           + layouter.truncationTokenTextStyleData().count());
+}
+
+TextFrame::SizeAndOffset TextFrame::objectSizeAndThisOffset(Int paragraphCount, Int lineCount,
+                                                            Int colorCount, Int textStylesSize)
+{
   // The data layout must be kept in-sync with
   //   TextFrame::verticalSearchTable
   //   TextFrame::lineStringIndices
+  //   TextFrame::privateData
   //   STUTextFrameDataGetParagraphs
   //   STUTextFrameDataGetLines
   //   STUTextFrameLineGetParagraph
@@ -22,37 +59,43 @@ TextFrame::SizeAndOffset TextFrame::objectSizeAndThisOffset(const TextFrameLayou
 
   static_assert(IntervalSearchTable::arrayElementSize%alignof(STUTextFrameData) == 0
                 && sizeof(StringStartIndices)%alignof(STUTextFrameData) == 0
+                && sizeof(PrivateData)%alignof(STUTextFrameData) == 0
                 && alignof(STUTextFrameData) == alignof(STUTextFrameLine)
                 && alignof(STUTextFrameData) == alignof(STUTextFrameParagraph)
                 && alignof(STUTextFrameData) == alignof(ColorRef)
                 && alignof(STUTextFrameData) >= alignof(TextStyle));
 
-  const Int lineCount = layouter.lines().count();
-
   const UInt verticalSearchTableSize = IntervalSearchTable::sizeInBytesForCount(lineCount);
   const UInt lineStringIndicesTableSize = sizeof(StringStartIndices)*sign_cast(lineCount + 1);
-  const Int stylesTerminatorSize = TextStyle::sizeOfTerminatorWithStringIndex(
-                                                layouter.rangeInOriginalString().end);
-  const ArrayRef<const ColorRef> colors = layouter.colors();
 
   return {.offset = verticalSearchTableSize + sanitizerGap
-                  + lineStringIndicesTableSize + sanitizerGap,
+                  + lineStringIndicesTableSize + sanitizerGap
+                  + sizeof(PrivateData),
           .size = verticalSearchTableSize
                 + sanitizerGap
                 + lineStringIndicesTableSize
                 + sanitizerGap
+                + sizeof(PrivateData)
                 + sizeof(STUTextFrameData)
-                + layouter.paragraphs().arraySizeInBytes()
-                + layouter.lines().arraySizeInBytes()
+                + sizeof(TextFrameParagraph)*sign_cast(paragraphCount)
+                + sizeof(TextFrameLine)*sign_cast(lineCount)
                 + sanitizerGap
-                + colors.arraySizeInBytes()
+                + sizeof(ColorRef)*sign_cast(colorCount)
                 + sanitizerGap
-                + layouter.originalStringStyles().dataExcludingTerminator().arraySizeInBytes()
-                + sign_cast(stylesTerminatorSize)
-                + layouter.truncationTokenTextStyleData().arraySizeInBytes()
+                + sign_cast(textStylesSize)
                 + sanitizerGap};
 }
 
+void TextFrame::poisonSanitizerGaps() const {
+#if STU_USE_ADDRESS_SANITIZER
+  sanitizer::poison((Byte*)verticalSearchTable().startValues().end(), sanitizerGap);
+  sanitizer::poison((Byte*)lineStringIndices().end(), sanitizerGap);
+  sanitizer::poison((Byte*)lines().end(), sanitizerGap);
+  sanitizer::poison((Byte*)colors().end(), sanitizerGap);
+  sanitizer::poison((Byte*)this + _dataSize - sanitizerGap, sanitizerGap);
+#endif
+}
+
 TextFrame::TextFrame(TextFrameLayouter&& layouter, UInt dataSize)
 : STUTextFrameData{
     .paragraphCount = narrow_cast<Int32>(layouter.paragraphs().count()),
@@ -70,6 +113,7 @@ TextFrame::TextFrame(TextFrameLayouter&& layouter, UInt dataSize)
     ._dataSize = dataSize
   }
 {
+  new (&mutablePrivateData()) PrivateData{};
   incrementRefCount(originalAttributedString);
   const Range<Int32> stringRange = rangeInOriginalString();
   const Int originalStylesTerminatorSize = TextStyle
@@ -83,13 +127,7 @@ TextFrame::TextFrame(TextFrameLayouter&& layouter, UInt dataSize)
                   - layouter.truncationTokenTextStyleData().count()
                   - originalStringTextStyleDataSize;
 
-#if STU_USE_ADDRESS_SANITIZER
-  sanitizer::poison((Byte*)verticalSearchTable().startValues().end(), sanitizerGap);
-  sanitizer::poison((Byte*)lineStringIndices().end(), sanitizerGap);
-  sanitizer::poison((Byte*)lines().end(), sanitizerGap);
-  sanitizer::poison((Byte*)colors().end(), sanitizerGap);
-  sanitizer::poison((Byte*)this + _dataSize - sanitizerGap, sanitizerGap);
-#endif
+  poisonSanitizerGaps();
   { // Write out the data into the embedded arrays.
     Byte* p = reinterpret_cast<Byte*>(this + 1);
     using array_utils::copyConstructArray;
@@ -136,48 +174,41 @@ TextFrame::TextFrame(TextFrameLayouter&& layouter, UInt dataSize)
   lineIndices[lines.count()].startIndexInOriginalString = rangeInOriginalString().end;
   lineIndices[lines.count()].startIndexInTruncatedString = truncatedStringLength;
 
-  if (lines.isEmpty()) {
-    this->consistentAlignment = STUTextFrameConsistentAlignmentLeft;
-    this->flags = STUTextFrameHasMaxTypographicWidth;
-    return;
-  }
+  const STUTextFrameLayoutInfo info = layouter.layoutInfo();
+  this->flags = info.flags;
+  this->consistentAlignment = info.consistentAlignment;
+  this->minX = info.minX;
+  this->maxX = info.maxX;
+  this->firstBaseline = info.firstBaseline;
+  this->lastBaseline = info.lastBaseline;
+  this->firstLineHeight = info.firstLineHeight;
+  this->firstLineHeightAboveBaseline = info.firstLineHeightAboveBaseline;
+  this->lastLineHeight = info.lastLineHeight;
+  this->lastLineHeightBelowBaseline = info.lastLineHeightBelowBaseline;
+  this->lastLineHeightBelowBaselineWithoutSpacing = info.lastLineHeightBelowBaselineWithoutSpacing;
+  this->lastLineHeightBelowBaselineWithMinimalSpacing =
+    info.lastLineHeightBelowBaselineWithMinimalSpacing;
+
+  if (lines.isEmpty()) return;
 
-  bool isTruncated = false;
-  TextFlags flags{};
-  Range<Float64> xBounds = Range<Float64>::infinitelyEmpty();
   const ArrayRef<Float32> increasingMaxYs{const_array_cast(verticalSearchTable().endValues())};
   const ArrayRef<Float32> increasingMinYs{const_array_cast(verticalSearchTable().startValues())};
   Float32 maxY = minValue<Float32>;
 
-  const Float64 inverseScale = layouter.scaleInfo().inverseScale;
-
   Int32 lineIndex = 0;
   for (TextFrameParagraph& para : paragraphs) {
-    isTruncated |= !para.excisedRangeInOriginalString().isEmpty();
-
-    bool isIndented = para.isIndented;
-    Float64 initialLeftIndent;
-    Float64 initialRightIndent;
-    Float64 nonInitialLeftIndent;
-    Float64 nonInitialRightIndent;
-    if (isIndented) {
+    if (para.isIndented) {
       const ShapedString::Paragraph& p = layouter.originalStringParagraphs()[para.paragraphIndex];
-      initialLeftIndent  = p.commonLeftIndent*inverseScale;
-      initialRightIndent = p.commonRightIndent*inverseScale;
-      nonInitialLeftIndent  = initialLeftIndent;
-      nonInitialRightIndent = initialRightIndent;
       if (p.initialExtraLeftIndent == 0) {
         para.initialLinesLeftIndent    = p.commonLeftIndent;
         para.nonInitialLinesLeftIndent = p.commonLeftIndent;
       } else {
         if (p.initialExtraLeftIndent > 0) {
-          initialLeftIndent += p.initialExtraLeftIndent;
           para.nonInitialLinesLeftIndent = p.commonLeftIndent;
           para.initialLinesLeftIndent = p.commonLeftIndent
                                       + textScaleFactor*p.initialExtraLeftIndent;
 
         } else {
-          nonInitialLeftIndent -= p.initialExtraLeftIndent;
           para.initialLinesLeftIndent = p.commonLeftIndent;
           para.nonInitialLinesLeftIndent = p.commonLeftIndent
                                          - textScaleFactor*p.initialExtraLeftIndent;
@@ -188,13 +219,11 @@ TextFrame::TextFrame(TextFrameLayouter&& layouter, UInt dataSize)
         para.nonInitialLinesRightIndent = p.commonRightIndent;
       } else {
         if (p.initialExtraRightIndent > 0) {
-          initialRightIndent += p.initialExtraRightIndent;
           para.nonInitialLinesRightIndent = p.commonRightIndent;
           para.initialLinesRightIndent = p.commonRightIndent
                                        + textScaleFactor*p.initialExtraRightIndent;
 
         } else {
-          nonInitialRightIndent -= p.initialExtraRightIndent;
           para.initialLinesRightIndent = p.commonRightIndent;
           para.nonInitialLinesRightIndent = p.commonRightIndent
                                           - textScaleFactor*p.initialExtraRightIndent;
@@ -214,19 +243,6 @@ TextFrame::TextFrame(TextFrameLayouter&& layouter, UInt dataSize)
       lineIndices[lineIndex].startIndexInOriginalString = line.rangeInOriginalString.start;
       lineIndices[lineIndex].startIndexInTruncatedString = line.rangeInTruncatedString.start;
 
-      Range<Float64> x = line.originX + Range{0., line.width};
-      if (isIndented) {
-        STU_DISABLE_CLANG_WARNING("-Wconditional-uninitialized")
-        const Float64 leftIndent = lineIndex < para.initialLinesEndIndex
-                                 ? initialLeftIndent : nonInitialLeftIndent;
-        const Float64 rightIndent = lineIndex < para.initialLinesEndIndex
-                                  ? initialRightIndent : nonInitialRightIndent;
-        STU_REENABLE_CLANG_WARNING
-        x.start -= leftIndent;
-        x.end += rightIndent;
-      }
-      xBounds = xBounds.convexHull(x);
-
       if (const auto& displayScale = layouter.scaleInfo().displayScale) {
         line.originY = ceilToScale(line.originY, *displayScale);
       }
@@ -249,7 +265,6 @@ TextFrame::TextFrame(TextFrameLayouter&& layouter, UInt dataSize)
       increasingMinYs[lineIndex] = narrow_cast<Float32>(line.originY - line.fastBoundsLLOMaxY);
     }
     implicit_cast<STUTextFrameParagraph&>(para).textFlags = static_cast<STUTextFlags>(paraFlags);
-    flags |= paraFlags;
   }
 
   {
@@ -259,70 +274,6 @@ TextFrame::TextFrame(TextFrameLayouter&& layouter, UInt dataSize)
       value = minY = min(value, minY);
     }
   }
-
-  this->minX = textScaleFactor*xBounds.start;
-  this->maxX = textScaleFactor*xBounds.end;
-
-  const auto& firstLine = lines[0];
-  const auto& lastLine = lines[$ - 1];
-
-  this->firstBaseline = textScaleFactor*firstLine.originY;
-  this->lastBaseline = textScaleFactor*lastLine.originY;
-
-  const Float32 firstLineHeight = firstLine._heightAboveBaseline + firstLine._heightBelowBaseline;
-  const Float32 lastLineHeight = lastLine._heightAboveBaseline + lastLine._heightBelowBaseline;
-  const Float32 firstLineMinBaselineDistance =
-                  layouter.originalStringParagraphs()[0].minBaselineDistance;
-  const Float32 lastLineMinBaselineDistance =
-                  layouter.originalStringParagraphs()[lastLine.paragraphIndex].minBaselineDistance;
-
-  const Float32 scale32 = narrow_cast<Float32>(textScaleFactor);
-
-  this->firstLineHeight = scale32*max(firstLineHeight, firstLineMinBaselineDistance);
-  this->firstLineHeightAboveBaseline =
-    scale32*(firstLine._heightAboveBaseline
-             + max(0.f, (firstLineMinBaselineDistance - firstLineHeight)/2));
-
-  this->lastLineHeight = scale32*max(lastLineHeight, lastLineMinBaselineDistance);
-  this->lastLineHeightBelowBaselineWithoutSpacing =
-    scale32*lastLine._heightBelowBaselineWithoutSpacing;
-  this->lastLineHeightBelowBaselineWithMinimalSpacing =
-    scale32*min(lastLine._heightBelowBaseline,
-                lastLine._heightBelowBaselineWithoutSpacing
-                + layouter.minimalSpacingBelowLastLine());
-  this->lastLineHeightBelowBaseline =
-    scale32*(lastLine._heightBelowBaseline
-             + max(0.f, (lastLineMinBaselineDistance - lastLineHeight)/2));
-
-  STUTextFrameConsistentAlignment consistentAlignment = stuTextFrameConsistentAlignment(
-                                                          paragraphs[0].alignment);
-  for (const TextFrameParagraph& para : paragraphs[{1, $}]) {
-    if (consistentAlignment != stuTextFrameConsistentAlignment(para.alignment)) {
-      consistentAlignment = STUTextFrameConsistentAlignmentNone;
-      break;
-    }
-  }
-
-  const bool isScaled = this->textScaleFactor < 1;
-
-  bool hasMaxTypographicWidth = consistentAlignment != STUTextFrameConsistentAlignmentNone
-                             && !isTruncated
-                             && !isScaled;
-  if (hasMaxTypographicWidth) {
-    Int32 i = 0;
-    for (const TextFrameParagraph& para : paragraphs) {
-      if (para.lineIndexRange().end == ++i) continue;
-      hasMaxTypographicWidth = false;
-      break;
-    }
-  }
-
-  this->consistentAlignment = consistentAlignment;
-  this->flags = static_cast<STUTextFrameFlags>(
-                  static_cast<STUTextFrameFlags>(flags)
-                  | (isTruncated ? STUTextFrameIsTruncated : 0)
-                  | (isScaled ? STUTextFrameIsScaled : 0)
-                  | (hasMaxTypographicWidth ? STUTextFrameHasMaxTypographicWidth : 0));
 }
 
 
@@ -330,6 +281,13 @@ TextFrame::~TextFrame() {
   if (const void* const bs = atomic_load_explicit(&_backgroundSegments, memory_order_relaxed)) {
     free(const_cast<void*>(bs));
   }
+  if (TextFrameImageBoundsCache* const cache =
+        privateData().imageBoundsCache.load(std::memory_order_relaxed))
+  {
+    stu_mutex_destroy(&cache->mutex);
+    cache->~TextFrameImageBoundsCache();
+    free(cache);
+  }
   if (flags & STUTextFrameIsTruncated) {
     if (const CFAttributedString* const ts = atomic_load_explicit(&_truncatedAttributedString,
                                                                   memory_order_relaxed))
@@ -359,6 +317,66 @@ TextFrame::~TextFrame() {
 #endif
 }
 
+Optional<Rect<CGFloat>> TextFrame::cachedImageBounds(const ImageBoundsCacheKey& key) const {
+  TextFrameImageBoundsCache* const cache =
+    privateData().imageBoundsCache.load(std::memory_order_acquire);
+  if (!cache) return none;
+  Optional<Rect<CGFloat>> result;
+  stu_mutex_lock(&cache->mutex);
+  for (Int i = 0; i < cache->count; ++i) {
+    if (cache->entries[i].key == key) {
+      result = cache->entries[i].bounds;
+      if (i != 0) {
+        std::rotate(cache->entries, cache->entries + i, cache->entries + i + 1);
+      }
+      break;
+    }
+  }
+  stu_mutex_unlock(&cache->mutex);
+  return result;
+}
+
+void TextFrame::cacheImageBounds(const ImageBoundsCacheKey& key, Rect<CGFloat> bounds) const {
+  const PrivateData& data = privateData();
+  if (!data.cachesImageBounds) return;
+  TextFrameImageBoundsCache* cache = data.imageBoundsCache.load(std::memory_order_acquire);
+  if (!cache) {
+    TextFrameImageBoundsCache* const newCache =
+      new (Malloc().allocate<TextFrameImageBoundsCache>(1)) TextFrameImageBoundsCache{};
+    stu_mutex_init(&newCache->mutex);
+    TextFrameImageBoundsCache* expected = nullptr;
+    if (data.imageBoundsCache.compare_exchange_strong(expected, newCache,
+                                                      std::memory_order_acq_rel,
+                                                      std::memory_order_acquire))
+    {
+      cache = newCache;
+    } else {
+      stu_mutex_destroy(&newCache->mutex);
+      newCache->~TextFrameImageBoundsCache();
+      free(newCache);
+      cache = expected;
+    }
+  }
+  stu_mutex_lock(&cache->mutex);
+  Int i = 0;
+  for (; i < cache->count; ++i) {
+    if (cache->entries[i].key == key) break;
+  }
+  if (i == cache->count) {
+    if (cache->count < TextFrameImageBoundsCache::capacity) {
+      cache->count += 1;
+    } else {
+      i -= 1;
+    }
+  }
+  std::rotate(cache->entries, cache->entries + i, cache->entries + i + 1);
+  TextFrameImageBoundsCache::Entry& entry = cache->entries[0];
+  entry.key = key;
+  entry.bounds = bounds;
+  entry.highlightStyle = key.highlightStyle;
+  stu_mutex_unlock(&cache->mutex);
+}
+
 Rect<CGFloat> TextFrame::calculateImageBounds(TextFrameOrigin originalTextFrameOrigin,
                                               const ImageBoundsContext& originalContext) const
 {
@@ -392,5 +410,751 @@ Rect<CGFloat> TextFrame::calculateImageBounds(TextFrameOrigin originalTextFrameO
   return narrow_cast<Rect<CGFloat>>(textScaleFactor*bounds);
 }
 
+// MARK: - Snapshots
+
+// A text frame snapshot consists of a header followed by the raw TextFrame arrays, the information
+// needed for recreating and checking the CTLines of the text lines, and a keyed archive containing
+// the truncation tokens and the colors. Each section starts at a 16-byte aligned offset. Object
+// pointers in the raw arrays are cleared when creating the snapshot and restored when loading it.
+//
+// CTLines can't be serialized, so they are recreated from the typesetter of the shaped string
+// when loading a snapshot. This is much cheaper than a full layout, since the line breaking,
+// truncation and scaling is skipped. If a recreated CTLine doesn't match the stored metrics,
+// e.g. because the snapshot was created with a different OS version, the snapshot is rejected.
+//
+// Since the arrays are stored in their in-memory representation, snapshots can only be read by the
+// build of the library that created them. This is checked using the layout fields of the header
+// and a fingerprint combining a hash of the offsets of the snapshot struct fields with the build ID
+// of the library binary. All ranges, indices and text style offsets in the snapshot arrays are
+// checked before the text frame is created, so that corrupted data can't lead to out-of-bounds
+// accesses.
+
+namespace {
+
+struct TextFrameSnapshotHeader {
+  static constexpr UInt32 magicValue = 0x53545546; // "STUF"
+  static constexpr UInt32 currentVersion = 3;
+
+  UInt32 magic;
+  UInt32 version;
+  // Layout fields
+  UInt64 layoutFingerprint;
+  UInt16 pointerSize;
+  UInt16 cgFloatSize;
+  UInt16 frameDataSize;
+  UInt16 paragraphSize;
+  UInt16 lineSize;
+  UInt16 maxTextStyleSize;
+  // Content fields
+  UInt16 colorCount;
+  Int32 paragraphCount;
+  Int32 lineCount;
+  Int32 stringLength;
+  /// 1 if the text frame was created with `STUTextFrameOptions.cachesImageBounds`, 0 otherwise.
+  UInt8 cachesImageBounds;
+  /// The SHA-256 digest of the UTF-16 code units of the original string.
+  Byte stringDigest[CC_SHA256_DIGEST_LENGTH];
+  UInt64 textStylesSize;
+  UInt64 archiveSize;
+};
+
+struct TextFrameSnapshotLineInfo {
+  Int32 ctLineStringStart;
+  /// 0 if the line has no `_ctLine`.
+  Int32 ctLineStringLength;
+  Int32 ctLineRunCount;
+  Int32 ctLineGlyphCount;
+  Int32 tokenCTLineRunCount;
+  Int32 tokenCTLineGlyphCount;
+  Float64 ctLineWidth;
+  Float64 tokenCTLineWidth;
+};
+
+struct TextFrameSnapshotLayout {
+  Int verticalSearchTableOffset;
+  Int lineStringIndicesOffset;
+  /// The STUTextFrameData followed by the paragraphs and the lines.
+  Int frameDataOffset;
+  Int colorFlagsOffset;
+  Int textStylesOffset;
+  Int lineInfosOffset;
+  Int archiveOffset;
+  Int size;
+
+  /// \pre The counts in the header must be non-negative and the sizes must be less than 2^32.
+  explicit TextFrameSnapshotLayout(const TextFrameSnapshotHeader& header) {
+    Int offset = sizeof(TextFrameSnapshotHeader);
+    const auto section = [&](UInt size) -> Int {
+      const Int start = roundUpToMultipleOf<16>(offset);
+      offset = start + sign_cast(size);
+      return start;
+    };
+    const UInt lineCount = sign_cast(header.lineCount);
+    verticalSearchTableOffset = section(IntervalSearchTable::sizeInBytesForCount(header.lineCount));
+    lineStringIndicesOffset = section(sizeof(StringStartIndices)*(lineCount + 1));
+    frameDataOffset = section(sizeof(STUTextFrameData)
+                              + sizeof(TextFrameParagraph)*sign_cast(header.paragraphCount)
+                              + sizeof(TextFrameLine)*lineCount);
+    colorFlagsOffset = section(sizeof(ColorFlags)*header.colorCount);
+    textStylesOffset = section(header.textStylesSize);
+    lineInfosOffset = section(sizeof(TextFrameSnapshotLineInfo)*lineCount);
+    archiveOffset = section(header.archiveSize);
+    size = offset;
+  }
+};
+
+} // namespace
+
+struct StringDigest {
+  Byte bytes[CC_SHA256_DIGEST_LENGTH];
+};
+
+static StringDigest stringDigest(NSString* __unsafe_unretained string) {
+  const NSStringRef stringRef{string};
+  const Int length = stringRef.count();
+  CC_SHA256_CTX context;
+  CC_SHA256_Init(&context);
+  Char16 buffer[1024];
+  for (Int index = 0; index < length;) {
+    const Int n = min(length - index, arrayLength(buffer));
+    stringRef.copyUTF16Chars(Range{index, Count{n}}, ArrayRef{buffer, n});
+    CC_SHA256_Update(&context, buffer, narrow_cast<CC_LONG>(n*sizeof(Char16)));
+    index += n;
+  }
+  StringDigest digest;
+  CC_SHA256_Final(digest.bytes, &context);
+  return digest;
+}
+
+static UInt64 textFrameLayoutFingerprint() {
+  using Data = STUTextFrameData;
+  using Para = STUTextFrameParagraph;
+  using Line = STUTextFrameLine;
+  static constexpr UInt64 structLayoutHash =
+    layoutHash(sizeof(void*), sizeof(CGFloat),
+               sizeof(TextFrameSnapshotLineInfo), sizeof(StringStartIndices),
+               IntervalSearchTable::arrayElementSize, sizeof(ColorFlags), TextStyle::maxSize,
+               sizeof(Data), alignof(Data),
+               offsetof(Data, paragraphCount),
+               offsetof(Data, lineCount),
+               offsetof(Data, _textStylesData),
+               offsetof(Data, _colorCount),
+               offsetof(Data, flags),
+               offsetof(Data, consistentAlignment),
+               offsetof(Data, layoutMode),
+               offsetof(Data, rangeInOriginalStringIsFullString),
+               offsetof(Data, _layoutIterationCount),
+               offsetof(Data, truncatedStringLength),
+               offsetof(Data, rangeInOriginalString),
+               offsetof(Data, size),
+               offsetof(Data, displayScale),
+               offsetof(Data, textScaleFactor),
+               offsetof(Data, minX),
+               offsetof(Data, maxX),
+               offsetof(Data, firstBaseline),
+               offsetof(Data, lastBaseline),
+               offsetof(Data, firstLineHeight),
+               offsetof(Data, firstLineHeightAboveBaseline),
+               offsetof(Data, lastLineHeight),
+               offsetof(Data, lastLineHeightBelowBaseline),
+               offsetof(Data, lastLineHeightBelowBaselineWithoutSpacing),
+               offsetof(Data, lastLineHeightBelowBaselineWithMinimalSpacing),
+               offsetof(Data, _dataSize),
+               offsetof(Data, originalAttributedString),
+               offsetof(Data, _truncatedAttributedString),
+               offsetof(Data, _backgroundSegments),
+               sizeof(TextFrameParagraph), alignof(TextFrameParagraph),
+               offsetof(Para, paragraphIndex),
+               offsetof(Para, lineIndexRange),
+               offsetof(Para, initialLinesEndIndex),
+               offsetof(Para, rangeInOriginalString),
+               offsetof(Para, excisedRangeInOriginalString),
+               offsetof(Para, rangeInTruncatedString),
+               offsetof(Para, truncationTokenLength),
+               offsetof(Para, textFlags),
+               offsetof(Para, alignment),
+               offsetof(Para, truncationToken),
+               offsetof(Para, initialLinesLeftIndent),
+               offsetof(Para, initialLinesRightIndent),
+               offsetof(Para, nonInitialLinesLeftIndent),
+               offsetof(Para, nonInitialLinesRightIndent),
+               sizeof(TextFrameLine), alignof(TextFrameLine),
+               offsetof(Line, lineIndex),
+               offsetof(Line, paragraphIndex),
+               offsetof(Line, rangeInOriginalString),
+               offsetof(Line, rangeInTruncatedString),
+               offsetof(Line, trailingWhitespaceInTruncatedStringLength),
+               offsetof(Line, _initStep),
+               offsetof(Line, _hyphenRunIndex),
+               offsetof(Line, _hyphenGlyphIndex),
+               offsetof(Line, width),
+               offsetof(Line, originX),
+               offsetof(Line, originY),
+               offsetof(Line, ascent),
+               offsetof(Line, descent),
+               offsetof(Line, leading),
+               offsetof(Line, _heightAboveBaseline),
+               offsetof(Line, _heightBelowBaseline),
+               offsetof(Line, _heightBelowBaselineWithoutSpacing),
+               offsetof(Line, _textStylesOffset),
+               offsetof(Line, _tokenStylesOffset),
+               offsetof(Line, _ctLine),
+               offsetof(Line, _tokenCTLine),
+               offsetof(Line, _leftPartEnd),
+               offsetof(Line, _rightPartStart),
+               offsetof(Line, leftPartWidth),
+               offsetof(Line, tokenWidth),
+               offsetof(Line, _rightPartXOffset),
+               offsetof(Line, _hyphenXOffset),
+               offsetof(Line, fastBoundsMinX),
+               offsetof(Line, fastBoundsMaxX),
+               offsetof(Line, fastBoundsLLOMaxY),
+               offsetof(Line, fastBoundsLLOMinY));
+  return dataLayoutFingerprint(structLayoutHash);
+}
+
+static bool hasCompatibleLayout(const TextFrameSnapshotHeader& header) {
+  using Header = TextFrameSnapshotHeader;
+  return header.magic == Header::magicValue
+      && header.version == Header::currentVersion
+      && header.layoutFingerprint == textFrameLayoutFingerprint()
+      && header.pointerSize == sizeof(void*)
+      && header.cgFloatSize == sizeof(CGFloat)
+      && header.frameDataSize == sizeof(STUTextFrameData)
+      && header.paragraphSize == sizeof(TextFrameParagraph)
+      && header.lineSize == sizeof(TextFrameLine)
+      && header.maxTextStyleSize == TextStyle::maxSize;
+}
+
+static void clearObjectPointers(STUTextFrameData& data) {
+  data._textStylesData = nullptr;
+  data.originalAttributedString = nil;
+  atomic_store_explicit(&data._truncatedAttributedString, nullptr, memory_order_relaxed);
+  atomic_store_explicit(&data._backgroundSegments, nullptr, memory_order_relaxed);
+}
+
+NSData* TextFrame::snapshotData() const {
+  const ArrayRef<const TextFrameParagraph> paragraphs = this->paragraphs();
+  const ArrayRef<const TextFrameLine> lines = this->lines();
+  const ArrayRef<const ColorRef> colors = this->colors();
+
+  NSData* archive;
+  @try {
+    NSMutableArray* const tokens = [[NSMutableArray alloc]
+                                      initWithCapacity:sign_cast(paragraphCount)];
+    for (const TextFrameParagraph& para : paragraphs) {
+      // CTRunDelegate values don't support NSCoding. createFromSnapshotData recreates the run
+      // delegates from the STUTextAttachment attributes.
+      [tokens addObject:para.truncationToken
+                        ? [para.truncationToken stu_attributedStringByRemovingCTRunDelegates]
+                        : NSNull.null];
+    }
+    NSMutableArray<STUColor*>* const colorObjects = [[NSMutableArray alloc]
+                                                       initWithCapacity:_colorCount];
+    for (const ColorRef& color : colors) {
+      [colorObjects addObject:[STUColor colorWithCGColor:color.cgColor()]];
+    }
+    archive = [NSKeyedArchiver archivedDataWithRootObject:@[tokens, colorObjects]
+                                    requiringSecureCoding:true error:nil];
+  } @catch (NSException* __unused exception) {
+    archive = nil;
+  }
+  if (!archive) return nil;
+
+  const Int textStylesSize = textStylesDataSize();
+
+  TextFrameSnapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = TextFrameSnapshotHeader::magicValue;
+  header.version = TextFrameSnapshotHeader::currentVersion;
+  header.layoutFingerprint = textFrameLayoutFingerprint();
+  header.pointerSize = sizeof(void*);
+  header.cgFloatSize = sizeof(CGFloat);
+  header.frameDataSize = sizeof(STUTextFrameData);
+  header.paragraphSize = sizeof(TextFrameParagraph);
+  header.lineSize = sizeof(TextFrameLine);
+  header.maxTextStyleSize = TextStyle::maxSize;
+  header.colorCount = _colorCount;
+  header.paragraphCount = paragraphCount;
+  header.lineCount = lineCount;
+  header.stringLength = narrow_cast<Int32>(originalAttributedString.length);
+  header.cachesImageBounds = privateData().cachesImageBounds;
+  {
+    const StringDigest digest = stringDigest(originalAttributedString.string);
+    memcpy(header.stringDigest, digest.bytes, sizeof(digest.bytes));
+  }
+  header.textStylesSize = sign_cast(textStylesSize);
+  header.archiveSize = archive.length;
+
+  const TextFrameSnapshotLayout layout{header};
+
+  NSMutableData* const data = [[NSMutableData alloc] initWithLength:sign_cast(layout.size)];
+  Byte* const bytes = static_cast<Byte*>(data.mutableBytes);
+  memcpy(bytes, &header, sizeof(header));
+  memcpy(bytes + layout.verticalSearchTableOffset, verticalSearchTable().endValues().begin(),
+         IntervalSearchTable::sizeInBytesForCount(lineCount));
+  memcpy(bytes + layout.lineStringIndicesOffset, lineStringIndices().begin(),
+         lineStringIndices().arraySizeInBytes());
+  {
+    Byte* p = bytes + layout.frameDataOffset;
+    STUTextFrameData* const frameData = reinterpret_cast<STUTextFrameData*>(p);
+    memcpy(frameData, static_cast<const STUTextFrameData*>(this), sizeof(STUTextFrameData));
+    clearObjectPointers(*frameData);
+    p += sizeof(STUTextFrameData);
+    TextFrameParagraph* const paras = reinterpret_cast<TextFrameParagraph*>(p);
+    memcpy(paras, paragraphs.begin(), paragraphs.arraySizeInBytes());
+    for (Int i = 0; i < paragraphCount; ++i) {
+      paras[i].truncationToken = nil;
+    }
+    p += paragraphs.arraySizeInBytes();
+    TextFrameLine* const snapshotLines = reinterpret_cast<TextFrameLine*>(p);
+    memcpy(snapshotLines, lines.begin(), lines.arraySizeInBytes());
+    for (Int i = 0; i < lineCount; ++i) {
+      snapshotLines[i]._ctLine = nullptr;
+      snapshotLines[i]._tokenCTLine = nullptr;
+    }
+  }
+  for (Int i = 0; i < _colorCount; ++i) {
+    bytes[layout.colorFlagsOffset + i] = static_cast<Byte>(colors[i].colorFlags());
+  }
+  {
+    const ArrayRef<Byte> textStyles{bytes + layout.textStylesOffset, textStylesSize};
+    memcpy(textStyles.begin(), _textStylesData, sign_cast(textStylesSize));
+    bool isWellFormed = resetTextStyleObjectPointers(textStyles, rangeInOriginalString(), nil)
+                        != nullptr;
+    for (const TextFrameLine& line : lines) {
+      if (!line.hasTruncationToken) continue;
+      isWellFormed &= resetTextStyleObjectPointers(
+                        textStyles[{line._tokenStylesOffset, $}],
+                        Range{0, paragraphs[line.paragraphIndex].truncationTokenLength}, nil)
+                      != nullptr;
+    }
+    STU_ASSERT(isWellFormed);
+  }
+  {
+    TextFrameSnapshotLineInfo* const infos = reinterpret_cast<TextFrameSnapshotLineInfo*>(
+                                               bytes + layout.lineInfosOffset);
+    for (const TextFrameLine& line : lines) {
+      TextFrameSnapshotLineInfo& info = infos[line.lineIndex];
+      if (line._ctLine) {
+        const CFRange range = CTLineGetStringRange(line._ctLine);
+        info.ctLineStringStart = narrow_cast<Int32>(range.location);
+        info.ctLineStringLength = narrow_cast<Int32>(range.length);
+        info.ctLineRunCount = narrow_cast<Int32>(glyphRuns(line._ctLine).count());
+        info.ctLineGlyphCount = narrow_cast<Int32>(CTLineGetGlyphCount(line._ctLine));
+        info.ctLineWidth = typographicWidth(line._ctLine);
+      }
+      if (line._tokenCTLine) {
+        info.tokenCTLineRunCount = narrow_cast<Int32>(glyphRuns(line._tokenCTLine).count());
+        info.tokenCTLineGlyphCount = narrow_cast<Int32>(CTLineGetGlyphCount(line._tokenCTLine));
+        info.tokenCTLineWidth = typographicWidth(line._tokenCTLine);
+      }
+    }
+  }
+  memcpy(bytes + layout.archiveOffset, archive.bytes, archive.length);
+
+  return data;
+}
+
+static bool hasMatchingMetrics(CTLine* __nullable line, Int32 runCount, Int32 glyphCount,
+                               Float64 width)
+{
+  // Core Text may not reproduce the exact same floating-point width when justifying a line.
+  constexpr Float64 maxWidthDifference = 1/256.;
+  return line
+      && glyphRuns(line).count() == runCount
+      && CTLineGetGlyphCount(line) == glyphCount
+      && abs(typographicWidth(line) - width) <= maxWidthDifference;
+}
+
+TextFrame::TextFrame(const STUTextFrameData& data) {
+  new (&mutablePrivateData()) PrivateData{};
+  memcpy(static_cast<STUTextFrameData*>(this), &data, sizeof(STUTextFrameData));
+}
+
+TextFrame* __nullable
+  TextFrame::createFromSnapshotData(NSData* __unsafe_unretained const unalignedData,
+                                    const ShapedString& shapedString,
+                                    const FunctionRef<void*(UInt)> alloc)
+{
+  using Header = TextFrameSnapshotHeader;
+  using LineInfo = TextFrameSnapshotLineInfo;
+
+  NSData* data = unalignedData;
+  if (reinterpret_cast<UInt>(data.bytes)%16 != 0) {
+    data = [[NSData alloc] initWithBytes:data.bytes length:data.length];
+    if (reinterpret_cast<UInt>(data.bytes)%16 != 0) return nullptr;
+  }
+  const UInt dataLength = data.length;
+  const Byte* const bytes = static_cast<const Byte*>(data.bytes);
+
+  if (dataLength < sizeof(Header)) return nullptr;
+  Header header;
+  memcpy(&header, bytes, sizeof(header));
+  if (!hasCompatibleLayout(header)
+      || header.stringLength != shapedString.stringLength
+      || memcmp(header.stringDigest, stringDigest(shapedString.attributedString.string).bytes,
+                sizeof(header.stringDigest)) != 0
+      || !(0 <= header.lineCount && header.lineCount <= header.stringLength + 1)
+      || !(0 <= header.paragraphCount && header.paragraphCount <= header.stringLength + 1)
+      || header.textStylesSize > dataLength
+      || header.archiveSize > dataLength)
+  {
+    return nullptr;
+  }
+  const TextFrameSnapshotLayout layout{header};
+  if (sign_cast(layout.size) != dataLength) return nullptr;
+
+  const Int32 paragraphCount = header.paragraphCount;
+  const Int32 lineCount = header.lineCount;
+  const Int textStylesSize = narrow_cast<Int>(header.textStylesSize);
+  const SizeAndOffset oso = objectSizeAndThisOffset(paragraphCount, lineCount, header.colorCount,
+                                                    textStylesSize);
+
+  STUTextFrameData frameData;
+  memcpy(&frameData, bytes + layout.frameDataOffset, sizeof(STUTextFrameData));
+  clearObjectPointers(frameData);
+  const Range<Int32> stringRange = frameData.rangeInOriginalString;
+  if (frameData.paragraphCount != paragraphCount
+      || frameData.lineCount != lineCount
+      || frameData._colorCount != header.colorCount
+      || frameData._dataSize != oso.size - oso.offset
+      || !(0 <= stringRange.start && stringRange.start <= stringRange.end
+           && stringRange.end <= header.stringLength)
+      || frameData.truncatedStringLength < 0
+      || !(frameData.textScaleFactor > 0 && frameData.textScaleFactor <= 1))
+  {
+    return nullptr;
+  }
+  const ArrayRef<const TextFrameParagraph> paragraphs{
+    reinterpret_cast<const TextFrameParagraph*>(bytes + layout.frameDataOffset
+                                                + sizeof(STUTextFrameData)),
+    paragraphCount, unchecked};
+  const ArrayRef<const TextFrameLine> lines{
+    reinterpret_cast<const TextFrameLine*>(paragraphs.end()), lineCount, unchecked};
+  const ArrayRef<const LineInfo> lineInfos{
+    reinterpret_cast<const LineInfo*>(bytes + layout.lineInfosOffset), lineCount, unchecked};
+
+  // The frame paragraphs correspond to a contiguous subrange of the shaped string paragraphs.
+  const ArrayRef<const ShapedString::Paragraph> allStringParas = shapedString.arrays().paragraphs;
+  Int firstStringParaIndex = 0;
+  while (firstStringParaIndex < allStringParas.count()
+         && allStringParas[firstStringParaIndex].stringRange.end <= stringRange.start)
+  {
+    ++firstStringParaIndex;
+  }
+  if (paragraphCount > allStringParas.count() - firstStringParaIndex) return nullptr;
+  const ArrayRef<const ShapedString::Paragraph> stringParas =
+    allStringParas[{firstStringParaIndex, Count{paragraphCount}}];
+
+  const Int32 truncatedStringLength = frameData.truncatedStringLength;
+  // The paragraphs must partition the string range and the line index range of the text frame.
+  // The last paragraph may have been clipped.
+  Int32 stringIndex = stringRange.start;
+  Int32 truncatedStringIndex = 0;
+  Int32 lineIndex = 0;
+  for (Int32 i = 0; i < paragraphCount; ++i) {
+    const TextFrameParagraph& para = paragraphs[i];
+    const Range<Int32> lineIndexRange = para.Base::lineIndexRange;
+    const Range<Int32> range = para.Base::rangeInOriginalString;
+    const Range<Int32> excisedRange = para.Base::excisedRangeInOriginalString;
+    const Range<Int32> truncatedRange = para.Base::rangeInTruncatedString;
+    if (para.paragraphIndex != i
+        || !(lineIndexRange.start == lineIndex && lineIndexRange.start <= lineIndexRange.end
+             && lineIndexRange.end <= lineCount)
+        || !(lineIndexRange.start <= para.initialLinesEndIndex
+             && para.initialLinesEndIndex <= lineIndexRange.end)
+        || !(range.start == stringIndex && range.start <= range.end
+             && range.end <= stringRange.end)
+        || !(range.start <= excisedRange.start && excisedRange.start <= excisedRange.end
+             && excisedRange.end <= range.end)
+        || para.truncationTokenLength < 0
+        || para.paragraphTerminatorInOriginalStringLength > range.count()
+        || truncatedRange.start != truncatedStringIndex
+        || truncatedRange.end < truncatedRange.start
+        || truncatedRange.count() != Int{range.count()} - excisedRange.count()
+                                     + para.truncationTokenLength
+        || truncatedRange.end > truncatedStringLength)
+    {
+      return nullptr;
+    }
+    stringIndex = range.end;
+    truncatedStringIndex = truncatedRange.end;
+    lineIndex = lineIndexRange.end;
+  }
+  if (lineIndex != lineCount) return nullptr;
+  for (Int32 i = 0; i < lineCount; ++i) {
+    const TextFrameLine& line = lines[i];
+    const Range<Int32> range = line.rangeInOriginalString;
+    const Range<Int32> truncatedRange = line.rangeInTruncatedString;
+    if (line.lineIndex != i
+        || !(0 <= line.paragraphIndex && line.paragraphIndex < paragraphCount)
+        || !Range{paragraphs[line.paragraphIndex].Base::lineIndexRange}.contains(i)
+        || !(stringRange.start <= range.start && range.start <= range.end
+             && range.end <= stringRange.end)
+        || !(0 <= truncatedRange.start && truncatedRange.start <= truncatedRange.end
+             && line.trailingWhitespaceInTruncatedStringLength >= 0
+             && Int{truncatedRange.end} + line.trailingWhitespaceInTruncatedStringLength
+                <= truncatedStringLength)
+        || !(0 <= line._textStylesOffset && line._textStylesOffset < textStylesSize
+             && line._textStylesOffset%4 == 0)
+        || !(0 <= line._tokenStylesOffset && line._tokenStylesOffset < textStylesSize
+             && line._tokenStylesOffset%4 == 0))
+    {
+      return nullptr;
+    }
+  }
+  {
+    // The line string indices table contains the start indices of the lines followed by the end
+    // indices of the text frame. The index conversion functions binary search in this table.
+    const ArrayRef<const StringStartIndices> lineStringIndices{
+      reinterpret_cast<const StringStartIndices*>(bytes + layout.lineStringIndicesOffset),
+      lineCount + 1, unchecked};
+    for (Int32 i = 0; i < lineCount; ++i) {
+      const StringStartIndices& indices = lineStringIndices[i];
+      const StringStartIndices& nextIndices = lineStringIndices[i + 1];
+      if (indices.startIndexInOriginalString != lines[i].rangeInOriginalString.start
+          || indices.startIndexInTruncatedString != lines[i].rangeInTruncatedString.start
+          || nextIndices.startIndexInOriginalString < indices.startIndexInOriginalString
+          || nextIndices.startIndexInTruncatedString < indices.startIndexInTruncatedString)
+      {
+        return nullptr;
+      }
+    }
+    if (lineStringIndices[lineCount].startIndexInOriginalString != stringRange.end
+        || lineStringIndices[lineCount].startIndexInTruncatedString != truncatedStringLength)
+    {
+      return nullptr;
+    }
+  }
+  {
+    // The end values and the start values of the vertical search table must be monotonically
+    // increasing. (The comparisons are false for NaN values.)
+    const ArrayRef<const Float32> values{
+      reinterpret_cast<const Float32*>(bytes + layout.verticalSearchTableOffset),
+      2*lineCount, unchecked};
+    for (Int32 i = 0; i < 2*lineCount; ++i) {
+      const bool isFirstValue = i == 0 || i == lineCount;
+      if (!(isFirstValue ? values[i] == values[i] : values[i - 1] <= values[i])) return nullptr;
+    }
+  }
+
+  NSData* const archive = [data subdataWithRange:NSRange{sign_cast(layout.archiveOffset),
+                                                         header.archiveSize}];
+  const id root = [NSKeyedUnarchiver unarchivedObjectOfClasses:attributedStringArchiveClasses()
+                                                       fromData:archive error:nil];
+  if (![root isKindOfClass:NSArray.class] || [root count] != 2) return nullptr;
+  NSArray* const tokenObjects = [root objectAtIndex:0];
+  NSArray<STUColor*>* const colorObjects = [root objectAtIndex:1];
+  if (![tokenObjects isKindOfClass:NSArray.class]
+      || tokenObjects.count != sign_cast(paragraphCount)
+      || ![colorObjects isKindOfClass:NSArray.class]
+      || colorObjects.count != header.colorCount)
+  {
+    return nullptr;
+  }
+
+  const bool isTruncated = frameData.flags & STUTextFrameIsTruncated;
+  TempArray<NSAttributedString* __unsafe_unretained> tokens{uninitialized,
+                                                            Count{paragraphCount}};
+  // Keeps the tokens with recreated run delegates alive.
+  NSMutableArray<NSAttributedString*>* const tokenStrings = [[NSMutableArray alloc] init];
+  for (Int32 i = 0; i < paragraphCount; ++i) {
+    const id object = tokenObjects[sign_cast(i)];
+    if (object == NSNull.null) {
+      tokens[i] = nil;
+      continue;
+    }
+    if (!isTruncated
+        || ![object isKindOfClass:NSAttributedString.class]
+        || [object length] != sign_cast(paragraphs[i].truncationTokenLength))
+    {
+      return nullptr;
+    }
+    NSAttributedString* const token =
+      [object stu_attributedStringByAddingCTRunDelegatesForSTUTextAttachments];
+    [tokenStrings addObject:token];
+    tokens[i] = token;
+  }
+
+  TempArray<ColorRef> colors{uninitialized, Count{header.colorCount}};
+  for (Int i = 0; i < colors.count(); ++i) {
+    STUColor* const color = colorObjects[sign_cast(i)];
+    if (![color isKindOfClass:STUColor.class]) return nullptr;
+    const auto flags = static_cast<ColorFlags>(bytes[layout.colorFlagsOffset + i]);
+    colors[i] = ColorRef{color.CGColor, flags};
+  }
+
+  // The text style data must be 8-byte aligned.
+  TempArray<UInt64> textStylesStorage{uninitialized, Count{(textStylesSize + 7)/8}};
+  const ArrayRef<Byte> textStyles{reinterpret_cast<Byte*>(textStylesStorage.begin()),
+                                  textStylesSize};
+  memcpy(textStyles.begin(), bytes + layout.textStylesOffset, sign_cast(textStylesSize));
+  {
+    const Int colorCount = header.colorCount;
+    const TextStyle* const terminator = resetTextStyleObjectPointers(
+                                          textStyles, stringRange,
+                                          shapedString.attributedString);
+    if (!terminator) return nullptr;
+    const Int originalStylesSize = reinterpret_cast<const Byte*>(terminator) - textStyles.begin()
+                                 + TextStyle::sizeOfTerminatorWithStringIndex(stringRange.end);
+    for (const TextStyle* style = reinterpret_cast<const TextStyle*>(textStyles.begin());
+         style != terminator; style = &style->next())
+    {
+      if (!hasValidColorIndices(*style, colorCount)) return nullptr;
+    }
+    // The style offset of a line must be the offset of a style in the original string style
+    // sequence. The offsets are nondecreasing.
+    const TextStyle* style = reinterpret_cast<const TextStyle*>(textStyles.begin());
+    for (const TextFrameLine& line : lines) {
+      for (;;) {
+        const Int offset = reinterpret_cast<const Byte*>(style) - textStyles.begin();
+        if (offset == line._textStylesOffset) break;
+        if (offset > line._textStylesOffset || style == terminator) return nullptr;
+        style = &style->next();
+      }
+    }
+    // Each truncation token has its own style sequence following the original string styles.
+    // The sequences are ordered by line index, but there may be unused sequences in between if
+    // the layout backtracked after truncating a line.
+    Int tokenStylesEnd = originalStylesSize;
+    for (const TextFrameLine& line : lines) {
+      if (!line.hasTruncationToken) continue;
+      NSAttributedString* const token = tokens[line.paragraphIndex];
+      if (!token || line._tokenStylesOffset < tokenStylesEnd) return nullptr;
+      const Int32 tokenLength = narrow_cast<Int32>(token.length);
+      const TextStyle* const tokenTerminator = resetTextStyleObjectPointers(
+                                                 textStyles[{line._tokenStylesOffset, $}],
+                                                 Range{0, tokenLength}, token);
+      if (!tokenTerminator) return nullptr;
+      const TextStyle* tokenStyle = reinterpret_cast<const TextStyle*>(
+                                      textStyles.begin() + line._tokenStylesOffset);
+      // The first style of a sequence has no previous style.
+      if (&tokenStyle->previous() != tokenStyle) return nullptr;
+      for (; tokenStyle != tokenTerminator; tokenStyle = &tokenStyle->next()) {
+        if (!hasValidColorIndices(*tokenStyle, colorCount)) return nullptr;
+      }
+      tokenStylesEnd = reinterpret_cast<const Byte*>(tokenTerminator) - textStyles.begin()
+                     + TextStyle::sizeOfTerminatorWithStringIndex(tokenLength);
+    }
+  }
+
+  // Recreate the CTLines.
+  TempArray<CTLine*> ctLines{zeroInitialized, Count{lineCount}};
+  TempArray<CTLine*> tokenCTLines{zeroInitialized, Count{lineCount}};
+  auto guard = ScopeGuard{[&]{
+    for (CTLine* const line : ctLines) {
+      if (line) CFRelease(line);
+    }
+    for (CTLine* const line : tokenCTLines) {
+      if (line) CFRelease(line);
+    }
+  }};
+  const NSAttributedStringRef attributedString{shapedString.attributedString};
+  const Float64 inverseScale = 1.0/frameData.textScaleFactor;
+  for (Int32 i = 0; i < lineCount; ++i) {
+    const TextFrameLine& line = lines[i];
+    const LineInfo& info = lineInfos[i];
+    if (info.ctLineStringLength != 0) {
+      const Range<Int32> range{info.ctLineStringStart, Count{info.ctLineStringLength}};
+      if (!(0 <= range.start && range.start < range.end && range.end <= stringRange.end)) {
+        return nullptr;
+      }
+      const TextFrameParagraph& para = paragraphs[line.paragraphIndex];
+      const Float64 headIndent = TextFrameLayouter::lineHeadIndent(
+                                   stringParas[line.paragraphIndex],
+                                   line.lineIndex < para.initialLinesEndIndex, inverseScale);
+      CTLine* ctLine = CTTypesetterCreateLineWithOffset(shapedString.typesetter.get(),
+                                                        CFRange{range.start, range.count()},
+                                                        headIndent);
+      if (!ctLine) return nullptr;
+      if (typographicWidth(ctLine) != info.ctLineWidth) {
+        // The line was justified.
+        if (CTLine* const justifiedLine = CTLineCreateJustifiedLine(ctLine, 1, info.ctLineWidth)) {
+          CFRelease(ctLine);
+          ctLine = justifiedLine;
+        }
+      }
+      ctLines[i] = ctLine;
+      if (!hasMatchingMetrics(ctLine, info.ctLineRunCount, info.ctLineGlyphCount,
+                              info.ctLineWidth))
+      {
+        return nullptr;
+      }
+    }
+    if (line.hasTruncationToken) {
+      tokenCTLines[i] = CTLineCreateWithAttributedString(
+                          (__bridge CFAttributedStringRef)tokens[line.paragraphIndex]);
+    } else if (line.hasInsertedHyphen) {
+      if (!ctLines[i]) return nullptr;
+      const NSArrayRef<CTRun*> runs = glyphRuns(ctLines[i]);
+      const Int trailingRunIndex = stu_label::trailingRunIndex(
+                                     runs, line.rangeInOriginalString.end,
+                                     line.paragraphBaseWritingDirection);
+      if (trailingRunIndex < 0) return nullptr;
+      // The layout normally inserts hyphenCodePoint. If the line was hyphenated with a different
+      // character, the metrics check below rejects the snapshot.
+      const HyphenLine hyphenLine = createHyphenLine(attributedString, runs[trailingRunIndex],
+                                                     hyphenCodePoint);
+      tokenCTLines[i] = hyphenLine.line;
+      if (hyphenLine.runIndex != line._hyphenRunIndex
+          || hyphenLine.glyphIndex != line._hyphenGlyphIndex)
+      {
+        return nullptr;
+      }
+    } else {
+      continue;
+    }
+    if (!hasMatchingMetrics(tokenCTLines[i], info.tokenCTLineRunCount,
+                            info.tokenCTLineGlyphCount, info.tokenCTLineWidth))
+    {
+      return nullptr;
+    }
+  }
+  guard.dismiss();
+
+  frameData.originalAttributedString = shapedString.attributedString;
+  Byte* const block = static_cast<Byte*>(alloc(oso.size));
+  TextFrame* const textFrame = new (block + oso.offset) TextFrame{frameData};
+  textFrame->_textStylesData = reinterpret_cast<const Byte*>(textFrame) + textFrame->_dataSize
+                             - sanitizerGap - textStylesSize;
+  textFrame->poisonSanitizerGaps();
+  incrementRefCount(textFrame->originalAttributedString);
+
+  memcpy(const_cast<Float32*>(textFrame->verticalSearchTable().endValues().begin()),
+         bytes + layout.verticalSearchTableOffset,
+         IntervalSearchTable::sizeInBytesForCount(lineCount));
+  memcpy(const_cast<StringStartIndices*>(textFrame->lineStringIndices().begin()),
+         bytes + layout.lineStringIndicesOffset, textFrame->lineStringIndices().arraySizeInBytes());
+
+  using array_utils::copyConstructArray;
+
+  const ArrayRef<TextFrameParagraph> thisParas = const_array_cast(textFrame->paragraphs());
+  copyConstructArray(paragraphs, thisParas.begin());
+  for (Int32 i = 0; i < paragraphCount; ++i) {
+    if (NSAttributedString* const token = tokens[i]) {
+      incrementRefCount(token);
+      thisParas[i].truncationToken = token;
+    }
+  }
+
+  const ArrayRef<TextFrameLine> thisLines = const_array_cast(textFrame->lines());
+  copyConstructArray(lines, thisLines.begin());
+  for (Int32 i = 0; i < lineCount; ++i) {
+    thisLines[i]._ctLine = ctLines[i];
+    thisLines[i]._tokenCTLine = tokenCTLines[i];
+  }
+
+  for (const ColorRef& color : colors) {
+    incrementRefCount(color.cgColor());
+  }
+  copyConstructArray(colors, const_array_cast(textFrame->colors()).begin());
+
+  copyConstructArray(textStyles, const_cast<Byte*>(textFrame->_textStylesData));
+
+  textFrame->mutablePrivateData().cachesImageBounds = header.cachesImageBounds != 0;
+
+  return textFrame;
+}
 
 } // namespace stu_label
@@ -26,11 +26,8 @@ static Float64 typographicOffset(const NSArrayRef<CTRun*>& runs, const RunGlyphI
   return width;
 }
 
-/// @returns The index of the last run in string order with positive width,
-///          or -1 if there is no such run or if there's a run with negative width.
-/// @pre Assumes all runs have a string range <= stringEndIndex.
-static Int trailingRunIndex(const NSArrayRef<CTRun*>& runs, Int stringEndIndex,
-                            STUWritingDirection baseWritingDirection) {
+Int trailingRunIndex(const NSArrayRef<CTRun*>& runs, Int stringEndIndex,
+                     STUWritingDirection baseWritingDirection) {
   const Int runCount = runs.count();
   Int maxStringRangeEnd = -1;
   Int maxStringRangeEndRunIndex = -1;
@@ -58,11 +55,12 @@ static Int trailingRunIndex(const NSArrayRef<CTRun*>& runs, Int stringEndIndex,
 }
 
 /// This function can be called multiple times for the same line.
-/// If if fails because the full line width including the inserted hyphen exceeds lineMaxWidth_,
-/// it won't mutate the line.
+/// If if fails because the full line width including the inserted hyphen exceeds
+/// state.lineMaxWidth, it won't mutate the line.
 auto TextFrameLayouter
      ::breakLineAt(TextFrameLine& line, Int stringIndex, Hyphen hyphen,
-                   TrailingWhitespaceStringLength trailingWhitespaceStringLength) const
+                   TrailingWhitespaceStringLength trailingWhitespaceStringLength,
+                   const LineBreakingState& state) const
   -> BreakLineAtStatus
 {
   STU_DEBUG_ASSERT(stringIndex >= line.rangeInOriginalString.start);
@@ -73,7 +71,7 @@ auto TextFrameLayouter
   if (stringLength > 0) {
     ctLine = CTTypesetterCreateLineWithOffset(
                typesetter_, Range{line.rangeInOriginalString.start, stringIndex},
-               lineHeadIndent_);
+               state.lineHeadIndent);
     width = typographicWidth(ctLine);
     if (STU_UNLIKELY(width <= 0)) {
       CFRelease(ctLine);
@@ -93,7 +91,7 @@ auto TextFrameLayouter
           const HyphenLine hyphenLine = createHyphenLine(attributedString_, run, hyphen.value);
           const Float64 ctLineWidth = width;
           width += hyphenLine.trailingGlyphAdvanceCorrection + hyphenLine.width;
-          if (width > lineMaxWidth_) {
+          if (width > state.lineMaxWidth) {
             CFRelease(ctLine);
             CFRelease(hyphenLine.line);
             return {.success = false, .ctLineWidthWithoutHyphen = ctLineWidth};
@@ -165,7 +163,7 @@ void TextFrameLayouter::justifyLine(STUTextFrameLine& line) const {
   const Float64 hyphenWidthPlusAdvanceCorrection = line.width - originalCTLineWidth;
   const CTLine* justifiedCTLine = CTLineCreateJustifiedLine(
                                     line._ctLine, 1,
-                                    lineMaxWidth_ - hyphenWidthPlusAdvanceCorrection);
+                                    lineBreaking_.lineMaxWidth - hyphenWidthPlusAdvanceCorrection);
   if (!justifiedCTLine) return;
   const Float64 justifiedCTLineWidth = typographicWidth(justifiedCTLine);
   if (justifiedCTLineWidth <= originalCTLineWidth) {
@@ -206,7 +204,9 @@ void TextFrameLayouter::justifyLine(STUTextFrameLine& line) const {
   }
 }
 
-bool TextFrameLayouter::hyphenateLineInRange(TextFrameLine& line, Range<Int> stringRange) {
+bool TextFrameLayouter::hyphenateLineInRange(TextFrameLine& line, Range<Int> stringRange,
+                                             const LineBreakingState& state) const
+{
   if (lastHyphenationLocationInRangeFinder_) {
     for (Int i = stringRange.end; i > stringRange.start + 1;) {
       const STUHyphenationLocation hl = lastHyphenationLocationInRangeFinder_(
@@ -218,57 +218,22 @@ bool TextFrameLayouter::hyphenateLineInRange(TextFrameLine& line, Range<Int> str
       }
       if (hl.index <= sign_cast(stringRange.start) || hl.index >= sign_cast(i)) break;
       i = sign_cast(hl.index);
-      if (breakLineAt(line, i, Hyphen{hl.hyphen}, TrailingWhitespaceStringLength{0}).success) {
+      if (breakLineAt(line, i, Hyphen{hl.hyphen}, TrailingWhitespaceStringLength{0}, state)
+          .success)
+      {
         return true;
       }
     }
     return false;
   }
-  const Int stringLength = attributedString_.string.count();
-  const Int outerEnd = stringRange.end >= stringLength ? stringRange.end
-                     : attributedString_.string
-                       .indexOfFirstUTF16CharWhere({stringRange.end,
-                                                    min(stringRange.end + 16, stringLength)},
-                                                   isUnicodeWhitespace);
-  __block bool result = false;
-  [attributedString_.attributedString
-     enumerateAttribute:STUHyphenationLocaleIdentifierAttributeName
-                inRange:NSRange(Range{stringRange.start, outerEnd})
-                options:NSAttributedStringEnumerationReverse // We want the longest effective range.
-             usingBlock:^(__unsafe_unretained id value, NSRange nsRange, BOOL* shouldStop)
-  {
-    const auto range = Range<Int>(nsRange);
-    if (range.start >= stringRange.end) return;
-    CFString* const localeId = (__bridge CFStringRef)value;
-    if (!localeId) return;
-    if (localeId != cachedLocaleId_ && CFStringGetLength(localeId) == 0) return;
-    if (localeId == cachedLocaleId_ || (cachedLocaleId_ && CFEqual(localeId, cachedLocaleId_))) {
-      if (!cachedLocale_) return;
-    } else {
-      cachedLocaleId_ = localeId;
-      cachedLocale_ = RC<CFLocale>{CFLocaleCreate(nil, localeId), ShouldIncrementRefCount{false}};
-      if (!cachedLocale_) return;
-      if (!CFStringIsHyphenationAvailableForLocale(cachedLocale_.get())) {
-        cachedLocale_ = nullptr;
-        return;
-      }
-    }
-    for (Int i = min(stringRange.end, range.end); i > range.start + 1;) {
-      UTF32Char hyphen;
-      i = CFStringGetHyphenationLocationBeforeIndex(
-            attributedString_.string, i, range, 0, cachedLocale_.get(), &hyphen);
-      if (i <= range.start) break;
-      if (hyphen == 0x2D) { // We prefer a proper hyphen, not a hyphen-minus.
-        hyphen = hyphenCodePoint;
-      }
-      if (breakLineAt(line, i, Hyphen{hyphen}, TrailingWhitespaceStringLength{0}).success) {
-        result = true;
-        *shouldStop = true;
-        return;
-      }
-    }
-  }];
-  return result;
+  // The ShapedString caches the hyphenation opportunities of all but very long paragraphs, so that
+  // repeated layouts of the same string don't have to query CFString again.
+  return shapedString_.forEachHyphenationOpportunityInReverse(
+           stringParas()[line.paragraphIndex], stringRange,
+           [&](const ShapedString::HyphenationOpportunity& ho) {
+             return breakLineAt(line, ho.stringIndex, Hyphen{ho.hyphen},
+                                TrailingWhitespaceStringLength{0}, state).success;
+           });
 }
 
 STU_NO_INLINE
@@ -320,12 +285,14 @@ bool isLikelyGoodLineBreakLocation(const NSAttributedStringRef& attributedString
   }
 }
 
-void TextFrameLayouter::breakLine(TextFrameLine& line, Int paraStringEndIndex) {
+void TextFrameLayouter::breakLine(TextFrameLine& line, Int paraStringEndIndex,
+                                  const LineBreakingState& state) const
+{
   STU_DEBUG_ASSERT(line._ctLine == nil);
   const Int start = line.rangeInOriginalString.start;
   STU_DEBUG_ASSERT(paraStringEndIndex > start);
-  const Float64 maxWidth = lineMaxWidth_;
-  const Float64 headIndent = lineHeadIndent_;
+  const Float64 maxWidth = state.lineMaxWidth;
+  const Float64 headIndent = state.lineHeadIndent;
   Int end = min(paraStringEndIndex, start + CTTypesetterSuggestLineBreakWithOffset(
                                               typesetter_, start, maxWidth, headIndent));
   const NSStringRef& string = attributedString_.string;
@@ -341,7 +308,7 @@ void TextFrameLayouter::breakLine(TextFrameLine& line, Int paraStringEndIndex) {
     // https://openradar.appspot.com/radar?id=5491960840192000
     const Int end1 = hyphen == 0 ? string.indexOfTrailingWhitespaceIn({start, end}) : end;
     const auto status = breakLineAt(line, end1, Hyphen{hyphen},
-                                    TrailingWhitespaceStringLength{end - end1});
+                                    TrailingWhitespaceStringLength{end - end1}, state);
     if (status.success) break;
     STU_DEBUG_ASSERT(hyphen != 0);
     const Int end2 = start + CTTypesetterSuggestLineBreakWithOffset(
@@ -357,10 +324,10 @@ void TextFrameLayouter::breakLine(TextFrameLine& line, Int paraStringEndIndex) {
     }
     // There is no good prior line break opportunity, so we break the line at the soft hyphen
     // without inserting a hyphen.
-    breakLineAt(line, end, Hyphen{}, TrailingWhitespaceStringLength{0});
+    breakLineAt(line, end, Hyphen{}, TrailingWhitespaceStringLength{0}, state);
     break;
   }
-  if (hyphenationFactor_ == 0 || end == paraStringEndIndex || maxWidth <= 0) {
+  if (state.hyphenationFactor == 0 || end == paraStringEndIndex || maxWidth <= 0) {
     return;
   }
   const Int maxEnd = clamp(end,
@@ -371,13 +338,14 @@ void TextFrameLayouter::breakLine(TextFrameLine& line, Int paraStringEndIndex) {
   // find any good location that would fit the max width. We might be able to improve on that
   // by finding a hyphenation location.
   const bool isGoodBreak = isLikelyGoodLineBreakLocation(attributedString_, end);
-  if (isGoodBreak && (end == maxEnd || line.width/maxWidth >= hyphenationFactor_)) {
+  if (isGoodBreak && (end == maxEnd || line.width/maxWidth >= state.hyphenationFactor)) {
     return;
   }
   // `hyphenateLineInRange` will try to break the line with a hyphen in the specified range. If
   // successful, the result in `line` will be overwritten, otherwise `line` is not changed.
   hyphenateLineInRange(line, Range{isGoodBreak ? end : start,
-                                   string.endIndexOfGraphemeClusterAt(maxEnd)});
+                                   string.endIndexOfGraphemeClusterAt(maxEnd)},
+                       state);
 }
 
 } // namespace stu_label
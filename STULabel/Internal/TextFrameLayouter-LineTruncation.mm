@@ -2,6 +2,8 @@
 
 #import "TextFrameLayouter.hpp"
 
+#import "STULabel/stu_mutex.h"
+
 #import "LineTruncation.hpp"
 #import "Once.hpp"
 #import "UnicodeCodePointProperties.hpp"
@@ -30,6 +32,177 @@ void TextFrameLayouter::addAttributesNotYetPresentInAttributedString(
   }];
 }
 
+static NSAttributedString* createTruncationToken(
+                              NSAttributedString* __unsafe_unretained __nullable originalToken,
+                              NSDictionary<NSAttributedStringKey, id>* __unsafe_unretained
+                                __nullable attributes,
+                              STUWritingDirection baseWritingDirection)
+{
+  if (!originalToken) {
+    // The NSMutableParagraphStyle.baseWritingDirection shouldn't matter for the ellipsis.
+    return [[NSAttributedString alloc] initWithString:@"…" attributes:attributes];
+  }
+  NSMutableAttributedString* const mutableToken = [originalToken mutableCopy];
+  const NSRange range = NSRange{0, originalToken.length};
+  if (attributes) {
+    TextFrameLayouter::addAttributesNotYetPresentInAttributedString(mutableToken, range,
+                                                                    attributes);
+  }
+  NSParagraphStyle* __unsafe_unretained paraStyle;
+  if (baseWritingDirection == STUWritingDirectionLeftToRight) {
+    STU_STATIC_CONST_ONCE(NSParagraphStyle*, ltrStyle, ({
+      NSMutableParagraphStyle* style = [[NSMutableParagraphStyle alloc] init];
+      style.baseWritingDirection = NSWritingDirectionLeftToRight;
+      style;
+    }));
+    paraStyle = ltrStyle;
+  } else {
+    // TODO: Add radar numbers for CoreText RTL bugs.
+    STU_STATIC_CONST_ONCE(NSParagraphStyle*, rtlStyle, ({
+      NSMutableParagraphStyle* style = [[NSMutableParagraphStyle alloc] init];
+      style.baseWritingDirection = NSWritingDirectionRightToLeft;
+      style;
+    }));
+    paraStyle = rtlStyle;
+  }
+  [mutableToken addAttribute:NSParagraphStyleAttributeName value:paraStyle range:range];
+  return [mutableToken copy];
+}
+
+namespace {
+
+/// A small most-recently-used cache of shaped truncation tokens. Feeds with many truncated labels
+/// usually use the same token with only a few different attribute dictionaries, so a short list
+/// suffices.
+struct TruncationTokenCache {
+  static constexpr Int capacity = 16;
+
+  struct Entry {
+    /// Is compared by identity. The token strings in the text frame options and truncation scopes
+    /// are immutable copies. Null for the default ellipsis token.
+    NSAttributedString* originalToken;
+    NSDictionary<NSAttributedStringKey, id>* attributes;
+    STUWritingDirection baseWritingDirection;
+    NSAttributedString* token;
+    RC<CTLine> line;
+    Float64 width;
+
+    bool matches(NSAttributedString* __unsafe_unretained __nullable otherOriginalToken,
+                 NSDictionary<NSAttributedStringKey, id>* __unsafe_unretained __nullable
+                   otherAttributes,
+                 STUWritingDirection otherBaseWritingDirection) const
+    {
+      return originalToken == otherOriginalToken
+          && baseWritingDirection == otherBaseWritingDirection
+          && (attributes == otherAttributes || [attributes isEqual:otherAttributes]);
+    }
+  };
+
+  Int count;
+  Entry entries[capacity];
+
+  void clear() {
+    for (Int i = 0; i < count; ++i) {
+      entries[i] = Entry{};
+    }
+    count = 0;
+  }
+};
+
+stu_mutex truncationTokenCacheMutex = STU_MUTEX_INIT;
+bool truncationTokenCacheIsInitialized = false;
+alignas(TruncationTokenCache)
+Byte truncationTokenCacheStorage[sizeof(TruncationTokenCache)];
+
+} // namespace
+
+/// @pre truncationTokenCacheMutex must be locked by the current thread.
+static TruncationTokenCache& truncationTokenCache() {
+  if (STU_UNLIKELY(!truncationTokenCacheIsInitialized)) {
+    truncationTokenCacheIsInitialized = true;
+    TruncationTokenCache& cache = *new (truncationTokenCacheStorage) TruncationTokenCache{};
+
+#if TARGET_OS_IPHONE
+    NSNotificationCenter* const notificationCenter = NSNotificationCenter.defaultCenter;
+    NSOperationQueue* const mainQueue = NSOperationQueue.mainQueue;
+    const auto clearCacheBlock = ^(NSNotification*) {
+      stu_mutex_lock(&truncationTokenCacheMutex);
+      cache.clear();
+      stu_mutex_unlock(&truncationTokenCacheMutex);
+    };
+    [notificationCenter addObserverForName:UIApplicationDidEnterBackgroundNotification
+                                    object:nil queue:mainQueue usingBlock:clearCacheBlock];
+    [notificationCenter addObserverForName:UIApplicationDidReceiveMemoryWarningNotification
+                                    object:nil queue:mainQueue usingBlock:clearCacheBlock];
+#endif
+  }
+  return reinterpret_cast<TruncationTokenCache&>(truncationTokenCacheStorage);
+}
+
+auto TextFrameLayouter::truncationTokenLine(
+                          NSAttributedString* __unsafe_unretained __nullable originalToken,
+                          NSDictionary<NSAttributedStringKey, id>* __unsafe_unretained
+                            __nullable attributes,
+                          STUWritingDirection baseWritingDirection)
+  -> TruncationTokenLine
+{
+  if (!originalToken) {
+    baseWritingDirection = STUWritingDirectionLeftToRight;
+  }
+  stu_mutex_lock(&truncationTokenCacheMutex);
+  {
+    TruncationTokenCache& cache = truncationTokenCache();
+    for (Int i = 0; i < cache.count; ++i) {
+      TruncationTokenCache::Entry& entry = cache.entries[i];
+      if (!entry.matches(originalToken, attributes, baseWritingDirection)) continue;
+      if (i != 0) {
+        std::rotate(cache.entries, cache.entries + i, cache.entries + i + 1);
+      }
+      const TruncationTokenCache::Entry& e = cache.entries[0];
+      TruncationTokenLine result = {.token = e.token, .line = e.line.get(), .width = e.width};
+      CFRetain(result.line);
+      stu_mutex_unlock(&truncationTokenCacheMutex);
+      return result;
+    }
+  }
+  stu_mutex_unlock(&truncationTokenCacheMutex);
+
+  NSAttributedString* const token = createTruncationToken(originalToken, attributes,
+                                                          baseWritingDirection);
+  CTLine* const line = CTLineCreateWithAttributedString((__bridge CFAttributedStringRef)token);
+  STU_ASSERT(line);
+  const Float64 width = typographicWidth(line);
+
+  stu_mutex_lock(&truncationTokenCacheMutex);
+  {
+    TruncationTokenCache& cache = truncationTokenCache();
+    Int i = 0;
+    for (; i < cache.count; ++i) {
+      if (cache.entries[i].matches(originalToken, attributes, baseWritingDirection)) break;
+    }
+    if (i == cache.count) {
+      if (cache.count < TruncationTokenCache::capacity) {
+        cache.count += 1;
+      } else {
+        i -= 1;
+      }
+    }
+    std::rotate(cache.entries, cache.entries + i, cache.entries + i + 1);
+    cache.entries[0] = TruncationTokenCache::Entry{
+                         .originalToken = originalToken,
+                         // The attributes may be a mutable dictionary created for the excised
+                         // range, so we store an immutable copy.
+                         .attributes = [attributes copy],
+                         .baseWritingDirection = baseWritingDirection,
+                         .token = token,
+                         .line = RC<CTLine>{line},
+                         .width = width};
+  }
+  stu_mutex_unlock(&truncationTokenCacheMutex);
+
+  return {.token = token, .line = line, .width = width};
+}
+
 static NSDictionary<NSAttributedStringKey, id>*
   getAttributesThatApplyToWholeRangeIgnoringTrailingWhitespace(
     const NSAttributedStringRef& attributedString,
@@ -192,14 +365,14 @@ void TextFrameLayouter::truncateLine(TextFrameLine& line,
   const Range<Int> untruncatedRange = {start, end};
   CTLine* untruncatedLine = untruncatedRange.isEmpty() ? nullptr
                           : CTTypesetterCreateLineWithOffset(typesetter_, untruncatedRange,
-                                                             lineHeadIndent_);
+                                                             lineBreaking_.lineHeadIndent);
   const Float64 untruncatedWidth = untruncatedLine ? typographicWidth(untruncatedLine) : 0;
   if (STU_UNLIKELY(untruncatedLine && untruncatedWidth == 0)) {
     CFRelease(untruncatedLine);
     untruncatedLine = nullptr;
   }
   if (isSingleLineTruncation) {
-    if (untruncatedWidth <= lineMaxWidth_) {
+    if (untruncatedWidth <= lineBreaking_.lineMaxWidth) {
       line.init_step2(TextFrameLine::InitStep2Params{
         .rangeInOriginalStringEnd = end,
         .rangeInTruncatedStringCount = untruncatedRange.count(),
@@ -274,54 +447,20 @@ void TextFrameLayouter::truncateLine(TextFrameLine& line,
   Int iterationCount = 0;
   for (;;) {
     NSAttributedString* const previousToken = token;
-    bool tokenIsMutable;
-    if (!truncationToken) {
-      token = [[NSAttributedString alloc] initWithString:@"…" attributes:tokenAttributes];
-      // The NSMutableParagraphStyle.baseWritingDirection shouldn't matter for the ellipsis.
-      tokenIsMutable = false;
-    } else {
-      NSMutableAttributedString* const mutableToken = [truncationToken mutableCopy];
-      if (tokenAttributes) {
-        addAttributesNotYetPresentInAttributedString(mutableToken,
-                                                     NSRange{0, sign_cast(tokenLength)},
-                                                     tokenAttributes);
-      }
-      NSParagraphStyle* __unsafe_unretained paraStyle;
-      if (tokenBaseWritingDirection == STUWritingDirectionLeftToRight) {
-        STU_STATIC_CONST_ONCE(NSParagraphStyle*, ltrStyle, ({
-          NSMutableParagraphStyle* style = [[NSMutableParagraphStyle alloc] init];
-          style.baseWritingDirection = NSWritingDirectionLeftToRight;
-          style;
-        }));
-        paraStyle = ltrStyle;
-      } else {
-        // TODO: Add radar numbers for CoreText RTL bugs.
-        STU_STATIC_CONST_ONCE(NSParagraphStyle*, rtlStyle, ({
-          NSMutableParagraphStyle* style = [[NSMutableParagraphStyle alloc] init];
-          style.baseWritingDirection = NSWritingDirectionRightToLeft;
-          style;
-        }));
-        paraStyle = rtlStyle;
-      }
-      [mutableToken addAttribute:NSParagraphStyleAttributeName
-                           value:paraStyle range:NSRange(Range{0, tokenLength})];
-      token = mutableToken;
-      tokenIsMutable = true;
-    }
+    const TruncationTokenLine tl = truncationTokenLine(truncationToken, tokenAttributes,
+                                                       tokenBaseWritingDirection);
+    token = tl.token;
     if (++iterationCount > 1) {
       // If the attributedToken hasn't changed from the last iteration, we're done.
-      if ([previousToken isEqual:token] || iterationCount == 4) break;
+      if (token == previousToken || [previousToken isEqual:token] || iterationCount == 4) {
+        CFRelease(tl.line);
+        break;
+      }
       CFRelease(tokenLine);
     }
-    if (tokenIsMutable) {
-      token = [token copy];
-      tokenIsMutable = false;
-      discard(tokenIsMutable); // We won't actually read this value again.
-    }
-    tokenLine = CTLineCreateWithAttributedString((__bridge CFAttributedStringRef)token);
-    STU_ASSERT(tokenLine);
+    tokenLine = tl.line;
     const Float64 previousTokenWidth = tokenWidth;
-    tokenWidth = typographicWidth(tokenLine);
+    tokenWidth = tl.width;
   #if STU_DEBUG
     STU_ASSERT(iterationCount != 1 || tokenWidth != previousTokenWidth);
   #else
@@ -330,7 +469,7 @@ void TextFrameLayouter::truncateLine(TextFrameLine& line,
   #endif
     // If the width didn't change, the truncation range and thus the attributes won't change either.
     if (tokenWidth == previousTokenWidth) break;
-    if (tokenWidth >= lineMaxWidth_) {
+    if (tokenWidth >= lineBreaking_.lineMaxWidth) {
       rightPartXOffset = 0;
       leftPartEnd = rightPartStart = RunGlyphIndex{-1, -1};
       // We rather exceed the max width than have no indication of truncation.
@@ -351,7 +490,7 @@ void TextFrameLayouter::truncateLine(TextFrameLine& line,
     } else {
       keepUntruncated = true;
       keepToken = true;
-      const Float64 availableWidth = lineMaxWidth_ - tokenWidth;
+      const Float64 availableWidth = lineBreaking_.lineMaxWidth - tokenWidth;
       if (availableWidth >= untruncatedWidth) {
         // We can get here if the stringRange contains multiple line terminators and the first line
         // isn't long.
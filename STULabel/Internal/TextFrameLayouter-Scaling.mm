@@ -273,8 +273,7 @@ Float64 TextFrameLayouter::estimateTailTruncationTokenWidth(const TextFrameLine&
                                                               originalTruncationToken) const
 
 {
-  // TODO: Compute the token exactly like in TextFrameLayouter::truncateLine, ideally by using
-  //       a common utility function.
+  // TODO: Compute the token attributes exactly like in TextFrameLayouter::truncateLine.
   const auto& stringPara = stringParas()[line.paragraphIndex];
   if (stringPara.truncationScopeIndex >= 0) {
     const auto& truncationScope = truncationScopes_[stringPara.truncationScopeIndex];
@@ -283,18 +282,11 @@ Float64 TextFrameLayouter::estimateTailTruncationTokenWidth(const TextFrameLine&
     }
   }
   auto* const attributes = attributedString_.attributesAtIndex(line.rangeInOriginalString.end - 1);
-  NSAttributedString* token;
-  if (!originalTruncationToken) {
-    token = [[NSAttributedString alloc] initWithString:@"…" attributes:attributes];
-  } else {
-    NSMutableAttributedString* mutableToken = [originalTruncationToken mutableCopy];
-    TextFrameLayouter::addAttributesNotYetPresentInAttributedString(
-                         mutableToken, NSRange{0, mutableToken.length}, attributes);
-    token = mutableToken;
-  }
-  const RC<CTLine> ctLine{CTLineCreateWithAttributedString((__bridge CFAttributedStringRef)token),
-                          ShouldIncrementRefCount{false}};
-  return CTLineGetTypographicBounds(ctLine.get(), nullptr, nullptr, nullptr);
+  const TruncationTokenLine tl = truncationTokenLine(
+                                   originalTruncationToken, attributes,
+                                   paras_[line.paragraphIndex].baseWritingDirection);
+  CFRelease(tl.line);
+  return tl.width;
 }
 
 struct ScalingPara {
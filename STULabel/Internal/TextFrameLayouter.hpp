@@ -12,6 +12,12 @@ using CTTypesetter = RemovePointer<CTTypesetterRef>;
 
 struct TextFrameOptions;
 
+/// @returns The index of the last run in string order with positive width,
+///          or -1 if there is no such run or if there's a run with negative width.
+/// @pre Assumes all runs have a string range <= stringEndIndex.
+Int trailingRunIndex(const NSArrayRef<CTRun*>& runs, Int stringEndIndex,
+                     STUWritingDirection baseWritingDirection);
+
 class TextFrameLayouter {
 public:
   TextFrameLayouter(const ShapedString&, Range<Int32> stringRange,
@@ -77,6 +83,16 @@ public:
 
   void justifyLinesWhereNecessary();
 
+  /// Tries to adapt the current layout to the specified frame width without breaking the lines
+  /// again. This is only possible if the width is not larger than the current frame width, the
+  /// text is neither scaled, truncated, clipped, justified nor hyphenated and all lines fit the new
+  /// width.
+  /// Returns false (and leaves the layout unchanged) if the lines would have to be laid out again.
+  bool tryToReuseLayoutForNarrowerFrameWidth(Float64 frameWidth);
+
+  /// The layout info of a text frame created from the current layout, for the frame origin (0, 0).
+  STUTextFrameLayoutInfo layoutInfo() const;
+
   const ScaleInfo& scaleInfo() const { return scaleInfo_; }
 
   Size<Float64> inverselyScaledFrameSize() const { return inverselyScaledFrameSize_; }
@@ -131,6 +147,14 @@ public:
     ownsCTLinesAndParagraphTruncationTokens_ = false;
   }
 
+  /// Releases the CTLines and paragraph truncation tokens of the current layout, e.g. after the
+  /// layout info was obtained when no text frame is to be created from the layout.
+  /// After this call no method other than the destructor may be called.
+  void releaseCTLinesAndParagraphTruncationTokens() {
+    destroyLinesAndParagraphs();
+    ownsCTLinesAndParagraphTruncationTokens_ = false;
+  }
+
   LocalFontInfoCache& localFontInfoCache() { return localFontInfoCache_; }
 
   STU_INLINE
@@ -141,6 +165,14 @@ public:
                (minBaselineDistance - (line._heightAboveBaseline + line._heightBelowBaseline))/2);
   }
 
+  /// The offset that is passed to `CTTypesetterCreateLineWithOffset` for lines in the specified
+  /// paragraph.
+  static Float64 lineHeadIndent(const ShapedString::Paragraph& para, bool isInitialLine,
+                                Float64 inverseScale)
+  {
+    return Indentations{para, isInitialLine, ScaleInfo{.inverseScale = inverseScale}}.head;
+  }
+
 
 private:
   struct Indentations {
@@ -192,7 +224,14 @@ private:
     using Parameter::Parameter;
   };
 
-  void breakLine(TextFrameLine& line, Int paraStringEndIndex);
+  /// The per-line parameters of the line breaking functions.
+  struct LineBreakingState {
+    Float64 lineMaxWidth;
+    Float64 lineHeadIndent;
+    Float64 hyphenationFactor;
+  };
+
+  void breakLine(TextFrameLine& line, Int paraStringEndIndex, const LineBreakingState&) const;
 
   struct BreakLineAtStatus {
     bool success;
@@ -200,9 +239,10 @@ private:
   };
 
   BreakLineAtStatus breakLineAt(TextFrameLine& line, Int stringIndex, Hyphen hyphen,
-                                TrailingWhitespaceStringLength) const;
+                                TrailingWhitespaceStringLength, const LineBreakingState&) const;
 
-  bool hyphenateLineInRange(TextFrameLine& line, Range<Int> stringRange);
+  bool hyphenateLineInRange(TextFrameLine& line, Range<Int> stringRange,
+                            const LineBreakingState&) const;
 
   void truncateLine(TextFrameLine& line, Int32 stringEndIndex, Range<Int32> truncatableRange,
                     CTLineTruncationType, NSAttributedString* __nullable token,
@@ -229,6 +269,25 @@ private:
   static void addAttributesNotYetPresentInAttributedString(
                 NSMutableAttributedString*, NSRange, NSDictionary<NSAttributedStringKey, id>*);
 
+  struct TruncationTokenLine {
+    NSAttributedString* token;
+    /// The caller owns a reference to the line.
+    CTLine* line;
+    Float64 width;
+  };
+
+  /// Returns the truncation token with the specified attributes added to the original token (or
+  /// the default "…" token if `originalToken` is null), together with its shaped line.
+  ///
+  /// The results are kept in a small process-wide cache, so that the same token doesn't have to be
+  /// shaped again for every truncated line in every text frame.
+  ///
+  /// Thread-safe.
+  static TruncationTokenLine truncationTokenLine(
+                               NSAttributedString* __nullable originalToken,
+                               NSDictionary<NSAttributedStringKey, id>* __nullable attributes,
+                               STUWritingDirection baseWritingDirection);
+
   Float64 estimateTailTruncationTokenWidth(const TextFrameLine& line, NSAttributedString*) const;
 
   class SavedLayout {
@@ -267,6 +326,7 @@ private:
   void restoreLayoutFrom(SavedLayout&&);
 
   struct InitData {
+    const ShapedString& shapedString;
     const STUCancellationFlag& cancellationFlag;
     CTTypesetter* const typesetter;
     TempStringBuffer tempStringBuffer;
@@ -294,6 +354,7 @@ private:
   }
 
   const TempStringBuffer tempStringBuffer_;
+  const ShapedString& shapedString_;
   const STUCancellationFlag& cancellationFlag_;
   CTTypesetter* const typesetter_;
   const NSAttributedStringRef attributedString_;
@@ -316,12 +377,8 @@ private:
   Float32 minimalSpacingBelowLastLine_{};
   Int clippedParagraphCount_{};
   const TextStyle* clippedOriginalStringTerminatorStyle_;
-  /// A cached CFLocale instance for hyphenation purposes.
-  RC<CFLocale> cachedLocale_;
-  CFString* cachedLocaleId_{};
-  Float64 lineMaxWidth_;
-  Float64 lineHeadIndent_;
-  Float64 hyphenationFactor_;
+  /// The line breaking state of the sequential layout.
+  LineBreakingState lineBreaking_{};
   STULastHyphenationLocationInRangeFinder __nullable __unsafe_unretained
     lastHyphenationLocationInRangeFinder_;
   LocalFontInfoCache localFontInfoCache_;
@@ -7,6 +7,7 @@
 
 #import "CoreGraphicsUtils.hpp"
 #import "InputClamping.hpp"
+#import "Once.hpp"
 
 #include "DefineUIntOnCatalystToWorkAroundGlobalNamespacePollution.h"
 
@@ -112,6 +113,7 @@ auto TextFrameLayouter::InitData::create(const ShapedString& shapedString, Range
   if (!paras.isEmpty()) {
     paras[0].rangeInOriginalString.start = stringRange.start;
     paras[$ - 1].rangeInOriginalString.end = stringRange.end;
+    paras[$ - 1].excisedRangeInOriginalString = {stringRange.end, stringRange.end};
     paras[$ - 1].paragraphTerminatorInOriginalStringLength =
       narrow_cast<UInt8>(max(0, stringRange.end - (  stringParas[$ - 1].stringRange.end
                                                    - stringParas[$ - 1].terminatorStringLength)));
@@ -150,7 +152,8 @@ auto TextFrameLayouter::InitData::create(const ShapedString& shapedString, Range
   TempStringBuffer tempStringBuffer{paras.allocator()};
   NSAttributedStringRef attributedString{shapedString.attributedString, Ref{tempStringBuffer}};
 
-  return {.cancellationFlag = *(cancellationFlag ?: &CancellationFlag::neverCancelledFlag),
+  return {.shapedString = shapedString,
+          .cancellationFlag = *(cancellationFlag ?: &CancellationFlag::neverCancelledFlag),
           .typesetter = shapedString.typesetter.get(),
           .tempStringBuffer = std::move(tempStringBuffer),
           .attributedString = attributedString,
@@ -167,6 +170,7 @@ auto TextFrameLayouter::InitData::create(const ShapedString& shapedString, Range
 
 TextFrameLayouter::TextFrameLayouter(InitData init)
 : tempStringBuffer_{std::move(init.tempStringBuffer)},
+  shapedString_{init.shapedString},
   cancellationFlag_{init.cancellationFlag},
   typesetter_{init.typesetter},
   attributedString_{init.attributedString},
@@ -589,6 +593,19 @@ bool isJustified(const STUTextFrameParagraph& para) {
   return (para.alignment & 0x1) != 0;
 }
 
+STU_INLINE
+Float64 lineOriginX(const STUTextFrameParagraph& para, Float64 frameWidth, Float64 lineWidth,
+                    Float64 leftIndent, Float64 rightIndent)
+{
+  if (isLeftAligned(para)) {
+    return leftIndent;
+  } else if (para.alignment == STUParagraphAlignmentCenter) {
+    return (frameWidth - lineWidth)/2 + (leftIndent - rightIndent);
+  } else { // Align right.
+    return frameWidth - rightIndent - lineWidth;
+  }
+}
+
 
 bool TextFrameLayouter::lastLineFitsFrameHeight() const {
   if (STU_UNLIKELY(lines_.isEmpty())) return true;
@@ -631,8 +648,11 @@ void TextFrameLayouter::layout(const Size<Float64> inverselyScaledFrameSize,
     if (clippedStringRangeEnd_ < stringRange_.end) {
       TextFrameParagraph& clippedPara = paras_[clippedParagraphCount_ - 1];
       const ShapedString::Paragraph& spara = stringParas()[clippedParagraphCount_ - 1];
-      clippedPara.rangeInOriginalString.end = spara.stringRange.end;
-      clippedPara.paragraphTerminatorInOriginalStringLength = spara.terminatorStringLength;
+      // The last paragraph is clipped to the string range of the text frame.
+      clippedPara.rangeInOriginalString.end = min(spara.stringRange.end, stringRange_.end);
+      clippedPara.paragraphTerminatorInOriginalStringLength = narrow_cast<UInt8>(
+        max(0, clippedPara.rangeInOriginalString.end
+               - (spara.stringRange.end - spara.terminatorStringLength)));
       clippedPara.isLastParagraph = clippedParagraphCount_ == paras_.count();
     }
     for (auto& para : paras_[{0, clippedParagraphCount_}].reversed()) {
@@ -657,7 +677,7 @@ NewTruncationScope:;
   Optional<const TruncationScope&> truncationScope =
     spara->truncationScopeIndex < 0 ? nil : &truncationScopes_[spara->truncationScopeIndex];
 NewParagraph:;
-  hyphenationFactor_ = spara->hyphenationFactor;
+  lineBreaking_.hyphenationFactor = spara->hyphenationFactor;
   para->lineIndexRange.start = narrow_cast<Int32>(lines_.count());
   if (__builtin_add_overflow(para->lineIndexRange.start, spara->maxNumberOfInitialLines,
                              &para->initialLinesEndIndex))
@@ -697,8 +717,8 @@ NewParagraph:;
     });
 
     const Indentations indent{*spara, isInitialLineInParagraph, scaleInfo_};
-    lineHeadIndent_ = indent.head;
-    lineMaxWidth_ = max(0, frameWidth - indent.left - indent.right);
+    lineBreaking_.lineHeadIndent = indent.head;
+    lineBreaking_.lineMaxWidth = max(0, frameWidth - indent.left - indent.right);
 
     enum ShouldTruncate {
       shouldNotTruncate = 0,
@@ -718,7 +738,7 @@ NewParagraph:;
 
     Int32 nextStringIndex;
     if (!shouldTruncate) {
-      breakLine(*line, para->rangeInOriginalString.end);
+      breakLine(*line, para->rangeInOriginalString.end, lineBreaking_);
       nextStringIndex = line->rangeInOriginalString.end
                       + line->trailingWhitespaceInTruncatedStringLength;
     } else {
@@ -756,16 +776,9 @@ NewParagraph:;
     }
 
     // "may" because we may backtrack.
-    mayExceedMaxWidth_ |= line->width > lineMaxWidth_;
-
-    Float64 originX;
-    if (isLeftAligned(*para)) {
-      originX = indent.left;
-    } else if (para->alignment == STUParagraphAlignmentCenter) {
-      originX = (frameWidth - line->width)/2 + (indent.left - indent.right);
-    } else { // Align right.
-      originX = frameWidth - indent.right - line->width;
-    }
+    mayExceedMaxWidth_ |= line->width > lineBreaking_.lineMaxWidth;
+
+    const Float64 originX = lineOriginX(*para, frameWidth, line->width, indent.left, indent.right);
 
     style = initializeTypographicMetricsOfLine(*line);
 
@@ -810,7 +823,7 @@ NewParagraph:;
       {
         para->initialLinesEndIndex = maxValue<Int32>;
       }
-      hyphenationFactor_ = spara->hyphenationFactor;
+      lineBreaking_.hyphenationFactor = spara->hyphenationFactor;
       truncationScope = none;
       goto LastLine;
     } else { // lastLineTruncationMode == STULastLineTruncationModeClip
@@ -862,6 +875,7 @@ NewParagraph:;
       const Int32 lineIndex = narrow_cast<Int32>(lines_.count());
       para->lineIndexRange.start = lineIndex;
       para->lineIndexRange.end = lineIndex;
+      para->initialLinesEndIndex = lineIndex;
       para->excisedRangeInOriginalString.start = para->rangeInOriginalString.start;
       STU_ASSERT(stringIndex >= para->rangeInOriginalString.end
                                 - para->paragraphTerminatorInOriginalStringLength);
@@ -1132,8 +1146,8 @@ void TextFrameLayouter::justifyLinesWhereNecessary() {
       const Indentations indent{stringParas()[paraIndex], para, lineIndex, scaleInfo_};
       const Float64 maxWidth = frameWidth - indent.left - indent.right;
       if (maxWidth <= line.width) continue;
-      lineMaxWidth_ = maxWidth;
-      lineHeadIndent_ = indent.head;
+      lineBreaking_.lineMaxWidth = maxWidth;
+      lineBreaking_.lineHeadIndent = indent.head;
       justifyLine(line);
       if (para.alignment == STUParagraphAlignmentJustifiedLeft) {
         line.originX = indent.left;
@@ -1144,4 +1158,130 @@ void TextFrameLayouter::justifyLinesWhereNecessary() {
   }
 }
 
+STUTextFrameLayoutInfo TextFrameLayouter::layoutInfo() const {
+  const CGFloat textScaleFactor = scaleInfo_.scale;
+  STUTextFrameLayoutInfo info = {
+    .lineCount = narrow_cast<Int32>(lines_.count()),
+    .layoutMode = layoutMode_,
+    .size = narrow_cast<CGSize>(textScaleFactor*inverselyScaledFrameSize_),
+    .textScaleFactor = textScaleFactor
+  };
+  const ArrayRef<const TextFrameParagraph> paragraphs = this->paragraphs();
+  if (lines_.isEmpty()) {
+    info.consistentAlignment = STUTextFrameConsistentAlignmentLeft;
+    info.flags = STUTextFrameHasMaxTypographicWidth;
+    return info;
+  }
+
+  bool isTruncated = false;
+  TextFlags flags{};
+  Range<Float64> xBounds = Range<Float64>::infinitelyEmpty();
+  for (const TextFrameParagraph& para : paragraphs) {
+    isTruncated |= !para.excisedRangeInOriginalString().isEmpty();
+    const ShapedString::Paragraph& spara = stringParas()[para.paragraphIndex];
+    for (const Int32 lineIndex : para.lineIndexRange().iter()) {
+      const TextFrameLine& line = lines_[lineIndex];
+      flags |= line.textFlags();
+      Range<Float64> x = line.originX + Range{0., line.width};
+      if (para.isIndented) {
+        const Indentations indent{spara, para, lineIndex, scaleInfo_};
+        x.start -= indent.left;
+        x.end += indent.right;
+      }
+      xBounds = xBounds.convexHull(x);
+    }
+  }
+  info.minX = textScaleFactor*xBounds.start;
+  info.maxX = textScaleFactor*xBounds.end;
+
+  const auto& firstLine = lines_[0];
+  const auto& lastLine = lines_[$ - 1];
+
+  Float64 firstBaseline = firstLine.originY;
+  Float64 lastBaseline = lastLine.originY;
+  if (const auto& displayScale = scaleInfo_.displayScale) {
+    firstBaseline = ceilToScale(firstBaseline, *displayScale);
+    lastBaseline = ceilToScale(lastBaseline, *displayScale);
+  }
+  info.firstBaseline = textScaleFactor*firstBaseline;
+  info.lastBaseline = textScaleFactor*lastBaseline;
+
+  const Float32 firstLineHeight = firstLine._heightAboveBaseline + firstLine._heightBelowBaseline;
+  const Float32 lastLineHeight = lastLine._heightAboveBaseline + lastLine._heightBelowBaseline;
+  const Float32 firstLineMinBaselineDistance = stringParas()[0].minBaselineDistance;
+  const Float32 lastLineMinBaselineDistance =
+                  stringParas()[lastLine.paragraphIndex].minBaselineDistance;
+
+  const Float32 scale32 = narrow_cast<Float32>(textScaleFactor);
+
+  info.firstLineHeight = scale32*max(firstLineHeight, firstLineMinBaselineDistance);
+  info.firstLineHeightAboveBaseline =
+    scale32*(firstLine._heightAboveBaseline
+             + max(0.f, (firstLineMinBaselineDistance - firstLineHeight)/2));
+
+  info.lastLineHeight = scale32*max(lastLineHeight, lastLineMinBaselineDistance);
+  info.lastLineHeightBelowBaselineWithoutSpacing =
+    scale32*lastLine._heightBelowBaselineWithoutSpacing;
+  info.lastLineHeightBelowBaselineWithMinimalSpacing =
+    scale32*min(lastLine._heightBelowBaseline,
+                lastLine._heightBelowBaselineWithoutSpacing + minimalSpacingBelowLastLine_);
+  info.lastLineHeightBelowBaseline =
+    scale32*(lastLine._heightBelowBaseline
+             + max(0.f, (lastLineMinBaselineDistance - lastLineHeight)/2));
+
+  STUTextFrameConsistentAlignment consistentAlignment = stuTextFrameConsistentAlignment(
+                                                          paragraphs[0].alignment);
+  for (const TextFrameParagraph& para : paragraphs[{1, $}]) {
+    if (consistentAlignment != stuTextFrameConsistentAlignment(para.alignment)) {
+      consistentAlignment = STUTextFrameConsistentAlignmentNone;
+      break;
+    }
+  }
+
+  const bool isScaled = textScaleFactor < 1;
+
+  bool hasMaxTypographicWidth = consistentAlignment != STUTextFrameConsistentAlignmentNone
+                             && !isTruncated
+                             && !isScaled;
+  if (hasMaxTypographicWidth) {
+    Int32 i = 0;
+    for (const TextFrameParagraph& para : paragraphs) {
+      if (para.lineIndexRange().end == ++i) continue;
+      hasMaxTypographicWidth = false;
+      break;
+    }
+  }
+
+  info.consistentAlignment = consistentAlignment;
+  info.flags = static_cast<STUTextFrameFlags>(
+                 static_cast<STUTextFrameFlags>(flags)
+                 | (isTruncated ? STUTextFrameIsTruncated : 0)
+                 | (isScaled ? STUTextFrameIsScaled : 0)
+                 | (hasMaxTypographicWidth ? STUTextFrameHasMaxTypographicWidth : 0));
+  return info;
+}
+
+bool TextFrameLayouter::tryToReuseLayoutForNarrowerFrameWidth(Float64 frameWidth) {
+  STU_DEBUG_ASSERT(frameWidth <= inverselyScaledFrameSize_.width);
+  // Line breaking is greedy, so if every line of the current layout fits into the narrower width,
+  // the line breaking would stop at the same break opportunities. This doesn't hold if the line
+  // breaking also depends on the ratio between the line width and the available width (as it does
+  // with a hyphenation factor), or if lines were truncated, scaled or justified.
+  if (scaleInfo_.scale != 1 || mayExceedMaxWidth_ || needToJustifyLines_ || textIsClipped()) {
+    return false;
+  }
+  for (const TextFrameParagraph& para : paragraphs()) {
+    if (!para.excisedRangeInOriginalString().isEmpty()) return false;
+    const ShapedString::Paragraph& spara = stringParas()[para.paragraphIndex];
+    if (spara.hyphenationFactor > 0 || isJustified(para)) return false;
+    for (const Int32 lineIndex : para.lineIndexRange().iter()) {
+      const Indentations indent{spara, para, lineIndex, scaleInfo_};
+      if (lines_[lineIndex].width > frameWidth - indent.left - indent.right) return false;
+    }
+  }
+  inverselyScaledFrameSize_.width = frameWidth;
+  realignCenteredAndRightAlignedLines();
+  return true;
+}
+
 } // namespace stu_label
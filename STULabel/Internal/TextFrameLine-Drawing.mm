@@ -11,30 +11,108 @@
 
 namespace stu_label {
 
-static void drawRunGlyphsDirectly(GlyphSpan span, const TextStyle& style, DrawingContext& context) {
-  const GlyphsWithPositions gwp = span.getGlyphsWithPositions();
-  if (gwp.count() == 0) return;
-  const FontRef font = span.run().font();
-  const ColorIndex colorIndex = context.textColorIndex(style);
-  context.setFillColor(colorIndex);
-  const TextStyle::StrokeInfo* const stroke = style.strokeInfo();
-  const CGContextRef cgContext = context.cgContext();
-  if (stroke) {
-    CGContextSetLineWidth(cgContext, stroke->strokeWidth);
-    const ColorIndex strokeColorIndex = stroke->colorIndex ? *stroke->colorIndex : colorIndex;
-    context.setStrokeColor(strokeColorIndex);
-    CGContextSetTextDrawingMode(cgContext, stroke->doNotFill ? kCGTextStroke : kCGTextFillStroke);
+/// Collects the glyphs of consecutive directly drawn glyph spans with the same font, text matrix,
+/// colors, stroke and shadow, so that they can be drawn with a single CTFontDrawGlyphs call.
+/// Runs often only differ in attributes that don't affect the glyph rendering, e.g. link
+/// attributes or custom attribute keys.
+class GlyphDrawBatch {
+public:
+  explicit STU_INLINE
+  GlyphDrawBatch(DrawingContext& context)
+  : context_{context}
+  {}
+
+  GlyphDrawBatch(const GlyphDrawBatch&) = delete;
+  GlyphDrawBatch& operator=(const GlyphDrawBatch&) = delete;
+
+  ~GlyphDrawBatch() {
+    STU_DEBUG_ASSERT(glyphs_.isEmpty());
+  }
+
+  void add(GlyphSpan span, const CGAffineTransform& matrix, const TextStyle& style,
+           const TextStyle::ShadowInfo* __nullable shadow)
+  {
+    const GlyphsWithPositions gwp = span.getGlyphsWithPositions();
+    if (gwp.count() == 0) return;
+    const State state{span.run().font().ctFont(), matrix, style, shadow, context_};
+    if (!glyphs_.isEmpty() && !(state == state_)) {
+      flush();
+    }
+    state_ = state;
+    glyphs_.append(gwp.glyphs());
+    positions_.append(gwp.positions());
   }
-  CTFontDrawGlyphs(font.ctFont(), gwp.glyphs().begin(), gwp.positions().begin(),
-                   sign_cast(gwp.count()), cgContext);
-  if (stroke) {
-    CGContextSetTextDrawingMode(cgContext, kCGTextFill);
+
+  void flush() {
+    if (glyphs_.isEmpty()) return;
+    context_.setShadow(state_.shadow);
+    context_.setFillColor(state_.fillColorIndex);
+    const CGContextRef cgContext = context_.cgContext();
+    if (state_.hasStroke) {
+      CGContextSetLineWidth(cgContext, state_.strokeWidth);
+      context_.setStrokeColor(state_.strokeColorIndex);
+      CGContextSetTextDrawingMode(cgContext, state_.doNotFill ? kCGTextStroke : kCGTextFillStroke);
+    }
+    CGContextSetTextMatrix(cgContext, state_.matrix);
+    CTFontDrawGlyphs(state_.font, glyphs_.begin(), positions_.begin(),
+                     sign_cast(glyphs_.count()), cgContext);
+    context_.incrementGlyphDrawCallCount();
+    if (state_.hasStroke) {
+      CGContextSetTextDrawingMode(cgContext, kCGTextFill);
+    }
+    glyphs_.removeAll();
+    positions_.removeAll();
   }
-}
 
+private:
+  struct State {
+    CTFont* font;
+    CGAffineTransform matrix;
+    const TextStyle::ShadowInfo* shadow;
+    ColorIndex fillColorIndex;
+    ColorIndex strokeColorIndex;
+    Float32 strokeWidth;
+    bool hasStroke;
+    bool doNotFill;
+
+    State() = default;
+
+    STU_INLINE
+    State(CTFont* font, const CGAffineTransform& matrix, const TextStyle& style,
+          const TextStyle::ShadowInfo* __nullable shadow, const DrawingContext& context)
+    : font{font}, matrix{matrix}, shadow{shadow},
+      fillColorIndex{context.textColorIndex(style)}
+    {
+      const TextStyle::StrokeInfo* const stroke = style.strokeInfo();
+      hasStroke = stroke != nullptr;
+      strokeWidth = stroke ? stroke->strokeWidth : 0;
+      strokeColorIndex = stroke && stroke->colorIndex ? *stroke->colorIndex : fillColorIndex;
+      doNotFill = stroke && stroke->doNotFill;
+    }
+
+    STU_INLINE
+    bool operator==(const State& other) const {
+      return font == other.font
+          && CGAffineTransformEqualToTransform(matrix, other.matrix)
+          && shadow == other.shadow
+          && fillColorIndex == other.fillColorIndex
+          && hasStroke == other.hasStroke
+          && (!hasStroke
+              || (   strokeWidth == other.strokeWidth
+                  && strokeColorIndex == other.strokeColorIndex
+                  && doNotFill == other.doNotFill));
+    }
+  };
+
+  DrawingContext& context_;
+  State state_;
+  TempVector<CGGlyph> glyphs_{MaxInitialCapacity{256}};
+  TempVector<CGPoint> positions_{MaxInitialCapacity{256}};
+};
 
 static void drawRunGlyphs(GlyphSpan glyphSpan, const TextStyle& style,
-                          CGFloat ctLineXOffset, DrawingContext& context)
+                          const TextStyle::ShadowInfo* __nullable shadow,
+                          CGFloat ctLineXOffset, GlyphDrawBatch& batch, DrawingContext& context)
 {
   CGAffineTransform matrix = glyphSpan.run().textMatrix();
   matrix.tx = context.lineOrigin().x + ctLineXOffset;
@@ -46,22 +124,27 @@ static void drawRunGlyphs(GlyphSpan glyphSpan, const TextStyle& style,
       matrix.ty += style.baselineOffset();
     }
 #endif
-  CGContextSetTextMatrix(context.cgContext(), matrix);
   if (!context.needToDrawGlyphsDirectly(style)) {
+    batch.flush();
+    context.setShadow(shadow);
+    CGContextSetTextMatrix(context.cgContext(), matrix);
     glyphSpan.draw(context.cgContext());
+    context.incrementGlyphDrawCallCount();
     context.currentCGContextColorsMayHaveChanged();
   } else {
-    drawRunGlyphsDirectly(glyphSpan, style, context);
+    batch.add(glyphSpan, matrix, style, shadow);
   }
 }
 
 
 static void drawGlyphs(const TextFrameLine& line, bool drawShadow, DrawingContext& context) {
+  GlyphDrawBatch batch{context};
   if (context.styleOverride() || (line.textFlags() & TextFlags::hasAttachment)) {
     line.forEachStyledGlyphSpan(context.styleOverride(),
       [&](const StyledGlyphSpan& span, const TextStyle& style, Range<Float64> x) -> ShouldStop
     {
       if (style.flags() & TextFlags::hasAttachment) {
+        batch.flush();
         context.setShadow(drawShadow ? style.shadowInfo() : nullptr);
         // We don't apply any stroke style to the context. (Any objections?)
         drawAttachment(style.attachmentInfo()->attribute, narrow_cast<CGFloat>(x.start),
@@ -69,7 +152,11 @@ static void drawGlyphs(const TextFrameLine& line, bool drawShadow, DrawingContex
         return ShouldStop{context.isCancelled()};
       }
       const auto* const shadow = drawShadow ? style.shadowInfo() : nullptr;
-      context.setShadow(shadow);
+      if (STU_UNLIKELY(span.isPartialLigature)) {
+        // The clipped glyphs must be drawn separately.
+        batch.flush();
+        context.setShadow(shadow);
+      }
       const auto oldColorIndices = context.currentColorIndices();
       if (STU_UNLIKELY(span.isPartialLigature)) {
         if (shadow) {
@@ -92,8 +179,9 @@ static void drawGlyphs(const TextFrameLine& line, bool drawShadow, DrawingContex
         CGContextSaveGState(context.cgContext());
         CGContextClipToRect(context.cgContext(), clipRect);
       }
-      drawRunGlyphs(span.glyphSpan, style, span.ctLineXOffset, context);
+      drawRunGlyphs(span.glyphSpan, style, shadow, span.ctLineXOffset, batch, context);
       if (STU_UNLIKELY(span.isPartialLigature)) {
+        batch.flush();
         CGContextRestoreGState(context.cgContext());
         if (shadow) {
           CGContextEndTransparencyLayer(context.cgContext());
@@ -102,6 +190,7 @@ static void drawGlyphs(const TextFrameLine& line, bool drawShadow, DrawingContex
       }
       return ShouldStop{context.isCancelled()};
     });
+    batch.flush();
     return;
   }
   // When there's no style override, we want to delegate the drawing to CTLineDraw where possible.
@@ -116,6 +205,7 @@ static void drawGlyphs(const TextFrameLine& line, bool drawShadow, DrawingContex
         Optional<GlyphSpan> optGlyphSpan) -> ShouldStop
   {
     if (!optGlyphSpan) {
+      batch.flush();
       context.setShadow(nil);
       const CGContextRef cgContext = context.cgContext();
       CGContextSetTextMatrix(cgContext,
@@ -123,6 +213,7 @@ static void drawGlyphs(const TextFrameLine& line, bool drawShadow, DrawingContex
                                                .tx = context.lineOrigin().x + ctLineXOffset.value,
                                                .ty = context.lineOrigin().y});
       CTLineDraw(&ctLine, cgContext);
+      context.incrementGlyphDrawCallCount();
       context.currentCGContextColorsMayHaveChanged();
       return ShouldStop{context.isCancelled()};
     }
@@ -138,10 +229,11 @@ static void drawGlyphs(const TextFrameLine& line, bool drawShadow, DrawingContex
       } // We don't need to search for a hyphen token's style.
       style = tokenStyle;
     }
-    context.setShadow(drawShadow ? style->shadowInfo() : nil);
-    drawRunGlyphs(glyphSpan, *style, ctLineXOffset.value, context);
+    drawRunGlyphs(glyphSpan, *style, drawShadow ? style->shadowInfo() : nil, ctLineXOffset.value,
+                  batch, context);
     return ShouldStop{context.isCancelled()};
   });
+  batch.flush();
 }
 
 typedef enum : uint8_t {
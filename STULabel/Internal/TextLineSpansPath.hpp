@@ -127,4 +127,34 @@ void addLineSpansPath(CGMutablePath&,
                       const Rect<CGFloat>* __nullable clipRectBeforeTransform = nullptr,
                       const CGAffineTransform* __nullable = nullptr);
 
+/// Returns a path equivalent to the one that `addLineSpansPath` would add to an empty mutable path
+/// when called with the same arguments.
+///
+/// Recently created paths are kept in a small thread-safe global LRU cache that is keyed by the
+/// values of the spans, the referenced vertical positions and the remaining arguments (except the
+/// clip rect), so that repeatedly drawing the same background or highlight doesn't require
+/// rebuilding the path. The returned path must not be mutated.
+///
+/// \param clipRectBeforeTransform
+///   Only used if the path is too large to be cached, in which case the path returned may omit
+///   single-line rects that don't intersect the clip rect (as with `addLineSpansPath`).
+///
+/// \pre The spans must be non-adjacent and sorted left-to-right, top-to-bottom.
+///
+/// Thread-safe.
+RC<CGPath> createLineSpansPathUsingCache(
+             ArrayRef<const TextLineSpan>,
+             ArrayRef<const TextLineVerticalPosition>,
+             ShouldFillTextLineGaps = ShouldFillTextLineGaps{false},
+             ShouldExtendTextLinesToCommonHorizontalBounds =
+               ShouldExtendTextLinesToCommonHorizontalBounds{false},
+             STUEdgeInsets = STUEdgeInsets{}, CornerRadius = CornerRadius{},
+             const Rect<CGFloat>* __nullable clipRectBeforeTransform = nullptr,
+             const CGAffineTransform* __nullable = nullptr);
+
+/// Removes all paths from the global cache used by `createLineSpansPathUsingCache`.
+///
+/// Thread-safe.
+void clearLineSpansPathCache();
+
 } // stu_label
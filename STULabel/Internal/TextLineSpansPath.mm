@@ -4,6 +4,8 @@
 
 #import "TextFrame.hpp"
 
+#import "STULabel/stu_mutex.h"
+
 #include "DefineUIntOnCatalystToWorkAroundGlobalNamespacePollution.h"
 
 namespace stu_label {
@@ -661,4 +663,175 @@ void addLineSpansPath(CGPath& path,
   }
 }
 
+// MARK: - Path cache
+
+namespace {
+
+struct LineSpansPathCacheEntry {
+  UInt64 hashCode;
+  Int keyWordCount;
+  UInt64* key; // malloc
+  CGPath* path; // retained
+};
+
+constexpr Int lineSpansPathCacheCapacity = 16;
+/// We don't cache paths for larger span arrays, so that the memory usage of the cache stays small.
+constexpr Int lineSpansPathCacheMaxSpanCount = 256;
+
+stu_mutex lineSpansPathCacheMutex = STU_MUTEX_INIT;
+Int lineSpansPathCacheCount = 0;
+/// Ordered from the most recently to the least recently used entry.
+LineSpansPathCacheEntry lineSpansPathCacheEntries[lineSpansPathCacheCapacity];
+
+STU_INLINE UInt64 floatBits(Float64 value) { return bit_cast<UInt64>(value); }
+
+} // namespace
+
+/// Serializes all values that affect the path into an array of 64-bit words.
+static TempVector<UInt64> lineSpansPathCacheKey(
+                            ArrayRef<const TextLineSpan> spans,
+                            ArrayRef<const TextLineVerticalPosition> verticalPositions,
+                            ShouldFillTextLineGaps fillTextLineGaps,
+                            ShouldExtendTextLinesToCommonHorizontalBounds extendToCommonBounds,
+                            const STUEdgeInsets& edgeInsets, CornerRadius cornerRadius,
+                            const CGAffineTransform* __nullable transform)
+{
+  // The path only depends on the vertical positions of the lines spanned by the spans. We include
+  // the adjacent lines to be on the safe side.
+  const Int32 firstLineIndex = max(0, narrow_cast<Int32>(spans[0].lineIndex) - 1);
+  const Int32 endLineIndex = min(narrow_cast<Int32>(verticalPositions.count()),
+                                 narrow_cast<Int32>(spans[$ - 1].lineIndex) + 2);
+  const auto vps = verticalPositions[{firstLineIndex, endLineIndex}];
+  TempVector<UInt64> key{Capacity{1 + 1 + 4 + 6 + 1 + 3*spans.count() + 2*vps.count()}};
+  key.append(UInt64{fillTextLineGaps.value}
+             | (UInt64{extendToCommonBounds.value} << 1)
+             | (UInt64{transform != nullptr} << 2)
+             | (static_cast<UInt64>(spans.count()) << 8));
+  key.append(floatBits(cornerRadius.value));
+  key.append(floatBits(edgeInsets.top));
+  key.append(floatBits(edgeInsets.left));
+  key.append(floatBits(edgeInsets.bottom));
+  key.append(floatBits(edgeInsets.right));
+  if (transform) {
+    key.append(floatBits(transform->a));
+    key.append(floatBits(transform->b));
+    key.append(floatBits(transform->c));
+    key.append(floatBits(transform->d));
+    key.append(floatBits(transform->tx));
+    key.append(floatBits(transform->ty));
+  }
+  for (const TextLineSpan& span : spans) {
+    key.append(floatBits(span.x.start));
+    key.append(floatBits(span.x.end));
+    key.append(UInt64{span.lineIndex}
+               | (UInt64{span.isLeftEndOfLine} << 31)
+               | (UInt64{span.isRightEndOfLine} << 32)
+               | (UInt64{span.rangeIndex} << 33));
+  }
+  key.append(static_cast<UInt64>(firstLineIndex));
+  for (const TextLineVerticalPosition& vp : vps) {
+    key.append(floatBits(vp.baseline));
+    key.append(UInt64{bit_cast<UInt32>(vp.ascent)} | (UInt64{bit_cast<UInt32>(vp.descent)} << 32));
+  }
+  return key;
+}
+
+static UInt64 hashLineSpansPathCacheKey(ArrayRef<const UInt64> key) {
+  UInt64 h = 0;
+  for (const UInt64 word : key) {
+    h = hash(h, word).value;
+  }
+  return h;
+}
+
+RC<CGPath> createLineSpansPathUsingCache(
+             ArrayRef<const TextLineSpan> spans,
+             ArrayRef<const TextLineVerticalPosition> verticalPositions,
+             ShouldFillTextLineGaps fillTextLineGaps,
+             ShouldExtendTextLinesToCommonHorizontalBounds extendToCommonBounds,
+             STUEdgeInsets edgeInsets, CornerRadius cornerRadius,
+             const Rect<CGFloat>* __nullable clipRect,
+             const CGAffineTransform* __nullable transform)
+{
+  RC<CGPath> path;
+  if (spans.isEmpty() || spans.count() > lineSpansPathCacheMaxSpanCount) {
+    path = RC<CGPath>{CGPathCreateMutable(), ShouldIncrementRefCount{false}};
+    addLineSpansPath(*const_cast<CGMutablePath*>(path.get()), spans, verticalPositions,
+                     fillTextLineGaps, extendToCommonBounds, edgeInsets, cornerRadius,
+                     clipRect, transform);
+    return path;
+  }
+  const TempVector<UInt64> key = lineSpansPathCacheKey(spans, verticalPositions, fillTextLineGaps,
+                                                       extendToCommonBounds, edgeInsets,
+                                                       cornerRadius, transform);
+  const UInt64 hashCode = hashLineSpansPathCacheKey(key);
+  const auto isMatch = [&](const LineSpansPathCacheEntry& entry) STU_INLINE_LAMBDA {
+    return entry.hashCode == hashCode
+        && entry.keyWordCount == key.count()
+        && memcmp(entry.key, key.begin(), sign_cast(key.count())*sizeof(UInt64)) == 0;
+  };
+
+  stu_mutex_lock(&lineSpansPathCacheMutex);
+  for (Int i = 0; i < lineSpansPathCacheCount; ++i) {
+    if (isMatch(lineSpansPathCacheEntries[i])) {
+      std::rotate(lineSpansPathCacheEntries, lineSpansPathCacheEntries + i,
+                  lineSpansPathCacheEntries + i + 1);
+      path = lineSpansPathCacheEntries[0].path;
+      break;
+    }
+  }
+  stu_mutex_unlock(&lineSpansPathCacheMutex);
+  if (path) return path;
+
+  CGMutablePath* const newPath = CGPathCreateMutable();
+  addLineSpansPath(*newPath, spans, verticalPositions, fillTextLineGaps, extendToCommonBounds,
+                   edgeInsets, cornerRadius, nullptr, transform);
+  path = RC<CGPath>{newPath, ShouldIncrementRefCount{false}};
+
+  UInt64* const keyCopy = Malloc().allocate<UInt64>(key.count());
+  memcpy(keyCopy, key.begin(), sign_cast(key.count())*sizeof(UInt64));
+  LineSpansPathCacheEntry evictedEntry{};
+  stu_mutex_lock(&lineSpansPathCacheMutex);
+  {
+    Int i = 0;
+    for (; i < lineSpansPathCacheCount; ++i) {
+      // Another thread may have inserted the same path in the meantime.
+      if (isMatch(lineSpansPathCacheEntries[i])) break;
+    }
+    if (i == lineSpansPathCacheCount) {
+      if (lineSpansPathCacheCount < lineSpansPathCacheCapacity) {
+        lineSpansPathCacheCount += 1;
+      } else {
+        i -= 1;
+      }
+    }
+    std::rotate(lineSpansPathCacheEntries, lineSpansPathCacheEntries + i,
+                lineSpansPathCacheEntries + i + 1);
+    evictedEntry = lineSpansPathCacheEntries[0];
+    lineSpansPathCacheEntries[0] = {.hashCode = hashCode, .keyWordCount = key.count(),
+                                    .key = keyCopy, .path = newPath};
+    CFRetain(newPath);
+  }
+  stu_mutex_unlock(&lineSpansPathCacheMutex);
+  if (evictedEntry.key) {
+    free(evictedEntry.key);
+    CFRelease(evictedEntry.path);
+  }
+  return path;
+}
+
+void clearLineSpansPathCache() {
+  stu_mutex_lock(&lineSpansPathCacheMutex);
+  const Int count = lineSpansPathCacheCount;
+  LineSpansPathCacheEntry entries[lineSpansPathCacheCapacity];
+  std::copy_n(lineSpansPathCacheEntries, count, entries);
+  std::fill_n(lineSpansPathCacheEntries, count, LineSpansPathCacheEntry{});
+  lineSpansPathCacheCount = 0;
+  stu_mutex_unlock(&lineSpansPathCacheMutex);
+  for (Int i = 0; i < count; ++i) {
+    free(entries[i].key);
+    CFRelease(entries[i].path);
+  }
+}
+
 } // stu_label
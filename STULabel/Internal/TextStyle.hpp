@@ -506,6 +506,22 @@ void TextStyle::writeTerminatorWithStringIndex(Int32 stringIndex, const Byte* pr
   }
 }
 
+/// Sets the object pointers in the link, background and attachment infos of the text style
+/// sequence at the start of `data` to the corresponding attribute values in `string`, or to null
+/// if `string` is null. This is used when copying text style data to or from a serialized
+/// representation.
+///
+/// Returns the terminator style of the sequence, or null if `data` doesn't start with a
+/// well-formed text style sequence for the string indices in `stringRange` or if a required
+/// attribute value is missing.
+const TextStyle* __nullable
+  resetTextStyleObjectPointers(ArrayRef<Byte> data, Range<Int32> stringRange,
+                               NSAttributedString* __unsafe_unretained __nullable string);
+
+/// Indicates whether all color indices of the style are fixed color indices or indices into a
+/// color array with the specified count.
+bool hasValidColorIndices(const TextStyle& style, Int colorCount);
+
 
 struct TextFrame;
 class TextFrameDrawingOptions;
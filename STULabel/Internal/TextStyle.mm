@@ -75,6 +75,82 @@ const TextStyle& TextStyle::styleForStringIndex(Int32 stringIndex) const {
   return *style;
 }
 
+const TextStyle* __nullable
+  resetTextStyleObjectPointers(const ArrayRef<Byte> data, const Range<Int32> stringRange,
+                               NSAttributedString* __unsafe_unretained __nullable const string)
+{
+  STU_DEBUG_ASSERT(!string || stringRange.end <= sign_cast(string.length));
+  const auto getAttribute = [&](NSAttributedStringKey key, Int32 index) -> id {
+    return [string attribute:key atIndex:sign_cast(index) effectiveRange:nil];
+  };
+  Int32 minIndex = stringRange.start;
+  const Byte* p = data.begin();
+  const Byte* previous = nullptr;
+  for (;;) {
+    if (data.end() - p < Int{sizeof(TextStyle)}) return nullptr;
+    const TextStyle* const style = reinterpret_cast<const TextStyle*>(p);
+    if (style->isBig() && data.end() - p < Int{sizeof(TextStyle::Big)}) return nullptr;
+    if (previous && reinterpret_cast<const Byte*>(&style->previous()) != previous) return nullptr;
+    const Int32 index = style->stringIndex();
+    const TextStyle& next = style->next();
+    if (&next == style) {
+      return index == stringRange.end ? style : nullptr;
+    }
+    if (!(minIndex <= index && index < stringRange.end)) return nullptr;
+    // The style infos must lie between this style and the next one.
+    const Int ownSize = infoOffset(static_cast<UInt16>(style->bits & 0xff))
+                      + (style->hasBaselineOffset() ? Int{sizeof(TextStyle::BaselineOffsetInfo)}
+                                                    : 0);
+    if (style->isOverrideStyle() || reinterpret_cast<const Byte*>(&next) - p < ownSize) {
+      return nullptr;
+    }
+    if (const TextStyle::LinkInfo* const info = style->linkInfo()) {
+      const id attribute = string ? getAttribute(NSLinkAttributeName, index) : nil;
+      if (string && !attribute) return nullptr;
+      const_cast<TextStyle::LinkInfo*>(info)->attribute = attribute;
+    }
+    if (const TextStyle::BackgroundInfo* const info = style->backgroundInfo()) {
+      STUBackgroundAttribute* const attribute = string
+                                              ? getAttribute(STUBackgroundAttributeName, index)
+                                              : nil;
+      if (attribute && ![attribute isKindOfClass:STUBackgroundAttribute.class]) return nullptr;
+      const_cast<TextStyle::BackgroundInfo*>(info)->stuAttribute = attribute;
+    }
+    if (const TextStyle::AttachmentInfo* const info = style->attachmentInfo()) {
+      STUTextAttachment* const attribute = string
+                                         ? getAttribute(STUAttachmentAttributeName, index)
+                                         : nil;
+      if (string && ![attribute isKindOfClass:STUTextAttachment.class]) return nullptr;
+      const_cast<TextStyle::AttachmentInfo*>(info)->attribute = attribute;
+    }
+    minIndex = index + 1;
+    previous = p;
+    p = reinterpret_cast<const Byte*>(&next);
+  }
+}
+
+bool hasValidColorIndices(const TextStyle& style, Int colorCount) {
+  const Int end = ColorIndex::fixedColorIndexRange.end + colorCount;
+  const auto isValid = [&](Optional<ColorIndex> index) { return !index || (*index).value < end; };
+  if (!isValid(style.colorIndex())) return false;
+  if (const TextStyle::BackgroundInfo* const info = style.backgroundInfo()) {
+    if (!isValid(info->colorIndex) || !isValid(info->borderColorIndex)) return false;
+  }
+  if (const TextStyle::ShadowInfo* const info = style.shadowInfo()) {
+    if (!isValid(info->colorIndex)) return false;
+  }
+  if (const TextStyle::UnderlineInfo* const info = style.underlineInfo()) {
+    if (!isValid(info->colorIndex)) return false;
+  }
+  if (const TextStyle::StrikethroughInfo* const info = style.strikethroughInfo()) {
+    if (!isValid(info->colorIndex)) return false;
+  }
+  if (const TextStyle::StrokeInfo* const info = style.strokeInfo()) {
+    if (!isValid(info->colorIndex)) return false;
+  }
+  return true;
+}
+
 void TextStyleOverride::applyTo(const TextStyle& style) {
   const TextFlags styleFlags = style.flags();
   const TextFlags preservedFlags = styleFlags & this->flagsMask;
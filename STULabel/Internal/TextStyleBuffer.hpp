@@ -103,6 +103,24 @@ public:
   static constexpr Int maxFontCount = 43690;
 
 private:
+  /// A memoized encoding of an attribute dictionary without an attachment.
+  struct AttributesMemoEntry {
+    /// Retained, so that the pointer can't be reused for a different dictionary.
+    NSDictionary<NSAttributedStringKey, id>* __nullable attributes;
+    ParagraphAttributes paraAttributes;
+    TextFlags flags;
+    FontIndex fontIndex;
+    ColorIndex textColorIndex;
+    UInt8 infoSize;
+    /// The style info data following the TextStyle or TextStyle::Big header.
+    Byte infoData[TextStyle::maxSize - TextStyle::bigSize];
+  };
+
+  static constexpr Int attributesMemoCapacity = 8;
+
+  const AttributesMemoEntry* __nullable
+    memoizedAttributes(NSDictionary<NSAttributedStringKey, id>* __nonnull attributes) const;
+
   FontIndex addFont(FontRef);
   ColorIndex addColor(STUColor*);
   TextFlags colorFlags(ColorIndex) const;
@@ -123,6 +141,10 @@ private:
   Pair<ArrayRef<const ColorRef>, ArrayRef<const ColorHashBucket>> oldColors_;
 
   LocalFontInfoCache& localFontInfoCache_;
+
+  UInt8 attributesMemoCount_{};
+  UInt8 nextAttributesMemoIndex_{};
+  AttributesMemoEntry attributesMemo_[attributesMemoCapacity];
 };
 
 } // namespace stu_label
@@ -435,6 +435,27 @@ TextFlags TextStyleBuffer::colorFlags(ColorIndex colorIndex) const {
        : colors()[colorIndex.value - ColorIndex::fixedColorIndexRange.end].textFlags();
 }
 
+auto TextStyleBuffer::memoizedAttributes(
+       NSDictionary<NSAttributedStringKey, id>* __unsafe_unretained __nonnull attributes) const
+  -> const AttributesMemoEntry* __nullable
+{
+  const Int memoCount = attributesMemoCount_;
+  for (Int i = 0; i < memoCount; ++i) {
+    if (attributesMemo_[i].attributes == attributes) return &attributesMemo_[i];
+  }
+  // Attributed strings that were assembled from separately created pieces often contain equal
+  // dictionaries that aren't identical.
+  const CFDictionaryRef cfAttributes = (__bridge CFDictionaryRef)attributes;
+  const CFIndex attributeCount = CFDictionaryGetCount(cfAttributes);
+  for (Int i = 0; i < memoCount; ++i) {
+    const CFDictionaryRef other = (__bridge CFDictionaryRef)attributesMemo_[i].attributes;
+    if (CFDictionaryGetCount(other) == attributeCount && CFEqual(other, cfAttributes)) {
+      return &attributesMemo_[i];
+    }
+  }
+  return nullptr;
+}
+
 TextFlags TextStyleBuffer::encodeStringRangeStyle(
             Range<Int> range,
             NSDictionary<NSAttributedStringKey, id>* __unsafe_unretained __nullable attributes,
@@ -445,21 +466,30 @@ TextFlags TextStyleBuffer::encodeStringRangeStyle(
 
   ensureConstantsAreInitialized();
 
+  // NSAttributedString instances frequently share a single attributes dictionary between many
+  // runs, so we memoize the encoded style data for the most recently scanned dictionaries.
+  const AttributesMemoEntry* const memo = attributes ? memoizedAttributes(attributes) : nullptr;
+
   using Context = AttributeScanContext;
 
   Context context;
-  // Only zero-initialize fields that may be accessed without checking the corresponding flag.
-  context.flags = Context::Flags{};
-  context.paraAttributes = static_cast<ParagraphAttributes*>(outParaAttributes);
-  context.background = nil;
-  context.link = nil;
-  context.textAttachment = nil;
+  ParagraphAttributes paraAttributes{};
+  if (!memo) {
+    // Only zero-initialize fields that may be accessed without checking the corresponding flag.
+    context.flags = Context::Flags{};
+    context.paraAttributes = &paraAttributes;
+    context.background = nil;
+    context.link = nil;
+    context.textAttachment = nil;
+
+    context.scan(attributes);
+  } else {
+    paraAttributes = memo->paraAttributes;
+  }
   if (outParaAttributes) {
-    *outParaAttributes = ParagraphAttributes{};
+    *outParaAttributes = paraAttributes;
   }
 
-  context.scan(attributes);
-
   if (STU_UNLIKELY(data_.capacity() == 0)) {
     fonts_.setCapacity(8);
     colors_.setCapacity(8);
@@ -472,13 +502,23 @@ TextFlags TextStyleBuffer::encodeStringRangeStyle(
   lastStyle_ = reinterpret_cast<const TextStyle*>(reinterpret_cast<const Byte*>(next)
                                                   - lastStyleSize_);
 
-  STUFont* __unsafe_unretained font = STU_LIKELY(context.flags & Context::hasFont)
-                                   ? context.font : (__bridge STUFont*)defaultCoreTextFont();
-  const FontIndex fontIndex = addFont(font);
-  const ColorIndex textColorIndex = !(context.flags & Context::hasForegroundColor)
-                                  ? ColorIndex::black
-                                  : addColor(context.foregroundColor);
-  TextFlags flags = colorFlags(textColorIndex);
+  STUFont* __unsafe_unretained font = nil;
+  FontIndex fontIndex;
+  ColorIndex textColorIndex;
+  TextFlags flags;
+  if (!memo) {
+    font = STU_LIKELY(context.flags & Context::hasFont)
+         ? context.font : (__bridge STUFont*)defaultCoreTextFont();
+    fontIndex = addFont(font);
+    textColorIndex = !(context.flags & Context::hasForegroundColor)
+                   ? ColorIndex::black
+                   : addColor(context.foregroundColor);
+    flags = colorFlags(textColorIndex);
+  } else {
+    fontIndex = memo->fontIndex;
+    textColorIndex = memo->textColorIndex;
+    flags = memo->flags;
+  }
                    // We use range.end here, so that the string index later can be safely
                    // adjusted upwards within the original range.
   const bool isBig = range.end > TextStyle::maxSmallStringIndex
@@ -494,7 +534,10 @@ TextFlags TextStyleBuffer::encodeStringRangeStyle(
     next = bigStyle + 1;
   }
   const Int firstInfoOffset = reinterpret_cast<Byte*>(next) - reinterpret_cast<Byte*>(style);
-  if (context.flags & ~(Context::hasFont | Context::hasForegroundColor)) {
+  if (memo) {
+    memcpy(next, memo->infoData, memo->infoSize);
+    next = reinterpret_cast<Byte*>(next) + memo->infoSize;
+  } else if (context.flags & ~(Context::hasFont | Context::hasForegroundColor)) {
 
     if (context.flags & Context::hasLink) {
       flags |= TextFlags::hasLink;
@@ -666,6 +709,23 @@ TextFlags TextStyleBuffer::encodeStringRangeStyle(
   }
   const Int size = reinterpret_cast<Byte*>(next) - reinterpret_cast<Byte*>(style);
   STU_ASSERT(size <= TextStyle::maxSize);
+  // The encoding of attachments has side effects, so we don't memoize it.
+  if (!memo && attributes
+      && !(context.flags & (Context::hasTextAttachment | Context::hasNSTextAttachment)))
+  {
+    AttributesMemoEntry& entry = attributesMemo_[nextAttributesMemoIndex_];
+    nextAttributesMemoIndex_ = (nextAttributesMemoIndex_ + 1)%attributesMemoCapacity;
+    if (attributesMemoCount_ < attributesMemoCapacity) {
+      ++attributesMemoCount_;
+    }
+    entry.attributes = attributes;
+    entry.paraAttributes = paraAttributes;
+    entry.flags = flags;
+    entry.fontIndex = fontIndex;
+    entry.textColorIndex = textColorIndex;
+    entry.infoSize = narrow_cast<UInt8>(size - firstInfoOffset);
+    memcpy(entry.infoData, reinterpret_cast<Byte*>(style) + firstInfoOffset, entry.infoSize);
+  }
   if (size == lastStyleSize_
       && flags == lastStyle_->flags()
       && fontIndex == lastStyle_->fontIndex()
@@ -61,6 +61,40 @@ public:
   ThreadLocalArenaAllocator& operator=(ThreadLocalArenaAllocator&&) = delete;
 };
 
+/// Installs a `ThreadLocalArenaAllocator` using the specified initial buffer for the lifetime of
+/// this object, unless the current thread already has an allocator installed, in which case the
+/// existing allocator is used instead. This allows long-running worker tasks (like the ones
+/// started by `LabelPrerenderer::renderBatch`) to reuse a single arena for all the work items they
+/// process.
+class ThreadLocalArenaAllocatorScope {
+public:
+  template <auto size>
+  explicit STU_INLINE
+  ThreadLocalArenaAllocatorScope(Ref<ThreadLocalArenaAllocator::InitialBuffer<size>> buffer)
+  : ownsAllocator_{ThreadLocalArenaAllocator::instance() == nullptr}
+  {
+    if (STU_LIKELY(ownsAllocator_)) {
+      new (&allocator_) ThreadLocalArenaAllocator{buffer};
+    }
+  }
+
+  STU_INLINE
+  ~ThreadLocalArenaAllocatorScope() {
+    if (STU_LIKELY(ownsAllocator_)) {
+      allocator_.~ThreadLocalArenaAllocator();
+    }
+  }
+
+  ThreadLocalArenaAllocatorScope(const ThreadLocalArenaAllocatorScope&) = delete;
+  ThreadLocalArenaAllocatorScope& operator=(const ThreadLocalArenaAllocatorScope&) = delete;
+
+private:
+  const bool ownsAllocator_;
+  union {
+    ThreadLocalArenaAllocator allocator_;
+  };
+};
+
 class ThreadLocalAllocatorRef {
 public:
   STU_INLINE
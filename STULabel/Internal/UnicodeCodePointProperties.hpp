@@ -96,7 +96,24 @@ struct CodePointProperties {
   }
 
 private:
-  static UInt8 lookupCodePointGreaterThanD7FF(Char32 codePoint) noexcept
+  /// Only the table lookup for code points up to U+1FFFF is inlined. Code points above U+1FFFF
+  /// (CJK Extension B and later, tags, variation selectors supplement, private use planes)
+  /// still go through the out-of-line `lookupCodePointGreaterThan1FFFF` call.
+  STU_INLINE
+  static UInt8 lookupCodePointGreaterThanD7FF(Char32 cp) noexcept {
+    if (STU_LIKELY(cp <= 0x1FFFF)) {
+      cp -= 0xD800;
+      const UInt i0 = cp >> 7;
+      const UInt i1 = ((cp >> 3) & 15)
+                    + (static_cast<UInt>(indices1[i0]) << 4);
+      const UInt i2 = (cp & 7)
+                    + (static_cast<UInt>(indices2[i1]) << 3);
+      return data2[i2];
+    }
+    return lookupCodePointGreaterThan1FFFF(cp);
+  }
+
+  static UInt8 lookupCodePointGreaterThan1FFFF(Char32 codePoint) noexcept
                  __attribute__((const));
 
   static const UInt8 indices[3456];
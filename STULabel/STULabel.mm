@@ -8,6 +8,7 @@
 #import "UIFont+STUDynamicTypeFontScaling.h"
 
 #import "STULabelLayoutInfo-Internal.hpp"
+#import "STUTextFrameAccessibilityElement-Internal.hpp"
 
 #import "Internal/LabelParameters.hpp"
 #import "Internal/LabelRendering.hpp"
@@ -890,19 +891,16 @@ static STULabelBaselinesLayoutGuide* baselinesLayoutGuide(STULabel* __unsafe_unr
 - (STUTextFrameAccessibilityElement*)accessibilityElement {
   if (!_textFrameAccessibilityElement) {
     STUTextFrame* const textFrame = _layer.textFrame;
-    bool separateParagraphs = true;
-    if (_accessibilityElementParagraphSeparationCharacterThreshold > 1) {
-      if (_accessibilityElementParagraphSeparationCharacterThreshold >= maxValue<Int32>) {
-        separateParagraphs = false;
-      } else {
-        NSString* const string = _bits.accessibilityElementRepresentsUntruncatedText
-                               ? textFrame.originalAttributedString.string
-                               : textFrame.truncatedAttributedString.string;
-        const Int n = NSStringRef{string}.countGraphemeClusters();
-        separateParagraphs = sign_cast(n)
-                             > _accessibilityElementParagraphSeparationCharacterThreshold;
-      }
-    }
+    const TextFrameAccessibilityDataOptions options = {
+      .paragraphSeparationCharacterThreshold =
+         _accessibilityElementParagraphSeparationCharacterThreshold,
+      .representUntruncatedText = _bits.accessibilityElementRepresentsUntruncatedText,
+      .separateLinkElements = _bits.accessibilityElementSeparatesLinkElements
+    };
+    // Once the accessibility element has been requested, it will likely be requested again after
+    // the next layout change, so we let the layer precompute the data in the background after
+    // each rendering.
+    STULabelLayerSetAccessibilityDataOptions(_layer, options);
     STUTextLinkArray* const links = _layer.links;
     const id<STULabelDelegate> delegate = _delegate;
     const bool delegateRespondsToLinkCanBeDragged = _bits.delegateRespondsToLinkCanBeDragged;
@@ -914,9 +912,8 @@ static STULabelBaselinesLayoutGuide* baselinesLayoutGuide(STULabel* __unsafe_unr
                               textFrame:textFrame
                  originInContainerSpace:_layer.textFrameOrigin
                            displayScale:_layer.contentsScale
-               representUntruncatedText:_bits.accessibilityElementRepresentsUntruncatedText
-                     separateParagraphs:separateParagraphs
-                   separateLinkElements:_bits.accessibilityElementSeparatesLinkElements
+                                options:options
+                        precomputedData:STULabelLayerGetAccessibilityData(_layer)
                         isDraggableLink:^bool(STUTextRange range __unused, id linkValue,
                                               CGPoint point)
                         {
@@ -1693,8 +1690,8 @@ void setDragSessionCurrentlyLiftedLink(id<UIDragSession> session, STUTextLink* _
         {
           title = [originalAttributedString attributedSubstringFromRange:rangeInOriginalString];
         } else {
-          title = [textFrame.truncatedAttributedString
-                     attributedSubstringFromRange:link.rangeInTruncatedString];
+          title = textFrameRef(textFrame).truncatedAttributedSubstring(
+                    clampToInt32IndexRange(link.rangeInTruncatedString));
         }
         title = [title stu_attributedStringByReplacingSTUAttachmentsWithStringRepresentations];
         return [UIDragPreview previewForURL:(url ?: [NSURL URLWithString:@""])
@@ -1848,13 +1845,17 @@ void setDragSessionCurrentlyLiftedLink(id<UIDragSession> session, STUTextLink* _
       bg = attributes[NSBackgroundColorAttributeName];
     }
     if (bg) {
-      NSRange attributeRange;
-      [textFrame.truncatedAttributedString attribute:(isBackground ? STUBackgroundAttributeName
-                                                                   : NSBackgroundColorAttributeName)
-                                             atIndex:rangeInTruncatedString.location
-                               longestEffectiveRange:&attributeRange
-                                             inRange:rangeInTruncatedString];
-      if (attributeRange.length >= rangeInTruncatedString.length) {
+      const NSAttributedStringKey key = isBackground ? STUBackgroundAttributeName
+                                                     : NSBackgroundColorAttributeName;
+      bool isUniform = true;
+      // Iterating over the attribute runs avoids the creation of the full truncated string.
+      textFrameRef(textFrame).forEachTruncatedStringAttributeRun(
+        clampToInt32IndexRange(rangeInTruncatedString),
+        [&](const TruncatedStringRun& run) -> ShouldStop {
+          isUniform = equal(run.attributes[key], bg);
+          return ShouldStop{!isUniform};
+        });
+      if (isUniform) {
         backgroundColor = isBackground ? static_cast<STUBackgroundAttribute*>(bg).color
                         : static_cast<UIColor*>(bg);
       }
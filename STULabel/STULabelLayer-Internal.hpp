@@ -35,3 +35,33 @@ NSInteger STULabelLayerGetMaximumNumberOfLines(const STULabelLayer* __nonnull);
 
 const stu_label::LabelTextFrameInfo& STULabelLayerGetCurrentTextFrameInfo(STULabelLayer* __nonnull);
 
+struct STULabelLayerSizeThatFitsCacheStatistics {
+  /// The number of `sizeThatFits` calls answered from a cached text frame layout.
+  size_t hitCount;
+  /// The number of `sizeThatFits` calls that required a new text frame layout.
+  size_t missCount;
+};
+
+STULabelLayerSizeThatFitsCacheStatistics
+  STULabelLayerGetSizeThatFitsCacheStatistics(const STULabelLayer* __nonnull);
+
+#if TARGET_OS_IPHONE
+
+@class STUTextFrameAccessibilityData;
+namespace stu_label { struct TextFrameAccessibilityDataOptions; }
+
+/// Makes subsequent render tasks precompute the accessibility data with the specified options
+/// on the render queue.
+void STULabelLayerSetAccessibilityDataOptions(
+       STULabelLayer* __nonnull, const stu_label::TextFrameAccessibilityDataOptions&);
+
+/// Returns the accessibility data precomputed for the current text frame, if available.
+STUTextFrameAccessibilityData* __nullable
+  STULabelLayerGetAccessibilityData(const STULabelLayer* __nonnull);
+
+/// Sets a block that is called on the main thread whenever accessibility data computed in the
+/// background has been assigned to the layer.
+void STULabelLayerSetAccessibilityDataCompletionHandler(STULabelLayer* __nonnull,
+                                                        void (^ __nullable)(void));
+
+#endif
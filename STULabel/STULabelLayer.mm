@@ -10,6 +10,7 @@
 #import "STULabelPrerenderer-Internal.hpp"
 #import "STUTextFrameOptions-Internal.hpp"
 #import "STUTextFrame-Internal.hpp"
+#import "STUTextFrameAccessibilityElement-Internal.hpp"
 #import "STUTextLink-Internal.hpp"
 
 #import "Internal/CoreAnimationUtils.hpp"
@@ -131,7 +132,21 @@ class LabelLayer : public LabelPropertiesCRTPBase<LabelLayer> {
 
   LabelTextFrameInfo textFrameInfo_;
   CGPoint textFrameOrigin_;
-  LabelTextFrameInfo measuringTextFrameInfo_;
+
+  /// A text frame created by `sizeThatFits` for a size other than the current one.
+  /// The text frame may have been released while the info is still valid.
+  struct MeasuringTextFrame {
+    STUTextFrame* textFrame;
+    LabelTextFrameInfo info;
+    UInt lastUse;
+  };
+  /// Auto Layout and self-sizing cells typically probe a few different sizes per layout pass,
+  /// so we cache more than one measuring text frame (using an LRU replacement policy).
+  static constexpr Int measuringTextFrameCount = 4;
+  MeasuringTextFrame measuringTextFrames_[measuringTextFrameCount];
+  UInt measuringTextFrameUseCounter_{};
+  UInt sizeThatFitsCacheHitCount_{};
+  UInt sizeThatFitsCacheMissCount_{};
 
   /// The bounds of the drawn content within the text frame.
   CGRect contentBoundsInTextFrame_;
@@ -151,7 +166,6 @@ class LabelLayer : public LabelPropertiesCRTPBase<LabelLayer> {
   STUShapedString* shapedString_;
 
   STUTextFrame* textFrame_;
-  STUTextFrame* measuringTextFrame_;
   CALayer* contentLayer_;
 
   LabelRenderTask* task_;
@@ -159,6 +173,16 @@ class LabelLayer : public LabelPropertiesCRTPBase<LabelLayer> {
 
   STUTextLinkArrayWithTextFrameOrigin* links_;
 
+#if TARGET_OS_IPHONE
+  /// Is only set after the first call of `setAccessibilityDataOptions`.
+  Optional<TextFrameAccessibilityDataOptions> accessibilityDataOptions_;
+  /// Computed in the background for textFrame_ after a render task has finished, if
+  /// accessibilityDataOptions_ is set.
+  STUTextFrameAccessibilityData* accessibilityData_;
+  /// Is called after data computed in the background has been assigned to accessibilityData_.
+  void (^ __nullable accessibilityDataCompletionHandler_)(void);
+#endif
+
   PurgeableImage image_;
 
   friend const CGSize& ::STULabelLayerGetSize(const STULabelLayer*);
@@ -707,41 +731,45 @@ public:
     const LabelTextFrameInfo* info;
     if (textFrameInfo_.isValidForSize(innerSize, params_.displayScale())) {
       info = &textFrameInfo_;
+      ++sizeThatFitsCacheHitCount_;
+    } else if (MeasuringTextFrame* const entry = measuringTextFrameValidForSize(innerSize)) {
+      entry->lastUse = ++measuringTextFrameUseCounter_;
+      info = &entry->info;
+      ++sizeThatFitsCacheHitCount_;
     } else {
-      info = &measuringTextFrameInfo_;
-      if (!measuringTextFrameInfo_.isValidForSize(innerSize, params_.displayScale())) {
-        if (measuringTextFrameInfo_.isValid && !textFrameInfoIsValidForCurrentSize_) {
-          textFrame_ = measuringTextFrame_;
-          textFrameInfo_ = measuringTextFrameInfo_;
-        } else {
-          isInvalidated_ = false;
-        }
-        if (stringIsEmpty_) {
-          measuringTextFrame_ = nil;
-          measuringTextFrameInfo_ = LabelTextFrameInfo::empty;
-        } else {
-          if (!shapedString_) {
-            updateAttributedStringIfNecessary();
-            shapedString_ = STUShapedStringCreate(nil, attributedString_,
-                                                  params_.defaultBaseWritingDirection, nullptr);
-          }
-          measuringTextFrame_ = STUTextFrameCreateWithShapedString(nil, shapedString_, innerSize,
-                                                                   params_.displayScale(),
-                                                                   textFrameOptions_);
-          measuringTextFrameInfo_ = labelTextFrameInfo(textFrameRef(measuringTextFrame_),
-                                                       params_.verticalAlignment,
-                                                       params_.displayScale());
-        }
-        if (!textFrameInfoIsValidForCurrentSize_
-            && measuringTextFrameInfo_.isValidForSize(params_.maxTextFrameSize(),
-                                                      params_.displayScale()))
-        {
-          std::swap(textFrame_, measuringTextFrame_);
-          std::swap(textFrameInfo_, measuringTextFrameInfo_);
-          textFrameInfoIsValidForCurrentSize_ = true;
-          updateTextFrameOrigin();
-          info = &textFrameInfo_;
+      ++sizeThatFitsCacheMissCount_;
+      MeasuringTextFrame& entry = leastRecentlyUsedMeasuringTextFrame();
+      entry.lastUse = ++measuringTextFrameUseCounter_;
+      info = &entry.info;
+      if (entry.info.isValid && !textFrameInfoIsValidForCurrentSize_) {
+        textFrame_ = entry.textFrame;
+        textFrameInfo_ = entry.info;
+      } else {
+        isInvalidated_ = false;
+      }
+      if (stringIsEmpty_) {
+        entry.textFrame = nil;
+        entry.info = LabelTextFrameInfo::empty;
+      } else {
+        if (!shapedString_) {
+          updateAttributedStringIfNecessary();
+          shapedString_ = STUShapedStringCreate(nil, attributedString_,
+                                                params_.defaultBaseWritingDirection, nullptr);
         }
+        entry.textFrame = STUTextFrameCreateWithShapedString(nil, shapedString_, innerSize,
+                                                             params_.displayScale(),
+                                                             textFrameOptions_);
+        entry.info = labelTextFrameInfo(textFrameRef(entry.textFrame),
+                                        params_.verticalAlignment, params_.displayScale());
+      }
+      if (!textFrameInfoIsValidForCurrentSize_
+          && entry.info.isValidForSize(params_.maxTextFrameSize(), params_.displayScale()))
+      {
+        std::swap(textFrame_, entry.textFrame);
+        std::swap(textFrameInfo_, entry.info);
+        textFrameInfoIsValidForCurrentSize_ = true;
+        updateTextFrameOrigin();
+        info = &textFrameInfo_;
       }
     }
     // We assume that the screen scale stays constants until the next call to `setContentScale`
@@ -764,6 +792,45 @@ public:
     return info->sizeThatFits(contentInsets_, sizeThatFitsDisplayScale_);
   }
 
+  STULabelLayerSizeThatFitsCacheStatistics sizeThatFitsCacheStatistics() const {
+    return {.hitCount = sizeThatFitsCacheHitCount_, .missCount = sizeThatFitsCacheMissCount_};
+  }
+
+private:
+  MeasuringTextFrame* measuringTextFrameValidForSize(CGSize innerSize) {
+    for (MeasuringTextFrame& entry : measuringTextFrames_) {
+      if (entry.info.isValidForSize(innerSize, params_.displayScale())) {
+        return &entry;
+      }
+    }
+    return nullptr;
+  }
+
+  MeasuringTextFrame& leastRecentlyUsedMeasuringTextFrame() {
+    MeasuringTextFrame* result = &measuringTextFrames_[0];
+    for (MeasuringTextFrame& entry : measuringTextFrames_) {
+      if (!entry.info.isValid) return entry;
+      if (entry.lastUse < result->lastUse) {
+        result = &entry;
+      }
+    }
+    return *result;
+  }
+
+  void releaseMeasuringTextFrames() {
+    for (MeasuringTextFrame& entry : measuringTextFrames_) {
+      entry.textFrame = nil;
+    }
+  }
+
+  void invalidateMeasuringTextFrames() {
+    for (MeasuringTextFrame& entry : measuringTextFrames_) {
+      entry.textFrame = nil;
+      entry.info.isValid = false;
+    }
+  }
+
+public:
   Unretained<STUTextFrame* __nonnull> textFrame() {
     if (stringIsEmpty_) {
       return emptySTUTextFrame().unretained;
@@ -864,6 +931,51 @@ public:
     return links_;
   }
 
+#if TARGET_OS_IPHONE
+  void setAccessibilityDataOptions(const TextFrameAccessibilityDataOptions& options) {
+    if (accessibilityDataOptions_ && *accessibilityDataOptions_ == options) return;
+    accessibilityDataOptions_ = options;
+    accessibilityData_ = nil;
+  }
+
+  Unretained<STUTextFrameAccessibilityData* __nullable> accessibilityData() const {
+    return accessibilityData_;
+  }
+
+  void setAccessibilityDataCompletionHandler(void (^ __nullable completionHandler)(void)) {
+    accessibilityDataCompletionHandler_ = completionHandler;
+  }
+
+  /// Computes the accessibility data for the current text frame on a background queue, so that
+  /// neither the display of the rendered image nor the main thread has to wait for it.
+  void createAccessibilityDataAsyncIfNecessary() {
+    if (!accessibilityDataOptions_ || !textFrame_ || accessibilityData_) return;
+    STUTextFrame* const textFrame = textFrame_;
+    const CGFloat displayScale = params_.displayScale();
+    const TextFrameAccessibilityDataOptions options = *accessibilityDataOptions_;
+    STULabelLayer* __weak const weakSelf = self;
+    // The C++ object is a member of the layer, so it lives exactly as long as the layer.
+    LabelLayer* const impl = this;
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+      STUTextFrameAccessibilityData* const data =
+        STUTextFrameAccessibilityDataCreate(textFrame, displayScale, options);
+      dispatch_async(dispatch_get_main_queue(), ^{
+        STULabelLayer* const layer = weakSelf;
+        if (!layer) return;
+        if (impl->textFrame_ == textFrame && !impl->accessibilityData_
+            && impl->params_.displayScale() == displayScale
+            && impl->accessibilityDataOptions_ && *impl->accessibilityDataOptions_ == options)
+        {
+          impl->accessibilityData_ = data;
+          if (const auto completionHandler = impl->accessibilityDataCompletionHandler_) {
+            completionHandler();
+          }
+        }
+      });
+    });
+  }
+#endif
+
   /// MARK: - Properties not affecting layout
 
   void setOpaque(bool opaque) {
@@ -945,6 +1057,9 @@ public:
     params_.releasesTextFrameAfterRenderingWasExplicitlySet = true;
     if (releasesTextFrameAfterRendering && textFrame_ && !isInvalidated_ && hasContent_) {
       textFrame_ = nil;
+    #if TARGET_OS_IPHONE
+      accessibilityData_ = nil;
+    #endif
     }
   }
 
@@ -1184,7 +1299,10 @@ public:
                      TextFrameScaleAndDisplayScale{textFrame, params_.displayScale()});
         }
         textFrame_ = nil;
-        measuringTextFrame_ = nil;
+      #if TARGET_OS_IPHONE
+        accessibilityData_ = nil;
+      #endif
+        releaseMeasuringTextFrames();
       }
       if (params_.releasesShapedStringAfterRendering) {
         shapedString_ = nil;
@@ -1541,11 +1659,13 @@ private:
     removeTask();
     if (!preserveTextFrames) {
       links_ = nil;
+    #if TARGET_OS_IPHONE
+      accessibilityData_ = nil;
+    #endif
       textFrame_ = nil;
       textFrameInfo_.isValid = false;
       textFrameInfoIsValidForCurrentSize_ = false;
-      measuringTextFrame_ = nil;
-      measuringTextFrameInfo_.isValid = false;
+      invalidateMeasuringTextFrames();
       isInvalidated_ = true;
     }
     prefersSynchronousDrawingForNextDisplay_ = displaysAsynchronously_ && inUIViewAnimation();
@@ -1609,13 +1729,16 @@ private:
       }
       return;
     }
-    if (measuringTextFrameInfo_.isValidForSize(innerSize, params_.displayScale())) {
-      std::swap(textFrame_, measuringTextFrame_);
-      std::swap(textFrameInfo_, measuringTextFrameInfo_);
+    if (MeasuringTextFrame* const entry = measuringTextFrameValidForSize(innerSize)) {
+      std::swap(textFrame_, entry->textFrame);
+      std::swap(textFrameInfo_, entry->info);
       textFrameInfoIsValidForCurrentSize_ = true;
       updateTextFrameOrigin();
     }
     links_ = nil;
+  #if TARGET_OS_IPHONE
+    accessibilityData_ = nil;
+  #endif
     invalidateLayout_slowPath(true);
   }
 
@@ -1635,13 +1758,17 @@ private:
     }
     if (!textFrameInfoIsValidForCurrentSize_ || displayScaleChanged) {
       links_ = nil;
-    }
-    if (measuringTextFrame_) {
-      measuringTextFrameInfo_ = labelTextFrameInfo(textFrameRef(measuringTextFrame_),
-                                                   params_.verticalAlignment,
-                                                   params_.displayScale());
-    } else {
-      measuringTextFrameInfo_.isValid = false;
+    #if TARGET_OS_IPHONE
+      accessibilityData_ = nil;
+    #endif
+    }
+    for (MeasuringTextFrame& entry : measuringTextFrames_) {
+      if (entry.textFrame) {
+        entry.info = labelTextFrameInfo(textFrameRef(entry.textFrame), params_.verticalAlignment,
+                                        params_.displayScale());
+      } else {
+        entry.info.isValid = false;
+      }
     }
     invalidateLayout_slowPath(true);
   }
@@ -1786,6 +1913,11 @@ void LabelRenderTask::copyLayoutInfoTo(LabelLayer& label) const {
   label.textFrameInfo_ = textFrameInfo_;
   label.textFrameInfoIsValidForCurrentSize_ = true;
   label.updateTextFrameOrigin();
+#if TARGET_OS_IPHONE
+  if (label.textFrame_ != textFrame_) {
+    label.accessibilityData_ = nil;
+  }
+#endif
   label.textFrame_ = textFrame_;
   if (type_ != Type::render) {
     auto& self = down_cast<const LabelLayoutAndRenderTask&>(*this);
@@ -1828,10 +1960,15 @@ void LabelRenderTask::assignResultTo(LabelLayer& label) {
   const bool keepTextFrame = !label.params_.releasesTextFrameAfterRendering
                            || renderInfo_.mode == LabelRenderMode::tiledSublayer;
   if (keepTextFrame && textFrame_) {
+  #if TARGET_OS_IPHONE
+    if (label.textFrame_ != textFrame_) {
+      label.accessibilityData_ = nil;
+    }
+  #endif
     label.textFrame_ = textFrame_;
   }
   if (!keepTextFrame) {
-    label.measuringTextFrame_ = nil;
+    label.releaseMeasuringTextFrames();
   }
 
   STU_ASSERT(renderInfo_.mode != LabelRenderMode::drawInCAContext
@@ -1876,6 +2013,9 @@ void LabelRenderTask::finish_onMainThread(void* taskPointer) {
     if (!label.taskIsStale_) {
       STULabelLayer* NS_VALID_UNTIL_END_OF_SCOPE layer = label.self;
       task.assignResultTo(label);
+    #if TARGET_OS_IPHONE
+      label.createAccessibilityDataAsyncIfNecessary();
+    #endif
       auto* const delegate = label.labelLayerDelegate_;
       label.didDisplayText(delegate);
     } else {
@@ -1939,6 +2079,32 @@ const LabelTextFrameInfo& STULabelLayerGetCurrentTextFrameInfo(STULabelLayer* __
   return self->impl.currentTextFrameInfo();
 }
 
+STULabelLayerSizeThatFitsCacheStatistics
+  STULabelLayerGetSizeThatFitsCacheStatistics(const STULabelLayer* __nonnull self)
+{
+  return self->impl.sizeThatFitsCacheStatistics();
+}
+
+#if TARGET_OS_IPHONE
+void STULabelLayerSetAccessibilityDataOptions(STULabelLayer* __nonnull self,
+                                              const TextFrameAccessibilityDataOptions& options)
+{
+  self->impl.setAccessibilityDataOptions(options);
+}
+
+STUTextFrameAccessibilityData* __nullable
+  STULabelLayerGetAccessibilityData(const STULabelLayer* __nonnull self)
+{
+  return self->impl.accessibilityData().unretained;
+}
+
+void STULabelLayerSetAccessibilityDataCompletionHandler(STULabelLayer* __nonnull self,
+                                                        void (^ __nullable completionHandler)(void))
+{
+  self->impl.setAccessibilityDataCompletionHandler(completionHandler);
+}
+#endif
+
 Unretained<STUTextFrameOptions* __nonnull> stu_label::defaultLabelTextFrameOptions() {
   STU_STATIC_CONST_ONCE(STUTextFrameOptions*, defaultOptions,
                         [[STUTextFrameOptions alloc]
@@ -1,5 +1,6 @@
 // Copyright 2017–2018 Stephan Tolksdorf
 
+#import "STUCancellationFlag.h"
 #import "STULabelDrawingBlock.h"
 #import "STULabelLayoutInfo.h"
 #import "STUTextRange.h"
@@ -8,6 +9,11 @@ typedef void (^ STULabelRenderTaskSchedulerBlock)(
                void * __nullable taskContext,
                void (* __nonnull taskFunction)(void * __nullable taskContext));
 
+/// @param completedCount The number of prerenderers in the batch that have been processed so far.
+/// @param totalCount The total number of prerenderers in the batch.
+typedef void (^ STULabelPrerendererBatchProgressBlock)(NSInteger completedCount,
+                                                       NSInteger totalCount);
+
 typedef NS_OPTIONS(uint8_t, STULabelPrerendererSizeOptions) {
   STUShrinkLabelWidthToFit  = 1,
   STUShrinkLabelHeightToFit = 2
@@ -236,6 +242,34 @@ directionalContentInsets:(STUDirectionalEdgeInsets)contentInsets;
 /// \pre `!self.isFrozen`
 - (void)renderUsingScheduler:(STU_NOESCAPE STULabelRenderTaskSchedulerBlock)scheduler;
 
+/// Freezes the specified prerenderers and renders them asynchronously on up to
+/// @c maxConcurrentTaskCount concurrently executing tasks on the specified queue.
+///
+/// The tasks process the prerenderers in array order. Each task reuses its temporary memory
+/// allocator and font caches for all the prerenderers it processes, which makes this method more
+/// efficient than calling @c renderAsyncOnQueue: on each prerenderer individually.
+///
+/// If the cancellation flag is set, the tasks skip all prerenderers they haven't started yet.
+/// A skipped prerenderer is rendered later if a label is configured with it.
+///
+/// @param queue The queue on which the tasks are executed. If null, the default-QoS global
+///              queue is used.
+/// @param maxConcurrentTaskCount If this value is not positive,
+///                               @c NSProcessInfo.activeProcessorCount is used instead.
+/// @param cancellationFlag An optional cancellation flag. The flag must remain valid until the
+///                         progress block has been called with @c completedCount equal to
+///                         @c totalCount.
+/// @param progress An optional block that is called on the main thread after each prerenderer has
+///                 been processed (after labels waiting for the prerenderer have been updated).
+///
+/// \pre `!prerenderer.isFrozen` for every prerenderer in the array.
++ (void)renderAsync:(NSArray<STULabelPrerenderer *> *)prerenderers
+            onQueue:(nullable dispatch_queue_t)queue
+    maxConcurrentTaskCount:(NSInteger)maxConcurrentTaskCount
+          cancellationFlag:(nullable const STUCancellationFlag *)cancellationFlag
+                  progress:(nullable STULabelPrerendererBatchProgressBlock)progress
+  NS_SWIFT_NAME(renderAsync(_:on:maxConcurrentTaskCount:cancellationFlag:progress:));
+
 @end
 
 STU_ASSUME_NONNULL_AND_STRONG_END
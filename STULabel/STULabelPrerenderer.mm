@@ -313,5 +313,15 @@ using namespace stu_label;
   prerenderer->renderUsingScheduler(scheduler);
 }
 
++ (void)renderAsync:(NSArray<STULabelPrerenderer*>*)prerenderers
+            onQueue:(nullable dispatch_queue_t)queue
+    maxConcurrentTaskCount:(NSInteger)maxConcurrentTaskCount
+          cancellationFlag:(nullable const STUCancellationFlag*)cancellationFlag
+                  progress:(nullable STULabelPrerendererBatchProgressBlock)progress
+{
+  LabelPrerenderer::renderBatch(prerenderers, queue, maxConcurrentTaskCount, cancellationFlag,
+                                progress);
+}
+
 @end
 
@@ -7,6 +7,26 @@
 namespace stu_label {
   class ShapedString;
   Unretained<STUShapedString* __nonnull> emptyShapedString(STUWritingDirection);
+
+  enum class MemoryStatisticsObjectKind : stu::UInt8 {
+    shapedString,
+    textFrame
+  };
+
+  /// Updates the counters returned by `stu_memoryStatistics`.
+  void addToMemoryStatistics(MemoryStatisticsObjectKind, stu::UInt mallocSize);
+  void removeFromMemoryStatistics(MemoryStatisticsObjectKind, stu::UInt mallocSize);
+
+  /// Updates the counters returned by `stu_hyphenationStatistics`.
+  void addToHyphenationStatistics(stu::UInt paragraphCount, stu::UInt queryCount);
+  void addToCachedHyphenationLookupCount(stu::UInt lookupCount);
+
+  /// Core Text stores at least a glyph, a position, an advance and a string index per glyph.
+  constexpr stu::UInt estimatedCoreTextBytesPerGlyph = sizeof(CGGlyph) + sizeof(CGPoint)
+                                                     + sizeof(CGSize) + sizeof(CFIndex);
+
+  /// Estimates the memory used by the string and its attribute runs.
+  stu::UInt estimatedMemoryUsage(NSAttributedString* __nonnull);
 }
 
 STU_EXTERN_C_BEGIN
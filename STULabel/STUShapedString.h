@@ -37,6 +37,73 @@ STUWritingDirection stuWritingDirection(STUUserInterfaceLayoutDirection directio
 /// which equals `UIApplication.sharedApplication.userInterfaceLayoutDirection`.
 STUWritingDirection stu_defaultBaseWritingDirection(void);
 
+/// An approximate breakdown of the memory retained by a @c STUShapedString or @c STUTextFrame.
+///
+/// The inline data sizes are exact malloc sizes. The Core Text and attributed string sizes are
+/// estimates, since these objects don't expose their internal allocations.
+typedef struct STUMemoryUsage {
+  /// The size of the single malloc block containing the object and its arrays.
+  size_t inlineDataSize;
+  /// The part of @c inlineDataSize occupied by the text style data.
+  size_t textStyleDataSize;
+  /// The part of @c inlineDataSize occupied by the per-paragraph and per-line records.
+  size_t lineDataSize;
+  /// An estimate of the memory retained by the @c CTTypesetter or the @c CTLine objects.
+  size_t coreTextObjectsSize;
+  /// An estimate of the memory retained by attributed strings that are owned by the object.
+  /// A text frame doesn't own the @c originalAttributedString, which is owned by the shaped string,
+  /// but it owns a lazily created @c truncatedAttributedString that is not the original string.
+  size_t attributedStringSize;
+  /// The size of separately allocated auxiliary data, e.g. the image bounds cache of a text frame
+  /// or the cached hyphenation opportunities of a shaped string.
+  size_t cacheSize;
+} STUMemoryUsage;
+
+STU_INLINE NS_SWIFT_NAME(getter:STUMemoryUsage.totalSize(self:))
+size_t STUMemoryUsageGetTotalSize(STUMemoryUsage usage) {
+  return usage.inlineDataSize + usage.coreTextObjectsSize + usage.attributedStringSize
+       + usage.cacheSize;
+}
+
+/// Process-wide counters for the live @c STUShapedString and @c STUTextFrame instances.
+///
+/// Only the malloc blocks of the instances are counted, i.e. the @c inlineDataSize of the
+/// @c STUMemoryUsage of each object. Updating the counters costs a few atomic operations per
+/// allocation and deallocation.
+typedef struct STUMemoryStatistics {
+  size_t shapedStringCount;
+  size_t shapedStringInlineDataSize;
+  size_t textFrameCount;
+  size_t textFrameInlineDataSize;
+  /// The maximum of `shapedStringInlineDataSize + textFrameInlineDataSize` since the start of the
+  /// process or the last call of @c stu_resetMemoryStatisticsHighWaterMark.
+  size_t inlineDataSizeHighWaterMark;
+} STUMemoryStatistics;
+
+/// Returns a snapshot of the process-wide memory counters. The individual counters are read
+/// separately and may be slightly inconsistent while other threads are allocating objects.
+STUMemoryStatistics stu_memoryStatistics(void);
+
+/// Resets @c inlineDataSizeHighWaterMark to the current total inline data size.
+void stu_resetMemoryStatisticsHighWaterMark(void);
+
+/// Process-wide counters for the hyphenation opportunities that shaped strings compute once per
+/// paragraph and cache for the line breaking. The opportunities of very long paragraphs are not
+/// cached but queried per line.
+typedef struct STUHyphenationStatistics {
+  /// The number of paragraphs whose hyphenation opportunities were computed and cached.
+  size_t paragraphCount;
+  /// The number of @c CFStringGetHyphenationLocationBeforeIndex calls made while computing the
+  /// hyphenation opportunities, including the per-line queries for very long paragraphs.
+  size_t hyphenationLocationQueryCount;
+  /// The number of hyphenation opportunities that the line breaking looked up in the caches.
+  /// Without the caches, each lookup would have required a separate hyphenation location query.
+  size_t cachedLookupCount;
+} STUHyphenationStatistics;
+
+/// Returns a snapshot of the process-wide hyphenation counters.
+STUHyphenationStatistics stu_hyphenationStatistics(void);
+
 STU_EXPORT
 @interface STUShapedString : NSObject
 
@@ -87,9 +154,44 @@ STU_EXPORT
 
 - (nonnull instancetype)init NS_UNAVAILABLE;
 
+/// An approximate breakdown of the memory retained by this shaped string.
+///
+/// This property is computed on each access in time proportional to the number of attribute runs
+/// in the string.
+@property (readonly) STUMemoryUsage memoryUsage;
+
 + (nonnull STUShapedString *)emptyShapedStringWithDefaultBaseWritingDirection:
                                (STUWritingDirection)baseWritingDirection;
 
+/// Returns a binary representation of the shaped string that can be used to persist the result of
+/// the text analysis, e.g. in an on-disk cache, and that can be turned back into a shaped string
+/// with @c shapedStringWithSerializedData: without re-analyzing the attributed string.
+///
+/// The attributed string is stored in an @c NSKeyedArchiver archive, so all attribute values must
+/// support @c NSSecureCoding. @c CTRunDelegate attributes are removed before archiving and
+/// recreated for @c STUTextAttachment values when the data is deserialized.
+///
+/// Returns nil if the attributed string can't be securely archived.
+///
+/// The data embeds the internal memory layout of the shaped string and can only be deserialized by
+/// the same build of this library, which is checked with a fingerprint of the data layout and the
+/// library binary stored in the data. Don't use it as an exchange format.
+- (nullable NSData *)serializedData
+  API_AVAILABLE(ios(11.0), tvos(11.0));
+
+/// Creates a shaped string from data returned by @c serializedData.
+///
+/// Returns nil if the data wasn't produced by @c serializedData or was produced by a different
+/// build of this library.
+///
+/// The attributed string is unarchived with secure coding. Attribute values of classes other than
+/// the common Foundation, UIKit and STULabel attribute classes are rejected. Deserializing skips the
+/// text analysis, but unarchiving the attributed string still has a cost proportional to its size.
+/// Large data can e.g. be memory-mapped with @c NSDataReadingMappedIfSafe.
++ (nullable instancetype)shapedStringWithSerializedData:(NSData *)data
+  API_AVAILABLE(ios(11.0), tvos(11.0))
+  NS_SWIFT_NAME(init(serializedData:));
+
 @end
 
 /// Determines the writing direction of the specified string range using the Unicode Bidi algorithm
@@ -15,6 +15,10 @@
 #import "Internal/TextStyleBuffer.hpp"
 #import "Internal/UnicodeCodePointProperties.hpp"
 
+#import <malloc/malloc.h>
+
+#include <atomic>
+
 #include "Internal/DefineUIntOnCatalystToWorkAroundGlobalNamespacePollution.h"
 
 using namespace stu;
@@ -41,6 +45,113 @@ NSWritingDirection stu_detectBaseWritingDirection(NSString* __unsafe_unretained
   return detectBaseWritingDirection(string, Range<Int>{range}, SkipIsolatedText{skipIsolatedText});
 }
 
+namespace stu_label {
+
+namespace {
+struct MemoryCounters {
+  std::atomic<UInt> count;
+  std::atomic<UInt> size;
+};
+}
+
+static MemoryCounters memoryCounters[2];
+static std::atomic<UInt> inlineDataSizeHighWaterMark;
+
+STU_INLINE
+MemoryCounters& memoryCountersFor(MemoryStatisticsObjectKind kind) {
+  return memoryCounters[static_cast<UInt8>(kind)];
+}
+
+static UInt totalInlineDataSize() {
+  UInt total = 0;
+  for (const MemoryCounters& counters : memoryCounters) {
+    total += counters.size.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+void addToMemoryStatistics(MemoryStatisticsObjectKind kind, UInt mallocSize) {
+  MemoryCounters& counters = memoryCountersFor(kind);
+  counters.count.fetch_add(1, std::memory_order_relaxed);
+  counters.size.fetch_add(mallocSize, std::memory_order_relaxed);
+  const UInt total = totalInlineDataSize();
+  UInt maxTotal = inlineDataSizeHighWaterMark.load(std::memory_order_relaxed);
+  while (maxTotal < total
+         && !inlineDataSizeHighWaterMark.compare_exchange_weak(maxTotal, total,
+                                                               std::memory_order_relaxed))
+  {}
+}
+
+void removeFromMemoryStatistics(MemoryStatisticsObjectKind kind, UInt mallocSize) {
+  MemoryCounters& counters = memoryCountersFor(kind);
+  counters.count.fetch_sub(1, std::memory_order_relaxed);
+  counters.size.fetch_sub(mallocSize, std::memory_order_relaxed);
+}
+
+namespace {
+struct HyphenationCounters {
+  std::atomic<UInt> paragraphCount;
+  std::atomic<UInt> queryCount;
+  std::atomic<UInt> cachedLookupCount;
+};
+}
+
+static HyphenationCounters hyphenationCounters;
+
+void addToHyphenationStatistics(UInt paragraphCount, UInt queryCount) {
+  hyphenationCounters.paragraphCount.fetch_add(paragraphCount, std::memory_order_relaxed);
+  hyphenationCounters.queryCount.fetch_add(queryCount, std::memory_order_relaxed);
+}
+
+void addToCachedHyphenationLookupCount(UInt lookupCount) {
+  hyphenationCounters.cachedLookupCount.fetch_add(lookupCount, std::memory_order_relaxed);
+}
+
+UInt estimatedMemoryUsage(NSAttributedString* __unsafe_unretained string) {
+  // NSAttributedString doesn't expose its storage, so we assume UTF-16 string storage and one
+  // run record per attribute run. The attribute dictionaries are usually shared between runs.
+  constexpr UInt attributeRunSize = 2*sizeof(void*) + 2*sizeof(NSUInteger);
+  const NSUInteger length = string.length;
+  __block UInt runCount = 0;
+  [string enumerateAttributesInRange:NSRange{0, length}
+                             options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired
+                          usingBlock:^(NSDictionary* __unused attributes, NSRange __unused range,
+                                       BOOL* __unused stop)
+                          {
+                            ++runCount;
+                          }];
+  return malloc_size((__bridge const void*)string) + length*sizeof(unichar)
+       + runCount*attributeRunSize;
+}
+
+} // namespace stu_label
+
+STU_EXPORT
+STUMemoryStatistics stu_memoryStatistics() {
+  const MemoryCounters& shapedStrings = memoryCountersFor(MemoryStatisticsObjectKind::shapedString);
+  const MemoryCounters& textFrames = memoryCountersFor(MemoryStatisticsObjectKind::textFrame);
+  return {.shapedStringCount = shapedStrings.count.load(std::memory_order_relaxed),
+          .shapedStringInlineDataSize = shapedStrings.size.load(std::memory_order_relaxed),
+          .textFrameCount = textFrames.count.load(std::memory_order_relaxed),
+          .textFrameInlineDataSize = textFrames.size.load(std::memory_order_relaxed),
+          .inlineDataSizeHighWaterMark =
+             inlineDataSizeHighWaterMark.load(std::memory_order_relaxed)};
+}
+
+STU_EXPORT
+void stu_resetMemoryStatisticsHighWaterMark() {
+  inlineDataSizeHighWaterMark.store(totalInlineDataSize(), std::memory_order_relaxed);
+}
+
+STU_EXPORT
+STUHyphenationStatistics stu_hyphenationStatistics() {
+  return {.paragraphCount = hyphenationCounters.paragraphCount.load(std::memory_order_relaxed),
+          .hyphenationLocationQueryCount =
+             hyphenationCounters.queryCount.load(std::memory_order_relaxed),
+          .cachedLookupCount =
+             hyphenationCounters.cachedLookupCount.load(std::memory_order_relaxed)};
+}
+
 NSAttributedString* stu_emptyAttributedString() {
   STU_STATIC_CONST_ONCE(NSAttributedString*, instance, [[NSAttributedString alloc] init]);
   return instance;
@@ -117,6 +228,35 @@ size_t STUShapedStringGetLength(STUShapedString* self) {
 }
 
 
+/// Allocates the ObjC instance and the ShapedString in a single malloc block.
+static STUShapedString* __nullable
+  createShapedStringInstance(Class cls,
+                             FunctionRef<ShapedString* __nullable(FunctionRef<void*(UInt)>)>
+                               createShapedString)
+    NS_RETURNS_RETAINED
+{
+  ThreadLocalArenaAllocator::InitialBuffer<2048> buffer;
+  ThreadLocalArenaAllocatorScope alloc{Ref{buffer}};
+
+  const UInt instanceSize = roundUpToMultipleOf<alignof(ShapedString)>(class_getInstanceSize(cls));
+
+  Byte* p;
+  ShapedString* const shapedString = createShapedString([&](UInt size) -> void* {
+                                       p = static_cast<Byte*>(malloc(instanceSize + size));
+                                       if (!p) __builtin_trap();
+                                       return p + instanceSize;
+                                     });
+  if (!shapedString) return nil;
+
+  memset(p, 0, instanceSize);
+  STUShapedString* const instance = stu_constructClassInstance(cls, p);
+  STU_DEBUG_ASSERT([instance isKindOfClass:STUShapedString.class]);
+  const_cast<ShapedString*&>(instance->shapedString) = shapedString;
+  addToMemoryStatistics(MemoryStatisticsObjectKind::shapedString, malloc_size(p));
+
+  return instance;
+}
+
 STUShapedString* __nullable
   STUShapedStringCreate(__nullable Class cls,
                         NSAttributedString* __unsafe_unretained attributedString,
@@ -135,31 +275,40 @@ STUShapedString* __nullable
 
   baseWritingDirection = clampBaseWritingDirection(baseWritingDirection);
 
-  ThreadLocalArenaAllocator::InitialBuffer<2048> buffer;
-  ThreadLocalArenaAllocator alloc{Ref{buffer}};
-
-  const UInt instanceSize = roundUpToMultipleOf<alignof(ShapedString)>(class_getInstanceSize(cls));
+  return createShapedStringInstance(cls, [&](FunctionRef<void*(UInt)> alloc) {
+    return ShapedString::create(attributedString, baseWritingDirection, cancellationFlag, alloc);
+  });
+}
 
-  Byte* p;
-  ShapedString* const shapedString = ShapedString::create(
-                                       attributedString, baseWritingDirection, cancellationFlag,
-                                       [&](UInt size) -> void* {
-                                         p = static_cast<Byte*>(malloc(instanceSize + size));
-                                         if (!p) __builtin_trap();
-                                         return p + instanceSize;
-                                       });
-  if (!shapedString) return nil;
+- (nullable NSData*)serializedData {
+  return shapedString->serializedData();
+}
 
-  memset(p, 0, instanceSize);
-  STUShapedString* const instance = stu_constructClassInstance(cls, p);
-  STU_DEBUG_ASSERT([instance isKindOfClass:shapedStringClass]);
-  const_cast<ShapedString*&>(instance->shapedString) = shapedString;
++ (nullable instancetype)shapedStringWithSerializedData:(NSData*)data {
+  STU_CHECK_MSG(data != nil, "NSData argument is null.");
+  return createShapedStringInstance(self, [&](FunctionRef<void*(UInt)> alloc) {
+    return ShapedString::createFromSerializedData(data, alloc);
+  });
+}
 
-  return instance;
+- (STUMemoryUsage)memoryUsage {
+  const ShapedString& ss = *shapedString;
+  const ShapedString::ArraysRef arrays = ss.arrays();
+  const CTTypesetter* const typesetter = ss.typesetter.get();
+  return {.inlineDataSize = malloc_size((__bridge const void*)self),
+          .textStyleDataSize = sign_cast(ss.textStylesSize),
+          .lineDataSize = arrays.paragraphs.arraySizeInBytes(),
+          // The typesetter retains the glyph runs for the full string.
+          .coreTextObjectsSize = (typesetter ? malloc_size(typesetter) : 0)
+                               + sign_cast(ss.stringLength)*estimatedCoreTextBytesPerGlyph,
+          .attributedStringSize = estimatedMemoryUsage(ss.attributedString),
+          .cacheSize = ss.hyphenationCacheSize()};
 }
 
 - (void)dealloc {
   if (shapedString) {
+    removeFromMemoryStatistics(MemoryStatisticsObjectKind::shapedString,
+                               malloc_size((__bridge const void*)self));
     shapedString->~ShapedString();
   }
 }
@@ -6,7 +6,12 @@
 #import "Internal/TextStyle.hpp"
 
 
-namespace stu_label { Unretained<STUTextFrame* __nonnull> emptySTUTextFrame(); }
+namespace stu_label {
+  Unretained<STUTextFrame* __nonnull> emptySTUTextFrame();
+
+  /// Updates the counters returned by `stu_glyphDrawingStatistics`.
+  void addToGlyphDrawingStatistics(stu::UInt lineCount, stu::UInt glyphDrawCallCount);
+}
 
 stu_label::Rect<CGFloat> STUTextFrameGetImageBoundsForRange(
                            const STUTextFrame* __nonnull, STUTextFrameRange,
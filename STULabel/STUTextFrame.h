@@ -110,6 +110,20 @@ typedef struct STUTextFrameLayoutInfo {
 } NS_SWIFT_NAME(STUTextFrame.LayoutInfo)
   STUTextFrameLayoutInfo;
 
+/// Process-wide counters for the glyph drawing of text frames. Consecutive glyph runs that only
+/// differ in attributes that don't affect the glyph rendering are drawn with a single call, so the
+/// ratio of the two counters indicates how well the runs of the drawn lines could be batched.
+typedef struct STUGlyphDrawingStatistics {
+  /// The number of text frame lines that were drawn.
+  size_t lineCount;
+  /// The number of @c CTFontDrawGlyphs, @c CTRunDraw and @c CTLineDraw calls made while drawing
+  /// these lines.
+  size_t glyphDrawCallCount;
+} STUGlyphDrawingStatistics;
+
+/// Returns a snapshot of the process-wide glyph drawing counters.
+STUGlyphDrawingStatistics stu_glyphDrawingStatistics(void);
+
 STU_EXPORT
 @interface STUTextFrame : NSObject
 
@@ -159,6 +173,53 @@ STU_EXPORT
   NS_REFINED_FOR_SWIFT STU_SWIFT_UNAVAILABLE;
   // func layoutInfo(frameOrigin: CGPoint) -> LayoutInfo
 
+/// Calculates the layout info of a text frame for the specified substring of the shaped string,
+/// without creating a @c STUTextFrame instance.
+///
+/// The result is equal to the value returned by
+/// @c [[STUTextFrame alloc] initWithShapedString:shapedString stringRange:stringRange size:size
+/// displayScale:displayScale options:options cancellationFlag:nil]
+/// @c layoutInfoForFrameOrigin:CGPointZero],
+/// but the calculation is cheaper, since no text frame data has to be allocated and copied.
+///
+/// This method is thread-safe.
++ (STUTextFrameLayoutInfo)layoutInfoForShapedString:(STUShapedString *)shapedString
+                                         stringRange:(NSRange)stringRange
+                                                size:(CGSize)size
+                                        displayScale:(CGFloat)displayScale
+                                             options:(nullable STUTextFrameOptions *)options
+  NS_REFINED_FOR_SWIFT
+  NS_SWIFT_NAME(__layoutInfo(for:stringRange:size:displayScale:options:));
+  // static func layoutInfo(for: STUShapedString, stringRange: NSRange?, size: CGSize,
+  //                        displayScale: CGFloat?, options: STUTextFrameOptions?) -> LayoutInfo
+
+/// Calculates the layout info of text frames with the specified widths for the full string of the
+/// shaped string, without creating any @c STUTextFrame instances.
+///
+/// For each width the result is equal to the value returned by
+/// @c [[STUTextFrame alloc] initWithShapedString:shapedString size:CGSizeMake(width, frameHeight)
+/// displayScale:displayScale options:options] @c layoutInfoForFrameOrigin:CGPointZero].
+///
+/// Where the lines laid out for a larger width also fit a smaller width, the line breaks are
+/// reused, so measuring multiple widths in a single call is usually faster than creating separate
+/// text frames.
+///
+/// This method is thread-safe.
+///
+/// @param outInfos A pointer to an array with at least @c count elements.
+/// @param frameWidths A pointer to an array with @c count widths. The widths needn't be sorted.
++ (void)getLayoutInfos:(STUTextFrameLayoutInfo *)outInfos
+       forShapedString:(STUShapedString *)shapedString
+           frameWidths:(const CGFloat *)frameWidths
+                 count:(size_t)count
+           frameHeight:(CGFloat)frameHeight
+          displayScale:(CGFloat)displayScale
+               options:(nullable STUTextFrameOptions *)options
+  NS_REFINED_FOR_SWIFT
+  NS_SWIFT_NAME(__getLayoutInfos(_:for:frameWidths:count:frameHeight:displayScale:options:));
+  // static func layoutInfos(for: STUShapedString, frameWidths: [CGFloat], frameHeight: CGFloat,
+  //                         displayScale: CGFloat?, options: STUTextFrameOptions?) -> [LayoutInfo]
+
 /// The @c self.rangeInOriginalString substring of @c self.originalAttributedString, truncated in
 /// the same way it is truncated when the text is drawn, i.e. with truncation tokens replacing text
 /// that doesn't fit the frame size.
@@ -223,6 +284,34 @@ STU_EXPORT
   NS_REFINED_FOR_SWIFT NS_SWIFT_NAME(__range(forRangeInTruncatedString:));
   // func range(forRangeInTruncatedString range: NSRange) -> Range<Index>
 
+/// Equivalent to calling @c rangeForRangeInOriginalString: for each of the @c count ranges,
+/// but faster for many ranges, particularly when they are sorted by their start location.
+///
+/// @param outRanges
+///  A pointer to an array with space for @c count text frame ranges.
+/// @param rangesInOriginalString
+///  A pointer to an array of @c count UTF-16 code unit ranges in
+///  @c self.originalAttributedString.
+- (void)getRanges:(STUTextFrameRange *)outRanges
+  forRangesInOriginalString:(const NSRange *)rangesInOriginalString
+                      count:(size_t)count
+  NS_REFINED_FOR_SWIFT NS_SWIFT_NAME(__getRanges(_:forRangesInOriginalString:count:));
+  // func ranges(forRangesInOriginalString ranges: [NSRange]) -> [Range<Index>]
+
+/// Equivalent to calling @c rangeForRangeInTruncatedString: for each of the @c count ranges,
+/// but faster for many ranges, particularly when they are sorted by their start location.
+///
+/// @param outRanges
+///  A pointer to an array with space for @c count text frame ranges.
+/// @param rangesInTruncatedString
+///  A pointer to an array of @c count UTF-16 code unit ranges in
+///  @c self.truncatedAttributedString.
+- (void)getRanges:(STUTextFrameRange *)outRanges
+  forRangesInTruncatedString:(const NSRange *)rangesInTruncatedString
+                       count:(size_t)count
+  NS_REFINED_FOR_SWIFT NS_SWIFT_NAME(__getRanges(_:forRangesInTruncatedString:count:));
+  // func ranges(forRangesInTruncatedString ranges: [NSRange]) -> [Range<Index>]
+
 - (STUTextFrameRange)rangeForTextRange:(STUTextRange)textRange
   NS_REFINED_FOR_SWIFT STU_SWIFT_UNAVAILABLE;
   // func range(for textRange: STUTextRange) -> Range<Index>
@@ -241,6 +330,18 @@ STU_EXPORT
   NS_REFINED_FOR_SWIFT NS_SWIFT_NAME(__rangeInOriginalString(for:));
   // func rangeInOriginalString(for range: Range<Index>) -> NSRange
 
+/// Equivalent to calling @c rangeInOriginalStringForRange: for each of the @c count ranges.
+///
+/// @param outRanges
+///  A pointer to an array with space for @c count UTF-16 code unit ranges.
+/// @param ranges
+///  A pointer to an array of @c count text frame ranges.
+- (void)getRangesInOriginalString:(NSRange *)outRanges
+                        forRanges:(const STUTextFrameRange *)ranges
+                            count:(size_t)count
+  NS_REFINED_FOR_SWIFT NS_SWIFT_NAME(__getRangesInOriginalString(_:for:count:));
+  // func rangesInOriginalString(for ranges: [Range<Index>]) -> [NSRange]
+
 /// @param outRange
 ///  If @c outRange is non-null, @c *outRange is assigned the UTF-16 code unit range in
 ///  @c self.originalAttributedString corresponding to the specified text frame index.
@@ -321,6 +422,8 @@ STU_EXPORT
   NS_REFINED_FOR_SWIFT STU_SWIFT_UNAVAILABLE;
   // func rectsForAllLinksInTruncatedString(frameOrigin: CGPoint) -> STUTextLinkArray
 
+/// Unless the text frame was created with @c STUTextFrameOptions.cachesImageBounds set to false,
+/// the results of recent calls are memoized (except for calls that were cancelled).
 - (CGRect)imageBoundsForRange:(STUTextFrameRange)range
                   frameOrigin:(CGPoint)frameOrigin
                  displayScale:(CGFloat)displayScale
@@ -433,6 +536,44 @@ pixelAlignBaselines:(bool)pixelAlignBaselines
   //           options: STUTextFrameDrawingOptions = nil,
   //           cancellationFlag: UnsafePointer<STUCancellationFlag>? = nil)
 
+/// Returns a compact binary snapshot of the text frame's layout that can be turned back into a
+/// text frame with @c textFrameWithSnapshotData:shapedString:, e.g. for caching layouts on disk or
+/// sharing them with an app extension.
+///
+/// The truncation tokens are stored in an @c NSKeyedArchiver archive, so all attribute values in
+/// the tokens must support @c NSSecureCoding. Returns nil if the tokens can't be securely archived.
+///
+/// The snapshot doesn't contain the attributed string. The snapshot embeds the internal memory
+/// layout of the text frame and can only be loaded by the same build of this library.
+- (nullable NSData *)snapshotData
+  API_AVAILABLE(ios(11.0), tvos(11.0));
+
+/// Creates a text frame from data returned by @c snapshotData without redoing the line breaking,
+/// truncation and text scaling.
+///
+/// @param shapedString The shaped string the original text frame was created from, or a shaped
+///        string created from an equal attributed string, e.g. with
+///        @c shapedStringWithSerializedData:.
+///
+/// Returns nil if the data wasn't produced by @c snapshotData, was produced by a different build
+/// of this library, is corrupted, doesn't belong to the specified shaped string, or if the Core
+/// Text typesetting of the lines doesn't reproduce the stored line metrics (which can happen e.g.
+/// after an OS update).
+///
+/// The truncation tokens are unarchived with secure coding. Attribute values of classes other than
+/// the common Foundation, UIKit and STULabel attribute classes are rejected.
++ (nullable instancetype)textFrameWithSnapshotData:(NSData *)data
+                                      shapedString:(STUShapedString *)shapedString
+  API_AVAILABLE(ios(11.0), tvos(11.0))
+  NS_SWIFT_NAME(init(snapshotData:shapedString:));
+
+/// An approximate breakdown of the memory retained by this text frame.
+///
+/// The Core Text estimate covers the @c CTLine objects of the text lines, the truncation tokens and
+/// the inserted hyphens. The memory of the @c originalAttributedString is accounted to the
+/// @c STUShapedString.
+@property (readonly) STUMemoryUsage memoryUsage;
+
 @property (class, readonly) STUTextFrame *emptyTextFrame;
 
 - (instancetype)init NS_UNAVAILABLE;
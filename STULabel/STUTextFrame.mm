@@ -19,11 +19,36 @@
 #import "Internal/STUPlaceholderObjects.h"
 #import "Internal/TextLineSpan.hpp"
 
+#import <malloc/malloc.h>
+
 #include "Internal/DefineUIntOnCatalystToWorkAroundGlobalNamespacePollution.h"
 
 using namespace stu;
 using namespace stu_label;
 
+namespace {
+struct GlyphDrawingCounters {
+  std::atomic<UInt> lineCount;
+  std::atomic<UInt> glyphDrawCallCount;
+};
+}
+
+static GlyphDrawingCounters glyphDrawingCounters;
+
+void stu_label::addToGlyphDrawingStatistics(UInt lineCount, UInt glyphDrawCallCount) {
+  if (lineCount == 0 && glyphDrawCallCount == 0) return;
+  glyphDrawingCounters.lineCount.fetch_add(lineCount, std::memory_order_relaxed);
+  glyphDrawingCounters.glyphDrawCallCount.fetch_add(glyphDrawCallCount,
+                                                    std::memory_order_relaxed);
+}
+
+STU_EXPORT
+STUGlyphDrawingStatistics stu_glyphDrawingStatistics() {
+  return {.lineCount = glyphDrawingCounters.lineCount.load(std::memory_order_relaxed),
+          .glyphDrawCallCount =
+             glyphDrawingCounters.glyphDrawCallCount.load(std::memory_order_relaxed)};
+}
+
 STU_EXPORT
 NSRange STUTextFrameRangeGetRangeInTruncatedString(STUTextFrameRange range) {
   const UInt start = range.start.indexInTruncatedString
@@ -115,6 +140,25 @@ STUTextFrame* __nonnull
 }
 
 STU_NO_INLINE
+/// Calculates (and thereby caches) the image bounds that a label needs for rendering the text frame,
+/// i.e. the image bounds of the full range at the origin with the default drawing options.
+static void precomputeImageBounds(STUTextFrame* __unsafe_unretained textFrame,
+                                  const STUCancellationFlag* __nullable cancellationFlag)
+{
+  const CGFloat displayScale = textFrame->data->displayScale;
+  if (!NSThread.isMainThread) {
+    STUTextFrameGetImageBoundsForRange(textFrame, STUTextFrameGetRange(textFrame), CGPoint{},
+                                       displayScale, nil, cancellationFlag);
+    return;
+  }
+  // We don't want to block the main thread. The cancellation flag may not outlive this call.
+  STUTextFrame* const strongTextFrame = textFrame;
+  dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+    STUTextFrameGetImageBoundsForRange(strongTextFrame, STUTextFrameGetRange(strongTextFrame),
+                                       CGPoint{}, displayScale, nil, nullptr);
+  });
+}
+
 STUTextFrame* __nullable
   STUTextFrameCreateWithShapedStringRange(
     __nullable Class cls,
@@ -150,7 +194,7 @@ STUTextFrame* __nullable
   }
 
   ThreadLocalArenaAllocator::InitialBuffer<4096> buffer;
-  ThreadLocalArenaAllocator alloc{Ref{buffer}};
+  ThreadLocalArenaAllocatorScope alloc{Ref{buffer}};
 
   TextFrameLayouter layouter{shapedString, Range<Int32>(stringRange),
                              options->_options.defaultTextAlignment, cancellationFlag};
@@ -168,13 +212,96 @@ STUTextFrame* __nullable
   memset(p, 0, instanceSize);
   STUTextFrame* const instance = stu_constructClassInstance(cls, p);
   STU_DEBUG_ASSERT([instance isKindOfClass:textFrameClass]);
-  const_cast<STUTextFrameData*&>(instance->data) =
-    new (p + instanceSize + oso.offset) TextFrame(std::move(layouter), oso.size - oso.offset);
+  TextFrame* const textFrame = new (p + instanceSize + oso.offset)
+                                  TextFrame(std::move(layouter), oso.size - oso.offset);
+  textFrame->mutablePrivateData().cachesImageBounds = options->_options.cachesImageBounds;
+  const_cast<STUTextFrameData*&>(instance->data) = textFrame;
+  addToMemoryStatistics(MemoryStatisticsObjectKind::textFrame, malloc_size(p));
+  if (options->_options.precomputesImageBounds && options->_options.cachesImageBounds) {
+    precomputeImageBounds(instance, cancellationFlag);
+  }
   return instance;
 }
 
+- (nullable NSData*)snapshotData {
+  return textFrameRef(self).snapshotData();
+}
+
++ (nullable instancetype)textFrameWithSnapshotData:(NSData*)data
+                                      shapedString:(STUShapedString*)shapedString
+{
+  STU_CHECK_MSG(data != nil, "NSData argument is null.");
+  STU_CHECK_MSG(shapedString != nil, "STUShapedString argument is null.");
+
+  ThreadLocalArenaAllocator::InitialBuffer<4096> buffer;
+  ThreadLocalArenaAllocatorScope alloc{Ref{buffer}};
+
+  const Class cls = self;
+  const UInt instanceSize = roundUpToMultipleOf<alignof(TextFrame)>(class_getInstanceSize(cls));
+  STUTextFrame* instance = nil;
+  const TextFrame* const textFrame = TextFrame::createFromSnapshotData(
+                                       data, *shapedString->shapedString,
+                                       [&](UInt size) -> void* {
+                                         Byte* const p = static_cast<Byte*>(
+                                                           malloc(instanceSize + size));
+                                         if (!p) __builtin_trap();
+                                         memset(p, 0, instanceSize);
+                                         instance = stu_constructClassInstance(cls, p);
+                                         return p + instanceSize;
+                                       });
+  if (!textFrame) return nil;
+  const_cast<STUTextFrameData*&>(instance->data) = textFrame;
+  addToMemoryStatistics(MemoryStatisticsObjectKind::textFrame,
+                        malloc_size((__bridge const void*)instance));
+  return instance;
+}
+
+static UInt estimatedMemoryUsage(CTLine* __nonnull line) {
+  UInt size = malloc_size(line);
+  for (CTRun* const run : glyphRuns(line)) {
+    size += malloc_size(run);
+  }
+  return size + sign_cast(CTLineGetGlyphCount(line))*estimatedCoreTextBytesPerGlyph;
+}
+
+- (STUMemoryUsage)memoryUsage {
+  const TextFrame& tf = textFrameRef(self);
+  UInt coreTextObjectsSize = 0;
+  for (const TextFrameLine& line : tf.lines()) {
+    if (line._ctLine) {
+      coreTextObjectsSize += estimatedMemoryUsage(line._ctLine);
+    }
+    if (line._tokenCTLine) {
+      coreTextObjectsSize += estimatedMemoryUsage(line._tokenCTLine);
+    }
+  }
+  UInt attributedStringSize = 0;
+  if (const CFAttributedStringRef ts = atomic_load_explicit(&tf._truncatedAttributedString,
+                                                            memory_order_acquire))
+  {
+    attributedStringSize = estimatedMemoryUsage((__bridge NSAttributedString*)ts);
+  }
+  UInt cacheSize = 0;
+  if (const void* const bs = atomic_load_explicit(&tf._backgroundSegments, memory_order_relaxed)) {
+    cacheSize += malloc_size(bs);
+  }
+  if (const void* const cache = tf.privateData().imageBoundsCache.load(std::memory_order_relaxed)) {
+    cacheSize += malloc_size(cache);
+  }
+  return {.inlineDataSize = malloc_size((__bridge const void*)self),
+          .textStyleDataSize = sign_cast(tf.textStylesDataSize()),
+          .lineDataSize = tf.paragraphs().arraySizeInBytes() + tf.lines().arraySizeInBytes()
+                        + tf.lineStringIndices().arraySizeInBytes()
+                        + IntervalSearchTable::sizeInBytesForCount(tf.lineCount),
+          .coreTextObjectsSize = coreTextObjectsSize,
+          .attributedStringSize = attributedStringSize,
+          .cacheSize = cacheSize};
+}
+
 - (void)dealloc {
   if (const STUTextFrameData* const frame = data) {
+    removeFromMemoryStatistics(MemoryStatisticsObjectKind::textFrame,
+                               malloc_size((__bridge const void*)self));
     down_cast<const TextFrame&>(*frame).~TextFrame();
   }
 }
@@ -221,6 +348,100 @@ STUTextFrame* __nullable
   };
 }
 
+/// Equivalent to @c -[STUTextFrame layoutInfoForFrameOrigin:CGPointZero displayScale:] for a text
+/// frame created from the current layout.
+static STUTextFrameLayoutInfo layoutInfo(const TextFrameLayouter& layouter,
+                                         const Optional<DisplayScale>& displayScale)
+{
+  STUTextFrameLayoutInfo info = layouter.layoutInfo();
+  if (displayScale) {
+    info.firstBaseline = ceilToScale(info.firstBaseline, *displayScale);
+    info.lastBaseline = ceilToScale(info.lastBaseline, *displayScale);
+  }
+  return info;
+}
+
++ (STUTextFrameLayoutInfo)layoutInfoForShapedString:(STUShapedString* NS_VALID_UNTIL_END_OF_SCOPE)
+                                                       stuShapedString
+                                         stringRange:(NSRange)stringRange
+                                                size:(CGSize)size
+                                        displayScale:(CGFloat)displayScale
+                                             options:(nullable STUTextFrameOptions*
+                                                        NS_VALID_UNTIL_END_OF_SCOPE)options
+{
+  STU_CHECK_MSG(stuShapedString != nil, "STUShapedString argument is null.");
+  const ShapedString& shapedString = *stuShapedString->shapedString;
+  STU_CHECK_MSG(stringRange.location <= sign_cast(shapedString.stringLength)
+                && stringRange.length <= sign_cast(shapedString.stringLength)
+                                         - stringRange.location,
+                "Invalid string range.");
+  if (!options) {
+    options = [[STUTextFrameOptions alloc] init];
+  }
+  const Optional<DisplayScale> scale = DisplayScale::create(displayScale);
+
+  ThreadLocalArenaAllocator::InitialBuffer<4096> buffer;
+  ThreadLocalArenaAllocatorScope alloc{Ref{buffer}};
+
+  TextFrameLayouter layouter{shapedString, Range<Int32>(stringRange),
+                             options->_options.defaultTextAlignment, nullptr};
+  layouter.layoutAndScale(size, scale, options->_options);
+  if (layouter.needToJustifyLines()) {
+    layouter.justifyLinesWhereNecessary();
+  }
+  const STUTextFrameLayoutInfo info = layoutInfo(layouter, scale);
+  layouter.releaseCTLinesAndParagraphTruncationTokens();
+  return info;
+}
+
++ (void)getLayoutInfos:(STUTextFrameLayoutInfo*)outInfos
+          forShapedString:(STUShapedString* NS_VALID_UNTIL_END_OF_SCOPE)stuShapedString
+              frameWidths:(const CGFloat*)frameWidths
+                    count:(size_t)count
+              frameHeight:(CGFloat)frameHeight
+             displayScale:(CGFloat)displayScale
+                  options:(nullable STUTextFrameOptions* NS_VALID_UNTIL_END_OF_SCOPE)options
+{
+  STU_CHECK_MSG(stuShapedString != nil, "STUShapedString argument is null.");
+  const Int n = sign_cast(count);
+  if (n == 0) return;
+  const ShapedString& shapedString = *stuShapedString->shapedString;
+  if (!options) {
+    options = [[STUTextFrameOptions alloc] init];
+  }
+  const TextFrameOptions& textFrameOptions = options->_options;
+  const Optional<DisplayScale> scale = DisplayScale::create(displayScale);
+
+  ThreadLocalArenaAllocator::InitialBuffer<4096> buffer;
+  ThreadLocalArenaAllocatorScope alloc{Ref{buffer}};
+
+  // We process the widths in decreasing order, so that the line breaks calculated for one width
+  // can often be reused for the next narrower one.
+  TempArray<Int> order{uninitialized, Count{n}};
+  for (Int i = 0; i < n; ++i) {
+    order[i] = i;
+  }
+  order.sort([&](Int i1, Int i2) {
+    return frameWidths[i1] > frameWidths[i2];
+  });
+
+  TextFrameLayouter layouter{shapedString, Range<Int32>{0, shapedString.stringLength},
+                             textFrameOptions.defaultTextAlignment, nullptr};
+  bool hasLayout = false;
+  for (const Int i : order) {
+    const CGFloat width = frameWidths[i];
+    if (!(hasLayout && layouter.tryToReuseLayoutForNarrowerFrameWidth(width))) {
+      layouter.layoutAndScale(Size{width, frameHeight}, scale, textFrameOptions);
+      if (layouter.needToJustifyLines()) {
+        layouter.justifyLinesWhereNecessary();
+      }
+      hasLayout = true;
+    }
+    outInfos[i] = layoutInfo(layouter, scale);
+  }
+  layouter.releaseCTLinesAndParagraphTruncationTokens();
+}
+
 - (CGFloat)displayScale {
   return data->displayScale;
 }
@@ -257,6 +478,26 @@ STUTextFrame* __nullable
   return textFrameRef(*data).range(RangeInTruncatedString{rangeInTruncatedString});
 }
 
+- (void)getRanges:(STUTextFrameRange*)outRanges
+  forRangesInOriginalString:(const NSRange*)rangesInOriginalString
+                      count:(size_t)count
+{
+  const Int n = sign_cast(count);
+  if (n == 0) return;
+  textFrameRef(*data).ranges(RangesInOriginalString{{rangesInOriginalString, n}},
+                             {outRanges, n});
+}
+
+- (void)getRanges:(STUTextFrameRange*)outRanges
+  forRangesInTruncatedString:(const NSRange*)rangesInTruncatedString
+                       count:(size_t)count
+{
+  const Int n = sign_cast(count);
+  if (n == 0) return;
+  textFrameRef(*data).ranges(RangesInTruncatedString{{rangesInTruncatedString, n}},
+                             {outRanges, n});
+}
+
 - (STUTextFrameRange)fullRange {
   return STUTextFrameGetRange(self);
 }
@@ -273,6 +514,15 @@ STUTextFrame* __nullable
   return NSRange(textFrameRef(*data).rangeInOriginalString(range));
 }
 
+- (void)getRangesInOriginalString:(NSRange*)outRanges
+                        forRanges:(const STUTextFrameRange*)ranges
+                            count:(size_t)count
+{
+  const Int n = sign_cast(count);
+  if (n == 0) return;
+  textFrameRef(*data).rangesInOriginalString({ranges, n}, {outRanges, n});
+}
+
 - (void)getRangeInOriginalString:(NSRange* __nullable)outRange
                  truncationToken:(NSAttributedString* __nullable __autoreleasing * __nullable)outToken
                     indexInToken:(NSUInteger* __nullable)outIndexInToken
@@ -323,7 +573,7 @@ STUTextFrame* __nullable
   STU_CHECK_MSG(ignoringTrailingWhitespace,
                 "Currently only ignoringTrailingWhitespace == true is supported.");
   ThreadLocalArenaAllocator::InitialBuffer<2048> buffer;
-  ThreadLocalArenaAllocator alloc{Ref{buffer}};
+  ThreadLocalArenaAllocatorScope alloc{Ref{buffer}};
 
   const TextFrame& tf = textFrameRef(self);
   return narrow_cast<STUTextFrameGraphemeClusterRange>(
@@ -341,7 +591,7 @@ STUTextFrame* __nullable
                               displayScale:(CGFloat)displayScale
 {
   ThreadLocalArenaAllocator::InitialBuffer<2048> buffer;
-  ThreadLocalArenaAllocator alloc{Ref{buffer}};
+  ThreadLocalArenaAllocatorScope alloc{Ref{buffer}};
 
   const TextFrame& tf = textFrameRef(self);
   const TempArray<TextLineSpan> spans = tf.lineSpans(range);
@@ -435,7 +685,7 @@ void stu_label::drawTextFrame(const STUTextFrame* NS_VALID_UNTIL_END_OF_SCOPE se
 {
   const TextFrame& textFrame = textFrameRef(self);
   ThreadLocalArenaAllocator::InitialBuffer<4096> buffer;
-  ThreadLocalArenaAllocator alloc{Ref{buffer}};
+  ThreadLocalArenaAllocatorScope alloc{Ref{buffer}};
   const Range<TextFrameCompactIndex> fullRange = textFrame.range();
   const auto options = stuOptions ? stuOptions->impl : Optional<const TextFrameDrawingOptions&>();
   if ((!options || !options->highlightStyle()) && range == fullRange) {
@@ -457,23 +707,24 @@ void stu_label::drawTextFrame(const STUTextFrame* NS_VALID_UNTIL_END_OF_SCOPE se
 
 // MARK: - Frame image bounds
 
-stu_label::Rect<CGFloat> STUTextFrameGetImageBoundsForRange(
-                const STUTextFrame* __unsafe_unretained self,
-                STUTextFrameRange range,
-                CGPoint origin, CGFloat displayScale,
-                const STUTextFrameDrawingOptions* __nullable  NS_VALID_UNTIL_END_OF_SCOPE stuOptions,
-                const STUCancellationFlag* __nullable cancellationFlag)
+static Rect<CGFloat> calculateImageBoundsForRange(
+                       const TextFrame& tf, STUTextFrameRange range,
+                       CGPoint origin, CGFloat displayScale,
+                       Optional<const TextFrameDrawingOptions&> options,
+                       const STUCancellationFlag* __nullable cancellationFlag)
 {
   ThreadLocalArenaAllocator::InitialBuffer<2048> buffer;
-  ThreadLocalArenaAllocator alloc{Ref{buffer}};
+  ThreadLocalArenaAllocatorScope alloc{Ref{buffer}};
 
-  const TextFrame& tf = textFrameRef(self);
   const Range<TextFrameCompactIndex> fullRange = tf.range();
-  const auto options = stuOptions ? stuOptions->impl : Optional<const TextFrameDrawingOptions&>();
-  const auto drawingMode = stuOptions ? options->drawingMode() : STUTextFrameDefaultDrawingMode;
+  const auto drawingMode = options ? options->drawingMode() : STUTextFrameDefaultDrawingMode;
 
   LocalFontInfoCache fontInfoCache;
-  LocalGlyphBoundsCache glyphBoundsCache;
+  Optional<LocalGlyphBoundsCache> localGlyphBoundsCache;
+  ThreadLocalFontCache* const threadLocalFontCache = ThreadLocalFontCache::instance();
+  LocalGlyphBoundsCache& glyphBoundsCache = threadLocalFontCache
+                                          ? threadLocalFontCache->glyphBoundsCache()
+                                          : localGlyphBoundsCache.emplace();
   ImageBoundsContext context = {
     .cancellationFlag = *(cancellationFlag ?: &CancellationFlag::neverCancelledFlag),
     .drawingMode =  drawingMode,
@@ -498,3 +749,42 @@ stu_label::Rect<CGFloat> STUTextFrameGetImageBoundsForRange(
   }
 }
 
+stu_label::Rect<CGFloat> STUTextFrameGetImageBoundsForRange(
+                const STUTextFrame* __unsafe_unretained self,
+                STUTextFrameRange range,
+                CGPoint origin, CGFloat displayScale,
+                const STUTextFrameDrawingOptions* __nullable  NS_VALID_UNTIL_END_OF_SCOPE stuOptions,
+                const STUCancellationFlag* __nullable cancellationFlag)
+{
+  const TextFrame& tf = textFrameRef(self);
+  const auto options = stuOptions ? stuOptions->impl : Optional<const TextFrameDrawingOptions&>();
+
+  // The drawing options object is mutable, so we key the cache on the option values that can
+  // affect the image bounds instead of on the object identity.
+  ImageBoundsCacheKey key{};
+  key.range = range;
+  key.origin = origin;
+  key.displayScale = displayScale;
+  if (options) {
+    key.drawingMode = options->drawingMode();
+    key.highlightStyle = options->highlightStyle().unretained;
+    if (key.highlightStyle) {
+      if (const Optional<STUTextFrameRange> highlightRange = options->highlightTextFrameRange()) {
+        key.hasHighlightTextFrameRange = true;
+        key.highlightTextFrameRange = *highlightRange;
+      } else {
+        key.highlightTextRange = options->highlightRange();
+      }
+    }
+  }
+  if (const Optional<Rect<CGFloat>> bounds = tf.cachedImageBounds(key)) {
+    return *bounds;
+  }
+  const Rect<CGFloat> bounds = calculateImageBoundsForRange(tf, range, origin, displayScale,
+                                                            options, cancellationFlag);
+  if (!cancellationFlag || !STUCancellationFlagGetValue(cancellationFlag)) {
+    tf.cacheImageBounds(key, bounds);
+  }
+  return bounds;
+}
+
@@ -0,0 +1,79 @@
+// Copyright 2017–2018 Stephan Tolksdorf
+
+#import "STUTextFrameAccessibilityElement.h"
+
+#import "Internal/Common.hpp"
+
+#if TARGET_OS_IPHONE
+
+namespace stu_label {
+
+struct TextFrameAccessibilityDataOptions {
+  /// The paragraphs are represented by separate elements if the text has more grapheme clusters
+  /// than this threshold.
+  size_t paragraphSeparationCharacterThreshold;
+  bool representUntruncatedText;
+  bool separateLinkElements;
+
+  STU_INLINE_T
+  friend bool operator==(const TextFrameAccessibilityDataOptions& lhs,
+                         const TextFrameAccessibilityDataOptions& rhs)
+  {
+    return lhs.paragraphSeparationCharacterThreshold == rhs.paragraphSeparationCharacterThreshold
+        && lhs.representUntruncatedText == rhs.representUntruncatedText
+        && lhs.separateLinkElements == rhs.separateLinkElements;
+  }
+  STU_INLINE_T
+  friend bool operator!=(const TextFrameAccessibilityDataOptions& lhs,
+                         const TextFrameAccessibilityDataOptions& rhs)
+  {
+    return !(lhs == rhs);
+  }
+};
+
+} // namespace stu_label
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// The thread-agnostic part of a @c STUTextFrameAccessibilityElement: the string ranges, bounds,
+/// paths, activation points and link values of the subelements.
+///
+/// The data is computed one segment (paragraph or full text) at a time and is not thread-safe.
+/// An instance may only be shared between threads after all its segments have been computed.
+@interface STUTextFrameAccessibilityData : NSObject
+- (instancetype)init NS_UNAVAILABLE;
+@end
+
+/// Computes the accessibility data for the full text frame. Can be called on any thread.
+STUTextFrameAccessibilityData*
+  STUTextFrameAccessibilityDataCreate(STUTextFrame* textFrame, CGFloat displayScale,
+                                      const stu_label::TextFrameAccessibilityDataOptions& options)
+  NS_RETURNS_RETAINED;
+
+/// Returns the data used by the element. This is the precomputed data passed to the initializer
+/// if it was compatible.
+STUTextFrameAccessibilityData* __nullable
+  STUTextFrameAccessibilityElementGetData(STUTextFrameAccessibilityElement* element);
+
+@interface STUTextFrameAccessibilityElement ()
+
+/// @param precomputedData
+///  Is only used if it was created for the same text frame, display scale and options.
+- (instancetype)initWithAccessibilityContainer:(STUView*)view
+                                     textFrame:(nullable STUTextFrame*)textFrame
+                        originInContainerSpace:(CGPoint)originInContainerSpace
+                                  displayScale:(CGFloat)displayScale
+                                       options:(const stu_label::TextFrameAccessibilityDataOptions&)
+                                                 options
+                               precomputedData:(nullable STUTextFrameAccessibilityData*)
+                                                 precomputedData
+                               isDraggableLink:(nullable STUTextLinkRangePredicate)isDraggableLink
+                         linkActivationHandler:(nullable STUTextLinkRangePredicate)
+                                                 linkActivationHandler
+  NS_DESIGNATED_INITIALIZER;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif
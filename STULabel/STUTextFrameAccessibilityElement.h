@@ -40,6 +40,10 @@ STU_REENABLE_CLANG_WARNING
 @property (readonly) bool separatesParagraphs;
 @property (readonly) bool separatesLinkElements;
 
+/// The subelements are created lazily. The index-based @c UIAccessibilityContainer methods only
+/// process the paragraphs up to the one containing the requested element and only create the
+/// requested subelement. The element count only requires the string ranges of all subelements.
+/// This property returns a lazy array whose elements are created when they are accessed.
 @property (readonly) NSArray<STUTextFrameAccessibilitySubelement *> *accessibilityElements;
 
 - (instancetype)init NS_UNAVAILABLE;
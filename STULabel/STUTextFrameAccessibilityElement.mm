@@ -1,7 +1,8 @@
 // Copyright 2017–2018 Stephan Tolksdorf
 
-#import "STUTextFrameAccessibilityElement.h"
+#import "STUTextFrameAccessibilityElement-Internal.hpp"
 
+#import "STULabel/STULabelLayoutInfo-Internal.hpp"
 #import "STULabel/STUTextLink-Internal.hpp"
 
 #import "Internal/CoreAnimationUtils.hpp"
@@ -14,16 +15,91 @@
 #if TARGET_OS_IPHONE
 using namespace stu_label;
 
+namespace stu_label {
+
+/// The thread-agnostic part of a STUTextFrameAccessibilitySubelement.
+struct AccessibilitySubelementData {
+  /// The link attribute value, if the link spans the full string range.
+  id __nullable linkValue;
+  STUTextAttachment* __nullable attachment;
+  /// The substring from which the accessibility label is lazily created if
+  /// labelSourceIsSubstring, the full attributed string otherwise.
+  NSAttributedString* labelSource;
+  /// Only set if hasGeometry.
+  RC<CGPath> path;
+  /// Only set if hasGeometry.
+  CGRect bounds;
+  /// Only set if hasGeometry.
+  CGPoint activationPoint;
+  Range<stu::UInt32> stringRange;
+  /// The number of rotor link elements directly following this text element.
+  stu::UInt32 rotorLinkCount;
+  bool labelSourceIsSubstring;
+  bool labelHasEmbeddedLinks;
+  bool isRotorLinkElement;
+  /// Indicates whether the path, bounds and activation point have been computed. Counting the
+  /// elements doesn't require the geometry, so it is computed separately for each element.
+  bool hasGeometry;
+  /// Indicates whether the element is a full-range link whose activation point may be used as the
+  /// drag source point. Only set if hasGeometry.
+  bool mayBeDraggable;
+};
+
+} // namespace stu_label
+
+template <> struct stu::IsBitwiseMovable<stu_label::AccessibilitySubelementData> : stu::True {};
+
+@interface STUTextFrameAccessibilityData () {
+@package
+  STUTextFrame* _textFrame;
+  NSAttributedString* _attributedString;
+  CGFloat _displayScale;
+  TextFrameAccessibilityDataOptions _options;
+  bool _separatesParagraphs;
+  bool _separatesLinkElements;
+  /// A segment is a paragraph if the paragraphs are separated and the full text otherwise.
+  Int32 _segmentCount;
+  Int32 _computedSegmentCount;
+  /// The number of elements whose geometry has been computed.
+  Int32 _elementGeometryCount;
+  /// Allocated with malloc. Freed once the geometry of all elements has been computed.
+  TextLineVerticalPosition* _verticalPositions;
+  Vector<AccessibilitySubelementData> _elements;
+}
+- (instancetype)initWithTextFrame:(STUTextFrame*)textFrame
+                     displayScale:(CGFloat)displayScale
+                          options:(const TextFrameAccessibilityDataOptions&)options
+  NS_DESIGNATED_INITIALIZER;
+@end
+
 @class STUTextFrameAccessibilitySubelement;
 
+/// A lazy array of the subelements of a @c STUTextFrameAccessibilityElement. A subelement is only
+/// created when it is accessed.
+@interface STUTextFrameAccessibilitySubelementArray : NSArray {
+@package // fileprivate
+  STUTextFrameAccessibilityElement* __unsafe_unretained _textFrameElement;
+}
+- (instancetype)initWithTextFrameElement:(STUTextFrameAccessibilityElement*)textFrameElement
+  NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+@end
+
 @interface STUTextFrameAccessibilityElement() {
 @package // fileprivatef
   STUView* __weak _accessibilityContainer;
   CGRect _frame;
   __nullable STUTextLinkRangePredicate _linkActivationHandler;
 @private
-  CGFloat _displayScale;
-  NSArray<STUTextFrameAccessibilitySubelement*>* _elements;
+  /// Data created by this element is computed lazily and only used by this element. Precomputed
+  /// data already has all segments and element geometries computed, so it isn't modified by this
+  /// element.
+  STUTextFrameAccessibilityData* _data;
+  __nullable STUTextLinkRangePredicate _isDraggableLink;
+  /// The subelements are created lazily, one at a time. Elements that haven't been created yet
+  /// are represented by NSNull.
+  NSMutableArray* _elements;
+  STUTextFrameAccessibilitySubelementArray* _elementArray;
   bool _isAccessibilityElement;
   bool _representsUntruncatedText;
   bool _separatesParagraphs;
@@ -31,29 +107,11 @@ using namespace stu_label;
 }
 @end
 
-namespace stu_label {
-  struct InitParams {
-    const STUTextFrameAccessibilityElement* textFrameAccessibilityElement;
-    const TextFrame& textFrame;
-    NSAttributedString* attributedString;
-    NSStringRef string;
-    bool isTruncatedString;
-    bool separateParagraphs;
-    bool separateLinkElements;
-    TextFrameScaleAndDisplayScale scaleFactors;
-    ArrayRef<const TextLineVerticalPosition> verticalPositions;
-    Point<CGFloat> textFrameOrigin;
-    __nullable STUTextLinkRangePredicate isDraggableLink;
-  };
-}
-
 @interface STUTextFrameAccessibilitySubelement : STUAccessibilityElement
-- (instancetype)initWithParams:(const InitParams&)params
-                   stringRange:(NSRange)stringRange
-    mutableAttributedSubstring:(nullable NSMutableAttributedString*)mutableAttributedSubstring
-                     linkCount:(UInt)linkCount
-                 fullRangeLink:(nullable id)linkValue
-           fullRangeAttachment:(nullable STUTextAttachment*)attachment
+- (instancetype)initWithContainer:(STUTextFrameAccessibilityElement*)container
+                             data:(const AccessibilitySubelementData&)data
+                isTruncatedString:(bool)isTruncatedString
+                  isDraggableLink:(nullable STUTextLinkRangePredicate)isDraggableLink
   NS_DESIGNATED_INITIALIZER;
 
 @property (nonatomic) CGRect accessibilityFrameInContainerSpace;
@@ -68,6 +126,8 @@ namespace stu_label {
 @private
   UILabel* _uiLabel;
   id _accessibilityLabel;
+  /// The attributed string from which the accessibility label is lazily created.
+  NSAttributedString* _labelSource;
   id _linkValue;
   CGPathRef _path;
   UIAccessibilityTraits _accessibilityTraits;
@@ -75,6 +135,9 @@ namespace stu_label {
   Range<stu::UInt32> _stringRange;
   STUTextRangeType _stringRangeType;
   bool _accessibilityLabelIsAttributed;
+  bool _labelIsPending;
+  bool _labelSourceIsSubstring;
+  bool _labelHasEmbeddedLinks;
   bool _isDraggable;
 @protected
   bool _isAccessibilityElement;
@@ -180,49 +243,107 @@ namespace stu_label {
 }
 
 - (nullable NSString*)accessibilityLabel {
+  if (_labelIsPending) {
+    [self createPendingAccessibilityLabel];
+  }
   return !_accessibilityLabel || !_accessibilityLabelIsAttributed
        ? _accessibilityLabel
        : static_cast<NSAttributedString*>(_accessibilityLabel).string;
 }
 - (nullable NSAttributedString*)accessibilityAttributedLabel {
+  if (_labelIsPending) {
+    [self createPendingAccessibilityLabel];
+  }
   return !_accessibilityLabel || _accessibilityLabelIsAttributed
        ? _accessibilityLabel
        : [[NSAttributedString alloc] initWithString:_accessibilityLabel];
 }
 - (void)setAccessibilityLabel:(NSString*)accessibilityLabel {
+  _labelIsPending = false;
+  _labelSource = nil;
   _accessibilityLabelIsAttributed = false;
   _accessibilityLabel = accessibilityLabel;
 }
 - (void)setAccessibilityAttributedLabel:(NSAttributedString*)accessibilityAttributedLabel {
+  _labelIsPending = false;
+  _labelSource = nil;
   _accessibilityLabelIsAttributed = true;
   _accessibilityLabel = accessibilityAttributedLabel;
 }
 
-struct ActivationPoint {
-  Float64 x;
-  int32_t lineIndex;
-  bool isTruncationToken;
-};
+- (nullable NSString*)accessibilityLanguage {
+  if (_labelIsPending) {
+    [self createPendingAccessibilityLabel];
+  }
+  return [super accessibilityLanguage];
+}
+- (void)setAccessibilityLanguage:(nullable NSString*)accessibilityLanguage {
+  // The pending label may set the language, which must not override the value set here.
+  if (_labelIsPending) {
+    [self createPendingAccessibilityLabel];
+  }
+  [super setAccessibilityLanguage:accessibilityLanguage];
+}
 
-/// Returns an activation point outside the layout bounds of any truncation token, if possible.
-/// @pre !spans.isEmpty()
-static ActivationPoint findActivationPoint(const ArrayRef<const TextLineSpan> spans,
-                                           const ArrayRef<const TextFrameLine> lines)
-{
-  for (const TextLineSpan& span : spans) {
-    const TextFrameLine& line = lines[span.lineIndex];
-    const auto tokenX = line.origin().x + line.tokenXRange();
-    Range<Float64> x = span.x;
-    if (span.x.start < tokenX.start) {
-      x.end = min(x.end, tokenX.start);
-    } else if (x.end > tokenX.end) {
-      x.start = max(x.start, tokenX.end);
+/// Creating the label can be relatively expensive, particularly if the text contains links, and
+/// VoiceOver usually only needs the labels of a few elements, so we only do it on demand.
+- (void)createPendingAccessibilityLabel {
+  STU_DEBUG_ASSERT(_labelIsPending);
+  _labelIsPending = false;
+  NSAttributedString* const source = _labelSource;
+  _labelSource = nil;
+  const NSRange stringRange = _stringRange;
+  const id fullRangeLinkValue = _linkValue;
+
+  // The substring may be shared with other elements created from the same data, so we must not
+  // mutate it.
+  NSAttributedString* label = _labelSourceIsSubstring ? source
+                            : [source attributedSubstringFromRange:stringRange];
+  if (fullRangeLinkValue || NSFoundationVersionNumber <= NSFoundationVersionNumber_iOS_9_x_Max) {
+    NSMutableAttributedString* const mutableLabel = [label mutableCopy];
+    [mutableLabel removeAttribute:NSLinkAttributeName range:NSRange{0, stringRange.length}];
+    label = mutableLabel;
+  }
+  label = [[label stu_attributedStringByReplacingSTUAttachmentsWithStringRepresentations] copy];
+  { // Copy UIAccessibilitySpeechAttributeLanguage attribute to accessibilityLanguage property
+    // if the attribute is effective over the full string range.
+    const NSUInteger labelLength = label.length;
+    NSRange effectiveRange;
+    NSString* const language = [label attribute:UIAccessibilitySpeechAttributeLanguage
+                                        atIndex:0 longestEffectiveRange:&effectiveRange
+                                        inRange:NSRange{0, labelLength}];
+    if (language && effectiveRange == NSRange{0, labelLength}) {
+      [super setAccessibilityLanguage:language];
+    }
+  }
+  if (_labelHasEmbeddedLinks && !fullRangeLinkValue && !TARGET_OS_SIMULATOR) {
+    // We want VoiceOver to announce the presence of links when reading text, like it does for
+    // UILabel and UITextView. Unfortunately, UIAccessibility doesn't do this for normal
+    // accessibilityAttributedLabel values with NSLinkAttributeName attributes and there's no
+    // other public API for this purpose. To work around this limitation we let an UILabel
+    // create the appropriately attributed accessibility label for us.
+
+    // In iOS 11.3, -[UILabelAccessibility _accessibilityLabel:] started to aggressively cache the
+    // accessibility label by unretained pointer address of the UILabel instance, which forces us
+    // to create fresh UILabel instances for every accessibility element with embedded links and
+    // to keep the instance alive for the lifetime of the element. We don't do this on the
+    // simulator to conserve resources in automated UI tests.
+    _uiLabel = [[UILabel alloc] init];
+    _uiLabel.attributedText = label;
+    if (@available(iOS 11, tvOS 11, *)) {
+      _accessibilityLabelIsAttributed = true;
+      _accessibilityLabel = _uiLabel.accessibilityAttributedLabel;
     } else {
-      continue;
+      _accessibilityLabel = _uiLabel.accessibilityLabel;
+    }
+  } else {
+    if (@available(iOS 11, tvOS 11, *)) {
+      _accessibilityLabelIsAttributed = true;
+      _accessibilityLabel = label;
+    } else {
+      _accessibilityLabel = label.string;
     }
-    return {x.center(), sign_cast(span.lineIndex), false};
   }
-  return {spans[0].x.center(), sign_cast(spans[0].lineIndex), true};
 }
 
 - (instancetype)init {
@@ -230,120 +351,39 @@ static ActivationPoint findActivationPoint(const ArrayRef<const TextLineSpan> sp
   __builtin_trap();
 }
 
-- (instancetype)initWithParams:(const InitParams&)params
-                   stringRange:(NSRange)stringRange
-    mutableAttributedSubstring:(nullable NSMutableAttributedString* __unsafe_unretained)
-                                 mutableAttributedSubstring
-                     linkCount:(UInt)linkCount
-                 fullRangeLink:(nullable __unsafe_unretained id)fullRangeLinkValue
-           fullRangeAttachment:(nullable STUTextAttachment* __unsafe_unretained)attachment
+- (instancetype)initWithContainer:(STUTextFrameAccessibilityElement* __unsafe_unretained)container
+                             data:(const AccessibilitySubelementData&)data
+                isTruncatedString:(bool)isTruncatedString
+                  isDraggableLink:(nullable __unsafe_unretained STUTextLinkRangePredicate)
+                                    isDraggableLink
 {
-  // Strip any trailing whitespace ending with a line terminator (to prevent Voice Over from saying
-  // "new line".)
-  if (stringRange.length != 0) {
-    Range<Int> r = sign_cast(Range{stringRange});
-    if (isLineTerminator(params.string[r.end - 1])) {
-      r.end = params.string.indexOfEndOfLastCodePointWhere(r, isNotIgnorableAndNotWhitespace);
-      stringRange.length = sign_cast(r.end) - stringRange.location;
-    }
-  }
-  if (stringRange.length == 0) return nil;
-  const TextFrame& tf = params.textFrame;
-  const Range<TextFrameIndex> range = params.isTruncatedString
-                                    ? tf.range(RangeInTruncatedString{stringRange})
-                                    : tf.range(RangeInOriginalString{stringRange});
-  TempArray<TextLineSpan> spans = tf.lineSpans(range);
-  if (spans.isEmpty()) return nil;
-  self = [super initWithAccessibilityContainer:params.textFrameAccessibilityElement];
+  self = [super initWithAccessibilityContainer:container];
   if (!self) return self;
-  _textFrameElement = params.textFrameAccessibilityElement;
-  _linkValue = fullRangeLinkValue;
-  _stringRange = narrow_cast<Range<stu::UInt32>>(stringRange);
-  _stringRangeType = params.isTruncatedString ? STURangeInTruncatedString
-                                              : STURangeInOriginalString;
-
-  const auto lines = tf.lines();
-
-  ActivationPoint ap = findActivationPoint(spans, lines);
-  ap.x *= tf.textScaleFactor;
-
-  _activationPoint = CGPoint{narrow_cast<CGFloat>(ap.x),
-                             narrow_cast<CGFloat>(params.verticalPositions[ap.lineIndex]
-                                                  .y().center())};
-  STU_DISABLE_LOOP_UNROLL
-  for (auto& span : spans) {
-    span.x *= tf.textScaleFactor;
-  }
-  const TextLineSpansPathBounds bounds = calculateTextLineSpansPathBounds(spans,
-                                                                          params.verticalPositions);
-  _boundsInTextFrame = narrow_cast<CGRect>(bounds.rect);
-
-  if (bounds.pathExtendedToCommonHorizontalTextLineBoundsIsRect == false) {
-    CGPath* const path = CGPathCreateMutable();
-    _path = path;
-    addLineSpansPath(*path, spans, params.verticalPositions, ShouldFillTextLineGaps{true},
-                     ShouldExtendTextLinesToCommonHorizontalBounds{true});
+  _textFrameElement = container;
+  _linkValue = data.linkValue;
+  _stringRange = data.stringRange;
+  _stringRangeType = isTruncatedString ? STURangeInTruncatedString : STURangeInOriginalString;
+  _activationPoint = data.activationPoint;
+  _boundsInTextFrame = data.bounds;
+  if (data.path) {
+    _path = CGPathRetain(data.path.get());
   }
-
-  if (!attachment){
+  STUTextAttachment* __unsafe_unretained const attachment = data.attachment;
+  if (!attachment) {
     _accessibilityTraits = UIAccessibilityTraitStaticText;
-    if (fullRangeLinkValue) {
+    if (_linkValue) {
       _accessibilityTraits |= UIAccessibilityTraitLink;
     }
-    NSAttributedString* label = mutableAttributedSubstring
-                                ?: [params.attributedString attributedSubstringFromRange:stringRange];
-    if (fullRangeLinkValue || NSFoundationVersionNumber <= NSFoundationVersionNumber_iOS_9_x_Max) {
-      NSMutableAttributedString* const mutableLabel = mutableAttributedSubstring
-                                                      ?: [label mutableCopy];
-      [mutableLabel removeAttribute:NSLinkAttributeName range:NSRange{0, stringRange.length}];
-      label = mutableLabel;
-    }
-    label = [[label stu_attributedStringByReplacingSTUAttachmentsWithStringRepresentations] copy];
-    { // Copy UIAccessibilitySpeechAttributeLanguage attribute to accessibilityLanguage property
-      // if the attribute is effective over the full string range.
-      const NSUInteger labelLength = label.length;
-      NSRange effectiveRange;
-      NSString* const language = [label attribute:UIAccessibilitySpeechAttributeLanguage
-                                          atIndex:0 longestEffectiveRange:&effectiveRange
-                                          inRange:NSRange{0, labelLength}];
-      if (language && effectiveRange == NSRange{0, labelLength}) {
-        self.accessibilityLanguage = language;
-      }
-    }
-    if (linkCount > 0 && !fullRangeLinkValue && !TARGET_OS_SIMULATOR) {
-      // We want VoiceOver to announce the presence of links when reading text, like it does for
-      // UILabel and UITextView. Unfortunately, UIAccessibility doesn't do this for normal
-      // accessibilityAttributedLabel values with NSLinkAttributeName attributes and there's no
-      // other public API for this purpose. To work around this limitation we let an UILabel
-      // create the appropriately attributed accessibility label for us.
-
-      // In iOS 11.3, -[UILabelAccessibility _accessibilityLabel:] started to aggressively cache the
-      // accessibility label by unretained pointer address of the UILabel instance, which forces us
-      // to create fresh UILabel instances for every accessibility element with embedded links and
-      // to keep the instance alive for the lifetime of the element. We don't do this on the
-      // simulator to conserve resources in automated UI tests.
-      _uiLabel = [[UILabel alloc] init];
-      _uiLabel.attributedText = label;
-      if (@available(iOS 11, tvOS 11, *)) {
-        _accessibilityLabelIsAttributed = true;
-        _accessibilityLabel = _uiLabel.accessibilityAttributedLabel;
-      } else {
-        _accessibilityLabel = _uiLabel.accessibilityLabel;
-      }
-    } else {
-      if (@available(iOS 11, tvOS 11, *)) {
-        _accessibilityLabelIsAttributed = true;
-        _accessibilityLabel = label;
-      } else {
-        _accessibilityLabel = label.string;
-      }
-    }
+    _labelIsPending = true;
+    _labelSourceIsSubstring = data.labelSourceIsSubstring;
+    _labelSource = data.labelSource;
+    _labelHasEmbeddedLinks = data.labelHasEmbeddedLinks;
   } else { // attachment
     UIAccessibilityTraits traits = attachment.accessibilityTraits;
     if (!(traits & (UIAccessibilityTraitStaticText | UIAccessibilityTraitButton))) {
       traits |= UIAccessibilityTraitImage;
     }
-    if (fullRangeLinkValue && !(traits & UIAccessibilityTraitButton)) {
+    if (_linkValue && !(traits & UIAccessibilityTraitButton)) {
       traits |= UIAccessibilityTraitLink;
     }
     _accessibilityTraits = traits;
@@ -370,23 +410,17 @@ static ActivationPoint findActivationPoint(const ArrayRef<const TextLineSpan> sp
       }
     }
     if (NSString* const language = attachment.accessibilityLanguage
-                                   ?: [params.attributedString
+                                   ?: [data.labelSource
                                         attribute:UIAccessibilitySpeechAttributeLanguage
-                                         atIndex:stringRange.location effectiveRange:nil])
+                                         atIndex:_stringRange.start effectiveRange:nil])
     {
       self.accessibilityLanguage = language;
     }
   }
-  if (params.isDraggableLink
-      && fullRangeLinkValue
-      && (!ap.isTruncationToken
-          || [fullRangeLinkValue isEqual: [tf.attributesAt(range.start)
-                                             objectForKey:NSLinkAttributeName]])
-      && params.isDraggableLink(STUTextRange{stringRange,
-                                             params.isTruncatedString ? STURangeInTruncatedString
-                                                                      : STURangeInOriginalString},
-                                fullRangeLinkValue,
-                                _activationPoint + params.textFrameOrigin))
+  if (isDraggableLink
+      && data.mayBeDraggable
+      && isDraggableLink(STUTextRange{_stringRange, _stringRangeType}, _linkValue,
+                         _activationPoint + container->_frame.origin))
   {
     _isDraggable = true;
   }
@@ -399,20 +433,14 @@ static ActivationPoint findActivationPoint(const ArrayRef<const TextLineSpan> sp
 @end
 @implementation STUTextFrameAccessibilityRotorLinkElement
 
-- (instancetype)initWithParams:(const InitParams&)params
-                   stringRange:(NSRange)stringRange
-    mutableAttributedSubstring:(nullable NSMutableAttributedString* __unsafe_unretained)
-                                 mutableAttributedSubstring
-                     linkCount:(UInt)linkCount
-                 fullRangeLink:(nullable __unsafe_unretained id)linkValue
-           fullRangeAttachment:(nullable STUTextAttachment* __unsafe_unretained)attachment
+- (instancetype)initWithContainer:(STUTextFrameAccessibilityElement* __unsafe_unretained)container
+                             data:(const AccessibilitySubelementData&)data
+                isTruncatedString:(bool)isTruncatedString
+                  isDraggableLink:(nullable __unsafe_unretained STUTextLinkRangePredicate)
+                                    isDraggableLink
 {
-  if ((self = [super initWithParams:params
-                        stringRange:stringRange
-         mutableAttributedSubstring:mutableAttributedSubstring
-                          linkCount:(UInt)linkCount
-                      fullRangeLink:linkValue
-                fullRangeAttachment:attachment]))
+  if ((self = [super initWithContainer:container data:data isTruncatedString:isTruncatedString
+                       isDraggableLink:isDraggableLink]))
   {
     _isAccessibilityElement = false;
   }
@@ -482,152 +510,145 @@ static UIAccessibilityCustomRotor* createLinkRotorForAccessibilityContainer(
   }
 }
 
+// MARK: - Thread-agnostic accessibility data
 
-
-@implementation STUTextFrameAccessibilityElement
-
-- (instancetype)init {
-  [self doesNotRecognizeSelector:_cmd];
-  __builtin_trap();
+namespace stu_label {
+  struct AccessibilityDataParams {
+    const TextFrame& textFrame;
+    NSAttributedString* attributedString;
+    NSStringRef string;
+    bool isTruncatedString;
+    bool separateLinkElements;
+    ArrayRef<const TextLineVerticalPosition> verticalPositions;
+  };
 }
 
-- (instancetype)initWithAccessibilityContainer:(STUView*)view
-                                     textFrame:(NS_VALID_UNTIL_END_OF_SCOPE STUTextFrame*)textFrame
-                        originInContainerSpace:(CGPoint)originInContainerSpace
-                                  displayScale:(CGFloat)displayScale
-                      representUntruncatedText:(bool)representUntruncatedText
-                            separateParagraphs:(bool)separateParagraphs
-                          separateLinkElements:(bool)separateLinkElements
-                               isDraggableLink:(__nullable STUTextLinkRangePredicate)isDraggableLink
-                         linkActivationHandler:(__nullable STUTextLinkRangePredicate)
-                                                 linkActivationHandler
+struct ActivationPoint {
+  Float64 x;
+  int32_t lineIndex;
+  bool isTruncationToken;
+};
+
+/// Returns an activation point outside the layout bounds of any truncation token, if possible.
+/// @pre !spans.isEmpty()
+static ActivationPoint findActivationPoint(const ArrayRef<const TextLineSpan> spans,
+                                           const ArrayRef<const TextFrameLine> lines)
 {
-  STU_CHECK(is_main_thread());
-  self = [super initWithAccessibilityContainer:view];
-  if (!self) return self;
-  _accessibilityContainer = view;
-  _isAccessibilityElement = false; // Since this element has subelements.
-  _frame = CGRect{clampPointInput(originInContainerSpace), CGSize{}};
-  _linkActivationHandler = linkActivationHandler;
-  _displayScale = clampDisplayScaleInput(displayScale);
-  _representsUntruncatedText = representUntruncatedText;
-  _separatesParagraphs = separateParagraphs;
-  _separatesLinkElements = separateLinkElements;
-  if (NSFoundationVersionNumber <= NSFoundationVersionNumber_iOS_9_x_Max) {
-    separateLinkElements = true; // There's no way to provide a custom link rotor on iOS 9.
-  }
-  if (!textFrame) {
-    _elements = @[];
-    return self;
-  }
-  ThreadLocalArenaAllocator::InitialBuffer<4096> buffer;
-  ThreadLocalArenaAllocator alloc{Ref{buffer}};
-  const TextFrame& tf = textFrameRef(textFrame);
-  const auto scaleFactors = TextFrameScaleAndDisplayScale{tf, displayScale};
-  const auto lines = tf.lines();
-  TempArray<TextLineVerticalPosition> verticalPositions{uninitialized, Count{lines.count()}, alloc};
-  for (Int i = 0; i < lines.count(); ++i) {
-    const TextFrameLine& line = lines[i];
-    TextLineVerticalPosition vp = textLineVerticalPosition(line, scaleFactors.displayScale);
-    vp.scale(scaleFactors.textFrameScale);
-    verticalPositions[i] = vp;
-  }
-  NSAttributedString* __unsafe_unretained const attributedString =
-    representUntruncatedText ? tf.originalAttributedString
-                             : tf.truncatedAttributedString().unretained;
-  if (@available(iOS 11, *)) {
-  } else {
-    isDraggableLink = nil;
-  }
-  const InitParams params = {
-    .textFrameAccessibilityElement = self,
-    .textFrame = tf,
-    .attributedString = attributedString,
-    .string = NSStringRef{attributedString.string},
-    .isTruncatedString = !representUntruncatedText,
-    .separateParagraphs = separateParagraphs,
-    .separateLinkElements = separateLinkElements,
-    .scaleFactors = scaleFactors,
-    .verticalPositions = verticalPositions,
-    .textFrameOrigin = originInContainerSpace,
-    .isDraggableLink = isDraggableLink
-  };
-  NSMutableArray<STUTextFrameAccessibilitySubelement*>* const elements = [[NSMutableArray alloc]
-                                                                            init];
-  if (!separateParagraphs) {
-    const Range<Int> fullRange = representUntruncatedText ? tf.rangeInOriginalString()
-                                                          : tf.rangeInTruncatedString();
-    addAccessibilityElementsForRange(params, Range<UInt>{fullRange}, elements);
-  } else {
-    for (const TextFrameParagraph& para : tf.paragraphs()) {
-      const Range<Int> range = representUntruncatedText ? para.rangeInOriginalString
-                                                        : para.rangeInTruncatedString;
-      addAccessibilityElementsForRange(params, Range<UInt>{range}, elements);
+  for (const TextLineSpan& span : spans) {
+    const TextFrameLine& line = lines[span.lineIndex];
+    const auto tokenX = line.origin().x + line.tokenXRange();
+    Range<Float64> x = span.x;
+    if (span.x.start < tokenX.start) {
+      x.end = min(x.end, tokenX.start);
+    } else if (x.end > tokenX.end) {
+      x.start = max(x.start, tokenX.end);
+    } else {
+      continue;
     }
+    return {x.center(), sign_cast(span.lineIndex), false};
   }
-  stu_label::Rect<CGFloat> bounds = {};
-  for (STUTextFrameAccessibilitySubelement* const subelement in elements) {
-    bounds = bounds.convexHull(subelement.accessibilityFrameInContainerSpace);
-  }
-  _frame.size = CGSize{bounds.x.end, bounds.y.end};
-  _elements = [elements copy];
-  return self;
+  return {spans[0].x.center(), sign_cast(spans[0].lineIndex), true};
 }
 
-- (void)dealloc {
-  for (STUTextFrameAccessibilitySubelement* e in self->_elements) {
-    e->_textFrameElement = nil;
-  }
+static Range<TextFrameIndex> textFrameRange(const AccessibilityDataParams& params,
+                                            const NSRange stringRange)
+{
+  const TextFrame& tf = params.textFrame;
+  return params.isTruncatedString ? tf.range(RangeInTruncatedString{stringRange})
+                                  : tf.range(RangeInOriginalString{stringRange});
 }
 
-- (STUView*)accessibilityContainer {
-  return _accessibilityContainer;
-}
-- (void)setAccessibilityContainer:(nullable id)accessibilityContainer {
-  STU_CHECK_MSG(accessibilityContainer == nil || [accessibilityContainer isKindOfClass:STUView.class],
-                "The accessibilityContainer of a STUTextFrameAccessibilityElement must be a STUView");
-  _accessibilityContainer = accessibilityContainer;
-  [super setAccessibilityContainer:accessibilityContainer];
+/// Returns none if the string range contains no visible text (after trimming trailing whitespace
+/// ending with a line terminator).
+///
+/// Doesn't compute the geometry of the element, see `computeSubelementGeometry`.
+static Optional<AccessibilitySubelementData> subelementData(
+  const AccessibilityDataParams& params,
+  NSRange stringRange,
+  NSAttributedString* __unsafe_unretained __nullable attributedSubstring,
+  UInt linkCount,
+  __unsafe_unretained __nullable id fullRangeLinkValue,
+  STUTextAttachment* __unsafe_unretained __nullable attachment)
+{
+  // Strip any trailing whitespace ending with a line terminator (to prevent Voice Over from saying
+  // "new line".)
+  if (stringRange.length != 0) {
+    Range<Int> r = sign_cast(Range{stringRange});
+    if (isLineTerminator(params.string[r.end - 1])) {
+      r.end = params.string.indexOfEndOfLastCodePointWhere(r, isNotIgnorableAndNotWhitespace);
+      stringRange.length = sign_cast(r.end) - stringRange.location;
+    }
+  }
+  if (stringRange.length == 0) return none;
+  if (params.textFrame.lineSpans(textFrameRange(params, stringRange)).isEmpty()) return none;
+  return AccessibilitySubelementData{
+    .linkValue = fullRangeLinkValue,
+    .attachment = attachment,
+    .labelSource = attributedSubstring ?: params.attributedString,
+    .stringRange = narrow_cast<Range<stu::UInt32>>(stringRange),
+    .rotorLinkCount = 0,
+    .labelSourceIsSubstring = attributedSubstring != nil,
+    .labelHasEmbeddedLinks = linkCount > 0,
+    .isRotorLinkElement = false,
+    .hasGeometry = false
+  };
 }
 
-- (BOOL)isAccessibilityElement {
-  return _isAccessibilityElement;
-}
-- (void)setIsAccessibilityElement:(BOOL)isAccessibilityElement {
-  _isAccessibilityElement = isAccessibilityElement;
-}
+/// Computes the path, bounds and activation point of the element.
+/// @pre !data.hasGeometry && !params.verticalPositions.isEmpty()
+static void computeSubelementGeometry(const AccessibilityDataParams& params,
+                                      AccessibilitySubelementData& data)
+{
+  STU_DEBUG_ASSERT(!data.hasGeometry);
+  const TextFrame& tf = params.textFrame;
+  const Range<TextFrameIndex> range = textFrameRange(params, NSRange(data.stringRange));
+  TempArray<TextLineSpan> spans = tf.lineSpans(range);
+  STU_ASSERT(!spans.isEmpty());
 
-- (NSArray<STUTextFrameAccessibilitySubelement*>*)accessibilityElements {
-  return _elements;
-}
-- (void)setAccessibilityElements:(NSArray*)elements {
-  if (elements == _elements) return;
-  [self doesNotRecognizeSelector:_cmd];
-  __builtin_trap();
-}
+  const auto lines = tf.lines();
 
-@synthesize accessibilityFrameInContainerSpace = _frame;
+  ActivationPoint ap = findActivationPoint(spans, lines);
+  ap.x *= tf.textScaleFactor;
 
-- (CGPoint)textFrameOriginInContainerSpace {
-  return _frame.origin;
-}
-- (void)setTextFrameOriginInContainerSpace:(CGPoint)origin {
-  _frame.origin = origin;
+  STU_DISABLE_LOOP_UNROLL
+  for (auto& span : spans) {
+    span.x *= tf.textScaleFactor;
+  }
+  const TextLineSpansPathBounds bounds = calculateTextLineSpansPathBounds(spans,
+                                                                          params.verticalPositions);
+  RC<CGPath> path;
+  if (bounds.pathExtendedToCommonHorizontalTextLineBoundsIsRect == false) {
+    path = RC<CGPath>{CGPathCreateMutable(), ShouldIncrementRefCount{false}};
+    addLineSpansPath(*path.get(), spans, params.verticalPositions, ShouldFillTextLineGaps{true},
+                     ShouldExtendTextLinesToCommonHorizontalBounds{true});
+  }
+  const id fullRangeLinkValue = data.linkValue;
+  data.path = std::move(path);
+  data.bounds = narrow_cast<CGRect>(bounds.rect);
+  data.activationPoint = CGPoint{narrow_cast<CGFloat>(ap.x),
+                                 narrow_cast<CGFloat>(params.verticalPositions[ap.lineIndex]
+                                                      .y().center())};
+  data.mayBeDraggable = fullRangeLinkValue
+                        && (!ap.isTruncationToken
+                            || [fullRangeLinkValue isEqual:[tf.attributesAt(range.start)
+                                                              objectForKey:NSLinkAttributeName]]);
+  data.hasGeometry = true;
 }
 
-- (CGRect)accessibilityFrame {
-  STUView* const view = _accessibilityContainer;
-  return !view ? _frame : UIAccessibilityConvertFrameToScreenCoordinates(_frame, view);
-}
-- (void)setAccessibilityFrame:(CGRect __unused)frame {
-  [self doesNotRecognizeSelector:_cmd];
-  __builtin_trap();
+static void appendSubelementData(const AccessibilityDataParams& params,
+                                 NSRange stringRange,
+                                 UInt linkCount,
+                                 __unsafe_unretained __nullable id fullRangeLinkValue,
+                                 STUTextAttachment* __unsafe_unretained __nullable attachment,
+                                 Vector<AccessibilitySubelementData>& elements)
+{
+  if (auto data = subelementData(params, stringRange, nil, linkCount, fullRangeLinkValue,
+                                 attachment))
+  {
+    elements.append(std::move(*data));
+  }
 }
 
-- (bool)representsUntruncatedText { return _representsUntruncatedText; }
-- (bool)separatesParagraphs { return _separatesParagraphs; }
-- (bool)separatesLinkElements { return _separatesLinkElements; }
-
 static NSRange trimStringRange(const NSStringRef& string, const NSRange nsRange) {
   Range<Int> range{nsRange};
   range.start = string.indexOfFirstCodePointWhere(range, isNotIgnorableAndNotWhitespace);
@@ -638,10 +659,9 @@ static NSRange trimStringRange(const NSStringRef& string, const NSRange nsRange)
 }
 
 STU_NO_INLINE
-static void addElementsForRangeThatMayContainLinks(
-              const InitParams& params,
-              const NSRange stringRange,
-              NSMutableArray<STUTextFrameAccessibilitySubelement*>* __unsafe_unretained const array)
+static void addElementsForRangeThatMayContainLinks(const AccessibilityDataParams& params,
+                                                   const NSRange stringRange,
+                                                   Vector<AccessibilitySubelementData>& elements)
 {
   {
     const NSRange trimmedStringRange = trimStringRange(params.string, stringRange);
@@ -651,40 +671,25 @@ static void addElementsForRangeThatMayContainLinks(
                                                     atIndex:trimmedStringRange.location
                                       longestEffectiveRange:&firstRange inRange:trimmedStringRange];
     if (firstRange == trimmedStringRange) {
-      if (auto* const e = [[STUTextFrameAccessibilitySubelement alloc]
-                             initWithParams:params
-                               stringRange:linkValue ? trimmedStringRange : stringRange
-                mutableAttributedSubstring:nil
-                                 linkCount:linkValue ? 1 : 0
-                             fullRangeLink:linkValue
-                       fullRangeAttachment:nil])
-      {
-        [array addObject:e];
-      }
+      appendSubelementData(params, linkValue ? trimmedStringRange : stringRange,
+                           linkValue ? 1 : 0, linkValue, nil, elements);
       return;
     }
   }
 
   const bool createRotorLinks = NSFoundationVersionNumber > NSFoundationVersionNumber_iOS_9_x_Max;
 
-  const UInt index = array.count;
+  const Int index = elements.count();
   NSMutableAttributedString* __block mutableSubtring = nil;
+  Vector<AccessibilitySubelementData>* const elementsPointer = &elements;
   [params.attributedString enumerateAttribute:NSLinkAttributeName inRange:stringRange
                                       options:0 // We need the longest effective range.
                                    usingBlock:^(id linkValue, NSRange linkRange, BOOL*)
   {
     if (!linkValue) return;
-    if (STUTextFrameAccessibilitySubelement* const linkElement =
-          [[(createRotorLinks ? STUTextFrameAccessibilityRotorLinkElement.class
-                              : STUTextFrameAccessibilitySubelement.class) alloc]
-             initWithParams:params
-                stringRange:linkRange
- mutableAttributedSubstring:nil
-                  linkCount:1
-              fullRangeLink:linkValue
-        fullRangeAttachment:nil])
-    {
-      [array addObject:linkElement];
+    if (auto data = subelementData(params, linkRange, nil, 1, linkValue, nil)) {
+      data->isRotorLinkElement = createRotorLinks;
+      elementsPointer->append(std::move(*data));
       return;
     }
     if (!mutableSubtring) {
@@ -695,30 +700,17 @@ static void addElementsForRangeThatMayContainLinks(
     [mutableSubtring removeAttribute:NSLinkAttributeName
                                range:Range{linkRange} - stringRange.location];
   }];
-  const UInt linkCount = array.count - index;
-  auto* const textElement = [[STUTextFrameAccessibilitySubelement alloc]
-                               initWithParams:params
-                                  stringRange:stringRange
-                   mutableAttributedSubstring:mutableSubtring
-                                    linkCount:linkCount
-                                fullRangeLink:nil
-                          fullRangeAttachment:nil];
-  if (!textElement) {
+  const Int linkCount = elements.count() - index;
+  auto textData = subelementData(params, stringRange, mutableSubtring, sign_cast(linkCount),
+                                 nil, nil);
+  if (!textData) {
     STU_DEBUG_ASSERT(linkCount == 0);
     return;
   }
-  if (linkCount == 0) {
-    [array addObject:textElement];
-    return;
-  }
-  [array insertObject:textElement atIndex:index];
   if (createRotorLinks) {
-  STU_DISABLE_CLANG_WARNING("-Wunguarded-availability")
-    textElement.accessibilityCustomRotors =
-      @[createLinkRotorForAccessibilityContainer(params.textFrameAccessibilityElement,
-                                                 range(index + 1, Count{linkCount}))];
-  STU_REENABLE_CLANG_WARNING
+    textData->rotorLinkCount = narrow_cast<stu::UInt32>(linkCount);
   }
+  elements.insert(index, std::move(*textData));
 }
 
 static void forEachRangeSeparatedByAccessibleAttachments(
@@ -749,9 +741,9 @@ static void forEachRangeSeparatedByAccessibleAttachments(
 }
 
 STU_NO_INLINE
-static void addAccessibilityElementsForRange(
-              const InitParams& params, const Range<UInt> fullRange,
-              NSMutableArray<STUTextFrameAccessibilitySubelement*>* __unsafe_unretained const array)
+static void addAccessibilityElementsForRange(const AccessibilityDataParams& params,
+                                             const Range<UInt> fullRange,
+                                             Vector<AccessibilitySubelementData>& elements)
 {
   if (!params.separateLinkElements) {
     forEachRangeSeparatedByAccessibleAttachments(params.attributedString, fullRange,
@@ -759,25 +751,17 @@ static void addAccessibilityElementsForRange(
           STUTextAttachment* __unsafe_unretained __nullable const attachment)
     {
       if (!attachment) {
-        addElementsForRangeThatMayContainLinks(params, range, array);
+        addElementsForRangeThatMayContainLinks(params, range, elements);
         return;
       }
       STU_DEBUG_ASSERT(range.count() == 1);
       const id linkValue = [params.attributedString attribute:NSLinkAttributeName
                                                       atIndex:range.start effectiveRange:nil];
-      if (auto* const e = [[STUTextFrameAccessibilitySubelement alloc]
-                             initWithParams:params
-                                stringRange:range
-                 mutableAttributedSubstring:nil
-                                  linkCount:0
-                              fullRangeLink:linkValue
-                        fullRangeAttachment:attachment])
-      {
-        [array addObject:e];
-      }
+      appendSubelementData(params, range, 0, linkValue, attachment, elements);
     });
     return;
   }
+  Vector<AccessibilitySubelementData>* const elementsPointer = &elements;
   [params.attributedString enumerateAttribute:NSLinkAttributeName inRange:fullRange
                                       options:0 // We want the longest effective range.
                                    usingBlock:^(const __unsafe_unretained __nullable id linkValue,
@@ -793,20 +777,406 @@ static void addAccessibilityElementsForRange(
           subrange = trimmedRange;
         }
       }
-      if (auto* const e = [[STUTextFrameAccessibilitySubelement alloc]
-                             initWithParams:params
-                                stringRange:subrange
-                 mutableAttributedSubstring:nil
-                                  linkCount:linkValue ? 1 : 0
-                              fullRangeLink:linkValue
-                        fullRangeAttachment:attachment])
-      {
-        [array addObject:e];
-      }
+      appendSubelementData(params, subrange, linkValue ? 1 : 0, linkValue, attachment,
+                           *elementsPointer);
     });
   }];
 }
 
+static AccessibilityDataParams accessibilityDataParams(
+                                 STUTextFrameAccessibilityData* __unsafe_unretained self)
+{
+  const TextFrame& tf = textFrameRef(self->_textFrame);
+  NSAttributedString* __unsafe_unretained const attributedString = self->_attributedString;
+  return AccessibilityDataParams{
+    .textFrame = tf,
+    .attributedString = attributedString,
+    .string = NSStringRef{attributedString.string},
+    .isTruncatedString = !self->_options.representUntruncatedText,
+    .separateLinkElements = self->_separatesLinkElements,
+    .verticalPositions = !self->_verticalPositions ? ArrayRef<const TextLineVerticalPosition>{}
+                       : ArrayRef<const TextLineVerticalPosition>{self->_verticalPositions,
+                                                                  tf.lines().count(), unchecked}
+  };
+}
+
+/// Computes the element data for the segments up to (excluding) the specified segment index.
+/// This determines the string ranges and thus the number of elements, but not the geometry of
+/// the elements.
+STU_NO_INLINE
+static void computeSegments(STUTextFrameAccessibilityData* __unsafe_unretained self,
+                            const Int32 segmentEnd)
+{
+  STU_DEBUG_ASSERT(self->_computedSegmentCount < segmentEnd && segmentEnd <= self->_segmentCount);
+  ThreadLocalArenaAllocator::InitialBuffer<4096> buffer;
+  ThreadLocalArenaAllocatorScope alloc{Ref{buffer}};
+  const AccessibilityDataParams params = accessibilityDataParams(self);
+  const TextFrame& tf = params.textFrame;
+  const bool representsUntruncatedText = self->_options.representUntruncatedText;
+  Vector<AccessibilitySubelementData>& elements = self->_elements;
+  for (Int32 i = self->_computedSegmentCount; i < segmentEnd; ++i) {
+    Range<Int> range;
+    if (!self->_separatesParagraphs) {
+      range = representsUntruncatedText ? tf.rangeInOriginalString()
+                                        : tf.rangeInTruncatedString();
+    } else {
+      const TextFrameParagraph& para = tf.paragraphs()[i];
+      range = representsUntruncatedText ? para.rangeInOriginalString
+                                        : para.rangeInTruncatedString;
+    }
+    addAccessibilityElementsForRange(params, Range<UInt>{range}, elements);
+  }
+  self->_computedSegmentCount = segmentEnd;
+}
+
+/// Computes the geometry of the element with the specified index, if it hasn't been computed yet.
+/// @pre index < self->_elements.count()
+STU_NO_INLINE
+static void computeElementGeometryIfNecessary(
+              STUTextFrameAccessibilityData* __unsafe_unretained self, const Int index)
+{
+  if (self->_elements[index].hasGeometry) return;
+  const TextFrame& tf = textFrameRef(self->_textFrame);
+  const auto lines = tf.lines();
+  if (!self->_verticalPositions) {
+    const auto scaleFactors = TextFrameScaleAndDisplayScale{tf, self->_displayScale};
+    const Int size = max(lines.count(), Int{1})*Int{sizeof(TextLineVerticalPosition)};
+    self->_verticalPositions = reinterpret_cast<TextLineVerticalPosition*>(
+                                 Malloc{}.allocate(size));
+    for (Int i = 0; i < lines.count(); ++i) {
+      const TextFrameLine& line = lines[i];
+      TextLineVerticalPosition vp = textLineVerticalPosition(line, scaleFactors.displayScale);
+      vp.scale(scaleFactors.textFrameScale);
+      self->_verticalPositions[i] = vp;
+    }
+  }
+  ThreadLocalArenaAllocator::InitialBuffer<4096> buffer;
+  ThreadLocalArenaAllocatorScope alloc{Ref{buffer}};
+  computeSubelementGeometry(accessibilityDataParams(self), self->_elements[index]);
+  self->_elementGeometryCount += 1;
+  if (self->_computedSegmentCount == self->_segmentCount
+      && self->_elementGeometryCount == self->_elements.count())
+  {
+    free(self->_verticalPositions);
+    self->_verticalPositions = nullptr;
+  }
+}
+
+@implementation STUTextFrameAccessibilityData
+
+- (instancetype)init {
+  [self doesNotRecognizeSelector:_cmd];
+  __builtin_trap();
+}
+
+- (instancetype)initWithTextFrame:(STUTextFrame*)textFrame
+                     displayScale:(CGFloat)displayScale
+                          options:(const TextFrameAccessibilityDataOptions&)options
+{
+  self = [super init];
+  if (!self) return self;
+  _textFrame = textFrame;
+  _displayScale = clampDisplayScaleInput(displayScale);
+  _options = options;
+  const TextFrame& tf = textFrameRef(textFrame);
+  _attributedString = options.representUntruncatedText ? tf.originalAttributedString
+                    : tf.truncatedAttributedString().unretained;
+  const size_t threshold = options.paragraphSeparationCharacterThreshold;
+  _separatesParagraphs = true;
+  if (threshold > 1) {
+    if (threshold >= maxValue<Int32>) {
+      _separatesParagraphs = false;
+    } else {
+      const Int n = NSStringRef{_attributedString.string}.countGraphemeClusters();
+      _separatesParagraphs = sign_cast(n) > threshold;
+    }
+  }
+  // There's no way to provide a custom link rotor on iOS 9.
+  _separatesLinkElements = options.separateLinkElements
+                        || NSFoundationVersionNumber <= NSFoundationVersionNumber_iOS_9_x_Max;
+  _segmentCount = _separatesParagraphs ? tf.paragraphCount : 1;
+  return self;
+}
+
+- (void)dealloc {
+  if (_verticalPositions) {
+    free(_verticalPositions);
+  }
+}
+
+@end
+
+STUTextFrameAccessibilityData*
+  STUTextFrameAccessibilityDataCreate(STUTextFrame* textFrame, CGFloat displayScale,
+                                      const TextFrameAccessibilityDataOptions& options)
+{
+  STUTextFrameAccessibilityData* const data = [[STUTextFrameAccessibilityData alloc]
+                                                 initWithTextFrame:textFrame
+                                                      displayScale:displayScale
+                                                           options:options];
+  if (data->_segmentCount > 0) {
+    computeSegments(data, data->_segmentCount);
+  }
+  for (Int i = 0; i < data->_elements.count(); ++i) {
+    computeElementGeometryIfNecessary(data, i);
+  }
+  return data;
+}
+
+// MARK: - STUTextFrameAccessibilityElement
+
+@implementation STUTextFrameAccessibilityElement
+
+- (instancetype)init {
+  [self doesNotRecognizeSelector:_cmd];
+  __builtin_trap();
+}
+
+static void initCommon(STUTextFrameAccessibilityElement* __unsafe_unretained self,
+                       STUView* __unsafe_unretained view,
+                       STUTextFrame* __unsafe_unretained __nullable textFrame,
+                       CGPoint originInContainerSpace, CGFloat displayScale,
+                       const TextFrameAccessibilityDataOptions& options,
+                       STUTextFrameAccessibilityData* __nullable data,
+                       __nullable __unsafe_unretained STUTextLinkRangePredicate isDraggableLink,
+                       __nullable __unsafe_unretained STUTextLinkRangePredicate
+                         linkActivationHandler)
+{
+  self->_accessibilityContainer = view;
+  self->_isAccessibilityElement = false; // Since this element has subelements.
+  self->_frame = CGRect{clampPointInput(originInContainerSpace), CGSize{}};
+  self->_linkActivationHandler = linkActivationHandler;
+  self->_representsUntruncatedText = options.representUntruncatedText;
+  self->_separatesLinkElements = options.separateLinkElements;
+  self->_separatesParagraphs = options.paragraphSeparationCharacterThreshold
+                               < maxValue<Int32>;
+  self->_elements = [[NSMutableArray alloc] init];
+  self->_elementArray = [[STUTextFrameAccessibilitySubelementArray alloc]
+                           initWithTextFrameElement:self];
+  if (!textFrame) return;
+  displayScale = clampDisplayScaleInput(displayScale);
+  if (!data
+      || data->_textFrame != textFrame
+      || data->_displayScale != displayScale
+      || data->_options != options)
+  {
+    data = [[STUTextFrameAccessibilityData alloc] initWithTextFrame:textFrame
+                                                       displayScale:displayScale
+                                                            options:options];
+  }
+  self->_data = data;
+  self->_separatesParagraphs = data->_separatesParagraphs;
+  // The layout bounds contain the bounds of all subelements and don't require any text processing.
+  const Optional<DisplayScale> optDisplayScale = DisplayScale::create(displayScale);
+  const stu_label::Rect<CGFloat> layoutBounds =
+    labelTextFrameInfo(textFrameRef(textFrame), STULabelVerticalAlignmentTop,
+                       optDisplayScale ? *optDisplayScale : DisplayScale::one()).layoutBounds;
+  self->_frame.size = CGSize{layoutBounds.x.end, layoutBounds.y.end};
+  if (@available(iOS 11, *)) {
+    self->_isDraggableLink = isDraggableLink;
+  }
+}
+
+- (instancetype)initWithAccessibilityContainer:(STUView*)view
+                                     textFrame:(NS_VALID_UNTIL_END_OF_SCOPE STUTextFrame*)textFrame
+                        originInContainerSpace:(CGPoint)originInContainerSpace
+                                  displayScale:(CGFloat)displayScale
+                      representUntruncatedText:(bool)representUntruncatedText
+                            separateParagraphs:(bool)separateParagraphs
+                          separateLinkElements:(bool)separateLinkElements
+                               isDraggableLink:(__nullable STUTextLinkRangePredicate)isDraggableLink
+                         linkActivationHandler:(__nullable STUTextLinkRangePredicate)
+                                                 linkActivationHandler
+{
+  STU_CHECK(is_main_thread());
+  self = [super initWithAccessibilityContainer:view];
+  if (!self) return self;
+  const TextFrameAccessibilityDataOptions options = {
+    .paragraphSeparationCharacterThreshold = separateParagraphs ? 0 : maxValue<UInt>,
+    .representUntruncatedText = representUntruncatedText,
+    .separateLinkElements = separateLinkElements
+  };
+  initCommon(self, view, textFrame, originInContainerSpace, displayScale, options, nil,
+             isDraggableLink, linkActivationHandler);
+  return self;
+}
+
+- (instancetype)initWithAccessibilityContainer:(STUView*)view
+                                     textFrame:(NS_VALID_UNTIL_END_OF_SCOPE STUTextFrame*)textFrame
+                        originInContainerSpace:(CGPoint)originInContainerSpace
+                                  displayScale:(CGFloat)displayScale
+                                       options:(const TextFrameAccessibilityDataOptions&)options
+                               precomputedData:(nullable STUTextFrameAccessibilityData*)
+                                                 precomputedData
+                               isDraggableLink:(__nullable STUTextLinkRangePredicate)isDraggableLink
+                         linkActivationHandler:(__nullable STUTextLinkRangePredicate)
+                                                 linkActivationHandler
+{
+  STU_CHECK(is_main_thread());
+  self = [super initWithAccessibilityContainer:view];
+  if (!self) return self;
+  initCommon(self, view, textFrame, originInContainerSpace, displayScale, options,
+             precomputedData, isDraggableLink, linkActivationHandler);
+  return self;
+}
+
+- (void)dealloc {
+  for (id e in self->_elements) {
+    if (e == NSNull.null) continue;
+    static_cast<STUTextFrameAccessibilitySubelement*>(e)->_textFrameElement = nil;
+  }
+  _elementArray->_textFrameElement = nil;
+}
+
+- (STUView*)accessibilityContainer {
+  return _accessibilityContainer;
+}
+- (void)setAccessibilityContainer:(nullable id)accessibilityContainer {
+  STU_CHECK_MSG(accessibilityContainer == nil || [accessibilityContainer isKindOfClass:STUView.class],
+                "The accessibilityContainer of a STUTextFrameAccessibilityElement must be a STUView");
+  _accessibilityContainer = accessibilityContainer;
+  [super setAccessibilityContainer:accessibilityContainer];
+}
+
+- (BOOL)isAccessibilityElement {
+  return _isAccessibilityElement;
+}
+- (void)setIsAccessibilityElement:(BOOL)isAccessibilityElement {
+  _isAccessibilityElement = isAccessibilityElement;
+}
+
+- (NSArray<STUTextFrameAccessibilitySubelement*>*)accessibilityElements {
+  return _elementArray;
+}
+- (void)setAccessibilityElements:(NSArray*)elements {
+  if (elements == _elementArray) return;
+  [self doesNotRecognizeSelector:_cmd];
+  __builtin_trap();
+}
+
+- (NSInteger)accessibilityElementCount {
+  STUTextFrameAccessibilityData* const data = _data;
+  if (!data) return 0;
+  // Counting the elements only requires the string ranges of the elements, not their geometry or
+  // the subelement objects.
+  if (data->_computedSegmentCount < data->_segmentCount) {
+    computeSegments(data, data->_segmentCount);
+  }
+  return data->_elements.count();
+}
+
+- (nullable id)accessibilityElementAtIndex:(NSInteger)index {
+  if (index < 0) return nil;
+  return subelement(self, sign_cast(index));
+}
+
+- (NSInteger)indexOfAccessibilityElement:(id)element {
+  if (![element isKindOfClass:STUTextFrameAccessibilitySubelement.class]
+      || static_cast<STUTextFrameAccessibilitySubelement*>(element)->_textFrameElement != self)
+  {
+    return NSNotFound;
+  }
+  const NSUInteger index = [_elements indexOfObjectIdenticalTo:element];
+  return index == NSNotFound ? NSNotFound : sign_cast(index);
+}
+
+- (CGRect)accessibilityFrameInContainerSpace {
+  return _frame;
+}
+- (void)setAccessibilityFrameInContainerSpace:(CGRect)frame {
+  _frame = frame;
+}
+
+- (CGPoint)textFrameOriginInContainerSpace {
+  return _frame.origin;
+}
+- (void)setTextFrameOriginInContainerSpace:(CGPoint)origin {
+  _frame.origin = origin;
+}
+
+- (CGRect)accessibilityFrame {
+  STUView* const view = _accessibilityContainer;
+  return !view ? _frame : UIAccessibilityConvertFrameToScreenCoordinates(_frame, view);
+}
+- (void)setAccessibilityFrame:(CGRect __unused)frame {
+  [self doesNotRecognizeSelector:_cmd];
+  __builtin_trap();
+}
+
+- (bool)representsUntruncatedText { return _representsUntruncatedText; }
+- (bool)separatesParagraphs { return _separatesParagraphs; }
+- (bool)separatesLinkElements { return _separatesLinkElements; }
+
+/// Returns the subelement with the specified index, or nil if the index is out of bounds.
+/// Creates the subelement if necessary. Only computes the data of the segments up to the one
+/// containing the element.
+STU_NO_INLINE
+static STUTextFrameAccessibilitySubelement* __nullable
+  subelement(STUTextFrameAccessibilityElement* __unsafe_unretained self, const UInt index)
+{
+  STUTextFrameAccessibilityData* __unsafe_unretained const data = self->_data;
+  if (!data) return nil;
+  while (sign_cast(data->_elements.count()) <= index
+         && data->_computedSegmentCount < data->_segmentCount)
+  {
+    computeSegments(data, data->_computedSegmentCount + 1);
+  }
+  const Int elementCount = data->_elements.count();
+  if (index >= sign_cast(elementCount)) return nil;
+  NSMutableArray* __unsafe_unretained const elements = self->_elements;
+  for (Int i = sign_cast(elements.count); i < elementCount; ++i) {
+    [elements addObject:NSNull.null];
+  }
+  if (elements[index] != NSNull.null) {
+    return elements[index];
+  }
+  computeElementGeometryIfNecessary(data, sign_cast(index));
+  const AccessibilitySubelementData& d = data->_elements[sign_cast(index)];
+  const bool isTruncatedString = !data->_options.representUntruncatedText;
+  STUTextFrameAccessibilitySubelement* const element =
+    [[(d.isRotorLinkElement ? STUTextFrameAccessibilityRotorLinkElement.class
+                            : STUTextFrameAccessibilitySubelement.class) alloc]
+       initWithContainer:self data:d isTruncatedString:isTruncatedString
+         isDraggableLink:self->_isDraggableLink];
+  if (d.rotorLinkCount > 0) {
+  STU_DISABLE_CLANG_WARNING("-Wunguarded-availability")
+    element.accessibilityCustomRotors =
+      @[createLinkRotorForAccessibilityContainer(self, range(index + 1,
+                                                             Count{UInt{d.rotorLinkCount}}))];
+  STU_REENABLE_CLANG_WARNING
+  }
+  elements[index] = element;
+  return element;
+}
+
+STUTextFrameAccessibilityData* __nullable
+  STUTextFrameAccessibilityElementGetData(STUTextFrameAccessibilityElement* self)
+{
+  return self->_data;
+}
+
+@end
+
+@implementation STUTextFrameAccessibilitySubelementArray
+
+- (instancetype)initWithTextFrameElement:(STUTextFrameAccessibilityElement*)textFrameElement {
+  self = [super init];
+  if (!self) return self;
+  _textFrameElement = textFrameElement;
+  return self;
+}
+
+- (NSUInteger)count {
+  return !_textFrameElement ? 0 : sign_cast(_textFrameElement.accessibilityElementCount);
+}
+
+- (id)objectAtIndex:(NSUInteger)index {
+  STUTextFrameAccessibilitySubelement* const element =
+    !_textFrameElement ? nil : subelement(_textFrameElement, index);
+  STU_CHECK_MSG(element != nil, "The accessibility element index is out of bounds.");
+  return element;
+}
+
 @end
 
 
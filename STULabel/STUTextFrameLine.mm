@@ -22,7 +22,7 @@ STUTextFrameGraphemeClusterRange STUTextFrameLineGetRangeOfGraphemeClusterAtXOff
   STU_CHECK_MSG(0 <= xOffset, "xOffset must be non-negative");
   STU_CHECK_MSG(xOffset <= line->width, "xOffset must not be greater than line.width");
   ThreadLocalArenaAllocator::InitialBuffer<2048> buffer;
-  ThreadLocalArenaAllocator alloc{Ref{buffer}};
+  ThreadLocalArenaAllocatorScope alloc{Ref{buffer}};
   return narrow_cast<STUTextFrameGraphemeClusterRange>(
            down_cast<const TextFrameLine*>(line)->rangeOfGraphemeClusterAtXOffset(xOffset));
 }
@@ -19,6 +19,8 @@ namespace stu_label {
     CGFloat textScaleFactorStepSize;
     STUBaselineAdjustment textScalingBaselineAdjustment;
     __nullable STULastHyphenationLocationInRangeFinder lastHyphenationLocationInRangeFinder;
+    bool cachesImageBounds;
+    bool precomputesImageBounds;
   };
 }
 
@@ -174,6 +174,24 @@ STU_EXPORT
 @property (readonly, nullable) STULastHyphenationLocationInRangeFinder
                                  lastHyphenationLocationInRangeFinder;
 
+/// Indicates whether a text frame created with these options memoizes the results of
+/// @c imageBoundsForRange calls (for a few recently used parameter combinations).
+///
+/// Default value: true
+@property (readonly) bool cachesImageBounds;
+
+/// Indicates whether a text frame created with these options calculates and caches the image bounds
+/// of the full text at the origin with the default drawing options during initialization. These
+/// are the image bounds a label view needs for rendering the text frame.
+///
+/// If the text frame is created on the main thread, the calculation is done asynchronously on a
+/// background queue.
+///
+/// Has no effect if @c cachesImageBounds is false.
+///
+/// Default value: false
+@property (readonly) bool precomputesImageBounds;
+
 @end
 
 /// Equality for @c STUTextFrameOptionsBuilder instances is defined as pointer equality.
@@ -227,6 +245,24 @@ STU_EXPORT
 @property (nonatomic, nullable) STULastHyphenationLocationInRangeFinder
                                   lastHyphenationLocationInRangeFinder;
 
+/// Indicates whether a text frame created with these options memoizes the results of
+/// @c imageBoundsForRange calls (for a few recently used parameter combinations).
+///
+/// Default value: true
+@property (nonatomic) bool cachesImageBounds;
+
+/// Indicates whether a text frame created with these options calculates and caches the image bounds
+/// of the full text at the origin with the default drawing options during initialization. These
+/// are the image bounds a label view needs for rendering the text frame.
+///
+/// If the text frame is created on the main thread, the calculation is done asynchronously on a
+/// background queue.
+///
+/// Has no effect if @c cachesImageBounds is false.
+///
+/// Default value: false
+@property (nonatomic) bool precomputesImageBounds;
+
 @end
 
 STU_ASSUME_NONNULL_AND_STRONG_END
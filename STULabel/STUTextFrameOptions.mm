@@ -21,7 +21,9 @@ using namespace stu_label;
   f(CGFloat, minimumTextScaleFactor) \
   f(CGFloat, textScaleFactorStepSize) \
   f(STUBaselineAdjustment, textScalingBaselineAdjustment) \
-  f(__nullable STULastHyphenationLocationInRangeFinder, lastHyphenationLocationInRangeFinder)
+  f(__nullable STULastHyphenationLocationInRangeFinder, lastHyphenationLocationInRangeFinder) \
+  f(bool, cachesImageBounds) \
+  f(bool, precomputesImageBounds)
 
 #define DEFINE_FIELD(Type, name) Type _##name;
 
@@ -36,6 +38,7 @@ using namespace stu_label;
   object prefix##minimumTextScaleFactor = 1; \
   object prefix##textScaleFactorStepSize = 1/128.f; \
   object prefix##defaultTextAlignment = STUDefaultTextAlignment(stu_defaultBaseWritingDirection()); \
+  object prefix##cachesImageBounds = true; \
 
 static_assert((int)STUDefaultTextAlignmentLeft == (int)STUWritingDirectionLeftToRight);
 static_assert((int)STUDefaultTextAlignmentRight == (int)STUWritingDirectionRightToLeft);
@@ -187,9 +187,75 @@ CGPoint STUTextLinkArrayGetTextFrameOrigin(const STUTextLinkArrayWithTextFrameOr
 
 // MARK: - STUTextLinkArrayWithOriginalTextFrameOrigin
 
+namespace stu_label {
+
+/// A vertical search table over the rects of all links in a link array, with the rects ordered
+/// by link index and then by rect index. Since the rects of a link are line-sized, the table
+/// stays selective even when some links span many lines, unlike a table over the link bounds.
+struct LinkRectSearchIndex {
+  Int rectCount;
+  // Followed by the IntervalSearchTable arrays and the link index of each rect.
+
+  static LinkRectSearchIndex* create(ArrayRef<STUTextLink* __unsafe_unretained> links);
+
+  STU_INLINE
+  IntervalSearchTable verticalSearchTable() const {
+    const Float32* const maxYs = reinterpret_cast<const Float32*>(this + 1);
+    return {ArrayRef{maxYs, rectCount}, ArrayRef{maxYs + rectCount, rectCount}};
+  }
+
+  STU_INLINE
+  ArrayRef<const Int32> linkIndices() const {
+    const Float32* const maxYs = reinterpret_cast<const Float32*>(this + 1);
+    return {reinterpret_cast<const Int32*>(maxYs + 2*rectCount), rectCount, unchecked};
+  }
+};
+
+LinkRectSearchIndex* LinkRectSearchIndex::create(
+                       ArrayRef<STUTextLink* __unsafe_unretained> links)
+{
+  Int rectCount = 0;
+  for (STUTextLink* __unsafe_unretained link : links) {
+    rectCount += sign_cast(link.rectCount);
+  }
+  const UInt size = sizeof(LinkRectSearchIndex)
+                  + IntervalSearchTable::sizeInBytesForCount(rectCount)
+                  + sizeof(Int32)*sign_cast(rectCount);
+  auto* const index = reinterpret_cast<LinkRectSearchIndex*>(Malloc{}.allocate(sign_cast(size)));
+  index->rectCount = rectCount;
+  Float32* const increasingMaxYs = reinterpret_cast<Float32*>(index + 1);
+  Float32* const increasingMinYs = increasingMaxYs + rectCount;
+  Int32* const linkIndices = reinterpret_cast<Int32*>(increasingMinYs + rectCount);
+  Float32 maxY = minValue<Float32>;
+  Int i = 0;
+  for (Int32 linkIndex = 0; linkIndex < links.count(); ++linkIndex) {
+    STUTextLink* __unsafe_unretained const link = links[linkIndex];
+    const size_t linkRectCount = link.rectCount;
+    for (size_t j = 0; j < linkRectCount; ++j, ++i) {
+      const Rect<CGFloat> rect = [link rectAtIndex:j];
+      increasingMaxYs[i] = maxY = max(maxY, narrow_cast<Float32>(rect.y.end));
+      increasingMinYs[i] = narrow_cast<Float32>(rect.y.start);
+      linkIndices[i] = linkIndex;
+    }
+  }
+  STU_ASSERT(i == rectCount);
+  { // A second pass over increasingMinYs that makes sure that the values are actually increasing.
+    Float32 minY = infinity<Float32>;
+    STU_DISABLE_LOOP_UNROLL
+    for (Float32& value : ArrayRef{increasingMinYs, rectCount}.reversed()) {
+      value = minY = min(value, minY);
+    }
+  }
+  return index;
+}
+
+} // namespace stu_label
+
 @implementation STUTextLinkArrayWithOriginalTextFrameOrigin {
   STUTextLink* __unsafe_unretained * _array;
   Int _count;
+  /// Lazily created by linkClosestToPoint.
+  std::atomic<LinkRectSearchIndex*> _rectSearchIndex;
 }
 
 STU_INLINE
@@ -199,13 +265,21 @@ ArrayRef<STUTextLink* __unsafe_unretained>
   return {self->_array, self->_count, unchecked};
 }
 
-STU_INLINE
-IntervalSearchTable verticalSearchTable(const STUTextLinkArrayWithOriginalTextFrameOrigin* self) {
-  const auto array = links(self);
-  // The search table is stored immediately after the link array.
-  const Float32* const maxYs = reinterpret_cast<const Float32*>(
-                                 static_cast<const void*>(array.end()));
-  return {ArrayRef{maxYs, array.count()}, ArrayRef{maxYs + array.count(), array.count()}};
+static const LinkRectSearchIndex&
+  rectSearchIndex(const STUTextLinkArrayWithOriginalTextFrameOrigin* __unsafe_unretained self)
+{
+  auto& atomicIndex = const_cast<std::atomic<LinkRectSearchIndex*>&>(self->_rectSearchIndex);
+  LinkRectSearchIndex* index = atomicIndex.load(std::memory_order_acquire);
+  if (STU_LIKELY(index)) return *index;
+  LinkRectSearchIndex* const newIndex = LinkRectSearchIndex::create(links(self));
+  if (atomicIndex.compare_exchange_strong(index, newIndex,
+                                          std::memory_order_acq_rel, std::memory_order_acquire))
+  {
+    index = newIndex;
+  } else {
+    free(newIndex);
+  }
+  return *index;
 }
 
 STUTextLinkArrayWithTextFrameOrigin* __nonnull
@@ -215,7 +289,7 @@ STUTextLinkArrayWithTextFrameOrigin* __nonnull
   NS_RETURNS_RETAINED
 {
   ThreadLocalArenaAllocator::InitialBuffer<2048> buffer;
-  ThreadLocalArenaAllocator alloc{Ref{buffer}};
+  ThreadLocalArenaAllocatorScope alloc{Ref{buffer}};
 
   const TaggedRangeLineSpans rls = findAndSortTaggedRangeLineSpans(
     textFrame.lines(), none,
@@ -232,20 +306,15 @@ STUTextLinkArrayWithTextFrameOrigin* __nonnull
 
   STUTextLinkArrayWithOriginalTextFrameOrigin* const instance =
     stu_createClassInstance(STUTextLinkArrayWithOriginalTextFrameOrigin.class,
-                            sign_cast(count)*(sizeof(void*) + 2*sizeof(Float32)));
+                            sign_cast(count)*sizeof(void*));
 
   const ArrayRef<STUTextLink* __unsafe_unretained> links{
     down_cast<STUTextLink* __unsafe_unretained *>(stu_getObjectIndexedIvars(instance)), count
   };
-  // The verticalSearchTable is stored immediately after the links array.
-  Float32* const increasingMaxYs = reinterpret_cast<Float32*>(static_cast<void*>(links.end()));
-  Float32* const increasingMinYs = increasingMaxYs + count;
-
   instance->_textFrameOrigin = frameOrigin;
   instance->_array = links.begin();
   instance->_count = links.count();
 
-  Float32 maxY = minValue<Float32>;
   Int32 linkIndex = 0;
   rls.forEachTaggedLineSpanSequence(
     [&](ArrayRef<const TextLineSpan> spans, FirstLastRange<const TaggedStringRange&> ranges)
@@ -283,25 +352,12 @@ STUTextLinkArrayWithTextFrameOrigin* __nonnull
                                 linkValue, rangeInOriginalString, rangeInTruncatedString,
                                 spans, textFrame.lines(), TextFrameOrigin{frameOrigin},
                                 scaleFactors);
-    const stu_label::Rect bounds = STUTextRectArrayGetBounds(link);
-
     links[linkIndex] = link;
     incrementRefCount(link);
-
-    increasingMaxYs[linkIndex] = maxY = max(maxY, narrow_cast<Float32>(bounds.y.end));
-    increasingMinYs[linkIndex] = narrow_cast<Float32>(bounds.y.start);
     ++linkIndex;
   });
   STU_ASSERT(linkIndex == count);
 
-  { // A second pass over increasingMinYs that makes sure that the values are actually increasing.
-    Float32 minY = infinity<Float32>;
-    STU_DISABLE_LOOP_UNROLL
-    for (Float32& value : ArrayRef{increasingMinYs, count}.reversed()) {
-      value = minY = min(value, minY);
-    }
-  }
-
   return instance;
 }
 
@@ -309,6 +365,7 @@ STUTextLinkArrayWithTextFrameOrigin* __nonnull
   for (STUTextLink* __unsafe_unretained p : links(self)) {
     decrementRefCount(p);
   }
+  free(_rectSearchIndex.load(std::memory_order_relaxed));
 }
 
 - (size_t)count {
@@ -337,11 +394,20 @@ static Optional<Int> indexOfLinkClosestToPoint(
                        CGPoint point, CGFloat maxDistance)
 {
   const ArrayRef<STUTextLink* __unsafe_unretained> array = links(self);
-  const Range<Int> indexRange = verticalSearchTable(self)
-                                .indexRange({narrow_cast<Float32>(point.y - maxDistance),
-                                             narrow_cast<Float32>(point.y + maxDistance)});
+  if (array.isEmpty()) return none;
+  const LinkRectSearchIndex& rectIndex = rectSearchIndex(self);
+  const Range<Int> rectIndexRange = rectIndex.verticalSearchTable()
+                                    .indexRange({narrow_cast<Float32>(point.y - maxDistance),
+                                                 narrow_cast<Float32>(point.y + maxDistance)});
+  const ArrayRef<const Int32> linkIndices = rectIndex.linkIndices();
   Optional<Int> minIndex = none;
-  for (const Int i : indexRange.iter()) {
+  Int previousIndex = -1;
+  for (const Int k : rectIndexRange.iter()) {
+    // The link indices are non-decreasing, so we visit the links in the same order as a linear
+    // scan would.
+    const Int i = linkIndices[k];
+    if (i == previousIndex) continue;
+    previousIndex = i;
     const STUIndexAndDistance r = STUTextRectArrayFindRectClosestToPoint(array[i], point,
                                                                          maxDistance);
     if (r.index == NSNotFound || (r.distance == maxDistance && minIndex)) continue;
@@ -358,6 +424,23 @@ static Optional<Int> indexOfLinkMatching(
                        Range<Int32> rangeInTruncatedString)
 {
   const ArrayRef<STUTextLink* __unsafe_unretained> array = links(self);
+  { // Fast path for a link with the exact same string ranges and attribute object, e.g. a link
+    // from this array or from a copy with a shifted text frame origin.
+    const Int i = binarySearchFirstIndexWhere(array, [&](const STUTextLink* p) {
+                    return p->_rangeInTruncatedString.start >= rangeInTruncatedString.start;
+                  }).indexOrArrayCount;
+    if (i < array.count()
+        && !rangeInOriginalString.isEmpty() && !rangeInTruncatedString.isEmpty())
+    {
+      const STUTextLink& other = *array[i];
+      if (other._rangeInTruncatedString == rangeInTruncatedString
+          && other._rangeInOriginalString == rangeInOriginalString
+          && other._linkAttributeValue == attributeValue)
+      {
+        return i;
+      }
+    }
+  }
   const Range<Int> indexRange = {
     binarySearchFirstIndexWhere(array, [&](const STUTextLink* p) {
       return p->_rangeInOriginalString.end > rangeInOriginalString.start;
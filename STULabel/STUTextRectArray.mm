@@ -408,15 +408,15 @@ extendTextLinesToCommonHorizontalBounds:(bool)extendLinesToCommonBounds
   if (d.data) {
     const STUTextRectArrayData& data = *d.data;
     ThreadLocalArenaAllocator::InitialBuffer<2048> buffer;
-    ThreadLocalArenaAllocator alloc{Ref{buffer}};
+    ThreadLocalArenaAllocatorScope alloc{Ref{buffer}};
     cornerRadius = clampNonNegativeFloatInput(cornerRadius);
     edgeInsets = clampEdgeInsetsInput(edgeInsets);
-    CGMutablePathRef path = CGPathCreateMutable();
-    addLineSpansPath(*path, data.spans(), data.textLineVerticalPositions(),
-                     ShouldFillTextLineGaps{fillTextLineGaps},
-                     ShouldExtendTextLinesToCommonHorizontalBounds{extendLinesToCommonBounds},
-                     edgeInsets, CornerRadius{cornerRadius}, nil, transform);
-    return path;
+    RC<CGPath> path = createLineSpansPathUsingCache(
+                        data.spans(), data.textLineVerticalPositions(),
+                        ShouldFillTextLineGaps{fillTextLineGaps},
+                        ShouldExtendTextLinesToCommonHorizontalBounds{extendLinesToCommonBounds},
+                        edgeInsets, CornerRadius{cornerRadius}, nil, transform);
+    return std::move(path).toRawPointer();
   }
   STU_ANALYZER_ASSUME(d.otherArray != nil);
   return [d.otherArray createPathWithEdgeInsets:edgeInsets
@@ -95,6 +95,8 @@ FOR_ALL_FIELDS(DEFINE_GETTER)
 #define DECODE(Type, name) decode(decoder, @STU_STRINGIZE(name), Out{_##name});
   FOR_ALL_FIELDS(DECODE)
 #undef DECODE
+  _fixedTruncationToken =
+    [_truncationToken stu_attributedStringByConvertingNSTextAttachmentsToSTUTextAttachments];
   clampTruncationScopeParameters(self);
   return self;
 }
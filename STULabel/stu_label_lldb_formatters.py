@@ -748,6 +748,7 @@ class STUTextFrameData_ChildrenProvider:
       self.colorType = getType(valobj, 'const CGColorRef')
       self.textStyleType = getType(valobj, 'const stu_label::TextStyle')
       self.stringStartIndicesType = getType(valobj, 'const stu_label::StringStartIndices')
+      self.privateDataType = getType(valobj, 'const stu_label::TextFrame::PrivateData')
       self.float32Type = getType(valobj, 'const stu::Float32')
     self.update()
 
@@ -801,7 +802,8 @@ class STUTextFrameData_ChildrenProvider:
     linesOffset = paragraphsOffset + paragraphsByteSize
     colorsOffset = linesOffset + linesByteSize + sanitizerGap
     textStylesOffset = colorsOffset + colorsByteSize + sanitizerGap
-    lineStringIndicesOffset = -sanitizerGap - lineStringIndicesByteSize
+    privateDataOffset = -self.privateDataType.GetByteSize()
+    lineStringIndicesOffset = privateDataOffset - sanitizerGap - lineStringIndicesByteSize
     verticalSearchTableOffset = lineStringIndicesOffset - sanitizerGap - verticalSearchTableByteSize
 
     if paragraphCount > 0:
@@ -820,8 +822,12 @@ class STUTextFrameData_ChildrenProvider:
     childIndicesByName['textStyles'] = len(children)
     children.append(valobj.CreateChildAtOffset('textStyles', textStylesOffset, self.textStyleType))
 
-    childIndicesByName['lineStringIndices'] = len(children)
     # CreateChildAtOffset doesn't work for negative offsets.
+    childIndicesByName['privateData'] = len(children)
+    children.append(valobj.CreateValueFromAddress('privateData', address + privateDataOffset,
+                                                  self.privateDataType))
+
+    childIndicesByName['lineStringIndices'] = len(children)
     children.append(valobj.CreateValueFromAddress('lineStringIndices',
                                                   address + lineStringIndicesOffset,
                                                   lineStringIndicesType))
@@ -70,6 +70,30 @@ extension STUTextFrame {
     return Range<Index>(__range(forRangeInTruncatedString: range))
   }
 
+  /// Equivalent to `ranges.map { range(forRangeInOriginalString: $0) }`, but faster for many
+  /// ranges, particularly when they are sorted by their start location.
+  @inlinable
+  public func ranges(forRangesInOriginalString ranges: [NSRange]) -> [Range<Index>] {
+    if ranges.isEmpty { return [] }
+    var result = [__STUTextFrameRange](repeating: __STUTextFrameRange(), count: ranges.count)
+    result.withUnsafeMutableBufferPointer { buffer in
+      __getRanges(buffer.baseAddress!, forRangesInOriginalString: ranges, count: ranges.count)
+    }
+    return result.map { Range<Index>($0) }
+  }
+
+  /// Equivalent to `ranges.map { range(forRangeInTruncatedString: $0) }`, but faster for many
+  /// ranges, particularly when they are sorted by their start location.
+  @inlinable
+  public func ranges(forRangesInTruncatedString ranges: [NSRange]) -> [Range<Index>] {
+    if ranges.isEmpty { return [] }
+    var result = [__STUTextFrameRange](repeating: __STUTextFrameRange(), count: ranges.count)
+    result.withUnsafeMutableBufferPointer { buffer in
+      __getRanges(buffer.baseAddress!, forRangesInTruncatedString: ranges, count: ranges.count)
+    }
+    return result.map { Range<Index>($0) }
+  }
+
   @inlinable
   public func range(for textRange: STUTextRange) -> Range<Index> {
     return textRange.type == .rangeInOriginalString
@@ -122,6 +146,18 @@ extension STUTextFrame {
     return __rangeInOriginalString(for: __STUTextFrameRange(range))
   }
 
+  /// Equivalent to `ranges.map { rangeInOriginalString(for: $0) }`.
+  @inlinable
+  public func rangesInOriginalString(for ranges: [Range<Index>]) -> [NSRange] {
+    if ranges.isEmpty { return [] }
+    let textFrameRanges = ranges.map { __STUTextFrameRange($0) }
+    var result = [NSRange](repeating: NSRange(), count: ranges.count)
+    result.withUnsafeMutableBufferPointer { buffer in
+      __getRangesInOriginalString(buffer.baseAddress!, for: textFrameRanges, count: ranges.count)
+    }
+    return result
+  }
+
   @inlinable
   public func rangeInOriginalStringAndTruncationTokenIndex(for index: Index)
     -> (NSRange, (truncationToken: NSAttributedString, indexInToken: Int)?)
@@ -239,6 +275,47 @@ extension STUTextFrame {
     return __layoutInfo(frameOrigin: frameOrigin, displayScale: displayScaleOrZero)
   }
 
+  /// Returns the layout info of a text frame for the specified substring of `shapedString`,
+  /// without creating an `STUTextFrame` instance.
+  ///
+  /// The result equals
+  /// `STUTextFrame(shapedString, stringRange: stringRange, size: size,
+  ///  displayScale: displayScale, options: options).layoutInfo(frameOrigin: .zero)`.
+  ///
+  /// This method is thread-safe.
+  @inlinable
+  public static func layoutInfo(for shapedString: STUShapedString, stringRange: NSRange? = nil,
+                                size: CGSize, displayScale: CGFloat?,
+                                options: STUTextFrameOptions? = nil) -> LayoutInfo
+  {
+    return __layoutInfo(for: shapedString,
+                        stringRange: stringRange ?? NSRange(0..<shapedString.length),
+                        size: size, displayScale: displayScale ?? 0, options: options)
+  }
+
+  /// Returns the layout infos of text frames with the specified widths for the full string of
+  /// `shapedString`, without creating any `STUTextFrame` instances.
+  ///
+  /// For each width the result equals
+  /// `STUTextFrame(shapedString, size: CGSize(width: width, height: frameHeight),
+  ///  displayScale: displayScale, options: options).layoutInfo(frameOrigin: .zero)`.
+  ///
+  /// This method is thread-safe.
+  @inlinable
+  public static func layoutInfos(for shapedString: STUShapedString, frameWidths: [CGFloat],
+                                 frameHeight: CGFloat, displayScale: CGFloat?,
+                                 options: STUTextFrameOptions? = nil) -> [LayoutInfo]
+  {
+    if frameWidths.isEmpty { return [] }
+    var result = [LayoutInfo](repeating: LayoutInfo(), count: frameWidths.count)
+    result.withUnsafeMutableBufferPointer { buffer in
+      __getLayoutInfos(buffer.baseAddress!, for: shapedString, frameWidths: frameWidths,
+                       count: frameWidths.count, frameHeight: frameHeight,
+                       displayScale: displayScale ?? 0, options: options)
+    }
+    return result
+  }
+
   @inlinable
   public var flags: Flags {
     return withExtendedLifetime(self) { self.__data.pointee.flags }
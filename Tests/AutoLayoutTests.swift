@@ -300,4 +300,30 @@ class AutoLayoutTests: SnapshotTestCase {
 
     checkSnapshot(of: container, suffix: suffix)
   }
+
+  func testLabelSizeThatFitsWithAlternatingSizes() {
+    let text = "Some label text that wraps differently depending on the available width."
+    let label = STULabel()
+    label.font = font(size: 18)
+    label.maximumNumberOfLines = 0
+    label.text = text
+    let widths: [CGFloat] = [80, 120, 160, 200, 240]
+    var expectedSizes = [CGSize]()
+    for width in widths {
+      let referenceLabel = STULabel()
+      referenceLabel.font = font(size: 18)
+      referenceLabel.maximumNumberOfLines = 0
+      referenceLabel.text = text
+      expectedSizes.append(referenceLabel.sizeThatFits(CGSize(width: width, height: 1000)))
+    }
+    for _ in 0..<3 {
+      for (width, expectedSize) in zip(widths, expectedSizes) {
+        XCTAssertEqual(label.sizeThatFits(CGSize(width: width, height: 1000)), expectedSize)
+      }
+    }
+    label.frame = CGRect(origin: .zero, size: expectedSizes[1])
+    XCTAssertEqual(label.sizeThatFits(CGSize(width: widths[3], height: 1000)), expectedSizes[3])
+    label.text = text + " More text."
+    XCTAssertNotEqual(label.sizeThatFits(CGSize(width: widths[0], height: 1000)), expectedSizes[0])
+  }
 }
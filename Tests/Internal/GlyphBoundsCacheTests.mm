@@ -351,5 +351,51 @@ using FontFace = FontFaceGlyphBoundsCache::FontFace;
   }
 }
 
+- (void)testLineIntersectionCache {
+  UIFont* const font = [UIFont fontWithName:@"HelveticaNeue" size:16];
+  const CGFloat fontSize = font.pointSize;
+  CGGlyph glyph;
+  const unichar ch = 'g';
+  XCTAssert(CTFontGetGlyphsForCharacters((__bridge CTFontRef)font, &ch, &glyph, 1));
+
+  const Optional<UInt64> key = FontFaceGlyphBoundsCache::lineIntersectionKey(
+                                 glyph, fontSize, Range<CGFloat>{-2.5, -1.5}, false);
+  XCTAssert(key);
+  XCTAssert(*key == *FontFaceGlyphBoundsCache::lineIntersectionKey(
+                       glyph, fontSize, Range<CGFloat>{-2.5, -1.5}, false));
+  XCTAssert(*key != *FontFaceGlyphBoundsCache::lineIntersectionKey(
+                       glyph, fontSize, Range<CGFloat>{-2.5, -1.5}, true));
+  XCTAssert(*key != *FontFaceGlyphBoundsCache::lineIntersectionKey(
+                       glyph, 2*fontSize, Range<CGFloat>{-2.5, -1.5}, false));
+  const Range<CGFloat> lineY = FontFaceGlyphBoundsCache::lineIntersectionKeyLineY(*key, fontSize);
+  XCTAssert(lineY.start <= -2.5 && -2.5 - lineY.start < fontSize/1024);
+  XCTAssert(lineY.end >= -1.5 && lineY.end + 1.5 < fontSize/1024);
+  XCTAssert(!FontFaceGlyphBoundsCache::lineIntersectionKey(glyph, fontSize,
+                                                           Range<CGFloat>{-1000, 1}, false));
+
+  FontFaceGlyphBoundsCache::clearGlobalCache();
+  const FontFaceGlyphBoundsCache::CacheStats stats0 =
+    FontFaceGlyphBoundsCache::lineIntersectionCacheStats();
+  {
+    FontFaceGlyphBoundsCache::UniquePtr cache;
+    FontFaceGlyphBoundsCache::exchange(InOut(cache), font, FontFace{font, fontSize});
+    Int callCount = 0;
+    const LowerAndUpperInterval value = {Range<CGFloat>{0.25, 0.5}, Range<CGFloat>{1, 0}};
+    for (int i = 0; i < 3; ++i) {
+      const LowerAndUpperInterval xis = cache->lineIntersectionXBounds(*key, [&] {
+                                          ++callCount;
+                                          return value;
+                                        });
+      XCTAssert(xis.lower == value.lower);
+      XCTAssert(xis.upper == value.upper);
+    }
+    XCTAssertEqual(callCount, 1);
+  }
+  const FontFaceGlyphBoundsCache::CacheStats stats1 =
+    FontFaceGlyphBoundsCache::lineIntersectionCacheStats();
+  XCTAssertEqual(stats1.hitCount - stats0.hitCount, 2);
+  XCTAssertEqual(stats1.missCount - stats0.missCount, 1);
+}
+
 @end
 
@@ -0,0 +1,126 @@
+// Copyright 2018 Stephan Tolksdorf
+
+#import "TestUtils.h"
+
+#import "STULabel/STULabel.h"
+#import "STULabel/STULabelLayer-Internal.hpp"
+#import "STULabel/STUTextFrameAccessibilityElement-Internal.hpp"
+
+using namespace stu_label;
+
+static STULabel* labelWithManyLinkParagraphs() {
+  UIFont* const font = [UIFont fontWithName:@"HelveticaNeue" size:18];
+  NSMutableAttributedString* const string = [[NSMutableAttributedString alloc] init];
+  for (int i = 0; i < 100; ++i) {
+    NSString* const paragraph =
+      [NSString stringWithFormat:@"%@Paragraph %d with a link and some more text.",
+                                 i == 0 ? @"" : @"\n", i];
+    [string appendAttributedString:[[NSAttributedString alloc]
+                                      initWithString:paragraph
+                                          attributes:@{NSFontAttributeName: font}]];
+  }
+  NSString* const nsString = string.string;
+  NSRange range = {0, 0};
+  for (;;) {
+    const NSUInteger start = NSMaxRange(range);
+    range = [nsString rangeOfString:@"link" options:0
+                              range:NSRange{start, nsString.length - start}];
+    if (range.location == NSNotFound) break;
+    [string addAttribute:NSLinkAttributeName value:[NSURL URLWithString:@"https://example.com"]
+                   range:range];
+  }
+  STULabel* const label = [[STULabel alloc] initWithFrame:CGRect{{}, {200, 10000}}];
+  label.maximumNumberOfLines = 0;
+  label.attributedText = string;
+  return label;
+}
+
+@interface AsyncDisplayLabelDelegate : NSObject <STULabelDelegate>
+@end
+@implementation AsyncDisplayLabelDelegate
+- (bool)label:(STULabel* __unused)label
+  shouldDisplayAsynchronouslyWithProposedValue:(bool __unused)proposedValue
+{
+  return true;
+}
+@end
+
+@interface LabelAccessibilityDataTests : XCTestCase
+@end
+@implementation LabelAccessibilityDataTests
+
+- (void)testAccessibilityElementUsesDataPrecomputedInBackground {
+  STULabel* const label = labelWithManyLinkParagraphs();
+  AsyncDisplayLabelDelegate* const delegate = [[AsyncDisplayLabelDelegate alloc] init];
+  label.delegate = delegate;
+  label.displaysAsynchronously = true;
+  STULabelLayer* const layer = label.layer;
+  // Requesting the element makes the layer precompute the accessibility data in the background
+  // after subsequent render tasks.
+  [label accessibilityElement];
+  XCTAssertNil(STULabelLayerGetAccessibilityData(layer));
+  XCTestExpectation* const didComputeData =
+    [self expectationWithDescription:@"accessibility data computed in background"];
+  STULabelLayerSetAccessibilityDataCompletionHandler(layer, ^{ [didComputeData fulfill]; });
+  label.maximumNumberOfLines = 150;
+  [layer setNeedsDisplay];
+  [layer displayIfNeeded];
+  [self waitForExpectations:@[didComputeData] timeout:10];
+  STULabelLayerSetAccessibilityDataCompletionHandler(layer, nil);
+
+  STUTextFrameAccessibilityData* const data = STULabelLayerGetAccessibilityData(layer);
+  XCTAssertNotNil(data);
+  STUTextFrameAccessibilityElement* const element = label.accessibilityElement;
+  // The element must use the precomputed data instead of computing its own on the main thread.
+  XCTAssertEqual(STUTextFrameAccessibilityElementGetData(element), data);
+
+  STUTextFrameAccessibilityElement* const referenceElement =
+    [[STUTextFrameAccessibilityElement alloc]
+       initWithAccessibilityContainer:label
+                            textFrame:label.textFrame
+               originInContainerSpace:layer.textFrameOrigin
+                         displayScale:layer.contentsScale
+             representUntruncatedText:false
+                   separateParagraphs:element.separatesParagraphs
+                 separateLinkElements:false
+                      isDraggableLink:nil
+                linkActivationHandler:nil];
+  const NSInteger count = referenceElement.accessibilityElementCount;
+  XCTAssertGreaterThan(count, 100);
+  XCTAssertEqual(element.accessibilityElementCount, count);
+  XCTAssert(CGRectEqualToRect(element.accessibilityFrameInContainerSpace,
+                              referenceElement.accessibilityFrameInContainerSpace));
+  for (NSInteger i = 0; i < count; i += 7) {
+    NSObject* const e1 = [element accessibilityElementAtIndex:i];
+    NSObject* const e2 = [referenceElement accessibilityElementAtIndex:i];
+    XCTAssertEqualObjects(e1.accessibilityLabel, e2.accessibilityLabel);
+    XCTAssert(CGRectEqualToRect(e1.accessibilityFrame, e2.accessibilityFrame));
+    XCTAssertEqual(e1.accessibilityTraits, e2.accessibilityTraits);
+  }
+}
+
+- (void)testAccessibilityElementsArrayReturnsTheIndexedSubelements {
+  STULabel* const label = labelWithManyLinkParagraphs();
+  STUTextFrameAccessibilityElement* const element = label.accessibilityElement;
+  NSArray* const elements = element.accessibilityElements;
+  XCTAssertEqual(element.accessibilityElements, elements);
+  const NSInteger count = element.accessibilityElementCount;
+  XCTAssertGreaterThan(count, 100);
+  XCTAssertEqual(elements.count, sign_cast(count));
+  // Accesses the elements in reverse order, so that the later elements are created first.
+  for (NSInteger i = count - 1; i >= 0; i -= 5) {
+    NSObject* const e = elements[sign_cast(i)];
+    XCTAssertEqual(e, [element accessibilityElementAtIndex:i]);
+    XCTAssertEqual([element indexOfAccessibilityElement:e], i);
+    XCTAssertEqual(e.accessibilityContainer, element);
+  }
+  XCTAssertNil([element accessibilityElementAtIndex:count]);
+  NSUInteger n = 0;
+  for (NSObject* e in elements) {
+    XCTAssertEqual([element indexOfAccessibilityElement:e], sign_cast(n));
+    ++n;
+  }
+  XCTAssertEqual(n, elements.count);
+}
+
+@end
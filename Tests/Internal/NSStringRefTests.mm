@@ -1,6 +1,7 @@
 // Copyright 2018 Stephan Tolksdorf
 
 #import "NSStringRef.hpp"
+#import "ShapedString.hpp"
 
 #import "TestUtils.h"
 
@@ -273,6 +274,140 @@ static Int lastEndIndexOf(const NSStringRef& string, Range<Int> range, Char32 cp
   }
 }
 
+- (void)testIndexOfFirstUTF16CharIn {
+  const auto test = [&](NSString* nsString, const NSStringRef::UTF16CharSet& set) {
+    const NSStringRef string{nsString};
+    const Int length = string.count();
+    for (Int i = 0; i <= length; ++i) {
+      for (Int j = 0; j <= length; ++j) {
+        const Int index = string.indexOfFirstUTF16CharWhere({i, j}, [&](Char16 ch) {
+                                                                      return set.contains(ch);
+                                                                    });
+        XCTAssertEqual(string.indexOfFirstUTF16CharIn({i, j}, set), index);
+      }
+    }
+  };
+  const auto test3 = [&](NSString* nsString, const NSStringRef::UTF16CharSet& set) {
+    test(nsString, set);
+    test([[NSMutableString alloc] initWithString:nsString], set);
+    test([[StringWrapper alloc] initWithString:nsString], set);
+  };
+  const NSStringRef::UTF16CharSet terminators{0xD, 0xA, 0x2029};
+  test3(@"", terminators);
+  test3(@"a", terminators);
+  test3(@"\n", terminators);
+  test3(@"0123456789abcdef", terminators);
+  test3(@"0123456789abcdef\r\n0123456789abcdef", terminators);
+  test3(@"0123456789abcdef0123456789abcde\n", terminators);
+  test3(@"0123456789abcdef0123456789abcdef0\u2029x", terminators);
+  test3(@"äöü0123456789abcdef\u20290123456789abcdef", terminators);
+  test3(@"äöü0123456789abcdef\u20280123456789abcdef", terminators);
+  test3(@"0123456789abcdef0123456789abcdef", {'f'});
+  test3(@"0123456789abcdef0123456789abcdef", {'x', 'y'});
+  test3(@"0123456789abcdef0123456789abcdef", {0x130, '9', 'x', 'y'});
+  test3(@"😀0123456789abcdef😀0123456789", {0xD83D});
+  test3(@"😀0123456789abcdef😀0123456789", {0xDE00, 'z'});
+}
+
+- (void)testIndexOfFirstLatin1LetterOrNonLatin1Char {
+  for (Char16 ch = 0; ch <= 0xFF; ++ch) {
+    const BidiStrongType bt = bidiStrongType(ch);
+    XCTAssert(bt == BidiStrongType::none || bt == BidiStrongType::ltr);
+    NSString* const string = [NSString stringWithCharacters:&ch length:1];
+    XCTAssertEqual(NSStringRef{string}.indexOfFirstLatin1LetterOrNonLatin1Char({0, 1}),
+                   bt == BidiStrongType::ltr ? 0 : 1);
+  }
+  const auto test = [&](NSString* nsString) {
+    const NSStringRef string{nsString};
+    const Int length = string.count();
+    for (Int i = 0; i <= length; ++i) {
+      for (Int j = 0; j <= length; ++j) {
+        const Int index = string.indexOfFirstUTF16CharWhere({i, j}, [&](Char16 ch) {
+                            return ch > 0xFF || bidiStrongType(ch) == BidiStrongType::ltr;
+                          });
+        XCTAssertEqual(string.indexOfFirstLatin1LetterOrNonLatin1Char({i, j}), index);
+      }
+    }
+  };
+  const auto test3 = [&](NSString* nsString) {
+    test(nsString);
+    test([[NSMutableString alloc] initWithString:nsString]);
+    test([[StringWrapper alloc] initWithString:nsString]);
+  };
+  test3(@"");
+  test3(@"a");
+  test3(@"0123456789 .,;:!?()[]{}");
+  test3(@"0123456789 .,;:!?()[]{}Z");
+  test3(@"0123456789 .,;:!?()[]{}\u00D7\u00F7\u00B5");
+  test3(@"0123456789 .,;:!?()[]{}\u00D7\u00F7\u00C0");
+  test3(@"0123456789 .,;:!?()[]{}\u00AB\u00BB\u00BA");
+  test3(@"0123456789 .,;:!?()[]{}\u05D0");
+  test3(@"0123456789 .,;:!?()[]{}😀");
+}
+
+static NSWritingDirection detectBaseWritingDirectionReference(const NSStringRef& string,
+                                                              Range<Int> range)
+{
+  NSWritingDirection result = NSWritingDirectionNatural;
+  Int isolateCounter = 0;
+  string.indexOfFirstCodePointWhere(range, [&](Char32 cp) -> bool {
+    const BidiStrongType bt = bidiStrongType(cp);
+    if (bt == BidiStrongType::isolate) {
+      isolateCounter += cp == 0x2069 ? -1 : 1;
+      return false;
+    }
+    if (bt == BidiStrongType::none || isolateCounter != 0) return false;
+    result = bt == BidiStrongType::ltr ? NSWritingDirectionLeftToRight
+                                       : NSWritingDirectionRightToLeft;
+    return true;
+  });
+  return result;
+}
+
+static NSArray<NSString*>* multilingualParagraphs() {
+  return @[@"The quick brown fox jumps over the lazy dog.",
+           @"1234567890 – 2018-06-30, 12:00:00 (+0200) [§ 4.2.1]",
+           @"« Ça, c’est très français », a-t-il dit.",
+           @"Größenänderungen überprüfen wir später.",
+           @"Съешь же ещё этих мягких французских булок.",
+           @"Ξεσκεπάζω την ψυχοφθόρα βδελυγμία.",
+           @"١٢٣ عربي ٤٥٦ مرحبا بالعالم",
+           @"123 (456) \"שלום עולם\"",
+           @"😀😁😂🤣😃😄😅😆 🎉 ok",
+           @"2018年6月30日 日本語のテキスト",
+           @"\u2067مرحبا\u2069 after the isolate",
+           @"    \t\t    ...!!! ??? ---- 0000 1111 2222 3333 x"];
+}
+
+- (void)testDetectBaseWritingDirection {
+  for (NSString* const nsString in multilingualParagraphs()) {
+    for (NSString* s in @[nsString, [[StringWrapper alloc] initWithString:nsString]]) {
+      const NSStringRef string{s};
+      for (Int i = 0; i <= string.count(); ++i) {
+        const Range<Int> range{i, string.count()};
+        XCTAssertEqual(detectBaseWritingDirection(string, range, SkipIsolatedText{true}),
+                       detectBaseWritingDirectionReference(string, range));
+      }
+    }
+  }
+}
+
+- (void)testDetectBaseWritingDirectionPerformance {
+  NSMutableArray<NSString*>* const strings = [[NSMutableArray alloc] init];
+  for (NSString* const paragraph in multilingualParagraphs()) {
+    [strings addObject:[paragraph stringByPaddingToLength:paragraph.length*64
+                                               withString:paragraph startingAtIndex:0]];
+  }
+  [self measureBlock:^{
+    for (NSString* const nsString in strings) {
+      const NSStringRef string{nsString};
+      for (Int k = 0; k < 1024; ++k) {
+        detectBaseWritingDirection(string, Range<Int>{0, string.count()}, SkipIsolatedText{true});
+      }
+    }
+  }];
+}
+
 - (void)testIndexOfTrailingWhitespace {
   XCTAssertEqual(NSStringRef(@"").indexOfTrailingWhitespaceIn({}), 0);
   XCTAssertEqual(NSStringRef(@" ").indexOfTrailingWhitespaceIn({0, 1}), 0);
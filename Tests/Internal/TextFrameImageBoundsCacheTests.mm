@@ -0,0 +1,121 @@
+// Copyright 2018 Stephan Tolksdorf
+
+#import "TestUtils.h"
+
+#import "STULabel/STUTextFrame-Unsafe.h"
+
+#import "TextFrame.hpp"
+
+using namespace stu_label;
+
+static STUTextFrame* createTextFrame(void (^ __nullable optionsBlock)(STUTextFrameOptionsBuilder*))
+{
+  STUTextFrameOptions* const options = optionsBlock
+                                     ? [[STUTextFrameOptions alloc] initWithBlock:optionsBlock]
+                                     : nil;
+  NSAttributedString* const string =
+    [[NSAttributedString alloc]
+       initWithString:@"Image bounds of a text frame with a few lines of text."
+           attributes:@{NSFontAttributeName: [UIFont fontWithName:@"HelveticaNeue" size:18]}];
+  STUShapedString* const shapedString =
+    [[STUShapedString alloc] initWithAttributedString:string
+                          defaultBaseWritingDirection:STUWritingDirectionLeftToRight];
+  return [[STUTextFrame alloc] initWithShapedString:shapedString size:CGSize{100, 1000}
+                                       displayScale:2 options:options];
+}
+
+/// The key of an image bounds query for the full range at the origin with nil drawing options.
+static ImageBoundsCacheKey fullRangeKey(STUTextFrame* textFrame) {
+  ImageBoundsCacheKey key{};
+  key.range = STUTextFrameGetRange(textFrame);
+  key.displayScale = textFrame->data->displayScale;
+  return key;
+}
+
+static Rect<CGFloat> imageBounds(STUTextFrame* textFrame,
+                                 const STUCancellationFlag* __nullable cancellationFlag = nullptr)
+{
+  return STUTextFrameGetImageBoundsForRange(textFrame, STUTextFrameGetRange(textFrame), CGPoint{},
+                                            textFrame->data->displayScale, nil, cancellationFlag);
+}
+
+@interface TextFrameImageBoundsCacheTests : XCTestCase
+@end
+@implementation TextFrameImageBoundsCacheTests
+
+- (void)testCachedResultIsReturned {
+  STUTextFrame* const textFrame = createTextFrame(nil);
+  const TextFrame& tf = textFrameRef(textFrame);
+  XCTAssert(!tf.cachedImageBounds(fullRangeKey(textFrame)));
+  const Rect<CGFloat> bounds = imageBounds(textFrame);
+  XCTAssert(!bounds.isEmpty());
+  const Optional<Rect<CGFloat>> cachedBounds = tf.cachedImageBounds(fullRangeKey(textFrame));
+  XCTAssert(cachedBounds && *cachedBounds == bounds);
+  // A cancelled calculation wouldn't produce the full bounds, so the result must come from the
+  // cache.
+  CancellationFlag cancelledFlag;
+  STUCancellationFlagSetCancelled(&cancelledFlag);
+  XCTAssert(imageBounds(textFrame, &cancelledFlag) == bounds);
+  // A query with different parameters isn't answered from the cache.
+  ImageBoundsCacheKey otherKey = fullRangeKey(textFrame);
+  otherKey.origin = CGPoint{1, 0};
+  XCTAssert(!tf.cachedImageBounds(otherKey));
+}
+
+- (void)testCancelledCalculationIsNotCached {
+  STUTextFrame* const textFrame = createTextFrame(nil);
+  const TextFrame& tf = textFrameRef(textFrame);
+  CancellationFlag cancelledFlag;
+  STUCancellationFlagSetCancelled(&cancelledFlag);
+  imageBounds(textFrame, &cancelledFlag);
+  XCTAssert(!tf.cachedImageBounds(fullRangeKey(textFrame)));
+  const Rect<CGFloat> bounds = imageBounds(textFrame);
+  XCTAssert(!bounds.isEmpty());
+  const Optional<Rect<CGFloat>> cachedBounds = tf.cachedImageBounds(fullRangeKey(textFrame));
+  XCTAssert(cachedBounds && *cachedBounds == bounds);
+}
+
+- (void)testImageBoundsCachingCanBeDisabled {
+  STUTextFrame* const textFrame = createTextFrame(^(STUTextFrameOptionsBuilder* builder) {
+                                    builder.cachesImageBounds = false;
+                                    builder.precomputesImageBounds = true;
+                                  });
+  const TextFrame& tf = textFrameRef(textFrame);
+  const size_t cacheSize = textFrame.memoryUsage.cacheSize;
+  const Rect<CGFloat> bounds = imageBounds(textFrame);
+  XCTAssert(!bounds.isEmpty());
+  XCTAssert(!tf.cachedImageBounds(fullRangeKey(textFrame)));
+  XCTAssert(imageBounds(textFrame) == bounds);
+  XCTAssertEqual(textFrame.memoryUsage.cacheSize, cacheSize);
+}
+
+- (void)testImageBoundsArePrecomputedOnBackgroundThread {
+  __block STUTextFrame* textFrame;
+  dispatch_sync(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+    textFrame = createTextFrame(^(STUTextFrameOptionsBuilder* builder) {
+                  builder.precomputesImageBounds = true;
+                });
+  });
+  const Optional<Rect<CGFloat>> cachedBounds =
+    textFrameRef(textFrame).cachedImageBounds(fullRangeKey(textFrame));
+  XCTAssert(cachedBounds);
+  XCTAssert(cachedBounds && *cachedBounds == imageBounds(createTextFrame(nil)));
+}
+
+- (void)testImageBoundsArePrecomputedAsynchronouslyOnMainThread {
+  XCTAssert(NSThread.isMainThread);
+  STUTextFrame* const textFrame = createTextFrame(^(STUTextFrameOptionsBuilder* builder) {
+                                    builder.precomputesImageBounds = true;
+                                  });
+  const TextFrame* const tf = &textFrameRef(textFrame);
+  const ImageBoundsCacheKey key = fullRangeKey(textFrame);
+  XCTestExpectation* const expectation =
+    [[XCTNSPredicateExpectation alloc]
+       initWithPredicate:[NSPredicate predicateWithBlock:^BOOL(id, NSDictionary*) {
+                           return tf->cachedImageBounds(key) ? YES : NO;
+                         }]
+                  object:nil];
+  [self waitForExpectations:@[expectation] timeout:10];
+}
+
+@end
@@ -0,0 +1,245 @@
+// Copyright 2018 Stephan Tolksdorf
+
+#import "TestUtils.h"
+
+#import "STULabel/STUTextFrame-Unsafe.h"
+
+#import "TextFrame.hpp"
+
+#include <string.h>
+
+using namespace stu_label;
+
+static STUShapedString* shapedString() {
+  UIFont* const font = [UIFont fontWithName:@"HelveticaNeue" size:16];
+  NSMutableAttributedString* const string =
+    [[NSMutableAttributedString alloc]
+       initWithString:@"Text with a link that spans multiple lines.\nTruncated paragraph text"
+           attributes:@{NSFontAttributeName: font}];
+  [string addAttribute:NSLinkAttributeName value:[NSURL URLWithString:@"https://example.com"]
+                 range:NSRange{12, 4}];
+  return [[STUShapedString alloc] initWithAttributedString:string
+                               defaultBaseWritingDirection:STUWritingDirectionLeftToRight];
+}
+
+static STUTextFrame* truncatedTextFrame(STUShapedString* shapedString) {
+  STUTextFrameOptions* const options =
+    [[STUTextFrameOptions alloc] initWithBlock:^(STUTextFrameOptionsBuilder* builder) {
+      builder.maximumNumberOfLines = 3;
+      builder.truncationToken =
+        [[NSAttributedString alloc]
+           initWithString:@"…"
+               attributes:@{NSFontAttributeName: [UIFont fontWithName:@"HelveticaNeue" size:16],
+                            NSForegroundColorAttributeName: UIColor.redColor}];
+    }];
+  STUTextFrame* const textFrame = [[STUTextFrame alloc] initWithShapedString:shapedString
+                                                                        size:CGSize{120, 1000}
+                                                                displayScale:2
+                                                                     options:options];
+  return textFrame;
+}
+
+/// Returns a copy of `data` in which the first occurrence of `original` is replaced by
+/// `replacement`, or nil if `data` doesn't contain `original`.
+static NSData* __nullable replacingBytes(NSData* data, const void* original,
+                                         const void* replacement, size_t size)
+{
+  const void* const p = memmem(data.bytes, data.length, original, size);
+  if (!p) return nil;
+  NSMutableData* const result = [data mutableCopy];
+  memcpy(static_cast<Byte*>(result.mutableBytes) + (static_cast<const Byte*>(p)
+                                                    - static_cast<const Byte*>(data.bytes)),
+         replacement, size);
+  return result;
+}
+
+/// The bytes of a line as stored in a snapshot.
+struct SerializedLine {
+  alignas(TextFrameLine) Byte bytes[sizeof(TextFrameLine)];
+
+  explicit SerializedLine(const TextFrameLine& line) {
+    memcpy(bytes, &line, sizeof(bytes));
+    this->line()._ctLine = nullptr;
+    this->line()._tokenCTLine = nullptr;
+  }
+
+  TextFrameLine& line() { return *reinterpret_cast<TextFrameLine*>(bytes); }
+};
+
+/// The bytes of a paragraph as stored in a snapshot.
+struct SerializedParagraph {
+  alignas(TextFrameParagraph) Byte bytes[sizeof(TextFrameParagraph)];
+
+  explicit SerializedParagraph(const TextFrameParagraph& para) {
+    memcpy(bytes, &para, sizeof(bytes));
+    this->para().truncationToken = nil;
+  }
+
+  TextFrameParagraph& para() { return *reinterpret_cast<TextFrameParagraph*>(bytes); }
+};
+
+@interface TextFrameSnapshotValidationTests : XCTestCase
+@end
+@implementation TextFrameSnapshotValidationTests {
+  STUShapedString* _shapedString;
+  STUTextFrame* _textFrame;
+  NSData* _data;
+}
+
+- (void)setUp {
+  [super setUp];
+  self.continueAfterFailure = false;
+  _shapedString = shapedString();
+  _textFrame = truncatedTextFrame(_shapedString);
+  XCTAssert(_textFrame->data->flags & STUTextFrameIsTruncated);
+  XCTAssertGreaterThanOrEqual(_textFrame->data->lineCount, 3);
+  _data = _textFrame.snapshotData;
+  XCTAssertNotNil(_data);
+}
+
+- (void)checkModifiedDataIsRejected:(NSData* __nullable)data {
+  XCTAssertNotNil(data);
+  XCTAssertNotNil([STUTextFrame textFrameWithSnapshotData:_data shapedString:_shapedString]);
+  XCTAssertNil([STUTextFrame textFrameWithSnapshotData:data shapedString:_shapedString]);
+}
+
+- (void)checkModifiedLine:(Int)lineIndex isRejected:(void (^)(TextFrameLine&))modify {
+  const TextFrameLine& line = textFrameRef(_textFrame).lines()[lineIndex];
+  SerializedLine original{line};
+  SerializedLine modified{line};
+  modify(modified.line());
+  [self checkModifiedDataIsRejected:replacingBytes(_data, original.bytes, modified.bytes,
+                                                   sizeof(original.bytes))];
+}
+
+- (void)checkModifiedParagraph:(Int)paraIndex isRejected:(void (^)(TextFrameParagraph&))modify {
+  const TextFrameParagraph& para = textFrameRef(_textFrame).paragraphs()[paraIndex];
+  SerializedParagraph original{para};
+  SerializedParagraph modified{para};
+  modify(modified.para());
+  [self checkModifiedDataIsRejected:replacingBytes(_data, original.bytes, modified.bytes,
+                                                   sizeof(original.bytes))];
+}
+
+- (void)testUnmodifiedDataIsAccepted {
+  const TextFrameLine& line = textFrameRef(_textFrame).lines()[1];
+  SerializedLine original{line};
+  NSData* const data = replacingBytes(_data, original.bytes, original.bytes,
+                                      sizeof(original.bytes));
+  XCTAssertNotNil(data);
+  XCTAssertNotNil([STUTextFrame textFrameWithSnapshotData:data shapedString:_shapedString]);
+}
+
+- (void)testLineTextStylesOffsetMustBeStyleBoundary {
+  [self checkModifiedLine:1 isRejected:^(TextFrameLine& line) {
+    line._textStylesOffset += 4;
+  }];
+}
+
+- (void)testLineTextStylesOffsetsMustBeNondecreasing {
+  const Int lastIndex = textFrameRef(_textFrame).lineCount - 1;
+  [self checkModifiedLine:lastIndex isRejected:^(TextFrameLine& line) {
+    line._textStylesOffset = 0;
+  }];
+}
+
+- (void)testTokenStylesOffsetMustBeStyleSequenceStart {
+  Int lineIndex = -1;
+  for (const TextFrameLine& line : textFrameRef(_textFrame).lines()) {
+    if (line.hasTruncationToken) {
+      lineIndex = line.lineIndex;
+    }
+  }
+  XCTAssertGreaterThanOrEqual(lineIndex, 0);
+  [self checkModifiedLine:lineIndex isRejected:^(TextFrameLine& line) {
+    line._tokenStylesOffset += 4;
+  }];
+  [self checkModifiedLine:lineIndex isRejected:^(TextFrameLine& line) {
+    line._tokenStylesOffset = line._textStylesOffset;
+  }];
+}
+
+- (void)testLineTruncatedStringRangeMustBeInBounds {
+  const Int32 truncatedStringLength = textFrameRef(_textFrame).truncatedStringLength;
+  [self checkModifiedLine:0 isRejected:^(TextFrameLine& line) {
+    line.rangeInTruncatedString.end = truncatedStringLength + 1;
+  }];
+}
+
+- (void)testParagraphExcisedRangeMustBeInParagraphRange {
+  [self checkModifiedParagraph:0 isRejected:^(TextFrameParagraph& para) {
+    para.excisedRangeInOriginalString.end = para.rangeInOriginalString.end + 1;
+  }];
+  [self checkModifiedParagraph:0 isRejected:^(TextFrameParagraph& para) {
+    para.excisedRangeInOriginalString.start = para.rangeInOriginalString.start - 1;
+  }];
+}
+
+- (void)testParagraphTruncatedRangeMustBeConsistent {
+  [self checkModifiedParagraph:0 isRejected:^(TextFrameParagraph& para) {
+    para.rangeInTruncatedString.end += 1;
+  }];
+  [self checkModifiedParagraph:0 isRejected:^(TextFrameParagraph& para) {
+    para.truncationTokenLength += 1;
+  }];
+}
+
+- (void)testParagraphInitialLinesEndIndexMustBeInLineIndexRange {
+  [self checkModifiedParagraph:0 isRejected:^(TextFrameParagraph& para) {
+    para.initialLinesEndIndex = para.lineIndexRange.end + 1;
+  }];
+}
+
+- (void)testLineStringIndicesMustBeMonotonic {
+  const ArrayRef<const StringStartIndices> indices = textFrameRef(_textFrame).lineStringIndices();
+  const size_t size = sign_cast(indices.arraySizeInBytes());
+  NSMutableData* const modified = [NSMutableData dataWithBytes:indices.begin() length:size];
+  StringStartIndices* const modifiedIndices =
+    static_cast<StringStartIndices*>(modified.mutableBytes);
+  std::swap(modifiedIndices[1], modifiedIndices[2]);
+  [self checkModifiedDataIsRejected:replacingBytes(_data, indices.begin(), modified.bytes, size)];
+}
+
+- (void)checkModifiedVerticalSearchTableIsRejected:(void (^)(Float32* endValues,
+                                                             Float32* startValues, Int count))modify
+{
+  const IntervalSearchTable table = textFrameRef(_textFrame).verticalSearchTable();
+  const Int count = table.endValues().count();
+  const size_t size = IntervalSearchTable::sizeInBytesForCount(count);
+  NSMutableData* const modified = [NSMutableData dataWithBytes:table.endValues().begin()
+                                                        length:size];
+  Float32* const values = static_cast<Float32*>(modified.mutableBytes);
+  modify(values, values + count, count);
+  [self checkModifiedDataIsRejected:replacingBytes(_data, table.endValues().begin(),
+                                                   modified.bytes, size)];
+}
+
+- (void)testVerticalSearchTableMustNotContainNaN {
+  [self checkModifiedVerticalSearchTableIsRejected:^(Float32*, Float32* startValues, Int) {
+    startValues[0] = NAN;
+  }];
+}
+
+- (void)testVerticalSearchTableMustBeIncreasing {
+  [self checkModifiedVerticalSearchTableIsRejected:^(Float32* endValues, Float32*, Int count) {
+    endValues[count - 1] = endValues[count - 2] - 1;
+  }];
+}
+
+- (void)testTextStyleColorIndicesMustBeValid {
+  const TextFrame& tf = textFrameRef(_textFrame);
+  const TextStyle& style = *reinterpret_cast<const TextStyle*>(tf._textStylesData);
+  XCTAssert(!style.isBig());
+  // The first style and the bits of the second style contain no object pointers.
+  const size_t size = 16;
+  XCTAssertGreaterThanOrEqual(tf.textStylesDataSize(), 16);
+  Byte modified[size];
+  memcpy(modified, tf._textStylesData, size);
+  UInt64 bits;
+  memcpy(&bits, modified, sizeof(bits));
+  bits |= UInt64{TextStyle::maxSmallColorIndex} << TextStyle::BitIndex::Small::color;
+  memcpy(modified, &bits, sizeof(bits));
+  [self checkModifiedDataIsRejected:replacingBytes(_data, tf._textStylesData, modified, size)];
+}
+
+@end
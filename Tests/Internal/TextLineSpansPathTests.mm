@@ -389,5 +389,113 @@ using VP = TextLineVerticalPosition;
                        @"_1_rounded_outset_20");
 }
 
+- (void)testCreateLineSpansPathUsingCache {
+  ThreadLocalArenaAllocator::InitialBuffer<1024> buffer;
+  ThreadLocalArenaAllocator alloc{Ref{buffer}};
+
+  clearLineSpansPathCache();
+
+  const Vector<TextLineSpan> spans = createSpansForStars(10, 10, "  ***  **\n*** *\n    ***");
+  Vector<TextLineVerticalPosition> vps;
+  for (Int i = 0; i < 3; ++i) {
+    vps.append(TextLineVerticalPosition{.baseline = 20.0*(i + 1), .ascent = 12, .descent = 6});
+  }
+  const AddLineSpansPathArgs args = {.fillTextLineGaps = true,
+                                     .edgeInsets = UIEdgeInsets{-1, -2, -1, -2},
+                                     .cornerRadius = 3};
+  const auto createCachedPath = [&](ArrayRef<const TextLineVerticalPosition> vps) {
+    return createLineSpansPathUsingCache(
+             spans, vps, ShouldFillTextLineGaps{args.fillTextLineGaps},
+             ShouldExtendTextLinesToCommonHorizontalBounds{args.shouldExtendToCommonBounds},
+             args.edgeInsets, CornerRadius{args.cornerRadius});
+  };
+  const RC<CGPath> path = createPathWithSpans(spans, vps, args);
+  const RC<CGPath> cachedPath1 = createCachedPath(vps);
+  XCTAssert(CGPathEqualToPath(path.get(), cachedPath1.get()));
+  const RC<CGPath> cachedPath2 = createCachedPath(vps);
+  XCTAssertEqual(cachedPath1.get(), cachedPath2.get());
+
+  vps[1].baseline += 1;
+  const RC<CGPath> cachedPath3 = createCachedPath(vps);
+  XCTAssertNotEqual(cachedPath1.get(), cachedPath3.get());
+  XCTAssert(CGPathEqualToPath(createPathWithSpans(spans, vps, args).get(), cachedPath3.get()));
+
+  clearLineSpansPathCache();
+  vps[1].baseline -= 1;
+  const RC<CGPath> cachedPath4 = createCachedPath(vps);
+  XCTAssertNotEqual(cachedPath1.get(), cachedPath4.get());
+  XCTAssert(CGPathEqualToPath(path.get(), cachedPath4.get()));
+}
+
+/// The iteration count is inversely proportional to the span count, so that the measured times of
+/// the different span counts can be compared as throughput per span.
+- (void)measureAddLineSpansPathWithSpanCount:(Int)spanCount useCache:(bool)useCache {
+  const Int lineCount = min(spanCount, Int{64});
+  const Int iterationCount = 64000/spanCount;
+  Vector<TextLineVerticalPosition> vps;
+  for (Int i = 0; i < lineCount; ++i) {
+    vps.append(TextLineVerticalPosition{.baseline = 20.0*(i + 1), .ascent = 12, .descent = 6});
+  }
+  // One span per line, or more if there are more spans than lines. The varying offsets and widths
+  // make the rounded paths of spans in adjacent lines non-trivial.
+  Vector<TextLineSpan> spans;
+  const Int spansPerLine = max(Int{1}, spanCount/lineCount);
+  for (Int i = 0; i < spanCount; ++i) {
+    const Int lineIndex = i/spansPerLine;
+    const Int indexInLine = i%spansPerLine;
+    const Float64 x = 100.0*indexInLine + 7*(lineIndex%5);
+    spans.append(TextLineSpan{.x = Range{x, x + 50 + 3*(lineIndex%7)},
+                              .lineIndex = narrow_cast<stu::UInt32>(lineIndex)});
+  }
+  for (Int i = 0; i < spanCount; ++i) {
+    spans[i].isLeftEndOfLine = i == 0 || spans[i - 1].lineIndex != spans[i].lineIndex;
+    spans[i].isRightEndOfLine = i == spanCount - 1
+                             || spans[i + 1].lineIndex != spans[i].lineIndex;
+  }
+  const ArrayRef<const TextLineSpan> spansRef = spans;
+  const ArrayRef<const TextLineVerticalPosition> vpsRef = vps;
+  clearLineSpansPathCache();
+  [self measureBlock:^{
+    ThreadLocalArenaAllocator::InitialBuffer<4096> buffer;
+    ThreadLocalArenaAllocator alloc{Ref{buffer}};
+    for (Int k = 0; k < iterationCount; ++k) {
+      if (useCache) {
+        const RC<CGPath> path = createLineSpansPathUsingCache(
+                                  spansRef, vpsRef, ShouldFillTextLineGaps{true},
+                                  ShouldExtendTextLinesToCommonHorizontalBounds{false},
+                                  STUEdgeInsets{}, CornerRadius{4});
+      } else {
+        const RC<CGPath> path = createPathWithSpans(spansRef, vpsRef,
+                                                    {.fillTextLineGaps = true, .cornerRadius = 4});
+      }
+    }
+  }];
+  clearLineSpansPathCache();
+}
+
+- (void)testAddLineSpansPathPerformanceWith8Spans {
+  [self measureAddLineSpansPathWithSpanCount:8 useCache:false];
+}
+
+- (void)testAddLineSpansPathPerformanceWith64Spans {
+  [self measureAddLineSpansPathWithSpanCount:64 useCache:false];
+}
+
+- (void)testAddLineSpansPathPerformanceWith512Spans {
+  [self measureAddLineSpansPathWithSpanCount:512 useCache:false];
+}
+
+- (void)testCachedLineSpansPathPerformanceWith8Spans {
+  [self measureAddLineSpansPathWithSpanCount:8 useCache:true];
+}
+
+- (void)testCachedLineSpansPathPerformanceWith64Spans {
+  [self measureAddLineSpansPathWithSpanCount:64 useCache:true];
+}
+
+- (void)testCachedLineSpansPathPerformanceWith512Spans {
+  [self measureAddLineSpansPathWithSpanCount:512 useCache:true];
+}
+
 @end
 
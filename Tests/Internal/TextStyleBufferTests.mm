@@ -167,6 +167,56 @@ static NSDictionary<NSAttributedStringKey, id>* lotsOfAttributes() {
   }
 }
 
+- (void)testAttributesMemoization {
+  ThreadLocalArenaAllocator::InitialBuffer<2048> allocBuffer;
+  ThreadLocalArenaAllocator alloc{Ref{allocBuffer}};
+
+  LocalFontInfoCache fontInfoCache;
+  TextStyleBuffer buffer{Ref{fontInfoCache}, alloc};
+
+  NSMutableDictionary<NSAttributedStringKey, id>* NS_VALID_UNTIL_END_OF_SCOPE
+    attributes1 = [lotsOfAttributes() mutableCopy];
+  [attributes1 removeObjectForKey:STUAttachmentAttributeName];
+  attributes1[NSParagraphStyleAttributeName] = NSParagraphStyle.defaultParagraphStyle;
+  NSDictionary* NS_VALID_UNTIL_END_OF_SCOPE attributes1b = [attributes1 copy];
+  NSDictionary* NS_VALID_UNTIL_END_OF_SCOPE attributes2 =
+    @{NSForegroundColorAttributeName: UIColor.yellowColor};
+
+  TextStyleBuffer::ParagraphAttributes pas1;
+  TextStyleBuffer::ParagraphAttributes pas1b;
+  TextStyleBuffer::ParagraphAttributes pas2;
+  const auto flags1 = buffer.encodeStringRangeStyle(Range{0, 1}, attributes1, Out{pas1});
+  buffer.encodeStringRangeStyle(Range{1, 2}, attributes2, Out{pas2});
+  XCTAssertEqual(buffer.encodeStringRangeStyle(Range{2, 3}, attributes1, Out{pas1b}), flags1);
+  XCTAssertEqual(pas1b.style, pas1.style);
+  XCTAssertNil(pas2.style);
+  buffer.encodeStringRangeStyle(Range{3, 4}, attributes2);
+  XCTAssertEqual(buffer.encodeStringRangeStyle(Range{4, TextStyle::maxSmallStringIndex + 2},
+                                               attributes1b), flags1);
+  buffer.addStringTerminatorStyle();
+
+  const TextStyle& s0 = *reinterpret_cast<const TextStyle*>(buffer.data().begin());
+  const TextStyle& s2 = s0.next().next();
+  const TextStyle& s4 = s2.next().next();
+  XCTAssertEqual(s2.stringIndex(), 2);
+  XCTAssertEqual(s4.stringIndex(), 4);
+  XCTAssert(!s0.isBig());
+  XCTAssert(s4.isBig());
+  for (const TextStyle* s : {&s2, &s4}) {
+    XCTAssertEqual(s->flags(), s0.flags());
+    XCTAssertEqual(s->fontIndex(), s0.fontIndex());
+    XCTAssertEqual(s->colorIndex(), s0.colorIndex());
+    XCTAssertEqual(s->linkInfo()->attribute, s0.linkInfo()->attribute);
+    XCTAssertEqual(s->backgroundInfo()->stuAttribute, s0.backgroundInfo()->stuAttribute);
+    XCTAssertEqual(s->shadowInfo()->colorIndex, s0.shadowInfo()->colorIndex);
+    XCTAssertEqual(s->underlineInfo()->style(), s0.underlineInfo()->style());
+    XCTAssertEqual(s->strikethroughInfo()->style, s0.strikethroughInfo()->style);
+    XCTAssertEqual(s->strokeInfo()->strokeWidth, s0.strokeInfo()->strokeWidth);
+    XCTAssertEqual(s->baselineOffsetInfo()->baselineOffset,
+                   s0.baselineOffsetInfo()->baselineOffset);
+  }
+}
+
 - (void)testColorOverflowHandling {
   ThreadLocalArenaAllocator::InitialBuffer<2048> allocBuffer;
   ThreadLocalArenaAllocator alloc{Ref{allocBuffer}};
@@ -0,0 +1,151 @@
+// Copyright 2018 Stephan Tolksdorf
+
+#import "TestUtils.h"
+
+#import "STULabel/STUTextFrame-Unsafe.h"
+
+#import "TextFrame.hpp"
+
+using namespace stu_label;
+
+static STUTextFrame* createTextFrame(NSAttributedString* string, CGFloat width,
+                                     Int maxLineCount, STULastLineTruncationMode mode)
+{
+  STUTextFrameOptions* const options =
+    [[STUTextFrameOptions alloc] initWithBlock:^(STUTextFrameOptionsBuilder* builder) {
+      builder.textLayoutMode = STUTextLayoutModeTextKit;
+      builder.maximumNumberOfLines = maxLineCount;
+      builder.lastLineTruncationMode = mode;
+      builder.truncationToken =
+        [[NSAttributedString alloc]
+           initWithString:@"[…]"
+               attributes:@{NSFontAttributeName: [UIFont fontWithName:@"HelveticaNeue" size:14],
+                            NSForegroundColorAttributeName: UIColor.redColor}];
+    }];
+  STUShapedString* const shapedString =
+    [[STUShapedString alloc] initWithAttributedString:string
+                          defaultBaseWritingDirection:STUWritingDirectionLeftToRight];
+  return [[STUTextFrame alloc] initWithShapedString:shapedString size:CGSize{width, 10000}
+                                       displayScale:2 options:options];
+}
+
+static NSAttributedString* multiParagraphString() {
+  UIFont* const font = [UIFont fontWithName:@"HelveticaNeue" size:16];
+  NSMutableAttributedString* const string = [[NSMutableAttributedString alloc] init];
+  NSArray<NSString*>* const paragraphs = @[@"The first paragraph has a few words.\n",
+                                           @"The second paragraph has a few more words.\n",
+                                           @"The third one is short.\n",
+                                           @"And the fourth paragraph is the last one."];
+  [paragraphs enumerateObjectsUsingBlock:^(NSString* paragraph, NSUInteger i, BOOL*) {
+    [string appendAttributedString:
+              [[NSAttributedString alloc]
+                 initWithString:paragraph
+                     attributes:@{NSFontAttributeName: font,
+                                  NSUnderlineStyleAttributeName: @(i%2)}]];
+  }];
+  [string addAttribute:NSForegroundColorAttributeName value:UIColor.blueColor
+                 range:NSRange{4, 30}];
+  return string;
+}
+
+@interface TruncatedAttributedStringTests : XCTestCase
+@end
+@implementation TruncatedAttributedStringTests
+
+- (void)setUp {
+  [super setUp];
+  self.continueAfterFailure = false;
+}
+
+- (void)checkAttributeRunsOfTextFrame:(const TextFrame&)textFrame range:(Range<Int32>)range
+                   equalThoseOfString:(NSAttributedString*)expected
+{
+  Int32 index = range.start;
+  textFrame.forEachTruncatedStringAttributeRun(range,
+    [&](const TruncatedStringRun& run) -> ShouldStop
+  {
+    XCTAssertEqual(run.rangeInTruncatedString.start, index);
+    XCTAssertLessThan(run.rangeInTruncatedString.start, run.rangeInTruncatedString.end);
+    XCTAssertLessThanOrEqual(run.rangeInTruncatedString.end, range.end);
+    XCTAssertEqual(run.rangeInSource.count(), run.rangeInTruncatedString.count());
+    NSRange expectedRange;
+    NSDictionary* const expectedAttributes =
+      [expected attributesAtIndex:sign_cast(run.rangeInTruncatedString.start)
+                   effectiveRange:&expectedRange];
+    XCTAssertEqualObjects(run.attributes, expectedAttributes);
+    XCTAssertLessThanOrEqual(run.rangeInTruncatedString.end, NSMaxRange(expectedRange));
+    XCTAssertEqualObjects([run.source.string substringWithRange:NSRange(run.rangeInSource)],
+                          [expected.string substringWithRange:
+                                             NSRange(run.rangeInTruncatedString)]);
+    index = run.rangeInTruncatedString.end;
+    return ShouldStop{};
+  });
+  XCTAssertEqual(index, range.end);
+}
+
+/// Compares the attribute runs and substrings of a text frame whose truncated string hasn't been
+/// created yet with the fully created truncated string, for all subranges with bounds on a grid.
+- (void)checkTruncatedStringOfTextFrame:(STUTextFrame*)textFrame
+               againstEqualTextFrame:(STUTextFrame*)otherTextFrame
+{
+  const TextFrame& tf = textFrameRef(*textFrame->data);
+  XCTAssert(tf.flags & STUTextFrameIsTruncated);
+  NSAttributedString* const expected = otherTextFrame.truncatedAttributedString;
+  XCTAssertEqual(expected.length, sign_cast(tf.truncatedStringLength));
+  XCTAssertLessThan(expected.length, textFrame.originalAttributedString.length);
+  const Int32 length = tf.truncatedStringLength;
+  for (Int32 start = 0; start <= length; start += 3) {
+    for (Int32 end = start; end <= length; end += (end + 5 < length ? 5 : 1)) {
+      const Range<Int32> range{start, end};
+      XCTAssertEqualObjects(tf.truncatedAttributedSubstring(range),
+                            [expected attributedSubstringFromRange:NSRange(range)]);
+      [self checkAttributeRunsOfTextFrame:tf range:range equalThoseOfString:expected];
+    }
+  }
+  // The functions above must not have created the full truncated string.
+  XCTAssert(!atomic_load_explicit(const_cast<_Atomic(CFAttributedStringRef)*>(
+                                    &tf._truncatedAttributedString),
+                                  memory_order_relaxed));
+  XCTAssertEqualObjects(textFrame.truncatedAttributedString, expected);
+  const Range<Int32> fullRange{0, length};
+  XCTAssertEqualObjects(tf.truncatedAttributedSubstring(fullRange), expected);
+  [self checkAttributeRunsOfTextFrame:tf range:fullRange equalThoseOfString:expected];
+}
+
+- (void)checkTruncatedStringWithString:(NSAttributedString*)string width:(CGFloat)width
+                          maxLineCount:(Int)maxLineCount mode:(STULastLineTruncationMode)mode
+{
+  [self checkTruncatedStringOfTextFrame:createTextFrame(string, width, maxLineCount, mode)
+                  againstEqualTextFrame:createTextFrame(string, width, maxLineCount, mode)];
+}
+
+- (void)testSingleLineTruncation {
+  NSAttributedString* const string = [multiParagraphString()
+                                        attributedSubstringFromRange:NSRange{0, 35}];
+  for (const STULastLineTruncationMode mode : {STULastLineTruncationModeStart,
+                                               STULastLineTruncationModeMiddle,
+                                               STULastLineTruncationModeEnd})
+  {
+    [self checkTruncatedStringWithString:string width:150 maxLineCount:1 mode:mode];
+  }
+}
+
+- (void)testTruncationWithExcisionAcrossMultipleParagraphs {
+  NSAttributedString* const string = multiParagraphString();
+  for (const STULastLineTruncationMode mode : {STULastLineTruncationModeStart,
+                                               STULastLineTruncationModeMiddle,
+                                               STULastLineTruncationModeEnd})
+  {
+    STUTextFrame* const textFrame = createTextFrame(string, 200, 2, mode);
+    const TextFrame& tf = textFrameRef(*textFrame->data);
+    bool excisionIsContinuedInNextParagraph = false;
+    for (const TextFrameParagraph& para : tf.paragraphs()) {
+      excisionIsContinuedInNextParagraph |= para.excisedStringRangeIsContinuedInNextParagraph;
+    }
+    XCTAssert(excisionIsContinuedInNextParagraph);
+    [self checkTruncatedStringOfTextFrame:textFrame
+                    againstEqualTextFrame:createTextFrame(string, 200, 2, mode)];
+  }
+}
+
+@end
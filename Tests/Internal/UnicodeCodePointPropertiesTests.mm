@@ -226,5 +226,58 @@ static GraphemeClusterCategory graphemeClusterCategoryFromICU(Char32 cp) {
 
 #endif
 
+/// Every measurement does the same number of lookups, cycling through the code points of the
+/// range, so that the measured times of different scripts can be compared as lookups per second.
+- (void)measureCodePointPropertiesLookupsInRange:(Range<Char32>)range {
+  const Int lookupCount = 1 << 20;
+  __block UInt sum = 0;
+  [self measureBlock:^{
+    Char32 cp = range.start;
+    for (Int k = 0; k < lookupCount; ++k) {
+      sum += CodePointProperties{cp}.bits;
+      if (++cp == range.end) {
+        cp = range.start;
+      }
+    }
+  }];
+  XCTAssertNotEqual(sum, 0u);
+}
+
+- (void)testCodePointPropertiesLookupPerformanceLatin {
+  [self measureCodePointPropertiesLookupsInRange:Range<Char32>{0x20, 0x250}];
+}
+
+- (void)testCodePointPropertiesLookupPerformanceCyrillic {
+  [self measureCodePointPropertiesLookupsInRange:Range<Char32>{0x400, 0x500}];
+}
+
+- (void)testCodePointPropertiesLookupPerformanceArabic {
+  [self measureCodePointPropertiesLookupsInRange:Range<Char32>{0x600, 0x700}];
+}
+
+- (void)testCodePointPropertiesLookupPerformanceDevanagari {
+  [self measureCodePointPropertiesLookupsInRange:Range<Char32>{0x900, 0x980}];
+}
+
+- (void)testCodePointPropertiesLookupPerformanceCJK {
+  [self measureCodePointPropertiesLookupsInRange:Range<Char32>{0x4E00, 0xA000}];
+}
+
+- (void)testCodePointPropertiesLookupPerformanceHangul {
+  [self measureCodePointPropertiesLookupsInRange:Range<Char32>{0xAC00, 0xD7A4}];
+}
+
+- (void)testCodePointPropertiesLookupPerformanceEmoji {
+  [self measureCodePointPropertiesLookupsInRange:Range<Char32>{0x1F300, 0x1FB00}];
+}
+
+- (void)testCodePointPropertiesLookupPerformanceCJKExtensionB {
+  [self measureCodePointPropertiesLookupsInRange:Range<Char32>{0x20000, 0x2A6E0}];
+}
+
+- (void)testCodePointPropertiesLookupPerformanceTags {
+  [self measureCodePointPropertiesLookupsInRange:Range<Char32>{0xE0000, 0xE0080}];
+}
+
 @end
 
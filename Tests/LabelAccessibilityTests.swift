@@ -0,0 +1,75 @@
+// Copyright 2018 Stephan Tolksdorf
+
+import STULabelSwift
+
+import XCTest
+
+class LabelAccessibilityTests: XCTestCase {
+
+  let font = UIFont(name: "HelveticaNeue", size: 18)!
+
+  private func labelWithManyLinkParagraphs() -> STULabel {
+    let string = NSMutableAttributedString(
+                   (0..<100).map { "Paragraph \($0) with a link and some more text." }
+                            .joined(separator: "\n"),
+                   [.font: font])
+    let nsString = string.string as NSString
+    var range = NSRange(location: 0, length: 0)
+    while true {
+      range = nsString.range(of: "link", range: NSRange(range.upperBound..<nsString.length))
+      if range.location == NSNotFound { break }
+      string.addAttribute(.link, value: URL(string: "https://example.com")!, range: range)
+    }
+    let label = STULabel(frame: CGRect(x: 0, y: 0, width: 200, height: 10000))
+    label.maximumNumberOfLines = 0
+    label.attributedText = string
+    return label
+  }
+
+  func testAccessibilityElementCreatesSubelementsLazily() {
+    let label = labelWithManyLinkParagraphs()
+    let element = label.accessibilityElement
+    let first = element.accessibilityElement(at: 0) as! NSObject
+    XCTAssertEqual(element.index(ofAccessibilityElement: first), 0)
+    XCTAssertEqual(first.accessibilityLabel, "Paragraph 0 with a link and some more text.")
+
+    label.accessibilityElementSeparatesLinkElements = true
+    label.accessibilityElementSeparatesLinkElements = false
+    let eagerElement = label.accessibilityElement
+    let count = eagerElement.accessibilityElementCount()
+    XCTAssertGreaterThan(count, 100)
+    XCTAssertEqual(element.accessibilityElementCount(), count)
+    XCTAssertNil(element.accessibilityElement(at: count))
+    XCTAssertEqual(element.accessibilityFrameInContainerSpace,
+                   eagerElement.accessibilityFrameInContainerSpace)
+    for i in stride(from: 0, to: count, by: 7) {
+      let e1 = element.accessibilityElement(at: i) as! NSObject
+      let e2 = eagerElement.accessibilityElement(at: i) as! NSObject
+      XCTAssertEqual(element.index(ofAccessibilityElement: e1), i)
+      XCTAssertEqual(e1.accessibilityLabel, e2.accessibilityLabel)
+      XCTAssertEqual(e1.accessibilityFrame, e2.accessibilityFrame)
+      // The frame is computed from the layout bounds and must contain all subelements.
+      XCTAssert(element.accessibilityFrame.insetBy(dx: -1, dy: -1).contains(e1.accessibilityFrame))
+      XCTAssertEqual(e1.accessibilityTraits, e2.accessibilityTraits)
+    }
+  }
+
+  // Measures the accesses in the order in which VoiceOver makes them: first the element count,
+  // then the elements array and then the frames of the elements.
+  func testAccessibilityElementFirstAccessPerformance() {
+    let label = labelWithManyLinkParagraphs()
+    _ = label.accessibilityElement
+    measure {
+      for _ in 0..<10 {
+        // Resets the label's accessibility element.
+        label.accessibilityElementSeparatesLinkElements.toggle()
+        let element = label.accessibilityElement
+        _ = element.accessibilityElementCount()
+        let elements = element.accessibilityElements as NSArray?
+        for e in elements! {
+          _ = (e as! NSObject).accessibilityFrame
+        }
+      }
+    }
+  }
+}
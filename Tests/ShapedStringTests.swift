@@ -15,6 +15,8 @@ private func createTypesetter(_ string: NSAttributedString) -> CTTypesetter {
 
 class ShapedStringTests : XCTestCase {
 
+  let font = UIFont(name: "HelveticaNeue", size: 18)!
+
   // The CoreText headers state that all functions are thread-safe, but the online documentation
   // states that "layout objects (CTTypesetter, CTFramesetter, CTRun, CTLine, CTFrame,
   // and associated objects) should be used in a single operation, work queue, or thread."
@@ -122,4 +124,112 @@ class ShapedStringTests : XCTestCase {
       }
     }
   }
+
+  func testSerializationRoundTrip() {
+    let scope = STUTruncationScope(maximumNumberOfLines: 1, lastLineTruncationMode: .end,
+                                   truncationToken: NSAttributedString("…", [.font: font]))
+    let string = NSMutableAttributedString("Test link background\nSecond paragraph",
+                                           [.font: font, .foregroundColor: UIColor.red])
+    string.addAttributes([.link: URL(string: "https://example.com")!,
+                          .foregroundColor: UIColor.blue],
+                         range: NSRange(5..<9))
+    let backgroundBuilder = STUBackgroundAttributeBuilder(nil)
+    backgroundBuilder.color = UIColor.yellow
+    string.addAttribute(.stuBackground, value: STUBackgroundAttribute(backgroundBuilder),
+                        range: NSRange(10..<20))
+    string.addAttribute(.stuTruncationScope, value: scope, range: NSRange(21..<37))
+
+    let shapedString = STUShapedString(string, defaultBaseWritingDirection: .rightToLeft)
+    let data = shapedString.serializedData()!
+    let copy = STUShapedString(serializedData: data)!
+    XCTAssertEqual(copy.attributedString.string, shapedString.attributedString.string)
+    XCTAssertEqual(copy.defaultBaseWritingDirection, shapedString.defaultBaseWritingDirection)
+    XCTAssertEqual(copy.defaultBaseWritingDirectionWasUsed,
+                   shapedString.defaultBaseWritingDirectionWasUsed)
+    XCTAssertEqual(copy.serializedData()?.count, data.count)
+
+    let size = CGSize(width: 120, height: 200)
+    let tf = STUTextFrame(shapedString, size: size, displayScale: 0)
+    let tf2 = STUTextFrame(copy, size: size, displayScale: 0)
+    XCTAssertEqual(tf2.size, tf.size)
+    XCTAssertEqual(tf2.flags, tf.flags)
+    XCTAssertEqual(tf2.truncatedAttributedString.string, tf.truncatedAttributedString.string)
+    XCTAssertEqualLines(tf2, tf)
+
+    var corruptedData = data
+    corruptedData[0] ^= 1
+    XCTAssertNil(STUShapedString(serializedData: corruptedData))
+    XCTAssertNil(STUShapedString(serializedData: data.prefix(data.count - 1)))
+  }
+
+  func testTextFrameSnapshotRoundTrip() {
+    let paragraphStyle = NSMutableParagraphStyle()
+    paragraphStyle.alignment = .justified
+    paragraphStyle.firstLineHeadIndent = 10
+    let string = NSMutableAttributedString(
+                   "Justified text with a link that spans multiple lines\nTruncated paragraph text",
+                   [.font: font, .paragraphStyle: paragraphStyle])
+    string.addAttribute(.link, value: URL(string: "https://example.com")!,
+                        range: NSRange(22..<26))
+    let shapedString = STUShapedString(string)
+    let options = STUTextFrameOptions { b in
+      b.maximumNumberOfLines = 4
+      b.truncationToken = NSAttributedString("…", [.font: font, .foregroundColor: UIColor.red])
+    }
+    let tf = STUTextFrame(shapedString, size: CGSize(width: 150, height: 500), displayScale: 2,
+                          options: options)
+    XCTAssert(tf.flags.contains(.isTruncated))
+
+    let data = tf.snapshotData()!
+    let tf2 = STUTextFrame(snapshotData: data, shapedString: shapedString)!
+    XCTAssertEqualLayoutInfo(tf2.layoutInfo(frameOrigin: .zero),
+                             tf.layoutInfo(frameOrigin: .zero))
+    XCTAssertEqual(tf2.truncatedAttributedString, tf.truncatedAttributedString)
+    XCTAssertEqualLines(tf2, tf)
+    let links = tf.rectsForAllLinksInTruncatedString(frameOrigin: .zero)
+    let links2 = tf2.rectsForAllLinksInTruncatedString(frameOrigin: .zero)
+    XCTAssertEqual(links2.count, 1)
+    XCTAssertEqual(links2[0].bounds, links[0].bounds)
+    let point = CGPoint(x: 60, y: tf.lines[1].baselineOrigin.y)
+    XCTAssertEqual(tf2.rangeOfGraphemeCluster(closestTo: point, ignoringTrailingWhitespace: true,
+                                              frameOrigin: .zero).range,
+                   tf.rangeOfGraphemeCluster(closestTo: point, ignoringTrailingWhitespace: true,
+                                             frameOrigin: .zero).range)
+
+    // The snapshot can be used with a deserialized shaped string.
+    let copy = STUShapedString(serializedData: shapedString.serializedData()!)!
+    let tf3 = STUTextFrame(snapshotData: data, shapedString: copy)!
+    XCTAssertEqual(tf3.truncatedAttributedString.string, tf.truncatedAttributedString.string)
+
+    XCTAssertNil(STUTextFrame(snapshotData: data,
+                              shapedString: STUShapedString(NSAttributedString("Other string"))))
+    var corruptedData = data
+    corruptedData[0] ^= 1
+    XCTAssertNil(STUTextFrame(snapshotData: corruptedData, shapedString: shapedString))
+    XCTAssertNil(STUTextFrame(snapshotData: data.prefix(data.count - 1),
+                              shapedString: shapedString))
+  }
+
+  func testMemoryUsage() {
+    let shapedString = STUShapedString(NSAttributedString("Test string", [.font: font]))
+    let ssUsage = shapedString.memoryUsage
+    XCTAssertGreaterThan(ssUsage.inlineDataSize, ssUsage.textStyleDataSize + ssUsage.lineDataSize)
+    XCTAssertGreaterThan(ssUsage.coreTextObjectsSize, 0)
+    XCTAssertGreaterThan(ssUsage.attributedStringSize, 0)
+
+    let tf = STUTextFrame(shapedString, size: CGSize(width: 100, height: 50), displayScale: 0)
+    let usage = tf.memoryUsage
+    XCTAssertGreaterThan(usage.inlineDataSize, usage.textStyleDataSize + usage.lineDataSize)
+    XCTAssertGreaterThan(usage.coreTextObjectsSize, 0)
+    XCTAssertEqual(usage.attributedStringSize, 0)
+    XCTAssertEqual(usage.totalSize, usage.inlineDataSize + usage.coreTextObjectsSize
+                                    + usage.cacheSize)
+
+    let stats = stu_memoryStatistics()
+    XCTAssertGreaterThanOrEqual(stats.shapedStringCount, 1)
+    XCTAssertGreaterThanOrEqual(stats.textFrameCount, 1)
+    XCTAssertGreaterThanOrEqual(stats.textFrameInlineDataSize, usage.inlineDataSize)
+    XCTAssertGreaterThanOrEqual(stats.inlineDataSizeHighWaterMark,
+                                stats.shapedStringInlineDataSize + stats.textFrameInlineDataSize)
+  }
 }
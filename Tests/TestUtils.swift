@@ -79,3 +79,50 @@ public func XCTAssertEqual(_ expression1: @autoclosure () throws -> CGFloat,
   XCTAssertEqual(try expression1(), value2, accuracy: accuracyInFloat32ULP*CGFloat(Float32(value2).ulp),
                  file: file, line: line)
 }
+
+public func XCTAssertEqualLayoutInfo(_ info1: STUTextFrame.LayoutInfo,
+                                     _ info2: STUTextFrame.LayoutInfo,
+                                     file: StaticString = #file, line: UInt = #line)
+{
+  XCTAssertEqual(info1.lineCount, info2.lineCount, file: file, line: line)
+  XCTAssertEqual(info1.flags, info2.flags, file: file, line: line)
+  XCTAssertEqual(info1.layoutMode, info2.layoutMode, file: file, line: line)
+  XCTAssertEqual(info1.consistentAlignment, info2.consistentAlignment, file: file, line: line)
+  XCTAssertEqual(info1.minX, info2.minX, file: file, line: line)
+  XCTAssertEqual(info1.maxX, info2.maxX, file: file, line: line)
+  XCTAssertEqual(info1.firstBaseline, info2.firstBaseline, file: file, line: line)
+  XCTAssertEqual(info1.lastBaseline, info2.lastBaseline, file: file, line: line)
+  XCTAssertEqual(info1.firstLineHeight, info2.firstLineHeight, file: file, line: line)
+  XCTAssertEqual(info1.firstLineHeightAboveBaseline, info2.firstLineHeightAboveBaseline,
+                 file: file, line: line)
+  XCTAssertEqual(info1.lastLineHeight, info2.lastLineHeight, file: file, line: line)
+  XCTAssertEqual(info1.lastLineHeightBelowBaseline, info2.lastLineHeightBelowBaseline,
+                 file: file, line: line)
+  XCTAssertEqual(info1.lastLineHeightBelowBaselineWithoutSpacing,
+                 info2.lastLineHeightBelowBaselineWithoutSpacing, file: file, line: line)
+  XCTAssertEqual(info1.lastLineHeightBelowBaselineWithMinimalSpacing,
+                 info2.lastLineHeightBelowBaselineWithMinimalSpacing, file: file, line: line)
+  XCTAssertEqual(info1.size, info2.size, file: file, line: line)
+  XCTAssertEqual(info1.textScaleFactor, info2.textScaleFactor, file: file, line: line)
+}
+
+/// Asserts that the two text frames have the same number of lines and that corresponding lines
+/// have equal string ranges, flags and geometry.
+public func XCTAssertEqualLines(_ textFrame1: STUTextFrame, _ textFrame2: STUTextFrame,
+                                file: StaticString = #file, line: UInt = #line)
+{
+  XCTAssertEqual(textFrame1.lines.count, textFrame2.lines.count, file: file, line: line)
+  for (line1, line2) in zip(textFrame1.lines, textFrame2.lines) {
+    XCTAssertEqual(line1.rangeInOriginalString, line2.rangeInOriginalString,
+                   file: file, line: line)
+    XCTAssertEqual(line1.rangeInTruncatedString, line2.rangeInTruncatedString,
+                   file: file, line: line)
+    XCTAssertEqual(line1.textFlags, line2.textFlags, file: file, line: line)
+    XCTAssertEqual(line1.hasInsertedHyphen, line2.hasInsertedHyphen, file: file, line: line)
+    XCTAssertEqual(line1.baselineOrigin, line2.baselineOrigin, file: file, line: line)
+    XCTAssertEqual(line1.width, line2.width, file: file, line: line)
+  }
+  XCTAssertEqual(textFrame1.rects(for: textFrame1.indices, frameOrigin: .zero).bounds,
+                 textFrame2.rects(for: textFrame2.indices, frameOrigin: .zero).bounds,
+                 file: file, line: line)
+}
@@ -157,4 +157,31 @@ class TextFrameDrawingTests: SnapshotTestCase {
 
     self.checkSnapshotImage(pdfImage, referenceImage: referencePDFImage)
   }
+
+  func testGlyphDrawCallCountOfLineWithMultipleRuns() {
+    let font = UIFont(name: "HelveticaNeue", size: 18)!
+    let boldFont = UIFont(name: "HelveticaNeue-Bold", size: 18)!
+    let underline = NSUnderlineStyle.single.rawValue
+    let string = NSMutableAttributedString("One ", [.font: font, .underlineStyle: underline])
+    // The custom attribute splits the run, but doesn't affect the glyph rendering.
+    string.append(NSAttributedString("two ", [.font: font, .underlineStyle: underline,
+                                              NSAttributedString.Key("STUTestKey"): 1]))
+    string.append(NSAttributedString("three", [.font: boldFont, .underlineStyle: underline]))
+    let frame = STUTextFrame(STUShapedString(string),
+                             size: CGSize(width: 1000, height: 1000), displayScale: displayScale,
+                             options: nil)
+    XCTAssertEqual(frame.lines.count, 1)
+    let stats0 = stu_glyphDrawingStatistics()
+    _ = stu_createCGImage(size: CGSize(width: 150, height: 30), scale: displayScale,
+                          backgroundColor: UIColor.white.cgColor,
+                          STUCGImageFormat(.rgb, [.withoutAlphaChannel]),
+                          { context in
+                            frame.draw(in: context, contextBaseCTM_d: 1, pixelAlignBaselines: true)
+                          })
+    let stats1 = stu_glyphDrawingStatistics()
+    XCTAssertEqual(stats1.lineCount - stats0.lineCount, 1)
+    // The underlined glyphs are drawn run by run, but the first two runs only differ in an
+    // attribute that doesn't affect the glyph rendering and are drawn with a single call.
+    XCTAssertEqual(stats1.glyphDrawCallCount - stats0.glyphDrawCallCount, 2)
+  }
 }
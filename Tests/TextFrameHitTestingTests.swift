@@ -0,0 +1,54 @@
+// Copyright 2018 Stephan Tolksdorf
+
+import STULabelSwift
+
+import XCTest
+
+class TextFrameHitTestingTests: XCTestCase {
+
+  let font = UIFont(name: "HelveticaNeue", size: 18)!
+
+  func testLinkArrayHitTesting() {
+    let string = NSMutableAttributedString(
+                   "A long link at the start that wraps over several lines of text. "
+                   + (0..<60).map { "#tag\($0) " }.joined(),
+                   [.font: font])
+    string.addAttribute(.link, value: URL(string: "https://example.com")!,
+                        range: NSRange(2..<62))
+    var location = 64
+    for i in 0..<60 {
+      let length = "#tag\(i)".utf16.count
+      string.addAttribute(.link, value: "tag\(i)", range: NSRange(location..<location + length))
+      location += length + 1
+    }
+    let tf = STUTextFrame(STUShapedString(string), size: CGSize(width: 120, height: 10000),
+                          displayScale: 2)
+    let links = tf.rectsForAllLinksInTruncatedString(frameOrigin: CGPoint(x: 5, y: 7))
+    XCTAssertEqual(links.count, 61)
+    let shiftedLinks = tf.rectsForAllLinksInTruncatedString(frameOrigin: .zero)
+
+    let bounds = tf.layoutBounds(frameOrigin: CGPoint(x: 5, y: 7))
+    for y in stride(from: bounds.minY - 10, through: bounds.maxY + 10, by: 3.7) {
+      for x in stride(from: bounds.minX - 10, through: bounds.maxX + 10, by: 11.3) {
+        let point = CGPoint(x: x, y: y)
+        var expected: STUTextLink?
+        var minDistance: CGFloat = 5
+        for link in links {
+          if let r = link.findRect(closestTo: point, maxDistance: minDistance),
+             r.distance < minDistance || expected == nil
+          {
+            expected = link
+            minDistance = r.distance
+          }
+        }
+        XCTAssert(links.link(closestTo: point, maxDistance: 5) === expected)
+      }
+    }
+
+    for link in links {
+      XCTAssert(links.link(matching: link) === link)
+      XCTAssertEqual(shiftedLinks.link(matching: link)?.rangeInTruncatedString,
+                     link.rangeInTruncatedString)
+    }
+  }
+}
@@ -4,6 +4,8 @@ import STULabelSwift
 
 class TextFrameLayoutInfoTests : XCTestCase {
 
+  let font = UIFont(name: "HelveticaNeue", size: 18)!
+
   func testLayoutInfoConsistency(_ tf: STUTextFrame, origin: CGPoint) {
     let info0 = tf.layoutInfo(frameOrigin: origin, displayScale: nil)
     let info1 = tf.layoutInfo(frameOrigin: origin)
@@ -353,4 +355,76 @@ class TextFrameLayoutInfoTests : XCTestCase {
     })()
   }
 
+  func testLayoutInfosForMultipleFrameWidths() {
+    let paragraphStyle = NSMutableParagraphStyle()
+    paragraphStyle.alignment = .center
+    let string = NSMutableAttributedString(
+                   "Centered text that wraps onto multiple lines\nShort line",
+                   [.font: font, .paragraphStyle: paragraphStyle])
+    string.append(NSAttributedString("\nLeft-aligned paragraph", [.font: font]))
+    let shapedString = STUShapedString(string)
+    let options = STUTextFrameOptions { b in
+      b.maximumNumberOfLines = 4
+    }
+    let widths: [CGFloat] = [120, 1000, 999, 60, 300, 299.5, 20]
+    let infos = STUTextFrame.layoutInfos(for: shapedString, frameWidths: widths,
+                                         frameHeight: 1000, displayScale: 3, options: options)
+    XCTAssertEqual(infos.count, widths.count)
+    for (width, info) in zip(widths, infos) {
+      let tf = STUTextFrame(shapedString, size: CGSize(width: width, height: 1000),
+                            displayScale: 3, options: options)
+      XCTAssertEqualLayoutInfo(info, tf.layoutInfo(frameOrigin: .zero))
+    }
+    XCTAssert(STUTextFrame.layoutInfos(for: shapedString, frameWidths: [], frameHeight: 1000,
+                                       displayScale: nil).isEmpty)
+  }
+
+  private func typicalLabelShapedStrings() -> [STUShapedString] {
+    return (0..<20).map { i in
+      let text = "Label \(i): " + String(repeating: "Some typical label text. ", count: i%4 + 1)
+      return STUShapedString(NSAttributedString(text, [.font: font]))
+    }
+  }
+
+  func testLayoutInfoWithoutTextFrame() {
+    let options = STUTextFrameOptions { b in
+      b.maximumNumberOfLines = 2
+      b.truncationToken = NSAttributedString("…", [.font: font])
+    }
+    let size = CGSize(width: 150, height: 1000)
+    for shapedString in typicalLabelShapedStrings() {
+      for stringRange in [nil, NSRange(3..<shapedString.length - 1)] {
+        let info = STUTextFrame.layoutInfo(for: shapedString, stringRange: stringRange, size: size,
+                                           displayScale: 2, options: options)
+        XCTAssertEqualLayoutInfo(info, STUTextFrame(shapedString, stringRange: stringRange,
+                                                    size: size, displayScale: 2, options: options)
+                                         .layoutInfo(frameOrigin: .zero))
+      }
+    }
+  }
+
+  func testLayoutInfoWithoutTextFramePerformance() {
+    let shapedStrings = typicalLabelShapedStrings()
+    let size = CGSize(width: 150, height: 1000)
+    measure {
+      for _ in 0..<20 {
+        for shapedString in shapedStrings {
+          _ = STUTextFrame.layoutInfo(for: shapedString, size: size, displayScale: 2)
+        }
+      }
+    }
+  }
+
+  func testTextFrameCreationPerformance() {
+    let shapedStrings = typicalLabelShapedStrings()
+    let size = CGSize(width: 150, height: 1000)
+    measure {
+      for _ in 0..<20 {
+        for shapedString in shapedStrings {
+          _ = STUTextFrame(shapedString, size: size, displayScale: 2)
+                .layoutInfo(frameOrigin: .zero)
+        }
+      }
+    }
+  }
 }
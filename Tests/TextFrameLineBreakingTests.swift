@@ -431,4 +431,60 @@ class TextFrameLineBreakingTests: SnapshotTestCase {
     let f = textFrame(string, width: typographicWidth("اختباراختباراختبار"))
     self.checkSnapshotImage(image(f))
   }
+
+  func testHyphenationOpportunitiesAreCachedPerParagraph() {
+    let paragraphStyle = NSMutableParagraphStyle()
+    paragraphStyle.hyphenationFactor = 1
+    let string = NSAttributedString(
+                   "Internationalization characteristically necessitates uncharacteristically "
+                   + "comprehensive standardization.\nIncomprehensibilities notwithstanding.",
+                   [.font: font, .paragraphStyle: paragraphStyle,
+                    .stuHyphenationLocaleIdentifier: "en_US"])
+    let shapedString = STUShapedString(string)
+    XCTAssertEqual(shapedString.memoryUsage.cacheSize, 0)
+    let stats0 = stu_hyphenationStatistics()
+    let tf = STUTextFrame(shapedString, size: CGSize(width: 90, height: 1000), displayScale: 2)
+    XCTAssert(tf.lines.contains { $0.hasInsertedHyphen })
+    let stats1 = stu_hyphenationStatistics()
+    XCTAssertGreaterThan(stats1.paragraphCount, stats0.paragraphCount)
+    XCTAssertGreaterThan(stats1.hyphenationLocationQueryCount,
+                         stats0.hyphenationLocationQueryCount)
+    XCTAssertGreaterThan(stats1.cachedLookupCount, stats0.cachedLookupCount)
+    XCTAssertGreaterThan(shapedString.memoryUsage.cacheSize, 0)
+
+    let tf2 = STUTextFrame(shapedString, size: CGSize(width: 110, height: 1000), displayScale: 2)
+    XCTAssert(tf2.lines.contains { $0.hasInsertedHyphen })
+    let stats2 = stu_hyphenationStatistics()
+    // The second layout reuses the cached opportunities.
+    XCTAssertEqual(stats2.paragraphCount, stats1.paragraphCount)
+    XCTAssertEqual(stats2.hyphenationLocationQueryCount, stats1.hyphenationLocationQueryCount)
+    XCTAssertGreaterThan(stats2.cachedLookupCount, stats1.cachedLookupCount)
+  }
+
+  func testHyphenationOpportunitiesOfVeryLongParagraphsAreQueriedPerLine() {
+    let paragraphStyle = NSMutableParagraphStyle()
+    paragraphStyle.hyphenationFactor = 1
+    let string = NSAttributedString(
+                   String(repeating: "Internationalization characteristically necessitates "
+                                     + "uncharacteristically comprehensive standardization. ",
+                          count: 100),
+                   [.font: font, .paragraphStyle: paragraphStyle,
+                    .stuHyphenationLocaleIdentifier: "en_US"])
+    XCTAssertGreaterThan(string.length, 4096)
+    let shapedString = STUShapedString(string)
+    let stats0 = stu_hyphenationStatistics()
+    let options = STUTextFrameOptions { b in b.maximumNumberOfLines = 3 }
+    let tf = STUTextFrame(shapedString, size: CGSize(width: 90, height: 1000), displayScale: 2,
+                          options: options)
+    XCTAssert(tf.lines.contains { $0.hasInsertedHyphen })
+    let stats1 = stu_hyphenationStatistics()
+    // Only the laid out lines were hyphenated, and nothing was cached.
+    XCTAssertEqual(stats1.paragraphCount, stats0.paragraphCount)
+    XCTAssertGreaterThan(stats1.hyphenationLocationQueryCount,
+                         stats0.hyphenationLocationQueryCount)
+    XCTAssertLessThan(stats1.hyphenationLocationQueryCount - stats0.hyphenationLocationQueryCount,
+                      100)
+    XCTAssertEqual(shapedString.memoryUsage.cacheSize, 0)
+  }
+
 }
@@ -13,6 +13,8 @@ class TextFrameOptionsTests : XCTestCase {
     XCTAssertEqual(opts0.minimumTextScaleFactor, 1)
     XCTAssertEqual(opts0.textScalingBaselineAdjustment, .none)
     XCTAssert(opts0.lastHyphenationLocationInRangeFinder == nil)
+    XCTAssertEqual(opts0.cachesImageBounds, true)
+    XCTAssertEqual(opts0.precomputesImageBounds, false)
 
     let opts0b = STUTextFrameOptions { builder in }
     XCTAssertEqual(opts0b.textLayoutMode, .default)
@@ -25,6 +27,8 @@ class TextFrameOptionsTests : XCTestCase {
     XCTAssertEqual(opts0b.minimumTextScaleFactor, 1)
     XCTAssertEqual(opts0b.textScalingBaselineAdjustment, .none)
     XCTAssert(opts0b.lastHyphenationLocationInRangeFinder == nil)
+    XCTAssertEqual(opts0b.cachesImageBounds, true)
+    XCTAssertEqual(opts0b.precomputesImageBounds, false)
 
     let nonDefaultTruncationToken = NSAttributedString(string: "test")
     let nonDefaultTextAlignment =
@@ -44,6 +48,8 @@ class TextFrameOptionsTests : XCTestCase {
       builder.minimumTextScaleFactor = 0.25
       builder.textScalingBaselineAdjustment = .alignFirstLineXHeightCenter
       builder.lastHyphenationLocationInRangeFinder = dummyHyphenationLocationFinder
+      builder.cachesImageBounds = false
+      builder.precomputesImageBounds = true
     }
     XCTAssertEqual(opts1.textLayoutMode, .textKit)
     XCTAssertEqual(opts1.defaultTextAlignment, nonDefaultTextAlignment)
@@ -54,6 +60,8 @@ class TextFrameOptionsTests : XCTestCase {
     XCTAssertEqual(opts1.minimumTextScaleFactor, 0.25)
     XCTAssertEqual(opts1.textScalingBaselineAdjustment, .alignFirstLineXHeightCenter)
     XCTAssert(opts1.lastHyphenationLocationInRangeFinder != nil)
+    XCTAssertEqual(opts1.cachesImageBounds, false)
+    XCTAssertEqual(opts1.precomputesImageBounds, true)
 
     let opts1b = opts1.copy(updates: { (_: STUTextFrameOptionsBuilder) in })
     XCTAssertEqual(opts1b.textLayoutMode, .textKit)
@@ -65,6 +73,8 @@ class TextFrameOptionsTests : XCTestCase {
     XCTAssertEqual(opts1b.minimumTextScaleFactor, 0.25)
     XCTAssertEqual(opts1b.textScalingBaselineAdjustment, .alignFirstLineXHeightCenter)
     XCTAssert(opts1b.lastHyphenationLocationInRangeFinder != nil)
+    XCTAssertEqual(opts1b.cachesImageBounds, false)
+    XCTAssertEqual(opts1b.precomputesImageBounds, true)
 
     let opts2 = opts1b.copy { (builder) in builder.maximumNumberOfLines += 1 }
     XCTAssertEqual(opts2.textLayoutMode, .textKit)
@@ -76,6 +86,8 @@ class TextFrameOptionsTests : XCTestCase {
     XCTAssertEqual(opts2.minimumTextScaleFactor, 0.25)
     XCTAssertEqual(opts2.textScalingBaselineAdjustment, .alignFirstLineXHeightCenter)
     XCTAssert(opts2.lastHyphenationLocationInRangeFinder != nil)
+    XCTAssertEqual(opts2.cachesImageBounds, false)
+    XCTAssertEqual(opts2.precomputesImageBounds, true)
   }
 
   func testParameterClamping() {
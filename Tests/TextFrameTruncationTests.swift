@@ -1,6 +1,6 @@
 // Copyright 2018 Stephan Tolksdorf
 
-import STULabel
+import STULabelSwift
 
 import XCTest
 
@@ -134,4 +134,137 @@ class TruncationTests: SnapshotTestCase {
     }();
   }
 
+  func testTruncationTokenLinesAreSharedCorrectly() {
+    let string = NSAttributedString("A long line of text that has to be truncated.",
+                                    [.font: font, .foregroundColor: UIColor.blue])
+    let shapedString = STUShapedString(string)
+    let size = CGSize(width: 100, height: 100)
+    let customToken = NSAttributedString("[more]", [.foregroundColor: UIColor.red])
+    let options = STUTextFrameOptions { b in b.maximumNumberOfLines = 1 }
+    let options2 = STUTextFrameOptions { b in
+      b.maximumNumberOfLines = 1
+      b.truncationToken = customToken
+    }
+    // The second and fourth frames use the cached token lines of the first and third frames.
+    let frames = [options, options, options2, options2].map {
+      STUTextFrame(shapedString, size: size, displayScale: 2, options: $0)
+    }
+    XCTAssert(frames[0].truncatedAttributedString.string.hasSuffix("…"))
+    XCTAssert(frames[2].truncatedAttributedString.string.hasSuffix("[more]"))
+    XCTAssertEqual(frames[0].truncatedAttributedString, frames[1].truncatedAttributedString)
+    XCTAssertEqual(frames[2].truncatedAttributedString, frames[3].truncatedAttributedString)
+    XCTAssertEqual(frames[0].lines[0].width, frames[1].lines[0].width)
+    XCTAssertEqual(frames[2].lines[0].width, frames[3].lines[0].width)
+    let truncatedString = frames[2].truncatedAttributedString
+    let tokenStart = truncatedString.length - customToken.length
+    XCTAssertEqual(truncatedString.attribute(.foregroundColor, at: tokenStart, effectiveRange: nil)
+                     as? UIColor,
+                   UIColor.red)
+    XCTAssertNotNil(truncatedString.attribute(.font, at: tokenStart, effectiveRange: nil))
+  }
+
+  private func longSingleLineTextFrameOptions() -> STUTextFrameOptions {
+    return STUTextFrameOptions { b in
+      b.maximumNumberOfLines = 1
+      b.lastLineTruncationMode = .middle
+    }
+  }
+
+  private func longSingleLineShapedString() -> STUShapedString {
+    return STUShapedString(NSAttributedString(
+             (0..<1000).map { "/path/\($0)" }.joined() + "/file.txt", [.font: font]))
+  }
+
+  func testMiddleTruncationOfLongLine() {
+    let shapedString = longSingleLineShapedString()
+    XCTAssertGreaterThan(shapedString.attributedString.length, 9000)
+    for width in [300, 1000, 3000] as [CGFloat] {
+      let tf = STUTextFrame(shapedString, size: CGSize(width: width, height: 100),
+                            displayScale: 2, options: longSingleLineTextFrameOptions())
+      XCTAssertEqual(tf.lines.count, 1)
+      XCTAssertLessThanOrEqual(tf.lines[0].width, width)
+      // The middle truncation keeps the widths of the two remaining parts balanced.
+      XCTAssertGreaterThan(tf.lines[0].width, width*0.9)
+      let excisedRange = tf.lines[0].excisedRangeInOriginalString
+      let truncatedString = tf.truncatedAttributedString.string as NSString
+      XCTAssert(truncatedString.hasPrefix("/path/0/"))
+      XCTAssert(truncatedString.hasSuffix("/file.txt"))
+      let prefixLength = excisedRange.location
+      let suffixLength = shapedString.attributedString.length - NSMaxRange(excisedRange)
+      XCTAssertLessThan(abs(prefixLength - suffixLength), max(4, (prefixLength + suffixLength)/8))
+    }
+  }
+
+  func testMiddleTruncationOfLongLinePerformance() {
+    let shapedString = longSingleLineShapedString()
+    let options = longSingleLineTextFrameOptions()
+    measure {
+      for width in stride(from: 200, through: 2000, by: 50) as StrideThrough<CGFloat> {
+        _ = STUTextFrame(shapedString, size: CGSize(width: width, height: 100), displayScale: 2,
+                         options: options)
+      }
+    }
+  }
+
+  private func truncatedMultiParagraphTextFrame() -> STUTextFrame {
+    let string = NSAttributedString(
+                   (0..<8).map { "Paragraph \($0) with some text that wraps onto more lines." }
+                          .joined(separator: "\n"),
+                   [.font: font])
+    let options = STUTextFrameOptions { b in
+      b.maximumNumberOfLines = 9
+      b.lastLineTruncationMode = .middle
+      b.truncationToken = NSAttributedString("…", [.font: font])
+    }
+    return STUTextFrame(STUShapedString(string), size: CGSize(width: 150, height: 1000),
+                        displayScale: 2, options: options)
+  }
+
+  func testBatchIndexConversion() {
+    let tf = truncatedMultiParagraphTextFrame()
+    XCTAssert(tf.flags.contains(.isTruncated))
+    let originalLength = tf.originalAttributedString.length
+    let truncatedLength = tf.truncatedAttributedString.length
+
+    var sortedRanges = [NSRange]()
+    for location in 0...originalLength + 1 {
+      for length in [0, 1, 5, 40] {
+        sortedRanges.append(NSRange(location: location, length: length))
+      }
+    }
+    sortedRanges.append(NSRange(location: 0, length: Int.max))
+    let unsortedRanges = sortedRanges.reversed() + sortedRanges.shuffled()
+    for ranges in [sortedRanges, unsortedRanges] {
+      let frameRanges = tf.ranges(forRangesInOriginalString: ranges)
+      XCTAssertEqual(frameRanges, ranges.map { tf.range(forRangeInOriginalString: $0) })
+      XCTAssertEqual(tf.rangesInOriginalString(for: frameRanges),
+                     frameRanges.map { tf.rangeInOriginalString(for: $0) })
+    }
+
+    sortedRanges.removeAll()
+    for location in 0...truncatedLength + 1 {
+      for length in [0, 1, 7] {
+        sortedRanges.append(NSRange(location: location, length: length))
+      }
+    }
+    for ranges in [sortedRanges, sortedRanges.shuffled()] {
+      XCTAssertEqual(tf.ranges(forRangesInTruncatedString: ranges),
+                     ranges.map { tf.range(forRangeInTruncatedString: $0) })
+    }
+
+    XCTAssertEqual(tf.ranges(forRangesInOriginalString: []), [])
+    XCTAssertEqual(tf.rangesInOriginalString(for: []), [])
+  }
+
+  func testBatchIndexConversionPerformance() {
+    let tf = truncatedMultiParagraphTextFrame()
+    let ranges = (0..<tf.originalAttributedString.length).map {
+                   NSRange(location: $0, length: 3)
+                 }
+    measure {
+      for _ in 0..<100 {
+        _ = tf.ranges(forRangesInOriginalString: ranges)
+      }
+    }
+  }
 }